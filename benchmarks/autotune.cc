@@ -0,0 +1,94 @@
+//---- benchmarks/autotune.cc ------------------------------ -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  autotune.cc
+/// \brief Tunes the unroll factor, thread count and grain of the tunable
+///        kernels on this machine, and saves the fastest parameters to the
+///        tuning cache, which the kernels load when they are first used.
+///        This is run once per machine (or after an upgrade), with the 
+///        --filter, --repetitions, --size and --cache options of 
+///        benchmark.hpp.
+//
+//---------------------------------------------------------------------------//
+
+#include "benchmark.hpp"
+#include "snap/algorithm/metrics.hpp"
+#include "snap/algorithm/statistics.hpp"
+#include "snap/utility/tuning.hpp"
+#include <functional>
+#include <random>
+
+using namespace snap;
+
+namespace {
+
+/// Prevents the compiler from removing the computation of \p value.
+template <typename T>
+void keep(const T& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+/// Fills \p data with \p n random bytes.
+void randomize(uint8_t* data, size_t n, std::mt19937& gen) {
+  std::uniform_int_distribution<int> value(0, 255);
+  for (size_t i = 0; i < n; ++i)
+    data[i] = static_cast<uint8_t>(value(gen));
+}
+
+} // namespace anon
+
+int main(int argc, char** argv) {
+  const auto options = bench::parse_options(argc, argv);
+  const auto path    = 
+    options.cache.empty() ? util::tune::cache_path() : options.cache;
+
+  const size_t rows = options.rows, cols = options.cols;
+  std::mt19937 gen(42);
+  Matrix<mat::FM_GREY_8> a(rows, cols), b(rows, cols);
+  randomize(a.data(), a.size(), gen);
+  randomize(b.data(), b.size(), gen);
+
+  const auto policy = EP_PARALLEL;
+  const std::pair<const char*, std::function<void()>> kernels[] = {
+    {"alg::sum"           , [&] { keep(alg::sum(a, policy));            }},
+    {"alg::mean_stddev"   , [&] { keep(alg::mean_stddev(a, policy));    }},
+    {"alg::min_max_loc"   , [&] { keep(alg::min_max_loc(a, policy));    }},
+    {"alg::count_non_zero", [&] { keep(alg::count_non_zero(a, policy)); }},
+    {"alg::sad"           , [&] { keep(alg::sad(a, b, policy));         }},
+    {"alg::ssd"           , [&] { keep(alg::ssd(a, b, policy));         }}
+  };
+
+  const auto candidates = util::tune::default_candidates();
+  std::printf("Tuning for %s with %zu candidates\n", 
+    util::tune::machine_profile().c_str(), candidates.size());
+  std::printf("%-22s %7s %8s %9s %10s %10s %8s\n", "kernel", "unroll", 
+    "threads", "grain", "best us", "default us", "speedup");
+
+  for (const auto& kernel : kernels) {
+    if (std::string(kernel.first).find(options.filter) == std::string::npos)
+      continue;
+    const auto result = util::tune::tune(kernel.first, 
+      alg::detail::DEFAULT_TUNING, candidates, kernel.second, 
+      options.repetitions);
+    std::printf("%-22s %7u %8u %9llu %10.1f %10.1f %7.2fx\n", kernel.first,
+      result.best.unroll, result.best.threads, 
+      static_cast<unsigned long long>(result.best.grain), 
+      result.seconds * 1e6, result.baseline * 1e6, 
+      result.baseline / result.seconds);
+  }
+
+  if (!util::tune::save(path)) {
+    std::fprintf(stderr, "Can't write the tuning cache %s\n", path.c_str());
+    return 1;
+  }
+  std::printf("Saved the tuning cache %s\n", path.c_str());
+  return 0;
+}
@@ -0,0 +1,251 @@
+//---- benchmarks/benchmark.hpp ---------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  benchmark.hpp
+/// \brief Defines a small harness for benchmarking kernels, which times 
+///        repetitions of each kernel and optionally reads the hardware 
+///        counters, so that the time per pixel can be explained by the 
+///        cycles, instructions and cache misses per pixel.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_BENCHMARKS_BENCHMARK_HPP
+#define SNAP_BENCHMARKS_BENCHMARK_HPP
+
+#include "snap/utility/hardware_counters.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+using snap::util::perf::CounterValues;
+using snap::util::perf::HardwareCounters;
+
+/// Defines the options for running the benchmarks.
+struct Options {
+  bool        counters    = false;  //!< If the hardware counters are read.
+  std::string filter      = "";     //!< Only run benchmarks with this text.
+  size_t      repetitions = 11;     //!< The number of timed repetitions.
+  double      minSeconds  = 0.01;   //!< The min time of each repetition.
+  size_t      rows        = 1080;   //!< The number of rows of the images.
+  size_t      cols        = 1920;   //!< The number of columns of the images.
+  bool        save        = false;  //!< If the results are saved as baseline.
+  bool        compare     = false;  //!< If the results are compared.
+  double      threshold   = 0.1;    //!< The relative slowdown which regresses.
+  std::string baselineDir = ".";    //!< The directory of the baselines.
+  std::string profile     = "";     //!< The machine profile, if not detected.
+  std::string cache       = "";     //!< The tuning cache, if not the default.
+};
+
+/// Defines the result of a benchmark.
+struct Result {
+  std::string         name;        //!< The name of the benchmark.
+  size_t              pixels;      //!< The pixels processed per call.
+  size_t              bytes;       //!< The bytes read and written per call.
+  size_t              iterations;  //!< The calls per repetition.
+  std::vector<double> seconds;     //!< The time per call of each repetition.
+  CounterValues       counters;    //!< The counts over all repetitions.
+
+  /// Returns the median of the time per call of the repetitions.
+  double median() const {
+    auto sorted = seconds;
+    std::sort(sorted.begin(), sorted.end());
+    const size_t n = sorted.size();
+    return n == 0 ? 0.0 : n % 2 == 1 
+      ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+  }
+
+  /// Returns the count of \p event per pixel, over all the calls.
+  /// \param[in] event The event to get the count of.
+  double perPixel(snap::util::perf::HardwareEvent event) const {
+    const double calls = double(iterations) * seconds.size();
+    return double(counters.value[event]) / (calls * pixels);
+  }
+};
+
+/// Parses the options from the command line arguments, which are:
+///
+///   --counters          Read the hardware counters.
+///   --filter=TEXT       Only run benchmarks whose name contains TEXT.
+///   --repetitions=N     Time N repetitions of each benchmark.
+///   --min-time=SECONDS  The min time of each repetition.
+///   --size=COLSxROWS    The size of the images.
+///   --save-baseline     Save the results as the baseline for the profile.
+///   --compare           Compare the results with the baseline for the 
+///                       profile, and fail if any benchmark regressed.
+///   --threshold=PCT     The slowdown, in percent, which is a regression.
+///   --baseline-dir=DIR  The directory of the baseline files.
+///   --profile=NAME      The machine profile, instead of the detected one.
+///   --cache=PATH        The tuning cache file, instead of the default one.
+///
+/// \param[in] argc The number of arguments.
+/// \param[in] argv The arguments.
+static inline Options parse_options(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    auto value = [&] (const char* prefix) -> const char* {
+      const size_t n = std::strlen(prefix);
+      return arg.compare(0, n, prefix) == 0 ? argv[i] + n : nullptr;
+    };
+
+    if (arg == "--counters") {
+      options.counters = true;
+    } else if (const char* v = value("--filter=")) {
+      options.filter = v;
+    } else if (const char* v = value("--repetitions=")) {
+      options.repetitions = std::max(1, std::atoi(v));
+    } else if (const char* v = value("--min-time=")) {
+      options.minSeconds = std::atof(v);
+    } else if (const char* v = value("--size=")) {
+      unsigned cols = 0, rows = 0;
+      if (std::sscanf(v, "%ux%u", &cols, &rows) == 2 && cols && rows) {
+        options.cols = cols;
+        options.rows = rows;
+      }
+    } else if (arg == "--save-baseline") {
+      options.save = true;
+    } else if (arg == "--compare") {
+      options.compare = true;
+    } else if (const char* v = value("--threshold=")) {
+      options.threshold = std::atof(v) / 100.0;
+    } else if (const char* v = value("--baseline-dir=")) {
+      options.baselineDir = v;
+    } else if (const char* v = value("--profile=")) {
+      options.profile = v;
+    } else if (const char* v = value("--cache=")) {
+      options.cache = v;
+    } else {
+      std::cerr << "Unknown option: " << arg << "\n";
+      std::exit(1);
+    }
+  }
+  return options;
+}
+
+/// Defines a harness which runs benchmarks and collects their results.
+class Harness {
+ public:
+  /// Constructor: Creates a harness with \p options, and opens the hardware
+  /// counters if they are requested. If they are not available, the reason
+  /// is reported and the benchmarks are only timed.
+  /// \param[in] options The options for the benchmarks.
+  explicit Harness(const Options& options) : Opts(options) {
+    if (Opts.counters && !Counters.open()) {
+      std::cerr << "Hardware counters are unavailable (" << Counters.error()
+                << "), only timing the benchmarks.\n";
+    }
+  }
+
+  /// Returns the options of the harness.
+  const Options& options() const { return Opts; }
+
+  /// Returns the results of the benchmarks which have been run.
+  const std::vector<Result>& results() const { return Results; }
+
+  /// Runs the benchmark \p name, which calls \p f, where each call processes
+  /// \p pixels pixels and reads and writes \p bytes bytes. The benchmark is
+  /// skipped if it does not match the filter.
+  /// \param[in] name   The name of the benchmark.
+  /// \param[in] pixels The number of pixels processed by each call.
+  /// \param[in] bytes  The number of bytes read and written by each call.
+  /// \param[in] f      The function to benchmark.
+  template <typename F>
+  void run(const std::string& name, size_t pixels, size_t bytes, F&& f) {
+    using Clock = std::chrono::steady_clock;
+    if (name.find(Opts.filter) == std::string::npos)
+      return;
+
+    auto elapsed = [] (Clock::time_point start) {
+      return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    // Warm up, and find the number of calls for a repetition to take at
+    // least the min time.
+    size_t iterations = 1;
+    for (;;) {
+      const auto start = Clock::now();
+      for (size_t i = 0; i < iterations; ++i) f();
+      if (elapsed(start) >= Opts.minSeconds || iterations >= (1u << 30))
+        break;
+      iterations *= 2;
+    }
+
+    Result result{name, pixels, bytes, iterations, {}, CounterValues()};
+    Counters.start();
+    for (size_t r = 0; r < Opts.repetitions; ++r) {
+      const auto start = Clock::now();
+      for (size_t i = 0; i < iterations; ++i) f();
+      result.seconds.push_back(elapsed(start) / iterations);
+    }
+    result.counters = Counters.stop();
+
+    print(std::cout, result);
+    Results.push_back(result);
+  }
+
+  /// Prints the header of the table of results to \p stream.
+  /// \param[in] stream The stream to print to.
+  void printHeader(std::ostream& stream) const {
+    char line[160];
+    std::snprintf(line, sizeof(line), 
+      "%-32s %9s %8s %8s %6s %11s %11s %11s\n", "benchmark", "ns/px", 
+      "GB/s", "cyc/px", "IPC", "L1miss/kpx", "LLCmiss/kpx", "brmiss/kpx");
+    stream << line;
+  }
+
+ private:
+  Options             Opts;      //!< The options for the benchmarks.
+  HardwareCounters    Counters;  //!< The hardware counters.
+  std::vector<Result> Results;   //!< The results of the benchmarks.
+
+  /// Prints \p result as a row of the table of results to \p stream, where
+  /// the counts which are not available are printed as -.
+  /// \param[in] stream The stream to print to.
+  /// \param[in] result The result to print.
+  static void print(std::ostream& stream, const Result& result) {
+    using namespace snap::util::perf;
+    auto counter = [&] (HardwareEvent event, double scale, char* out) {
+      if (result.counters.has(event)) 
+        std::snprintf(out, 16, "%.3f", result.perPixel(event) * scale);
+      else
+        std::snprintf(out, 16, "-");
+    };
+
+    char cycles[16], l1[16], llc[16], branches[16], ipc[16];
+    counter(HE_CYCLES       , 1.0   , cycles);
+    counter(HE_L1D_MISSES   , 1000.0, l1);
+    counter(HE_LLC_MISSES   , 1000.0, llc);
+    counter(HE_BRANCH_MISSES, 1000.0, branches);
+    if (result.counters.has(HE_CYCLES) && result.counters.has(HE_INSTRUCTIONS))
+      std::snprintf(ipc, sizeof(ipc), "%.2f", result.counters.ipc());
+    else
+      std::snprintf(ipc, sizeof(ipc), "-");
+
+    const double median = result.median();
+    char line[160];
+    std::snprintf(line, sizeof(line), 
+      "%-32s %9.3f %8.2f %8s %6s %11s %11s %11s\n", result.name.c_str(), 
+      median * 1e9 / result.pixels, result.bytes / median * 1e-9, cycles,
+      ipc, l1, llc, branches);
+    stream << line;
+  }
+};
+
+} // namespace bench
+
+#endif // SNAP_BENCHMARKS_BENCHMARK_HPP
@@ -0,0 +1,208 @@
+//---- benchmarks/kernel_benchmarks.cc --------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  kernel_benchmarks.cc
+/// \brief Benchmarks the snap kernels on random images, serially and in
+///        parallel. See benchmark.hpp for the command line options, and
+///        regression.hpp for the baseline comparison.
+//
+//---------------------------------------------------------------------------//
+
+#include "benchmark.hpp"
+#include "regression.hpp"
+#include "snap/algorithm/binary.hpp"
+#include "snap/algorithm/blend.hpp"
+#include "snap/algorithm/components.hpp"
+#include "snap/algorithm/edges.hpp"
+#include "snap/algorithm/features.hpp"
+#include "snap/algorithm/filter.hpp"
+#include "snap/algorithm/match.hpp"
+#include "snap/algorithm/metrics.hpp"
+#include "snap/algorithm/motion.hpp"
+#include "snap/algorithm/preprocess.hpp"
+#include "snap/algorithm/statistics.hpp"
+#include "snap/algorithm/transform.hpp"
+#include "snap/algorithm/warp.hpp"
+#include <random>
+
+using namespace snap;
+
+namespace {
+
+/// Prevents the compiler from removing the computation of \p value.
+template <typename T>
+void keep(const T& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+/// Fills \p data with \p n random bytes.
+void randomize(uint8_t* data, size_t n, std::mt19937& gen) {
+  std::uniform_int_distribution<int> value(0, 255);
+  for (size_t i = 0; i < n; ++i)
+    data[i] = static_cast<uint8_t>(value(gen));
+}
+
+} // namespace anon
+
+int main(int argc, char** argv) {
+  const auto     options = bench::parse_options(argc, argv);
+  bench::Harness harness(options);
+
+  const size_t rows = options.rows, cols = options.cols, n = rows * cols;
+  std::mt19937 gen(7);
+
+  Matrix<mat::FM_GREY_8> a(rows, cols), b(rows, cols), out(rows, cols);
+  Matrix<mat::FM_GREY_8> half(rows / 2, cols / 2);
+  Matrix<mat::FM_BGR_24> bgr(rows, cols);
+  std::vector<float>     tensor(3 * n);
+  randomize(a.data(), n, gen);
+  randomize(b.data(), n, gen);
+  randomize(bgr.data(), 3 * n, gen);
+
+  // A premultiplied layer to composite onto a frame.
+  Matrix<mat::FM_BGRA_32> layer(rows, cols), frame(rows, cols);
+  randomize(layer.data(), 4 * n, gen);
+  randomize(frame.data(), 4 * n, gen);
+  alg::premultiply(layer, layer);
+
+  const float mean[3]   = {104.0f, 117.0f, 124.0f};
+  const float stddev[3] = {57.0f, 57.0f, 58.0f};
+  std::vector<uint32_t>          blocks;
+  std::vector<alg::MotionVector> field;
+  std::vector<int16_t>           dx(n), dy(n);
+  alg::FastParams                fastParams;
+  fastParams.threshold = 40;
+  alg::FastDetector              fast(fastParams);
+  alg::KeyPoints                 keypoints(1 << 16);
+  std::vector<alg::Blob>         blobs;
+  std::vector<uint32_t>          labels(n);
+  alg::ComponentLabeler          labeler;
+
+  // A sparse mask of the brightest pixels of a, for the labeling.
+  Matrix<mat::FM_GREY_8> mask(rows, cols);
+  for (size_t i = 0; i < n; ++i)
+    mask.data()[i] = a.data()[i] > 200 ? 255 : 0;
+  Matrix<mat::FM_BIN_1> bits(rows, cols), otherBits(rows, cols);
+  Matrix<mat::FM_BIN_1> bitsOut(rows, cols);
+  alg::pack(mask, bits);
+  alg::pack(b, otherBits);
+
+  // A rotation by 10 degrees about the center, for the warps.
+  const double angle  = 10.0 * 3.14159265358979 / 180.0;
+  const double rotate[6] = {
+    std::cos(angle), -std::sin(angle), 
+    cols / 2.0 * (1 - std::cos(angle)) + rows / 2.0 * std::sin(angle),
+    std::sin(angle),  std::cos(angle), 
+    rows / 2.0 * (1 - std::cos(angle)) - cols / 2.0 * std::sin(angle)};
+
+  // A 32x32 template cut from a, for the template matching.
+  Matrix<mat::FM_GREY_8> templ(32, 32);
+  for (size_t r = 0; r < 32; ++r)
+    for (size_t c = 0; c < 32; ++c)
+      templ.data()[r * templ.stride() + c] =
+        a.data()[(rows / 2 + r) * a.stride() + cols / 2 + c];
+
+  harness.printHeader(std::cout);
+  for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+    const std::string s = policy == EP_SERIAL ? "" : ".parallel";
+
+    harness.run("sum" + s, n, n, [&] { keep(alg::sum(a, policy)); });
+    harness.run("mean_stddev" + s, n, n, [&] { 
+      keep(alg::mean_stddev(a, policy)); 
+    });
+    harness.run("min_max_loc" + s, n, n, [&] { 
+      keep(alg::min_max_loc(a, policy)); 
+    });
+    harness.run("count_non_zero" + s, n, n, [&] { 
+      keep(alg::count_non_zero(a, policy)); 
+    });
+    harness.run("sad" + s, n, 2 * n, [&] { keep(alg::sad(a, b, policy)); });
+    harness.run("ssd" + s, n, 2 * n, [&] { keep(alg::ssd(a, b, policy)); });
+    harness.run("ssim" + s, n, 2 * n, [&] { keep(alg::ssim(a, b, policy)); });
+    harness.run("sad_blocks<16>" + s, n, 2 * n, [&] { 
+      alg::sad_blocks<16>(a, b, blocks, policy); keep(blocks[0]);
+    });
+    harness.run("fill" + s, n, n, [&] { 
+      alg::fill(out, 0x3c, policy); keep(out.data()[0]);
+    });
+    harness.run("copy" + s, n, 2 * n, [&] { 
+      alg::copy(a, out, policy); keep(out.data()[0]);
+    });
+    harness.run("absdiff" + s, n, 3 * n, [&] { 
+      alg::absdiff(a, b, out, policy); keep(out.data()[0]);
+    });
+    harness.run("estimate_motion<16>" + s, n, 2 * n, [&] { 
+      alg::estimate_motion<16>(a, b, field, alg::SM_DIAMOND, 16, policy); 
+      keep(field[0]);
+    });
+    harness.run("convert" + s, n, 4 * n, [&] { 
+      alg::convert(bgr, out, policy); keep(out.data()[0]);
+    });
+    harness.run("resize.half" + s, half.size(), n + half.size(), [&] { 
+      alg::resize(a, half, policy); keep(half.data()[0]);
+    });
+    harness.run("to_tensor.chw" + s, n, 15 * n, [&] { 
+      alg::to_tensor(bgr, tensor.data(), mean, stddev, alg::TL_CHW, policy);
+      keep(tensor[0]);
+    });
+    harness.run("sobel" + s, n, 5 * n, [&] { 
+      alg::sobel(a, dx.data(), dy.data(), policy); keep(dx[0]);
+    });
+    harness.run("fast9" + s, n, n, [&] { 
+      keypoints.clear();
+      keep(fast.detect(a, keypoints, 0, 1.0f, policy));
+    });
+    harness.run("label_components" + s, n, 5 * n, [&] { 
+      keep(labeler.label(mask, labels.data(), blobs, policy));
+    });
+    const size_t bitBytes = bits.rows() * bits.stride();
+    harness.run("pack" + s, n, n + bitBytes, [&] { 
+      alg::pack(mask, bitsOut, policy); keep(bitsOut.data()[0]);
+    });
+    harness.run("bitwise_and.bin" + s, n, 3 * bitBytes, [&] { 
+      alg::bitwise_and(bits, otherBits, bitsOut, policy); 
+      keep(bitsOut.data()[0]);
+    });
+    harness.run("count_non_zero.bin" + s, n, bitBytes, [&] { 
+      keep(alg::count_non_zero(bits, policy)); 
+    });
+    harness.run("dilate.bin" + s, n, 2 * bitBytes, [&] { 
+      alg::dilate(bits, bitsOut, alg::CN_8, policy); keep(bitsOut.data()[0]);
+    });
+    harness.run("warp_affine" + s, n, 2 * n, [&] { 
+      alg::warp_affine(a, out, rotate, alg::BM_CONSTANT, 0, policy); 
+      keep(out.data()[0]);
+    });
+    harness.run("median.r1" + s, n, 2 * n, [&] { 
+      alg::median(a, out, 1, alg::BM_REPLICATE, 0, policy); 
+      keep(out.data()[0]);
+    });
+    harness.run("median.r7" + s, n, 2 * n, [&] { 
+      alg::median(a, out, 7, alg::BM_REPLICATE, 0, policy); 
+      keep(out.data()[0]);
+    });
+    harness.run("canny" + s, n, 2 * n, [&] { 
+      alg::canny(a, out, 80, 240, policy); keep(out.data()[0]);
+    });
+    harness.run("blend.over" + s, n, 12 * n, [&] { 
+      alg::blend(layer, frame, alg::BL_OVER, alg::AM_PREMULTIPLIED, policy); 
+      keep(frame.data()[0]);
+    });
+    harness.run("blend.over.straight" + s, n, 12 * n, [&] { 
+      alg::blend(layer, frame, alg::BL_OVER, alg::AM_STRAIGHT, policy); 
+      keep(frame.data()[0]);
+    });
+    harness.run("find_template.ncc" + s, n, n, [&] { 
+      keep(alg::find_template(a, templ, alg::MM_NCC, 2, policy)); 
+    });
+  }
+  return bench::regression_gate(options, harness.results());
+}
@@ -0,0 +1,361 @@
+//---- benchmarks/regression.hpp --------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  regression.hpp
+/// \brief Defines the performance regression gate for the benchmarks. The
+///        results of a run are saved as a JSON baseline for the machine 
+///        profile, and later runs are compared against the baseline. A
+///        benchmark regresses when its median time is slower than the 
+///        baseline by more than the threshold, and the difference is larger
+///        than the noise of both runs, measured by the median absolute 
+///        deviation (MAD) of the repetitions.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_BENCHMARKS_REGRESSION_HPP
+#define SNAP_BENCHMARKS_REGRESSION_HPP
+
+#include "benchmark.hpp"
+#include "snap/utility/tuning.hpp"
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace bench {
+
+/// Defines the factor which scales the MAD to the standard deviation of 
+/// normally distributed timings.
+static constexpr double MAD_TO_STDDEV = 1.4826;
+
+/// Defines how many (scaled) MADs of combined noise a difference must 
+/// exceed to be significant.
+static constexpr double NOISE_FACTOR = 3.0;
+
+/// Defines the baseline result of a benchmark.
+struct BaselineEntry {
+  std::string name;         //!< The name of the benchmark.
+  size_t      pixels;       //!< The pixels processed per call.
+  size_t      repetitions;  //!< The number of repetitions.
+  double      median;       //!< The median time per call, in seconds.
+  double      mad;          //!< The MAD of the time per call, in seconds.
+};
+
+/// Defines a baseline, which is the results of a run on a machine profile.
+struct Baseline {
+  std::string                          profile;  //!< The machine profile.
+  std::map<std::string, BaselineEntry> entries;  //!< The results by name.
+};
+
+/// Defines the possible outcomes of comparing a benchmark to its baseline.
+enum RegressionStatus : uint8_t {
+  RS_SAME      = 0,   //!< Within the threshold or the noise.
+  RS_FASTER    = 1,   //!< Significantly faster than the baseline.
+  RS_SLOWER    = 2,   //!< Significantly slower: a regression.
+  RS_NEW       = 3,   //!< Not in the baseline.
+  RS_MISMATCH  = 4    //!< Run with a different image size.
+};
+
+/// Defines the comparison of a benchmark with its baseline.
+struct Comparison {
+  std::string      name;      //!< The name of the benchmark.
+  double           baseline;  //!< The baseline median, in seconds.
+  double           current;   //!< The current median, in seconds.
+  double           change;    //!< The relative change of the median.
+  double           noise;     //!< The significant difference, in seconds.
+  RegressionStatus status;    //!< The outcome of the comparison.
+};
+
+namespace detail {
+
+/// Returns the median of \p values.
+/// \param[in] values The values to get the median of.
+static inline double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  const size_t n = values.size();
+  return n == 0 ? 0.0 : n % 2 == 1 
+    ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+/// Returns \p text as the contents of a JSON string, with the quotes and
+/// backslashes escaped.
+/// \param[in] text The text to escape.
+static inline std::string escape(const std::string& text) {
+  std::string result;
+  for (const char c : text) {
+    if (c == '"' || c == '\\') result += '\\';
+    result += c;
+  }
+  return result;
+}
+
+/// Defines a reader for the subset of JSON written by write_baseline: 
+/// objects, arrays, strings without unicode escapes, and numbers.
+class JsonReader {
+ public:
+  /// Constructor: Creates a reader for \p text.
+  /// \param[in] text The JSON text.
+  explicit JsonReader(const std::string& text) : Text(text), Pos(0) {}
+
+  /// Reads an object, calling \p onKey(key) for each key, which must read
+  /// the value. Returns false if the text is not a valid object.
+  /// \param[in] onKey The function which reads the value of each key.
+  template <typename F>
+  bool object(F&& onKey) {
+    if (!consume('{')) return false;
+    if (consume('}')) return true;
+    do {
+      std::string key;
+      if (!string(key) || !consume(':') || !onKey(key)) return false;
+    } while (consume(','));
+    return consume('}');
+  }
+
+  /// Reads an array, calling \p onElement() for each element, which must
+  /// read the element. Returns false if the text is not a valid array.
+  /// \param[in] onElement The function which reads each element.
+  template <typename F>
+  bool array(F&& onElement) {
+    if (!consume('[')) return false;
+    if (consume(']')) return true;
+    do {
+      if (!onElement()) return false;
+    } while (consume(','));
+    return consume(']');
+  }
+
+  /// Reads a string into \p value. Returns false if there is no string.
+  /// \param[in] value The string which is read.
+  bool string(std::string& value) {
+    if (!consume('"')) return false;
+    value.clear();
+    while (Pos < Text.size() && Text[Pos] != '"') {
+      if (Text[Pos] == '\\' && Pos + 1 < Text.size()) ++Pos;
+      value += Text[Pos++];
+    }
+    return consume('"');
+  }
+
+  /// Reads a number into \p value. Returns false if there is no number.
+  /// \param[in] value The number which is read.
+  bool number(double& value) {
+    skip();
+    const char* start = Text.c_str() + Pos;
+    char*       end   = nullptr;
+    value = std::strtod(start, &end);
+    Pos  += end - start;
+    return end != start;
+  }
+
+  /// Returns true if only whitespace is left.
+  bool done() { skip(); return Pos == Text.size(); }
+
+ private:
+  const std::string& Text;  //!< The JSON text.
+  size_t             Pos;   //!< The position of the next character.
+
+  /// Skips any whitespace.
+  void skip() {
+    while (Pos < Text.size() && std::isspace(
+             static_cast<unsigned char>(Text[Pos]))) 
+      ++Pos;
+  }
+
+  /// Consumes \p c, if it is the next character after any whitespace.
+  /// \param[in] c The character to consume.
+  bool consume(char c) {
+    skip();
+    if (Pos == Text.size() || Text[Pos] != c) return false;
+    ++Pos;
+    return true;
+  }
+};
+
+} // namespace detail
+
+/// Returns the median absolute deviation of the time per call of the
+/// repetitions of \p result.
+/// \param[in] result The result to get the MAD of.
+static inline double mad(const Result& result) {
+  const double m = result.median();
+  std::vector<double> deviations;
+  for (const auto seconds : result.seconds)
+    deviations.push_back(std::abs(seconds - m));
+  return detail::median(deviations);
+}
+
+/// Writes the \p results for machine \p profile as a JSON baseline to the 
+/// file at \p path. Returns false if the file can't be written.
+/// \param[in] path    The path of the baseline file.
+/// \param[in] profile The machine profile.
+/// \param[in] results The results to write.
+static inline bool write_baseline(const std::string&         path   , 
+                                  const std::string&         profile,
+                                  const std::vector<Result>& results) {
+  std::ofstream file(path);
+  file.precision(9);
+  file << "{\n  \"profile\": \"" << detail::escape(profile) 
+       << "\",\n  \"benchmarks\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto& r = results[i];
+    file << (i == 0 ? "\n" : ",\n") 
+         << "    {\"name\": \"" << detail::escape(r.name) 
+         << "\", \"pixels\": " << r.pixels
+         << ", \"repetitions\": " << r.seconds.size() 
+         << ", \"median\": " << r.median() << ", \"mad\": " << mad(r) << "}";
+  }
+  file << "\n  ]\n}\n";
+  return bool(file);
+}
+
+/// Reads the JSON baseline in the file at \p path into \p baseline. Returns
+/// false if the file can't be read or is not a valid baseline.
+/// \param[in] path     The path of the baseline file.
+/// \param[in] baseline The baseline which is read.
+static inline bool read_baseline(const std::string& path, Baseline& baseline) {
+  std::ifstream file(path);
+  if (!file) return false;
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  const std::string text = buffer.str();
+
+  detail::JsonReader json(text);
+  baseline = Baseline();
+  auto readEntry = [&] {
+    BaselineEntry entry{"", 0, 0, 0.0, 0.0};
+    double pixels = 0.0, repetitions = 0.0;
+    const bool valid = json.object([&] (const std::string& key) {
+      if (key == "name")        return json.string(entry.name);
+      if (key == "pixels")      return json.number(pixels);
+      if (key == "repetitions") return json.number(repetitions);
+      if (key == "median")      return json.number(entry.median);
+      if (key == "mad")         return json.number(entry.mad);
+      return false;
+    });
+    entry.pixels      = size_t(pixels);
+    entry.repetitions = size_t(repetitions);
+    baseline.entries[entry.name] = entry;
+    return valid;
+  };
+
+  return json.object([&] (const std::string& key) {
+    if (key == "profile")    return json.string(baseline.profile);
+    if (key == "benchmarks") return json.array(readEntry);
+    return false;
+  }) && json.done();
+}
+
+/// Compares the \p results with the \p baseline. A benchmark is slower or
+/// faster when its median differs from the baseline median by more than
+/// \p threshold of the baseline median, and by more than NOISE_FACTOR 
+/// times the combined scaled MAD of both runs.
+/// \param[in] baseline  The baseline to compare with.
+/// \param[in] results   The results of the current run.
+/// \param[in] threshold The relative change which is significant.
+static inline std::vector<Comparison> compare(
+    const Baseline& baseline, const std::vector<Result>& results, 
+    double threshold) {
+  std::vector<Comparison> comparisons;
+  for (const auto& result : results) {
+    const double current = result.median();
+    const auto   it      = baseline.entries.find(result.name);
+    if (it == baseline.entries.end()) {
+      comparisons.push_back({result.name, 0.0, current, 0.0, 0.0, RS_NEW});
+      continue;
+    }
+
+    const auto&  base   = it->second;
+    const double change = base.median > 0.0 
+      ? (current - base.median) / base.median : 0.0;
+    const double noise  = NOISE_FACTOR * MAD_TO_STDDEV * 
+      std::sqrt(base.mad * base.mad + mad(result) * mad(result));
+    const double diff   = current - base.median;
+
+    RegressionStatus status = RS_SAME;
+    if (base.pixels != result.pixels)
+      status = RS_MISMATCH;
+    else if (change >  threshold && diff >  noise)
+      status = RS_SLOWER;
+    else if (change < -threshold && -diff > noise)
+      status = RS_FASTER;
+    comparisons.push_back(
+      {result.name, base.median, current, change, noise, status});
+  }
+  return comparisons;
+}
+
+/// Prints the \p comparisons to \p stream, and returns the number of 
+/// regressions.
+/// \param[in] stream      The stream to print to.
+/// \param[in] comparisons The comparisons to print.
+static inline size_t report(std::ostream&                  stream     , 
+                            const std::vector<Comparison>& comparisons) {
+  static const char* names[] = {"ok", "faster", "SLOWER", "new", "size"};
+
+  size_t regressions = 0;
+  char   line[160];
+  std::snprintf(line, sizeof(line), "%-32s %12s %12s %9s %12s  %s\n", 
+    "benchmark", "base ns", "current ns", "change", "noise ns", "status");
+  stream << line;
+  for (const auto& c : comparisons) {
+    std::snprintf(line, sizeof(line), 
+      "%-32s %12.1f %12.1f %8.1f%% %12.1f  %s\n", c.name.c_str(), 
+      c.baseline * 1e9, c.current * 1e9, c.change * 100.0, c.noise * 1e9, 
+      names[c.status]);
+    stream << line;
+    regressions += c.status == RS_SLOWER;
+  }
+  return regressions;
+}
+
+/// Runs the regression gate for the \p results with the \p options: saves
+/// the results as the baseline when options.save is set, and compares the
+/// results with the baseline when options.compare is set. Returns the exit
+/// code for the run, which is non-zero if there are regressions, or if the
+/// baseline can't be read or written.
+/// \param[in] options The options of the run.
+/// \param[in] results The results of the run.
+static inline int regression_gate(const Options&             options,
+                                  const std::vector<Result>& results) {
+  const std::string profile = options.profile.empty() 
+    ? snap::util::tune::machine_profile() : options.profile;
+  const std::string path    = options.baselineDir + "/" + profile + ".json";
+
+  if (options.compare) {
+    Baseline baseline;
+    if (!read_baseline(path, baseline)) {
+      std::cerr << "Can't read the baseline " << path << "\n";
+      return 2;
+    }
+    std::cout << "\nComparing with the baseline " << path << "\n";
+    const size_t regressions = 
+      report(std::cout, compare(baseline, results, options.threshold));
+    if (regressions > 0) {
+      std::cout << regressions << " benchmark(s) regressed by more than " 
+                << options.threshold * 100.0 << "%\n";
+      return 1;
+    }
+  }
+
+  if (options.save) {
+    if (!write_baseline(path, profile, results)) {
+      std::cerr << "Can't write the baseline " << path << "\n";
+      return 2;
+    }
+    std::cout << "Saved the baseline " << path << "\n";
+  }
+  return 0;
+}
+
+} // namespace bench
+
+#endif // SNAP_BENCHMARKS_REGRESSION_HPP
@@ -0,0 +1,28 @@
+# ---- snap/cmake/toolchains/aarch64-linux-gnu.cmake ------------------------ #
+#
+# Cross compiles for AArch64 Linux, which enables the NEON backend, and runs
+# the tests under qemu-user. Boost must be available for the target, e.g:
+#
+#   cmake -S . -B build-aarch64 \
+#     -DCMAKE_TOOLCHAIN_FILE=cmake/toolchains/aarch64-linux-gnu.cmake \
+#     -DBOOST_ROOT=/path/to/aarch64/boost
+#   cmake --build build-aarch64 && ctest --test-dir build-aarch64
+#
+# The sysroot used by qemu can be changed with SNAP_CROSS_SYSROOT.
+
+set(CMAKE_SYSTEM_NAME      Linux  )
+set(CMAKE_SYSTEM_PROCESSOR aarch64)
+
+set(CMAKE_C_COMPILER   aarch64-linux-gnu-gcc)
+set(CMAKE_CXX_COMPILER aarch64-linux-gnu-g++)
+
+IF(NOT SNAP_CROSS_SYSROOT)
+  set(SNAP_CROSS_SYSROOT /usr/aarch64-linux-gnu)
+ENDIF()
+
+set(CMAKE_FIND_ROOT_PATH ${SNAP_CROSS_SYSROOT})
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY BOTH )
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE BOTH )
+
+set(CMAKE_CROSSCOMPILING_EMULATOR qemu-aarch64 -L ${SNAP_CROSS_SYSROOT})
@@ -0,0 +1,28 @@
+# ---- snap/cmake/toolchains/arm-linux-gnueabihf.cmake ---------------------- #
+#
+# Cross compiles for 32-bit ARMv7 Linux, which enables the NEON backend, and
+# runs the tests under qemu-user. Boost must be available for the target, e.g:
+#
+#   cmake -S . -B build-arm \
+#     -DCMAKE_TOOLCHAIN_FILE=cmake/toolchains/arm-linux-gnueabihf.cmake \
+#     -DBOOST_ROOT=/path/to/arm/boost
+#   cmake --build build-arm && ctest --test-dir build-arm
+#
+# The sysroot used by qemu can be changed with SNAP_CROSS_SYSROOT.
+
+set(CMAKE_SYSTEM_NAME      Linux  )
+set(CMAKE_SYSTEM_PROCESSOR armv7l )
+
+set(CMAKE_C_COMPILER   arm-linux-gnueabihf-gcc)
+set(CMAKE_CXX_COMPILER arm-linux-gnueabihf-g++)
+
+IF(NOT SNAP_CROSS_SYSROOT)
+  set(SNAP_CROSS_SYSROOT /usr/arm-linux-gnueabihf)
+ENDIF()
+
+set(CMAKE_FIND_ROOT_PATH ${SNAP_CROSS_SYSROOT})
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY BOTH )
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE BOTH )
+
+set(CMAKE_CROSSCOMPILING_EMULATOR qemu-arm -L ${SNAP_CROSS_SYSROOT})
@@ -0,0 +1,465 @@
+//---- snap/algorithm/binary.hpp --------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  binary.hpp
+/// \brief Defines the kernels for bit packed binary masks (FM_BIN_1), which
+///        are 8 times smaller than FM_GREY_8 masks: packing and unpacking,
+///        the logical operations, the area, and binary morphology. Except
+///        for packing and unpacking, the kernels process 64 elements per
+///        word, or 128 per vector.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_ALGORITHM_BINARY_HPP
+#define SNAP_ALGORITHM_BINARY_HPP
+
+#include "components.hpp"
+#include "transform.hpp"
+#include <array>
+#include <cstring>
+
+namespace snap {
+namespace alg  {
+
+namespace detail {
+
+/// Defines the number of elements in each word of a binary mask row.
+static constexpr size_t WORD_BITS = 64;
+
+/// Loads the word of binary mask elements at \p p, which does not need to be
+/// aligned.
+/// \param[in] p A pointer to the word.
+static inline uint64_t load_word(const uint8_t* p) {
+  uint64_t word;
+  std::memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+/// Stores the word of binary mask elements \p word at \p p, which does not
+/// need to be aligned.
+/// \param[in] p    A pointer to the word.
+/// \param[in] word The word to store.
+static inline void store_word(uint8_t* p, uint64_t word) {
+  std::memcpy(p, &word, sizeof(word));
+}
+
+/// Returns the mask of the bits of the last word of a binary mask row of
+/// \p cols elements which are elements rather than padding.
+/// \param[in] cols The number of elements in the row.
+static constexpr uint64_t last_word_mask(size_t cols) {
+  return cols % WORD_BITS == 0 ? ~uint64_t(0)
+                               : (uint64_t(1) << (cols % WORD_BITS)) - 1;
+}
+
+/// Returns the table which expands each byte of a binary mask into 8 bytes,
+/// which are 0xff for the set bits, and 0 for the clear ones.
+static inline const uint64_t* expand_table() {
+  static const auto table = [] {
+    std::array<uint64_t, 256> t{};
+    for (size_t i = 0; i < t.size(); ++i) {
+      for (size_t k = 0; k < 8; ++k)
+        t[i] |= (i >> k & 1) ? uint64_t(0xff) << (8 * k) : 0;
+    }
+    return t;
+  }();
+  return table.data();
+}
+
+/// Packs the \p cols elements of the row \p in into the binary mask row
+/// \p out, where each non zero element is a set bit. Each 16 elements are
+/// classified with a compare and a movemask, so a word takes 4 vectors.
+/// \param[in] in   The row to pack.
+/// \param[in] cols The number of elements in the row.
+/// \param[in] out  The binary mask row to write.
+static inline void pack_row(const uint8_t* in, size_t cols, uint8_t* out) {
+  constexpr size_t width = Vec16x8u::width;
+  const Vec16x8u   zero(uint8_t(0));
+
+  for (size_t c = 0; c < cols; c += WORD_BITS) {
+    const size_t n    = std::min(WORD_BITS, cols - c);
+    uint64_t     word = 0;
+    size_t       k    = 0;
+    for (; k + width <= n; k += width) {
+      Vec16x8u v; v.load(in + c + k);
+      word |= uint64_t(~movemask(cmpeq(v, zero)) & 0xffff) << k;
+    }
+    for (; k < n; ++k)
+      word |= uint64_t(in[c + k] != 0) << k;
+    store_word(out + c / 8, word);
+  }
+}
+
+/// Unpacks the \p cols elements of the binary mask row \p in into the row
+/// \p out, where each set bit is \p value and each clear bit is 0. Each byte
+/// of the mask is expanded to 8 elements with a table lookup.
+/// \param[in] in    The binary mask row to unpack.
+/// \param[in] cols  The number of elements in the row.
+/// \param[in] out   The row to write.
+/// \param[in] value The value of the set elements.
+static inline void unpack_row(const uint8_t* in, size_t cols, uint8_t* out,
+    uint8_t value) {
+  const uint64_t* table = expand_table();
+  const uint64_t  fill  = uint64_t(0x0101010101010101) * value;
+
+  size_t c = 0;
+  for (; c + 8 <= cols; c += 8)
+    store_word(out + c, table[in[c / 8]] & fill);
+  for (; c < cols; ++c)
+    out[c] = (in[c / 8] >> (c % 8)) & 1 ? value : 0;
+}
+
+/// Applies the 3x3 binary morphology operation to the \p words words of
+/// the binary mask rows \p above, \p row and \p below, and writes the result
+/// to \p out. Dilation ors the neighbours of each element, and erosion ands
+/// them, so the neighbours in the row are the word shifted by one bit, with
+/// the bit carried in from the adjacent word. Elements outside the mask,
+/// including the padding, are the identity of the operation, so that they
+/// don't change the result.
+/// \param[in] above        The row above, which is \p row for the first row.
+/// \param[in] row          The row to apply the operation to.
+/// \param[in] below        The row below, which is \p row for the last row.
+/// \param[in] out          The row to write the result to.
+/// \param[in] words        The number of words in each row.
+/// \param[in] lastMask     The mask of the elements of the last word.
+/// \param[in] connectivity The connectivity of the structuring element.
+/// \tparam    Erode        If the operation is erosion rather than dilation.
+template <bool Erode>
+static inline void morph_row(const uint8_t* above, const uint8_t* row,
+    const uint8_t* below, uint8_t* out, size_t words, uint64_t lastMask,
+    Connectivity connectivity) {
+  constexpr uint64_t identity = Erode ? ~uint64_t(0) : 0;
+  const auto combine = [] (uint64_t a, uint64_t b) {
+    return Erode ? a & b : a | b;
+  };
+  const auto wordAt = [&] (const uint8_t* p, size_t w) {
+    if (w >= words)
+      return identity;
+    const uint64_t word = load_word(p + 8 * w);
+    return w + 1 < words ? word
+                         : (word & lastMask) | (identity & ~lastMask);
+  };
+  const auto horizontal = [&] (uint64_t prev, uint64_t word, uint64_t next) {
+    const uint64_t left  = (word << 1) | (prev >> 63);
+    const uint64_t right = (word >> 1) | (next << 63);
+    return combine(word, combine(left, right));
+  };
+
+  // Each row keeps its previous, current and next words, so each word is
+  // loaded once.
+  const uint8_t* rows[3] = {above, row, below};
+  uint64_t       prev[3] = {identity, identity, identity};
+  uint64_t       curr[3] = {wordAt(above, 0), wordAt(row, 0), wordAt(below, 0)};
+  for (size_t w = 0; w < words; ++w) {
+    uint64_t next[3], h[3];
+    for (size_t i = 0; i < 3; ++i) {
+      next[i] = wordAt(rows[i], w + 1);
+      h[i]    = horizontal(prev[i], curr[i], next[i]);
+    }
+    const uint64_t result = connectivity == CN_8
+      ? combine(h[1], combine(h[0], h[2]))
+      : combine(h[1], combine(curr[0], curr[2]));
+    store_word(out + 8 * w, result);
+    for (size_t i = 0; i < 3; ++i) {
+      prev[i] = curr[i];
+      curr[i] = next[i];
+    }
+  }
+}
+
+/// Applies the 3x3 binary morphology operation to \p src, and writes the
+/// result to \p dst, in parallel over bands of rows for EP_PARALLEL.
+/// \param[in] src          The mask to apply the operation to.
+/// \param[in] dst          The mask to write the result to.
+/// \param[in] connectivity The connectivity of the structuring element.
+/// \param[in] policy       The execution policy.
+/// \tparam    Erode        If the operation is erosion rather than dilation.
+template <bool Erode, typename A>
+static inline void morph(const Matrix<mat::FM_BIN_1, A>& src,
+    Matrix<mat::FM_BIN_1, A>& dst, Connectivity connectivity,
+    ExecutionPolicy policy) {
+  assert(src.rows() == dst.rows() && src.cols() == dst.cols());
+  assert(src.data() != dst.data());
+  const size_t   rows     = src.rows();
+  const size_t   stride   = src.stride();
+  const size_t   words    = stride / 8;
+  const uint64_t lastMask = last_word_mask(src.cols());
+  const uint8_t* in       = src.data();
+  uint8_t*       out      = dst.data();
+
+  util::par::parallel_for(0, rows,
+    util::par::chunk_count(src.size(), policy, MIN_PARALLEL_ELEMENTS),
+    [&] (size_t begin, size_t end, size_t) {
+      for (size_t r = begin; r < end; ++r) {
+        const uint8_t* row = in + r * stride;
+        morph_row<Erode>(r == 0 ? row : row - stride, row,
+          r + 1 == rows ? row : row + stride, out + r * stride, words,
+          lastMask, connectivity);
+      }
+    }
+  );
+}
+
+} // namespace detail
+
+/// Returns the element at row \p r and column \p c of the binary mask \p m.
+/// This does not check bounds.
+/// \param[in] m The mask to get the element of.
+/// \param[in] r The row of the element.
+/// \param[in] c The column of the element.
+template <typename A>
+static inline bool get_bit(const Matrix<mat::FM_BIN_1, A>& m, size_t r,
+                           size_t c) {
+  return (m.data()[r * m.stride() + c / 8] >> (c % 8)) & 1;
+}
+
+/// Sets the element at row \p r and column \p c of the binary mask \p m to
+/// \p value. This does not check bounds.
+/// \param[in] m     The mask to set the element of.
+/// \param[in] r     The row of the element.
+/// \param[in] c     The column of the element.
+/// \param[in] value The value of the element.
+template <typename A>
+static inline void set_bit(Matrix<mat::FM_BIN_1, A>& m, size_t r, size_t c,
+                           bool value) {
+  uint8_t&      byte = m.data()[r * m.stride() + c / 8];
+  const uint8_t bit  = uint8_t(1) << (c % 8);
+  byte = value ? byte | bit : byte & ~bit;
+}
+
+/// Packs the FM_GREY_8 matrix \p src into the binary mask \p dst, which must
+/// have the same dimensions, where each non zero element is set.
+/// \param[in] src    The matrix to pack.
+/// \param[in] dst    The binary mask to write.
+/// \param[in] policy The execution policy.
+template <typename A, typename B>
+static inline void pack(const Matrix<mat::FM_GREY_8, A>& src              ,
+                        Matrix<mat::FM_BIN_1, B>&        dst              ,
+                        ExecutionPolicy                  policy = EP_SERIAL) {
+  assert(src.rows() == dst.rows() && src.cols() == dst.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::pack", src.size(),
+    src.size() + dst.rows() * dst.stride());
+  util::par::parallel_for(0, src.rows(),
+    util::par::chunk_count(src.size(), policy, detail::MIN_PARALLEL_ELEMENTS),
+    [&] (size_t begin, size_t end, size_t) {
+      for (size_t r = begin; r < end; ++r) {
+        detail::pack_row(src.data() + r * src.stride(), src.cols(),
+          dst.data() + r * dst.stride());
+      }
+    }
+  );
+}
+
+/// Unpacks the binary mask \p src into the FM_GREY_8 matrix \p dst, which
+/// must have the same dimensions, where each set element is \p value and
+/// each clear element is 0.
+/// \param[in] src    The binary mask to unpack.
+/// \param[in] dst    The matrix to write.
+/// \param[in] value  The value of the set elements.
+/// \param[in] policy The execution policy.
+template <typename A, typename B>
+static inline void unpack(const Matrix<mat::FM_BIN_1, A>& src               ,
+                          Matrix<mat::FM_GREY_8, B>&      dst               ,
+                          uint8_t                         value  = 255      ,
+                          ExecutionPolicy                 policy = EP_SERIAL) {
+  assert(src.rows() == dst.rows() && src.cols() == dst.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::unpack", src.size(),
+    src.rows() * src.stride() + dst.size());
+  util::par::parallel_for(0, src.rows(),
+    util::par::chunk_count(src.size(), policy, detail::MIN_PARALLEL_ELEMENTS),
+    [&] (size_t begin, size_t end, size_t) {
+      for (size_t r = begin; r < end; ++r) {
+        detail::unpack_row(src.data() + r * src.stride(), src.cols(),
+          dst.data() + r * dst.stride(), value);
+      }
+    }
+  );
+}
+
+/// Computes the bitwise and of the binary masks \p a and \p b, and writes
+/// the result to \p out. All the masks must have the same dimensions.
+/// \param[in] a           The first mask.
+/// \param[in] b           The second mask.
+/// \param[in] out         The mask to write the result to.
+/// \param[in] policy      The execution policy.
+/// \param[in] writePolicy The policy for the stores.
+template <typename A>
+static inline void bitwise_and(const Matrix<mat::FM_BIN_1, A>& a            ,
+                               const Matrix<mat::FM_BIN_1, A>& b            ,
+                               Matrix<mat::FM_BIN_1, A>&       out          ,
+                               ExecutionPolicy policy      = EP_SERIAL,
+                               WritePolicy     writePolicy = WP_AUTO  ) {
+  assert(a.rows() == b.rows()   && a.cols() == b.cols() &&
+         a.rows() == out.rows() && a.cols() == out.cols());
+  const size_t n = out.rows() * out.stride();
+  SNAP_INSTRUMENT_KERNEL("alg::bitwise_and", a.size(), 3 * n);
+  const uint8_t* pa = a.data();
+  const uint8_t* pb = b.data();
+  detail::write_elements(out.data(), n, policy, writePolicy,
+    [pa, pb] (size_t i) {
+      Vec16x8u va, vb; va.load(pa + i); vb.load(pb + i); return va & vb;
+    },
+    [pa, pb] (size_t i) { return static_cast<uint8_t>(pa[i] & pb[i]); },
+    [pa, pb] (size_t i) { prefetch(pa + i); prefetch(pb + i); });
+}
+
+/// Computes the bitwise or of the binary masks \p a and \p b, and writes
+/// the result to \p out. All the masks must have the same dimensions.
+/// \param[in] a           The first mask.
+/// \param[in] b           The second mask.
+/// \param[in] out         The mask to write the result to.
+/// \param[in] policy      The execution policy.
+/// \param[in] writePolicy The policy for the stores.
+template <typename A>
+static inline void bitwise_or(const Matrix<mat::FM_BIN_1, A>& a            ,
+                              const Matrix<mat::FM_BIN_1, A>& b            ,
+                              Matrix<mat::FM_BIN_1, A>&       out          ,
+                              ExecutionPolicy policy      = EP_SERIAL,
+                              WritePolicy     writePolicy = WP_AUTO  ) {
+  assert(a.rows() == b.rows()   && a.cols() == b.cols() &&
+         a.rows() == out.rows() && a.cols() == out.cols());
+  const size_t n = out.rows() * out.stride();
+  SNAP_INSTRUMENT_KERNEL("alg::bitwise_or", a.size(), 3 * n);
+  const uint8_t* pa = a.data();
+  const uint8_t* pb = b.data();
+  detail::write_elements(out.data(), n, policy, writePolicy,
+    [pa, pb] (size_t i) {
+      Vec16x8u va, vb; va.load(pa + i); vb.load(pb + i); return va | vb;
+    },
+    [pa, pb] (size_t i) { return static_cast<uint8_t>(pa[i] | pb[i]); },
+    [pa, pb] (size_t i) { prefetch(pa + i); prefetch(pb + i); });
+}
+
+/// Computes the bitwise exclusive or of the binary masks \p a and \p b, and
+/// writes the result to \p out. All the masks must have the same
+/// dimensions.
+/// \param[in] a           The first mask.
+/// \param[in] b           The second mask.
+/// \param[in] out         The mask to write the result to.
+/// \param[in] policy      The execution policy.
+/// \param[in] writePolicy The policy for the stores.
+template <typename A>
+static inline void bitwise_xor(const Matrix<mat::FM_BIN_1, A>& a            ,
+                               const Matrix<mat::FM_BIN_1, A>& b            ,
+                               Matrix<mat::FM_BIN_1, A>&       out          ,
+                               ExecutionPolicy policy      = EP_SERIAL,
+                               WritePolicy     writePolicy = WP_AUTO  ) {
+  assert(a.rows() == b.rows()   && a.cols() == b.cols() &&
+         a.rows() == out.rows() && a.cols() == out.cols());
+  const size_t n = out.rows() * out.stride();
+  SNAP_INSTRUMENT_KERNEL("alg::bitwise_xor", a.size(), 3 * n);
+  const uint8_t* pa = a.data();
+  const uint8_t* pb = b.data();
+  detail::write_elements(out.data(), n, policy, writePolicy,
+    [pa, pb] (size_t i) {
+      Vec16x8u va, vb; va.load(pa + i); vb.load(pb + i); return va ^ vb;
+    },
+    [pa, pb] (size_t i) { return static_cast<uint8_t>(pa[i] ^ pb[i]); },
+    [pa, pb] (size_t i) { prefetch(pa + i); prefetch(pb + i); });
+}
+
+/// Computes the bitwise complement of the binary mask \p a, and writes the
+/// result to \p out, which must have the same dimensions.
+/// \param[in] a           The mask to complement.
+/// \param[in] out         The mask to write the result to.
+/// \param[in] policy      The execution policy.
+/// \param[in] writePolicy The policy for the stores.
+template <typename A>
+static inline void bitwise_not(const Matrix<mat::FM_BIN_1, A>& a            ,
+                               Matrix<mat::FM_BIN_1, A>&       out          ,
+                               ExecutionPolicy policy      = EP_SERIAL,
+                               WritePolicy     writePolicy = WP_AUTO  ) {
+  assert(a.rows() == out.rows() && a.cols() == out.cols());
+  const size_t n = out.rows() * out.stride();
+  SNAP_INSTRUMENT_KERNEL("alg::bitwise_not", a.size(), 2 * n);
+  const uint8_t* pa = a.data();
+  detail::write_elements(out.data(), n, policy, writePolicy,
+    [pa] (size_t i) { Vec16x8u va; va.load(pa + i); return ~va; },
+    [pa] (size_t i) { return static_cast<uint8_t>(~pa[i]); },
+    [pa] (size_t i) { prefetch(pa + i); });
+}
+
+/// Counts the number of set elements in the binary mask \p m, which is the
+/// area of the mask, with a population count of each word.
+/// \param[in] m      The mask to count the set elements of.
+/// \param[in] policy The execution policy for the computation.
+template <typename A>
+static inline size_t count_non_zero(const Matrix<mat::FM_BIN_1, A>& m,
+                                    ExecutionPolicy policy = EP_SERIAL) {
+  const size_t   stride   = m.stride();
+  const size_t   words    = stride / 8;
+  const uint64_t lastMask = detail::last_word_mask(m.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::count_non_zero", m.size(), m.rows() * stride);
+  if (m.size() == 0)
+    return 0;
+
+  const size_t chunks =
+    util::par::chunk_count(m.size(), policy, detail::MIN_PARALLEL_ELEMENTS);
+  std::vector<uint64_t> counts(std::max<size_t>(chunks, 1), 0);
+  util::par::parallel_for(0, m.rows(), chunks,
+    [&] (size_t begin, size_t end, size_t chunk) {
+      uint64_t count = 0;
+      for (size_t r = begin; r < end; ++r) {
+        const uint8_t* row = m.data() + r * stride;
+        for (size_t w = 0; w + 1 < words; ++w)
+          count += __builtin_popcountll(detail::load_word(row + 8 * w));
+        count += __builtin_popcountll(
+          detail::load_word(row + 8 * (words - 1)) & lastMask);
+      }
+      counts[chunk] = count;
+    }
+  );
+
+  uint64_t total = 0;
+  for (const auto count : counts)
+    total += count;
+  return total;
+}
+
+/// Dilates the binary mask \p src with a 3x3 structuring element, which is
+/// a square for CN_8, and a cross for CN_4, and writes the result to \p dst,
+/// which must have the same dimensions and must not be \p src. Elements
+/// outside the mask are clear.
+/// \param[in] src          The mask to dilate.
+/// \param[in] dst          The mask to write the result to.
+/// \param[in] connectivity The connectivity of the structuring element.
+/// \param[in] policy       The execution policy.
+template <typename A>
+static inline void dilate(const Matrix<mat::FM_BIN_1, A>& src               ,
+                          Matrix<mat::FM_BIN_1, A>&       dst               ,
+                          Connectivity                    connectivity = CN_8,
+                          ExecutionPolicy                 policy = EP_SERIAL) {
+  SNAP_INSTRUMENT_KERNEL("alg::dilate", src.size(),
+    2 * src.rows() * src.stride());
+  detail::morph<false>(src, dst, connectivity, policy);
+}
+
+/// Erodes the binary mask \p src with a 3x3 structuring element, which is
+/// a square for CN_8, and a cross for CN_4, and writes the result to \p dst,
+/// which must have the same dimensions and must not be \p src. Elements
+/// outside the mask are set, so that the border of the mask is not eroded.
+/// \param[in] src          The mask to erode.
+/// \param[in] dst          The mask to write the result to.
+/// \param[in] connectivity The connectivity of the structuring element.
+/// \param[in] policy       The execution policy.
+template <typename A>
+static inline void erode(const Matrix<mat::FM_BIN_1, A>& src               ,
+                         Matrix<mat::FM_BIN_1, A>&       dst               ,
+                         Connectivity                    connectivity = CN_8,
+                         ExecutionPolicy                 policy = EP_SERIAL) {
+  SNAP_INSTRUMENT_KERNEL("alg::erode", src.size(),
+    2 * src.rows() * src.stride());
+  detail::morph<true>(src, dst, connectivity, policy);
+}
+
+} // namespace alg
+} // namespace snap
+
+#endif // SNAP_ALGORITHM_BINARY_HPP
@@ -0,0 +1,366 @@
+//---- snap/algorithm/blend.hpp ---------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  blend.hpp
+/// \brief Defines alpha compositing of BGRA matrices: the over, multiply and
+///        screen blend modes for premultiplied and straight alpha, and the
+///        conversions between the two. The channels are widened to 16 bits,
+///        so that each vector holds 2 elements and the products of two
+///        channels fit in a lane, and the products are divided by 255 with a
+///        multiply and shift rather than a division.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_ALGORITHM_BLEND_HPP
+#define SNAP_ALGORITHM_BLEND_HPP
+
+#include "region.hpp"
+#include <algorithm>
+#include <cassert>
+
+namespace snap {
+namespace alg  {
+
+/// Defines the possible modes for blending a source element onto a
+/// destination element. Each mode is the separable W3C compositing formula,
+/// which is also applied to the alpha channel.
+enum BlendMode : uint8_t {
+  BL_OVER     = 0,  //!< The source over the destination.
+  BL_MULTIPLY = 1,  //!< The product of the source and destination.
+  BL_SCREEN   = 2   //!< The inverse of the product of the inverses.
+};
+
+/// Defines the possible representations of the alpha of BGRA elements.
+enum AlphaMode : uint8_t {
+  AM_PREMULTIPLIED = 0,   //!< The colour channels are multiplied by alpha.
+  AM_STRAIGHT      = 1    //!< The colour channels are independent of alpha.
+};
+
+namespace detail {
+
+/// Defines the index of the alpha channel of a BGRA element.
+static constexpr size_t BLEND_ALPHA = 3;
+
+/// Returns \p a * \p b / 255, rounded to the nearest integer, for \p a and
+/// \p b less than 256. This is exact for all such values.
+/// \param[in] a The first value.
+/// \param[in] b The second value.
+static SNAP_INLINE uint32_t mul_div255(uint32_t a, uint32_t b) {
+  const uint32_t t = a * b + 128;
+  return (t + (t >> 8)) >> 8;
+}
+
+/// Returns channel \p c of an element with alpha \p a, with the alpha
+/// divided out, rounded to the nearest integer. Channels of elements with
+/// zero alpha are zero.
+/// \param[in] c The premultiplied channel.
+/// \param[in] a The alpha of the element.
+static SNAP_INLINE uint8_t unpremultiply_value(uint32_t c, uint32_t a) {
+  return a == 0 ? 0 : static_cast<uint8_t>(
+    std::min<uint32_t>((c * 255 + a / 2) / a, 255));
+}
+
+/// Returns the channel of the premultiplied element \p s blended onto the
+/// channel of the premultiplied element \p d.
+/// \param[in]  s    The source channel.
+/// \param[in]  d    The destination channel.
+/// \param[in]  sa   The source alpha.
+/// \param[in]  da   The destination alpha.
+/// \tparam     Mode The blend mode.
+template <BlendMode Mode>
+static SNAP_INLINE uint32_t blend_value(uint32_t s, uint32_t d, uint32_t sa,
+                                        uint32_t da) {
+  if (Mode == BL_OVER)
+    return std::min<uint32_t>(s + mul_div255(d, 255 - sa), 255);
+  if (Mode == BL_MULTIPLY)
+    return std::min<uint32_t>(mul_div255(s, 255 - da) +
+      mul_div255(d, 255 - sa) + mul_div255(s, d), 255);
+  return s + d - mul_div255(s, d);
+}
+
+/// Blends the element \p s onto the element \p d, writing the result to
+/// \p out, which may be \p d.
+/// \param[in] s        A pointer to the source element.
+/// \param[in] d        A pointer to the destination element.
+/// \param[in] out      A pointer to the blended element.
+/// \tparam    Mode     The blend mode.
+/// \tparam    Straight If the elements have straight alpha.
+template <BlendMode Mode, bool Straight>
+static SNAP_INLINE void blend_element(const uint8_t* s, const uint8_t* d,
+                                      uint8_t* out) {
+  uint32_t ps[4], pd[4], r[4];
+  for (size_t k = 0; k < 4; ++k) {
+    ps[k] = Straight && k != BLEND_ALPHA
+          ? mul_div255(s[k], s[BLEND_ALPHA]) : s[k];
+    pd[k] = Straight && k != BLEND_ALPHA
+          ? mul_div255(d[k], d[BLEND_ALPHA]) : d[k];
+  }
+  for (size_t k = 0; k < 4; ++k)
+    r[k] = blend_value<Mode>(ps[k], pd[k], ps[BLEND_ALPHA], pd[BLEND_ALPHA]);
+  for (size_t k = 0; k < 4; ++k) {
+    out[k] = Straight && k != BLEND_ALPHA
+           ? unpremultiply_value(r[k], r[BLEND_ALPHA])
+           : static_cast<uint8_t>(r[k]);
+  }
+}
+
+#if defined(SSE_ENABLED)
+
+/// Returns the 16-bit lanes of \p x divided by 255, rounded to the nearest
+/// integer, for lanes of at most 255 * 255. (x + 128) * 257 >> 16 is the
+/// same as (t + (t >> 8)) >> 8 for t = x + 128.
+/// \param[in] x The values to divide.
+static SNAP_INLINE __m128i div255_epi16(__m128i x) {
+  return _mm_mulhi_epu16(_mm_add_epi16(x, _mm_set1_epi16(128)),
+                         _mm_set1_epi16(257));
+}
+
+/// Returns the products of the 16-bit lanes of \p a and \p b divided by
+/// 255, for lanes less than 256.
+/// \param[in] a The first values.
+/// \param[in] b The second values.
+static SNAP_INLINE __m128i mul_div255_epi16(__m128i a, __m128i b) {
+  return div255_epi16(_mm_mullo_epi16(a, b));
+}
+
+/// Returns the alpha of each of the 2 elements of \p x, which have 16-bit
+/// channels, in all the channels of the element.
+/// \param[in] x The elements to get the alpha of.
+static SNAP_INLINE __m128i broadcast_alpha(__m128i x) {
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xFF), 0xFF);
+}
+
+/// Returns the 2 elements of \p x, which have 16-bit channels, with the
+/// colour channels multiplied by alpha. The alpha channel is multiplied by
+/// 255, which leaves it unchanged.
+/// \param[in] x The elements to premultiply.
+static SNAP_INLINE __m128i premultiply_epi16(__m128i x) {
+  const __m128i alphaLanes = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+  return mul_div255_epi16(x, _mm_or_si128(broadcast_alpha(x), alphaLanes));
+}
+
+/// Returns the 2 elements of \p x, which have 16-bit channels, with alpha
+/// divided out of the colour channels. The quotients are computed in single
+/// precision as (c * 255 + a / 2 + 0.5) / a and truncated, which is exact
+/// since the fraction of the quotient is at least 0.5 / a from an integer.
+/// For zero alpha the quotient is infinite, which converts to the minimum
+/// integer, and is saturated to zero by the caller's pack.
+/// \param[in] x The elements to unpremultiply.
+static SNAP_INLINE __m128i unpremultiply_epi16(__m128i x) {
+  const __m128i zero      = _mm_setzero_si128();
+  const __m128i alphaLane = _mm_set_epi32(-1, 0, 0, 0);
+  const __m128  scale     = _mm_set1_ps(255.0f);
+  const __m128  half      = _mm_set1_ps(0.5f);
+  const auto divide = [&] (__m128i element) {
+    const __m128i a = _mm_shuffle_epi32(element, 0xFF);
+    const __m128  n = _mm_add_ps(
+      _mm_mul_ps(_mm_cvtepi32_ps(element), scale),
+      _mm_add_ps(_mm_cvtepi32_ps(_mm_srli_epi32(a, 1)), half));
+    const __m128i q = _mm_cvttps_epi32(_mm_div_ps(n, _mm_cvtepi32_ps(a)));
+    return _mm_or_si128(_mm_andnot_si128(alphaLane, q),
+                        _mm_and_si128(alphaLane, element));
+  };
+  return _mm_packs_epi32(divide(_mm_unpacklo_epi16(x, zero)),
+                         divide(_mm_unpackhi_epi16(x, zero)));
+}
+
+/// Returns the 2 premultiplied elements of \p s, which have 16-bit
+/// channels, blended onto the 2 premultiplied elements of \p d. The
+/// channels are clamped to 255.
+/// \param[in] s    The source elements.
+/// \param[in] d    The destination elements.
+/// \tparam    Mode The blend mode.
+template <BlendMode Mode>
+static SNAP_INLINE __m128i blend_epi16(__m128i s, __m128i d) {
+  const __m128i ff = _mm_set1_epi16(255);
+  if (Mode == BL_OVER) {
+    const __m128i inv = _mm_sub_epi16(ff, broadcast_alpha(s));
+    return _mm_min_epi16(_mm_add_epi16(s, mul_div255_epi16(d, inv)), ff);
+  }
+  if (Mode == BL_MULTIPLY) {
+    const __m128i invS = _mm_sub_epi16(ff, broadcast_alpha(s));
+    const __m128i invD = _mm_sub_epi16(ff, broadcast_alpha(d));
+    const __m128i sum  = _mm_add_epi16(
+      _mm_add_epi16(mul_div255_epi16(s, invD), mul_div255_epi16(d, invS)),
+      mul_div255_epi16(s, d));
+    return _mm_min_epi16(sum, ff);
+  }
+  return _mm_sub_epi16(_mm_add_epi16(s, d), mul_div255_epi16(s, d));
+}
+
+#endif // SSE_ENABLED
+
+/// Blends the \p cols elements at \p src onto the elements at \p dst. With
+/// SSE, 4 elements are blended per iteration, as 2 vectors of 2 elements
+/// with 16-bit channels.
+/// \param[in] src      A pointer to the source elements.
+/// \param[in] dst      A pointer to the destination elements.
+/// \param[in] cols     The number of elements.
+/// \tparam    Mode     The blend mode.
+/// \tparam    Straight If the elements have straight alpha.
+template <BlendMode Mode, bool Straight>
+static inline void blend_row(const uint8_t* src, uint8_t* dst, size_t cols) {
+  size_t c = 0;
+#if defined(SSE_ENABLED)
+  const __m128i zero = _mm_setzero_si128();
+  for (; c + 4 <= cols; c += 4) {
+    auto*         p = reinterpret_cast<__m128i*>(dst + 4 * c);
+    const __m128i s = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(src + 4 * c));
+    const __m128i d = _mm_loadu_si128(p);
+    __m128i sl = _mm_unpacklo_epi8(s, zero), sh = _mm_unpackhi_epi8(s, zero);
+    __m128i dl = _mm_unpacklo_epi8(d, zero), dh = _mm_unpackhi_epi8(d, zero);
+    if (Straight) {
+      sl = premultiply_epi16(sl); sh = premultiply_epi16(sh);
+      dl = premultiply_epi16(dl); dh = premultiply_epi16(dh);
+    }
+    __m128i rl = blend_epi16<Mode>(sl, dl), rh = blend_epi16<Mode>(sh, dh);
+    if (Straight) {
+      rl = unpremultiply_epi16(rl);
+      rh = unpremultiply_epi16(rh);
+    }
+    _mm_storeu_si128(p, _mm_packus_epi16(rl, rh));
+  }
+#endif
+  for (; c < cols; ++c)
+    blend_element<Mode, Straight>(src + 4 * c, dst + 4 * c, dst + 4 * c);
+}
+
+/// Converts the \p cols elements at \p in between straight and
+/// premultiplied alpha, writing them to \p out, which may be \p in.
+/// \param[in] in       A pointer to the elements to convert.
+/// \param[in] out      A pointer to the converted elements.
+/// \param[in] cols     The number of elements.
+/// \tparam    Multiply If alpha is multiplied into, or divided out of, the
+///                     colour channels.
+template <bool Multiply>
+static inline void convert_alpha_row(const uint8_t* in, uint8_t* out,
+                                     size_t cols) {
+  size_t c = 0;
+#if defined(SSE_ENABLED)
+  const __m128i zero = _mm_setzero_si128();
+  for (; c + 4 <= cols; c += 4) {
+    const __m128i x = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(in + 4 * c));
+    const __m128i l = _mm_unpacklo_epi8(x, zero);
+    const __m128i h = _mm_unpackhi_epi8(x, zero);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * c), Multiply
+      ? _mm_packus_epi16(premultiply_epi16(l), premultiply_epi16(h))
+      : _mm_packus_epi16(unpremultiply_epi16(l), unpremultiply_epi16(h)));
+  }
+#endif
+  for (; c < cols; ++c) {
+    const uint8_t a = in[4 * c + BLEND_ALPHA];
+    for (size_t k = 0; k < BLEND_ALPHA; ++k) {
+      const uint8_t v = in[4 * c + k];
+      out[4 * c + k] = Multiply ? static_cast<uint8_t>(mul_div255(v, a))
+                                : unpremultiply_value(v, a);
+    }
+    out[4 * c + BLEND_ALPHA] = a;
+  }
+}
+
+/// Blends \p src onto \p dst with straight or premultiplied alpha, splitting
+/// the rows across threads when \p policy is EP_PARALLEL.
+/// \param[in] src      The matrix to blend.
+/// \param[in] dst      The matrix to blend onto.
+/// \param[in] straight If the elements have straight alpha.
+/// \param[in] policy   The execution policy.
+/// \tparam    Mode     The blend mode.
+template <BlendMode Mode, typename A, typename B>
+static inline void blend_rows(const Matrix<mat::FM_BGRA_32, A>& src,
+                              Matrix<mat::FM_BGRA_32, B>& dst, bool straight,
+                              ExecutionPolicy policy) {
+  for_each_block_row(src.rows(), src.size(), policy, [&] (size_t r) {
+    const uint8_t* s = src.data() + r * src.stride();
+    uint8_t*       d = dst.data() + r * dst.stride();
+    if (straight)
+      blend_row<Mode, true>(s, d, src.cols());
+    else
+      blend_row<Mode, false>(s, d, src.cols());
+  });
+}
+
+} // namespace detail
+
+/// Multiplies the colour channels of the straight alpha matrix \p in by
+/// alpha, writing the elements to \p out, which must have the same
+/// dimensions, and may be \p in.
+/// \param[in] in     The matrix to premultiply.
+/// \param[in] out    The premultiplied matrix.
+/// \param[in] policy The execution policy.
+template <typename A, typename B>
+static inline void premultiply(const Matrix<mat::FM_BGRA_32, A>& in     ,
+                               Matrix<mat::FM_BGRA_32, B>&       out    ,
+                               ExecutionPolicy policy = EP_SERIAL       ) {
+  assert(in.rows() == out.rows() && in.cols() == out.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::premultiply", in.size(), 8 * in.size());
+  detail::for_each_block_row(in.rows(), in.size(), policy, [&] (size_t r) {
+    detail::convert_alpha_row<true>(in.data() + r * in.stride(),
+                                    out.data() + r * out.stride(), in.cols());
+  });
+}
+
+/// Divides alpha out of the colour channels of the premultiplied matrix \p
+/// in, writing the elements to \p out, which must have the same dimensions,
+/// and may be \p in. The colour channels of elements with zero alpha are
+/// zero, and channels greater than alpha are clamped to 255.
+/// \param[in] in     The matrix to unpremultiply.
+/// \param[in] out    The unpremultiplied matrix.
+/// \param[in] policy The execution policy.
+template <typename A, typename B>
+static inline void unpremultiply(const Matrix<mat::FM_BGRA_32, A>& in     ,
+                                 Matrix<mat::FM_BGRA_32, B>&       out    ,
+                                 ExecutionPolicy policy = EP_SERIAL       ) {
+  assert(in.rows() == out.rows() && in.cols() == out.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::unpremultiply", in.size(), 8 * in.size());
+  detail::for_each_block_row(in.rows(), in.size(), policy, [&] (size_t r) {
+    detail::convert_alpha_row<false>(in.data() + r * in.stride(),
+                                     out.data() + r * out.stride(), in.cols());
+  });
+}
+
+/// Blends the matrix \p src onto the matrix \p dst, which must have the same
+/// dimensions, with the separable W3C formula for \p mode. Premultiplied
+/// alpha is the fast path for stacks of layers: with straight alpha each
+/// element of both matrices is premultiplied before blending, and the result
+/// is unpremultiplied, which costs a division per element.
+/// \param[in] src    The matrix to blend.
+/// \param[in] dst    The matrix to blend onto.
+/// \param[in] mode   The blend mode.
+/// \param[in] alpha  The representation of the alpha of both matrices.
+/// \param[in] policy The execution policy.
+template <typename A, typename B>
+static inline void blend(const Matrix<mat::FM_BGRA_32, A>& src,
+                         Matrix<mat::FM_BGRA_32, B>&       dst,
+                         BlendMode       mode   = BL_OVER,
+                         AlphaMode       alpha  = AM_PREMULTIPLIED,
+                         ExecutionPolicy policy = EP_SERIAL) {
+  assert(src.rows() == dst.rows() && src.cols() == dst.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::blend", src.size(), 12 * src.size());
+  const bool straight = alpha == AM_STRAIGHT;
+  switch (mode) {
+    case BL_OVER:
+      detail::blend_rows<BL_OVER>(src, dst, straight, policy);
+      break;
+    case BL_MULTIPLY:
+      detail::blend_rows<BL_MULTIPLY>(src, dst, straight, policy);
+      break;
+    case BL_SCREEN:
+      detail::blend_rows<BL_SCREEN>(src, dst, straight, policy);
+      break;
+  }
+}
+
+} // namespace alg
+} // namespace snap
+
+#endif // SNAP_ALGORITHM_BLEND_HPP
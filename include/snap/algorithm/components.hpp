@@ -0,0 +1,369 @@
+//---- snap/algorithm/components.hpp ----------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  components.hpp
+/// \brief Defines run length based connected component labeling of binary
+///        masks, which also computes the area, bounding box and centroid of
+///        each component (blob).
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_ALGORITHM_COMPONENTS_HPP
+#define SNAP_ALGORITHM_COMPONENTS_HPP
+
+#include "region.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace snap {
+namespace alg  {
+
+/// Defines the possible connectivities of the pixels of a component.
+enum Connectivity : uint8_t {
+  CN_4 = 4,         //!< Pixels which share an edge are connected.
+  CN_8 = 8          //!< Pixels which share an edge or a corner are connected.
+};
+
+/// Defines the statistics of a connected component.
+struct Blob {
+  uint32_t label;     //!< The label of the blob, from 1.
+  uint64_t area;      //!< The number of pixels in the blob.
+  Rect     bounds;    //!< The bounding box of the blob.
+  double   cx;        //!< The column of the centroid.
+  double   cy;        //!< The row of the centroid.
+};
+
+namespace detail {
+
+/// Defines a run of foreground pixels in a row.
+struct Run {
+  uint32_t start;   //!< The first column of the run.
+  uint32_t end;     //!< The end column of the run (exclusive).
+};
+
+/// Appends the runs of non zero pixels of the \p cols pixels of \p row to
+/// \p runs. The pixels are classified 16 at a time with a compare and a
+/// movemask, blocks which don't change the state are skipped, and the run
+/// boundaries in the other blocks are found with bit scans.
+/// \param[in] row  A pointer to the row.
+/// \param[in] cols The number of pixels in the row.
+/// \param[in] runs The runs to append to.
+static inline void extract_runs(const uint8_t* row, size_t cols,
+    std::vector<Run>& runs) {
+  constexpr size_t width = Vec16x8u::width;
+  const Vec16x8u   zero(uint8_t(0));
+
+  bool     inRun = false;
+  uint32_t start = 0;
+  size_t   c     = 0;
+  for (; c + width <= cols; c += width) {
+    Vec16x8u v; v.load(row + c);
+    // Bits are set for the foreground pixels.
+    uint32_t bits = ~movemask(cmpeq(v, zero)) & 0xffff;
+    if (bits == (inRun ? 0xffffu : 0u))
+      continue;
+
+    // Scan for the next transition: the next set bit outside a run, or the
+    // next clear bit inside one.
+    uint32_t offset = 0;
+    while (offset < width) {
+      const uint32_t pending =
+        (inRun ? ~bits : bits) & (0xffffu << offset) & 0xffffu;
+      if (pending == 0)
+        break;
+      offset = __builtin_ctz(pending);
+      if (inRun)
+        runs.push_back(Run{start, static_cast<uint32_t>(c + offset)});
+      else
+        start = static_cast<uint32_t>(c + offset);
+      inRun = !inRun;
+    }
+  }
+
+  for (; c < cols; ++c) {
+    if ((row[c] != 0) == inRun)
+      continue;
+    if (inRun)
+      runs.push_back(Run{start, static_cast<uint32_t>(c)});
+    else
+      start = static_cast<uint32_t>(c);
+    inRun = !inRun;
+  }
+  if (inRun)
+    runs.push_back(Run{start, static_cast<uint32_t>(cols)});
+}
+
+/// Returns the root of the run with \p index in the union find forest
+/// \p parents, halving the path to it.
+/// \param[in] parents The parent of each run.
+/// \param[in] index   The index of the run.
+static inline uint32_t find_root(uint32_t* parents, uint32_t index) {
+  while (parents[index] != index) {
+    parents[index] = parents[parents[index]];
+    index          = parents[index];
+  }
+  return index;
+}
+
+/// Merges the sets of the runs with indices \p a and \p b in the union find
+/// forest \p parents. The root of the merged set is the smaller root, so
+/// the root of each component is its first run in raster order.
+/// \param[in] parents The parent of each run.
+/// \param[in] a       The index of the first run.
+/// \param[in] b       The index of the second run.
+static inline void unite(uint32_t* parents, uint32_t a, uint32_t b) {
+  a = find_root(parents, a);
+  b = find_root(parents, b);
+  if (a < b)
+    parents[b] = a;
+  else if (b < a)
+    parents[a] = b;
+}
+
+/// Merges the \p upperCount runs at \p upper of a row with the connected
+/// \p lowerCount runs at \p lower of the next row, where the first runs of
+/// the rows have the indices \p upperIndex and \p lowerIndex in \p parents.
+/// \param[in] upper        The runs of the upper row.
+/// \param[in] upperCount   The number of runs of the upper row.
+/// \param[in] upperIndex   The index of the first run of the upper row.
+/// \param[in] lower        The runs of the lower row.
+/// \param[in] lowerCount   The number of runs of the lower row.
+/// \param[in] lowerIndex   The index of the first run of the lower row.
+/// \param[in] connectivity The connectivity of the pixels.
+/// \param[in] parents      The parent of each run.
+static inline void merge_rows(const Run* upper, uint32_t upperCount,
+    uint32_t upperIndex, const Run* lower, uint32_t lowerCount,
+    uint32_t lowerIndex, Connectivity connectivity, uint32_t* parents) {
+  // Diagonal neighbours are connected by growing the runs by one pixel.
+  const uint32_t grow = connectivity == CN_8 ? 1 : 0;
+  uint32_t i = 0, j = 0;
+  while (i < upperCount && j < lowerCount) {
+    const Run& a = upper[i];
+    const Run& b = lower[j];
+    if (a.start < b.end + grow && b.start < a.end + grow)
+      unite(parents, upperIndex + i, lowerIndex + j);
+    if (a.end < b.end)
+      ++i;
+    else
+      ++j;
+  }
+}
+
+} // namespace detail
+
+/// Defines a labeler of the connected components of binary masks, where
+/// any non zero pixel is foreground. The runs of foreground pixels of each
+/// row are found with vector compares, and the connected runs of adjacent
+/// rows are merged with union find. When labeling in parallel, each thread
+/// extracts and merges the runs of a band of rows, and the runs at the
+/// boundaries of the bands are merged afterwards. The labeler keeps its
+/// buffers between calls, so that labeling masks of the same size does not
+/// allocate after the first call.
+class ComponentLabeler {
+ public:
+  /// Constructor: Creates a labeler for the \p connectivity.
+  /// \param[in] connectivity The connectivity of the pixels.
+  explicit ComponentLabeler(Connectivity connectivity = CN_8)
+  : Connect(connectivity) {}
+
+  /// Returns the connectivity of the labeler.
+  Connectivity connectivity() const { return Connect; }
+
+  /// Finds the connected components of \p mask, and writes their
+  /// statistics to \p blobs, in the raster order of their first pixels.
+  /// Returns the number of components.
+  /// \param[in] mask   The mask to label.
+  /// \param[in] blobs  The statistics of each component.
+  /// \param[in] policy The execution policy.
+  template <uint8_t F, typename A>
+  size_t label(const Matrix<F, A>& mask, std::vector<Blob>& blobs,
+               ExecutionPolicy policy = EP_SERIAL) {
+    return label(mask, nullptr, blobs, policy);
+  }
+
+  /// Finds the connected components of \p mask, writes their statistics to
+  /// \p blobs, in the raster order of their first pixels, and writes the
+  /// label of each pixel to \p labels, which must have space for
+  /// mask.rows() * mask.cols() labels, with rows of mask.cols() labels. The
+  /// label of the background is 0, and the label of each component is its
+  /// index in \p blobs plus one. Returns the number of components.
+  /// \param[in] mask   The mask to label.
+  /// \param[in] labels The labels of the pixels, or nullptr.
+  /// \param[in] blobs  The statistics of each component.
+  /// \param[in] policy The execution policy.
+  template <uint8_t F, typename A>
+  size_t label(const Matrix<F, A>& mask, uint32_t* labels,
+               std::vector<Blob>& blobs, ExecutionPolicy policy = EP_SERIAL);
+
+ private:
+  /// Defines the runs of a band of rows.
+  struct Band {
+    size_t                   begin;     //!< The first row of the band.
+    size_t                   end;       //!< The end row of the band.
+    uint32_t                 base;      //!< The global index of the runs.
+    std::vector<detail::Run> runs;      //!< The runs of the band.
+    std::vector<uint32_t>    rowStarts; //!< The first run of each row.
+  };
+
+  Connectivity          Connect;  //!< The connectivity of the pixels.
+  std::vector<Band>     Bands;    //!< The runs of each band.
+  std::vector<uint32_t> Parents;  //!< The union find forest of the runs.
+  std::vector<uint32_t> Labels;   //!< The label of each root run.
+
+  /// Returns the global index of the first run of \p row of \p band.
+  static uint32_t rowStart(const Band& band, size_t row) {
+    return band.base + band.rowStarts[row - band.begin];
+  }
+};
+
+// ---- Implementation ----------------------------------------------------- //
+
+template <uint8_t F, typename A>
+size_t ComponentLabeler::label(const Matrix<F, A>& mask  ,
+                               uint32_t*           labels,
+                               std::vector<Blob>&  blobs ,
+                               ExecutionPolicy     policy) {
+  const auto in = detail::make_region(mask);
+  SNAP_INSTRUMENT_KERNEL("alg::ComponentLabeler::label", in.size(),
+    labels ? 5 * in.size() : in.size());
+  blobs.clear();
+  if (in.size() == 0)
+    return 0;
+
+  const size_t chunks = std::max<size_t>(1, std::min(in.rows,
+    util::par::chunk_count(in.size(), policy, detail::MIN_PARALLEL_ELEMENTS)));
+  if (Bands.size() < chunks)
+    Bands.resize(chunks);
+
+  // Extract the runs of each band, and merge the runs within the band.
+  util::par::parallel_for(0, in.rows, chunks,
+    [&] (size_t begin, size_t end, size_t chunk) {
+      Band& band  = Bands[chunk];
+      band.begin  = begin;
+      band.end    = end;
+      band.runs.clear();
+      band.rowStarts.clear();
+      for (size_t r = begin; r < end; ++r) {
+        band.rowStarts.push_back(static_cast<uint32_t>(band.runs.size()));
+        detail::extract_runs(in.row(r), in.cols, band.runs);
+      }
+      band.rowStarts.push_back(static_cast<uint32_t>(band.runs.size()));
+    }
+  );
+
+  uint32_t total = 0;
+  for (size_t i = 0; i < chunks; ++i) {
+    Bands[i].base = total;
+    total        += static_cast<uint32_t>(Bands[i].runs.size());
+  }
+  Parents.resize(total);
+
+  // The runs of each band are stored separately, so each thread merges the
+  // runs with a view of the parents which is offset to the band.
+  util::par::parallel_for(0, chunks, chunks,
+    [&] (size_t chunk, size_t, size_t) {
+      const Band& band    = Bands[chunk];
+      uint32_t*   parents = Parents.data() + band.base;
+      for (uint32_t i = 0; i < band.runs.size(); ++i)
+        parents[i] = i;
+      const auto& starts = band.rowStarts;
+      for (size_t row = 1; row + band.begin < band.end; ++row) {
+        detail::merge_rows(&band.runs[starts[row - 1]],
+          starts[row] - starts[row - 1], starts[row - 1],
+          &band.runs[starts[row]], starts[row + 1] - starts[row],
+          starts[row], Connect, parents);
+      }
+      for (uint32_t i = 0; i < band.runs.size(); ++i)
+        parents[i] += band.base;
+    }
+  );
+
+  // Merge the last row of each band with the first row of the next band,
+  // with the runs of both bands in the global index space.
+  for (size_t i = 1; i < chunks; ++i) {
+    const Band& above = Bands[i - 1];
+    const Band& below = Bands[i];
+    if (above.end == above.begin || below.end == below.begin)
+      continue;
+
+    const uint32_t upper = rowStart(above, above.end - 1);
+    const uint32_t lower = rowStart(below, below.begin);
+    detail::merge_rows(&above.runs[upper - above.base],
+      rowStart(above, above.end) - upper, upper,
+      &below.runs[lower - below.base],
+      rowStart(below, below.begin + 1) - lower, lower,
+      Connect, Parents.data());
+  }
+
+  // Label the roots in raster order, which is the order of the runs since
+  // each root is the first run of its component, and accumulate the
+  // statistics of each run into its blob.
+  // The centroids accumulate the sums of the coordinates of the pixels
+  // until they are divided by the areas.
+  Labels.resize(total);
+  for (size_t i = 0; i < chunks; ++i) {
+    const Band& band = Bands[i];
+    for (size_t r = band.begin; r < band.end; ++r) {
+      const uint32_t first = rowStart(band, r), last = rowStart(band, r + 1);
+      for (uint32_t index = first; index < last; ++index) {
+        const auto&    run  = band.runs[index - band.base];
+        const uint32_t root = detail::find_root(Parents.data(), index);
+        if (root == index) {
+          Labels[index] = static_cast<uint32_t>(blobs.size() + 1);
+          blobs.push_back(Blob{Labels[index], 0,
+            Rect{run.start, r, run.end - run.start, 1}, 0.0, 0.0});
+        }
+        Labels[index] = Labels[root];
+
+        const uint32_t id     = Labels[index] - 1;
+        const uint64_t length = run.end - run.start;
+        Blob&          blob   = blobs[id];
+        const size_t   right  =
+          std::max<size_t>(blob.bounds.x + blob.bounds.width, run.end);
+        blob.bounds.x      = std::min<size_t>(blob.bounds.x, run.start);
+        blob.bounds.width  = right - blob.bounds.x;
+        blob.bounds.height = r + 1 - blob.bounds.y;
+        blob.area         += length;
+        // The sum of the columns start, ..., end - 1.
+        blob.cx += 0.5 * double(length) * double(run.start + run.end - 1);
+        blob.cy += double(length) * double(r);
+      }
+    }
+  }
+  for (auto& blob : blobs) {
+    blob.cx /= double(blob.area);
+    blob.cy /= double(blob.area);
+  }
+
+  if (labels != nullptr) {
+    util::par::parallel_for(0, chunks, chunks,
+      [&] (size_t chunk, size_t, size_t) {
+        const Band& band = Bands[chunk];
+        for (size_t r = band.begin; r < band.end; ++r) {
+          uint32_t* row = labels + r * in.cols;
+          std::fill(row, row + in.cols, 0u);
+          const uint32_t first = rowStart(band, r);
+          const uint32_t last  = rowStart(band, r + 1);
+          for (uint32_t index = first; index < last; ++index) {
+            const auto& run = band.runs[index - band.base];
+            std::fill(row + run.start, row + run.end, Labels[index]);
+          }
+        }
+      }
+    );
+  }
+  return blobs.size();
+}
+
+} // namespace alg
+} // namespace snap
+
+#endif // SNAP_ALGORITHM_COMPONENTS_HPP
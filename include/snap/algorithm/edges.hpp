@@ -0,0 +1,322 @@
+//---- snap/algorithm/edges.hpp ---------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  edges.hpp
+/// \brief Defines the Canny edge detector. The Sobel gradient magnitude and
+///        quantized direction are computed together in 16-bit lanes into a
+///        few rolling row buffers, non-max suppression runs on the buffered
+///        rows as soon as the row below is ready, and the hysteresis only
+///        visits the candidate edges, so there are no full frame
+///        intermediates.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_ALGORITHM_EDGES_HPP
+#define SNAP_ALGORITHM_EDGES_HPP
+
+#include "features.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace snap {
+namespace alg  {
+
+namespace detail {
+
+/// Defines the value of a candidate edge in the output of the non-max
+/// suppression, which is either connected to an edge by the hysteresis, or
+/// cleared.
+static constexpr uint8_t CANNY_WEAK = 1;
+
+/// Defines the value of an edge in the output of the Canny detector.
+static constexpr uint8_t CANNY_EDGE = 255;
+
+/// Defines the number of rolling row buffers of the gradients, which are
+/// the rows above, at and below the row which is suppressed.
+static constexpr size_t CANNY_ROWS = 3;
+
+/// Returns the quantized direction of the gradient (\p gx, \p gy): 0 when
+/// it is within 22.5 degrees of horizontal, 2 when it is within 22.5 degrees
+/// of vertical, and 1 or 3 for the diagonals where the signs of gx and gy
+/// are the same or different. tan(22.5) is approximated as 12 / 29, so that
+/// the products fit in 16 bits.
+/// \param[in] gx The horizontal gradient.
+/// \param[in] gy The vertical gradient.
+static SNAP_INLINE uint8_t gradient_direction(int gx, int gy) {
+  const int ax = std::abs(gx), ay = std::abs(gy);
+  if (12 * ax > 29 * ay)
+    return 0;
+  if (12 * ay > 29 * ax)
+    return 2;
+  return (gx ^ gy) >= 0 ? 1 : 3;
+}
+
+/// Computes the L1 magnitudes and the directions of the Sobel gradients of
+/// the 16 pixels starting at column \p c of \p row, where \p above and \p
+/// below are the adjacent rows. The pixels from column c - 1 to c + 16 must
+/// be valid. Each gradient is split into the sums of its positive and
+/// negative taps, which are at most 1020, so that everything is computed in
+/// unsigned 16-bit lanes: the absolute gradient is the or of the saturating
+/// differences of the sums, and its sign is whether the negative sum is
+/// larger. The magnitudes are at most 2040 and the products of the
+/// direction tests at most 29580.
+/// \param[in] above A pointer to the row above.
+/// \param[in] row   A pointer to the row.
+/// \param[in] below A pointer to the row below.
+/// \param[in] c     The first column.
+/// \param[in] mag   The magnitudes of the 16 pixels.
+/// \param[in] dir   The directions of the 16 pixels.
+static inline void canny_gradient_block(const uint8_t* above,
+                                        const uint8_t* row,
+                                        const uint8_t* below, size_t c,
+                                        uint16_t* mag, uint8_t* dir) {
+  const Vec8x16u zero(uint16_t(0)), two(uint16_t(2)), three(uint16_t(3));
+  const Vec8x16u k12(uint16_t(12)), k29(uint16_t(29));
+
+  Vec16x8u a[3], m[3], b[3];
+  for (size_t i = 0; i < 3; ++i) {
+    a[i].load(above + c + i - 1);
+    m[i].load(row + c + i - 1);
+    b[i].load(below + c + i - 1);
+  }
+
+  Vec8x16u dirs[2];
+  for (size_t h = 0; h < 2; ++h) {
+    const auto widen = [&] (const Vec16x8u& v) {
+      return h == 0 ? widen_lo(v) : widen_hi(v);
+    };
+    const Vec8x16u a0 = widen(a[0]), a1 = widen(a[1]), a2 = widen(a[2]);
+    const Vec8x16u m0 = widen(m[0]), m2 = widen(m[2]);
+    const Vec8x16u b0 = widen(b[0]), b1 = widen(b[1]), b2 = widen(b[2]);
+
+    // gx = px - nx and gy = py - ny.
+    const Vec8x16u px = a2 + b2 + m2 + m2, nx = a0 + b0 + m0 + m0;
+    const Vec8x16u py = b0 + b2 + b1 + b1, ny = a0 + a2 + a1 + a1;
+    const Vec8x16u ax = subs(px, nx) | subs(nx, px);
+    const Vec8x16u ay = subs(py, ny) | subs(ny, py);
+    (ax + ay).storeu(mag + 8 * h);
+
+    // A saturating difference is zero when the first value isn't greater.
+    const Vec8x16u notHorizontal = cmpeq(subs(ax * k12, ay * k29), zero);
+    const Vec8x16u notVertical   = cmpeq(subs(ay * k12, ax * k29), zero);
+    const Vec8x16u xPositive     = cmpeq(subs(nx, px), zero);
+    const Vec8x16u yPositive     = cmpeq(subs(ny, py), zero);
+    const Vec8x16u diagonal      = three - (~(xPositive ^ yPositive) & two);
+    dirs[h] = (~notVertical & two) | (notHorizontal & notVertical & diagonal);
+  }
+  narrow(dirs[0], dirs[1]).storeu(dir);
+}
+
+/// Computes the magnitudes and directions of the gradients of row \p r of
+/// \p image into \p mag and \p dir. The magnitudes of the rows and columns
+/// at the edges of the image, and of rows outside of it, are zero.
+/// \param[in] image The image.
+/// \param[in] r     The index of the row, which may be -1 or image.rows.
+/// \param[in] mag   The magnitudes of the row.
+/// \param[in] dir   The directions of the row.
+static inline void canny_gradient_row(const Region& image, int64_t r,
+                                      uint16_t* mag, uint8_t* dir) {
+  const size_t cols = image.cols;
+  if (r <= 0 || r + 1 >= int64_t(image.rows) || cols < 3) {
+    std::fill(mag, mag + cols, uint16_t(0));
+    return;
+  }
+
+  const uint8_t* row   = image.row(size_t(r));
+  const uint8_t* above = row - image.stride;
+  const uint8_t* below = row + image.stride;
+  mag[0] = mag[cols - 1] = 0;
+
+  size_t c = 1;
+  for (; c + Vec16x8u::width < cols; c += Vec16x8u::width)
+    canny_gradient_block(above, row, below, c, mag + c, dir + c);
+  for (; c + 1 < cols; ++c) {
+    int16_t gx, gy;
+    sobel_pixel(above, row, below, c, gx, gy);
+    mag[c] = static_cast<uint16_t>(std::abs(gx) + std::abs(gy));
+    dir[c] = gradient_direction(gx, gy);
+  }
+}
+
+/// Suppresses the pixels of a row which are not the max of their gradient
+/// direction, and writes the labels of the row to \p out: 0 for pixels
+/// with a magnitude of at most \p low, or which are suppressed, CANNY_EDGE
+/// for pixels with a magnitude over \p high, and CANNY_WEAK otherwise. A
+/// pixel must be greater than the neighbour before it, and at least the
+/// neighbour after it, so that only one of two equal pixels is kept. The
+/// offsets of the edges and weak candidates are added to \p strong and \p
+/// weak. Groups of 16 pixels with no magnitudes over \p low are skipped.
+/// \param[in] above  The magnitudes of the row above.
+/// \param[in] mag    The magnitudes of the row.
+/// \param[in] below  The magnitudes of the row below.
+/// \param[in] dir    The directions of the row.
+/// \param[in] cols   The number of pixels in the row.
+/// \param[in] low    The low threshold.
+/// \param[in] high   The high threshold.
+/// \param[in] out    A pointer to the output row.
+/// \param[in] offset The offset of the output row in the output.
+/// \param[in] strong The offsets of the edges.
+/// \param[in] weak   The offsets of the weak candidates.
+static inline void canny_suppress_row(const uint16_t* above,
+                                      const uint16_t* mag,
+                                      const uint16_t* below,
+                                      const uint8_t* dir, size_t cols,
+                                      uint16_t low, uint16_t high,
+                                      uint8_t* out, size_t offset,
+                                      std::vector<size_t>& strong,
+                                      std::vector<size_t>& weak) {
+  const auto suppress = [&] (size_t c) {
+    const uint16_t m = mag[c];
+    if (m <= low) {
+      out[c] = 0;
+      return;
+    }
+
+    bool keep;
+    switch (dir[c]) {
+      case 0 : keep = m > mag[c - 1]   && m >= mag[c + 1];   break;
+      case 2 : keep = m > above[c]     && m >= below[c];     break;
+      case 1 : keep = m > above[c - 1] && m >= below[c + 1]; break;
+      default: keep = m > above[c + 1] && m >= below[c - 1]; break;
+    }
+    if (!keep) {
+      out[c] = 0;
+    } else if (m > high) {
+      out[c] = CANNY_EDGE;
+      strong.push_back(offset + c);
+    } else {
+      out[c] = CANNY_WEAK;
+      weak.push_back(offset + c);
+    }
+  };
+
+  // The magnitudes over low are the non-zero saturating differences, which
+  // are narrowed so that a group is tested with a single movemask.
+  constexpr size_t width = Vec16x8u::width;
+  const Vec8x16u   threshold(low);
+  const Vec16x8u   none(uint8_t(0));
+  size_t c = 0;
+  for (; c + width <= cols; c += width) {
+    Vec8x16u lo, hi;
+    lo.load(mag + c);
+    hi.load(mag + c + width / 2);
+    const Vec16x8u over = narrow(subs(lo, threshold), subs(hi, threshold));
+    if (movemask(cmpeq(over, none)) == 0xffff) {
+      std::memset(out + c, 0, width);
+      continue;
+    }
+    for (size_t i = c; i < c + width; ++i)
+      suppress(i);
+  }
+  for (; c < cols; ++c)
+    suppress(c);
+}
+
+} // namespace detail
+
+/// Detects the edges of \p image with the Canny detector, and writes them
+/// to \p out, which must have the same dimensions and must not be \p image,
+/// as 255 for edges and 0 otherwise. The gradients are the 3x3 Sobel
+/// gradients, with the L1 magnitude |dx| + |dy|, which is in [0, 2040], and
+/// are zero at the edges of the image. Pixels with a magnitude over \p high
+/// which are the max in their gradient direction are edges, and those with
+/// a magnitude over \p low are edges when they are connected to an edge.
+///
+/// The rows are split into bands across the threads when \p policy is
+/// EP_PARALLEL. Each band keeps the magnitudes and directions of three rows
+/// in rolling buffers, and suppresses each row once the gradients of the
+/// row below have been computed, writing the candidates to \p out. The
+/// hysteresis then grows the edges into the connected weak candidates with
+/// a stack, and clears the remaining weak candidates, so it only visits
+/// the candidates.
+///
+/// \param[in] image  The image to detect the edges of.
+/// \param[in] out    The edges.
+/// \param[in] low    The low threshold of the gradient magnitude.
+/// \param[in] high   The high threshold, which must be at least \p low.
+/// \param[in] policy The execution policy.
+template <typename A, typename B>
+static inline void canny(const Matrix<mat::FM_GREY_8, A>& image            ,
+                         Matrix<mat::FM_GREY_8, B>&       out              ,
+                         uint16_t                         low              ,
+                         uint16_t                         high             ,
+                         ExecutionPolicy                  policy = EP_SERIAL) {
+  assert(image.rows() == out.rows() && image.cols() == out.cols());
+  assert(low <= high);
+  SNAP_INSTRUMENT_KERNEL("alg::canny", image.size(), 2 * image.size());
+
+  const auto   in     = detail::make_region(image);
+  const size_t cols   = in.cols;
+  const size_t stride = out.stride();
+  const size_t chunks = util::par::chunk_count(in.size(), policy,
+    detail::MIN_PARALLEL_ELEMENTS);
+  std::vector<std::vector<size_t>> strong(chunks), weak(chunks);
+
+  // The magnitude rows have a zero on each side, so that the neighbours of
+  // the first and last pixels can be read.
+  util::par::parallel_for(0, in.rows, chunks,
+    [&] (size_t begin, size_t end, size_t chunk) {
+      const size_t          width = cols + 2;
+      std::vector<uint16_t> mags(detail::CANNY_ROWS * width, 0);
+      std::vector<uint8_t>  dirs(detail::CANNY_ROWS * cols);
+      const auto magRow = [&] (int64_t r) {
+        return &mags[size_t(r + 1) % detail::CANNY_ROWS * width + 1];
+      };
+      const auto dirRow = [&] (int64_t r) {
+        return &dirs[size_t(r + 1) % detail::CANNY_ROWS * cols];
+      };
+      const auto gradients = [&] (int64_t r) {
+        detail::canny_gradient_row(in, r, magRow(r), dirRow(r));
+      };
+
+      gradients(int64_t(begin) - 1);
+      gradients(int64_t(begin));
+      for (size_t r = begin; r < end; ++r) {
+        const int64_t y = int64_t(r);
+        gradients(y + 1);
+        detail::canny_suppress_row(magRow(y - 1), magRow(y), magRow(y + 1),
+          dirRow(y), cols, low, high, out.data() + r * stride, r * stride,
+          strong[chunk], weak[chunk]);
+      }
+    }
+  );
+
+  uint8_t*      data          = out.data();
+  const int64_t s             = int64_t(stride);
+  const int64_t neighbours[8] = {-s - 1, -s, -s + 1, -1, 1, s - 1, s, s + 1};
+  std::vector<size_t> stack;
+  for (auto& edges : strong) {
+    stack.insert(stack.end(), edges.begin(), edges.end());
+    while (!stack.empty()) {
+      const size_t p = stack.back();
+      stack.pop_back();
+      for (const int64_t n : neighbours) {
+        uint8_t& q = data[int64_t(p) + n];
+        if (q == detail::CANNY_WEAK) {
+          q = detail::CANNY_EDGE;
+          stack.push_back(size_t(int64_t(p) + n));
+        }
+      }
+    }
+  }
+  for (const auto& candidates : weak) {
+    for (const size_t p : candidates)
+      data[p] = data[p] == detail::CANNY_WEAK ? 0 : data[p];
+  }
+}
+
+} // namespace alg
+} // namespace snap
+
+#endif // SNAP_ALGORITHM_EDGES_HPP
@@ -0,0 +1,586 @@
+//---- snap/algorithm/features.hpp ------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  features.hpp
+/// \brief Defines a FAST corner detector, with FAST, Harris or Shi-Tomasi
+///        scoring of the corners, 3x3 non-max suppression, and grid bucketed
+///        selection of the strongest corners into a preallocated buffer of
+///        keypoints. Also defines a 3x3 Sobel gradient kernel.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_ALGORITHM_FEATURES_HPP
+#define SNAP_ALGORITHM_FEATURES_HPP
+
+#include "region.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+namespace snap {
+namespace alg  {
+
+/// Defines the possible variants of the FAST segment test, which are the
+/// number of contiguous pixels of the 16 pixel ring which must all be
+/// brighter or darker than the centre.
+enum FastType : uint8_t {
+  FT_9  = 9,        //!< FAST-9, which finds the most corners.
+  FT_12 = 12        //!< FAST-12, which rejects non-corners faster.
+};
+
+/// Defines the possible scores of the corners, which are used for the non
+/// max suppression and to select the strongest corners in each grid cell.
+enum CornerScore : uint8_t {
+  CS_FAST       = 0,  //!< The sum of the differences over the threshold.
+  CS_HARRIS     = 1,  //!< The Harris response of a 7x7 window.
+  CS_SHI_TOMASI = 2   //!< The min eigenvalue of the 7x7 structure tensor.
+};
+
+/// Defines a detected keypoint.
+struct KeyPoint {
+  float   x;          //!< The column, scaled to the base pyramid level.
+  float   y;          //!< The row, scaled to the base pyramid level.
+  float   response;   //!< The score of the corner.
+  uint8_t level;      //!< The pyramid level the keypoint was found in.
+};
+
+/// Defines a buffer of keypoints with a fixed capacity, which is allocated
+/// once so that detection does not allocate for each frame. Keypoints which
+/// don't fit are dropped and counted.
+class KeyPoints {
+ public:
+  /// Constructor: Creates an empty buffer for \p capacity keypoints.
+  /// \param[in] capacity The max number of keypoints.
+  explicit KeyPoints(size_t capacity)
+  : Points(capacity), Size(0), Dropped(0) {}
+
+  /// Adds \p point to the buffer, returning false if the buffer is full.
+  /// \param[in] point The keypoint to add.
+  bool push(const KeyPoint& point) {
+    if (Size == Points.size()) {
+      ++Dropped;
+      return false;
+    }
+    Points[Size++] = point;
+    return true;
+  }
+
+  /// Removes all the keypoints, keeping the allocation.
+  void clear() { Size = Dropped = 0; }
+
+  /// Returns the number of keypoints.
+  size_t size() const { return Size; }
+
+  /// Returns the max number of keypoints.
+  size_t capacity() const { return Points.size(); }
+
+  /// Returns the number of keypoints which were dropped since the last
+  /// clear because the buffer was full.
+  size_t dropped() const { return Dropped; }
+
+  /// Returns a pointer to the keypoints.
+  const KeyPoint* data() const { return Points.data(); }
+
+  /// Returns the keypoint at index \p i.
+  /// \param[in] i The index of the keypoint.
+  const KeyPoint& operator[](size_t i) const { return Points[i]; }
+
+  /// Returns an iterator to the first keypoint.
+  const KeyPoint* begin() const { return Points.data(); }
+
+  /// Returns an iterator past the last keypoint.
+  const KeyPoint* end() const { return Points.data() + Size; }
+
+ private:
+  std::vector<KeyPoint> Points;   //!< The storage for the keypoints.
+  size_t                Size;     //!< The number of keypoints.
+  size_t                Dropped;  //!< The number of dropped keypoints.
+};
+
+/// Defines the parameters of the FAST detector.
+struct FastParams {
+  uint8_t     threshold   = 20;       //!< The segment test threshold.
+  FastType    type        = FT_9;     //!< The segment test variant.
+  CornerScore score       = CS_FAST;  //!< The score of the corners.
+  size_t      cellSize    = 32;       //!< The size of the grid cells.
+  size_t      cellCorners = 4;        //!< The max corners in each cell.
+  float       harrisK     = 0.04f;    //!< The Harris sensitivity.
+};
+
+namespace detail {
+
+/// Defines the distance from the edges of an image within which corners
+/// are not detected: 3 for the ring, and 1 more for the Sobel gradients of
+/// the 7x7 window of the Harris and Shi-Tomasi scores.
+static constexpr size_t FEATURE_BORDER = 4;
+
+/// Defines the offsets of the 16 pixels of the Bresenham circle of radius 3
+/// around the centre, clockwise from the top.
+static constexpr int RING_X[16] =
+  { 0,  1,  2,  3, 3, 3, 2, 1, 0, -1, -2, -3, -3, -3, -2, -1};
+static constexpr int RING_Y[16] =
+  {-3, -3, -2, -1, 0, 1, 2, 3, 3,  3,  2,  1,  0, -1, -2, -3};
+
+/// Returns the bits of the lanes for which at least \p n contiguous ring
+/// pixels can pass, given the bits \p c0, \p c1, \p c2, \p c3 of the lanes
+/// for which the ring pixels at the compass points 0, 4, 8 and 12 pass.
+/// Any arc of 9 ring pixels contains two adjacent compass points, and any
+/// arc of 12 contains three.
+/// \param[in] c0 The lanes for which the top pixel passes.
+/// \param[in] c1 The lanes for which the right pixel passes.
+/// \param[in] c2 The lanes for which the bottom pixel passes.
+/// \param[in] c3 The lanes for which the left pixel passes.
+/// \param[in] n  The number of contiguous pixels.
+static inline uint32_t compass_candidates(uint32_t c0, uint32_t c1,
+    uint32_t c2, uint32_t c3, size_t n) {
+  return n == FT_12
+    ? (c0 & c1 & c2) | (c1 & c2 & c3) | (c2 & c3 & c0) | (c3 & c0 & c1)
+    : (c0 & c1) | (c1 & c2) | (c2 & c3) | (c3 & c0);
+}
+
+/// Returns the FAST score of the pixel at \p p, which is the larger of the
+/// sums of the amounts by which the brighter and darker ring pixels exceed
+/// the \p threshold, or 0 if the pixel is not a corner for the \p type of
+/// segment test.
+/// \param[in] p         A pointer to the pixel.
+/// \param[in] stride    The stride between rows of the image.
+/// \param[in] threshold The segment test threshold.
+/// \param[in] type      The segment test variant.
+static inline uint16_t fast_score(const uint8_t* p, size_t stride,
+    int threshold, size_t type) {
+  const int centre = *p;
+  int    sums[2] = {0, 0};
+  size_t runs[2] = {0, 0}, best[2] = {0, 0};
+  for (size_t k = 0; k < 16 + type - 1; ++k) {
+    const size_t i = k & 15;
+    const int    d =
+      p[RING_Y[i] * static_cast<ptrdiff_t>(stride) + RING_X[i]] - centre;
+    const bool   brighter = d > threshold, darker = d < -threshold;
+    runs[0] = brighter ? runs[0] + 1 : 0;
+    runs[1] = darker   ? runs[1] + 1 : 0;
+    best[0] = std::max(best[0], runs[0]);
+    best[1] = std::max(best[1], runs[1]);
+    if (k < 16) {
+      sums[0] += brighter ? d - threshold  : 0;
+      sums[1] += darker   ? -d - threshold : 0;
+    }
+  }
+  if (best[0] < type && best[1] < type)
+    return 0;
+  return static_cast<uint16_t>(std::max(sums[0], sums[1]));
+}
+
+/// Computes the FAST scores of the pixels in columns [\p begin, \p end) of
+/// \p row, writing the scores of the corners to \p scores and appending
+/// their columns to \p corners. The pixels are tested 16 at a time: the
+/// ring pixels are compared with the centres with saturating arithmetic,
+/// the compass points reject the blocks without corners using movemask,
+/// and the longest runs of brighter and darker ring pixels are counted in
+/// the lanes of a vector. The ring of each pixel must be in the image.
+/// \param[in] row       A pointer to the row.
+/// \param[in] stride    The stride between rows of the image.
+/// \param[in] begin     The first column to test.
+/// \param[in] end       The end of the columns to test.
+/// \param[in] threshold The segment test threshold.
+/// \param[in] type      The segment test variant.
+/// \param[in] scores    The scores of the row.
+/// \param[in] corners   The columns of the corners of the row.
+static inline void fast_row(const uint8_t* row, size_t stride, size_t begin,
+    size_t end, uint8_t threshold, size_t type, uint16_t* scores,
+    std::vector<uint32_t>& corners) {
+  constexpr size_t width = Vec16x8u::width;
+  const Vec16x8u   zero(uint8_t(0)), one(uint8_t(1)), t(threshold);
+  const Vec16x8u   n(static_cast<uint8_t>(type));
+
+  size_t c = begin;
+  for (; c + width <= end; c += width) {
+    Vec16x8u p; p.load(row + c);
+    const auto hi = adds(p, t), lo = subs(p, t);
+
+    // Lanes are all ones where the ring pixel is NOT brighter (darker), so
+    // that a saturating subtract resets the run of the lane.
+    Vec16x8u notBrighter[16], notDarker[16];
+    for (size_t k = 0; k < 16; ++k) {
+      Vec16x8u ring;
+      ring.load(row + RING_Y[k] * static_cast<ptrdiff_t>(stride)
+                    + RING_X[k] + c);
+      notBrighter[k] = cmpeq(subs(ring, hi), zero);
+      notDarker[k]   = cmpeq(subs(lo, ring), zero);
+    }
+
+    auto passes = [&] (const Vec16x8u* fails, size_t k) {
+      return ~movemask(fails[k]) & 0xffff;
+    };
+    const uint32_t candidates =
+      compass_candidates(passes(notBrighter, 0), passes(notBrighter, 4),
+        passes(notBrighter, 8), passes(notBrighter, 12), type) |
+      compass_candidates(passes(notDarker, 0), passes(notDarker, 4),
+        passes(notDarker, 8), passes(notDarker, 12), type);
+    if (candidates == 0)
+      continue;
+
+    Vec16x8u runBrighter(uint8_t(0)), runDarker(uint8_t(0));
+    Vec16x8u maxBrighter(uint8_t(0)), maxDarker(uint8_t(0));
+    for (size_t k = 0; k < 16 + type - 1; ++k) {
+      runBrighter = subs(adds(runBrighter, one), notBrighter[k & 15]);
+      runDarker   = subs(adds(runDarker  , one), notDarker[k & 15]);
+      maxBrighter = max(maxBrighter, runBrighter);
+      maxDarker   = max(maxDarker  , runDarker);
+    }
+
+    uint32_t found = candidates &
+      (movemask(cmpeq(min(maxBrighter, n), n)) |
+       movemask(cmpeq(min(maxDarker  , n), n)));
+    while (found != 0) {
+      const size_t col = c + __builtin_ctz(found);
+      found &= found - 1;
+      scores[col] = fast_score(row + col, stride, threshold, type);
+      corners.push_back(static_cast<uint32_t>(col));
+    }
+  }
+
+  for (; c < end; ++c) {
+    const uint16_t score = fast_score(row + c, stride, threshold, type);
+    if (score != 0) {
+      scores[c] = score;
+      corners.push_back(static_cast<uint32_t>(c));
+    }
+  }
+}
+
+/// Computes the 3x3 Sobel gradients of the 16 pixels starting at column
+/// \p c of \p row, where \p above and \p below are the adjacent rows. The
+/// pixels from column c - 1 to c + 16 must be valid. The gradients are
+/// computed in 16-bit lanes, which can't overflow.
+/// \param[in] above A pointer to the row above.
+/// \param[in] row   A pointer to the row.
+/// \param[in] below A pointer to the row below.
+/// \param[in] c     The first column.
+/// \param[in] dx    The horizontal gradients.
+/// \param[in] dy    The vertical gradients.
+static inline void sobel_block(const uint8_t* above, const uint8_t* row,
+    const uint8_t* below, size_t c, int16_t* dx, int16_t* dy) {
+  Vec16x8u a[3], m[3], b[3];
+  for (size_t i = 0; i < 3; ++i) {
+    a[i].load(above + c + i - 1);
+    m[i].load(row   + c + i - 1);
+    b[i].load(below + c + i - 1);
+  }
+
+  // Unsigned 16-bit arithmetic wraps, and the results are reinterpreted as
+  // signed, which is exact since they are in [-1020, 1020].
+  auto half = [&] (auto widen, size_t offset) {
+    const Vec8x16u a0 = widen(a[0]), a1 = widen(a[1]), a2 = widen(a[2]);
+    const Vec8x16u m0 = widen(m[0]), m2 = widen(m[2]);
+    const Vec8x16u b0 = widen(b[0]), b1 = widen(b[1]), b2 = widen(b[2]);
+    const Vec8x16u gx = (a2 - a0) + (m2 - m0) + (m2 - m0) + (b2 - b0);
+    const Vec8x16u gy = (b0 + b1 + b1 + b2) - (a0 + a1 + a1 + a2);
+    gx.storeu(reinterpret_cast<uint16_t*>(dx + offset));
+    gy.storeu(reinterpret_cast<uint16_t*>(dy + offset));
+  };
+  half([] (const Vec16x8u& v) { return widen_lo(v); }, 0);
+  half([] (const Vec16x8u& v) { return widen_hi(v); }, 8);
+}
+
+/// Computes the 3x3 Sobel gradients of the pixel at column \p c of \p row.
+/// \param[in] above A pointer to the row above.
+/// \param[in] row   A pointer to the row.
+/// \param[in] below A pointer to the row below.
+/// \param[in] c     The column.
+/// \param[in] dx    The horizontal gradient.
+/// \param[in] dy    The vertical gradient.
+static inline void sobel_pixel(const uint8_t* above, const uint8_t* row,
+    const uint8_t* below, size_t c, int16_t& dx, int16_t& dy) {
+  dx = static_cast<int16_t>((above[c + 1] - above[c - 1]) +
+    2 * (row[c + 1] - row[c - 1]) + (below[c + 1] - below[c - 1]));
+  dy = static_cast<int16_t>((below[c - 1] + 2 * below[c] + below[c + 1]) -
+    (above[c - 1] + 2 * above[c] + above[c + 1]));
+}
+
+/// Computes the Sobel gradients of the columns [\p begin, \p end) of
+/// \p row, 16 at a time, where the columns from begin - 1 to end must be
+/// valid.
+/// \param[in] above A pointer to the row above.
+/// \param[in] row   A pointer to the row.
+/// \param[in] below A pointer to the row below.
+/// \param[in] begin The first column.
+/// \param[in] end   The end of the columns.
+/// \param[in] dx    The horizontal gradients of the row.
+/// \param[in] dy    The vertical gradients of the row.
+static inline void sobel_row(const uint8_t* above, const uint8_t* row,
+    const uint8_t* below, size_t begin, size_t end, int16_t* dx,
+    int16_t* dy) {
+  constexpr size_t width = Vec16x8u::width;
+  size_t c = begin;
+  for (; c + width <= end; c += width)
+    sobel_block(above, row, below, c, dx + c, dy + c);
+  for (; c < end; ++c)
+    sobel_pixel(above, row, below, c, dx[c], dy[c]);
+}
+
+/// Returns the Harris or Shi-Tomasi response of the 7x7 window centred on
+/// the pixel at column \p x of row \p y of \p image, from the structure
+/// tensor of the Sobel gradients, which are scaled to [-1, 1].
+/// \param[in] image The image.
+/// \param[in] x     The column of the pixel.
+/// \param[in] y     The row of the pixel.
+/// \param[in] score The score, which must be CS_HARRIS or CS_SHI_TOMASI.
+/// \param[in] k     The Harris sensitivity.
+static inline float corner_response(const Region& image, size_t x, size_t y,
+    CornerScore score, float k) {
+  constexpr size_t radius = 3, size = 2 * radius + 1;
+  int16_t dx[Vec16x8u::width], dy[Vec16x8u::width];
+
+  const size_t left = x - radius;
+  int64_t      xx   = 0, yy = 0, xy = 0;
+  for (size_t r = y - radius; r <= y + radius; ++r) {
+    const uint8_t* row = image.row(r);
+    if (left + Vec16x8u::width < image.cols) {
+      sobel_block(row - image.stride, row, row + image.stride, left, dx, dy);
+    } else {
+      for (size_t i = 0; i < size; ++i)
+        sobel_pixel(row - image.stride, row, row + image.stride, left + i,
+          dx[i], dy[i]);
+    }
+    for (size_t i = 0; i < size; ++i) {
+      xx += dx[i] * dx[i];
+      yy += dy[i] * dy[i];
+      xy += dx[i] * dy[i];
+    }
+  }
+
+  const double scale = 1.0 / (4.0 * 255.0);
+  const double a = xx * scale * scale, b = xy * scale * scale;
+  const double c = yy * scale * scale;
+  if (score == CS_HARRIS)
+    return static_cast<float>(a * c - b * b - k * (a + c) * (a + c));
+  return static_cast<float>(
+    0.5 * (a + c) - std::sqrt(0.25 * (a - c) * (a - c) + b * b));
+}
+
+} // namespace detail
+
+/// Computes the 3x3 Sobel gradients of \p image into \p dx and \p dy,
+/// which must have space for image.rows() * image.cols() elements, with
+/// rows of image.cols() elements. The gradients at the edges of the image
+/// are zero. When \p policy is EP_PARALLEL the rows are split across
+/// threads.
+/// \param[in] image  The image to compute the gradients of.
+/// \param[in] dx     The horizontal gradients.
+/// \param[in] dy     The vertical gradients.
+/// \param[in] policy The execution policy.
+template <uint8_t F, typename A>
+static inline void sobel(const Matrix<F, A>& image, int16_t* dx,
+    int16_t* dy, ExecutionPolicy policy = EP_SERIAL) {
+  const auto   in   = detail::make_region(image);
+  const size_t rows = in.rows, cols = in.cols;
+  SNAP_INSTRUMENT_KERNEL("alg::sobel", in.size(), 5 * in.size());
+
+  const size_t chunks = util::par::chunk_count(in.size(), policy,
+    detail::MIN_PARALLEL_ELEMENTS);
+  util::par::parallel_for(0, rows, chunks,
+    [&] (size_t begin, size_t end, size_t) {
+      for (size_t r = begin; r < end; ++r) {
+        int16_t* rowDx = dx + r * cols;
+        int16_t* rowDy = dy + r * cols;
+        if (r == 0 || r + 1 >= rows || cols < 3) {
+          std::fill(rowDx, rowDx + cols, int16_t(0));
+          std::fill(rowDy, rowDy + cols, int16_t(0));
+          continue;
+        }
+        rowDx[0] = rowDy[0] = rowDx[cols - 1] = rowDy[cols - 1] = 0;
+        detail::sobel_row(in.row(r - 1), in.row(r), in.row(r + 1), 1,
+          cols - 1, rowDx, rowDy);
+      }
+    }
+  );
+}
+
+/// Defines a FAST corner detector. The segment test finds the corners,
+/// which are scored and suppressed when a neighbour in their 3x3 window
+/// has a higher FAST score. The remaining corners are scored with the
+/// FastParams::score, and the FastParams::cellCorners strongest corners of
+/// each cell of a grid of FastParams::cellSize cells are added to the
+/// keypoints, so that the keypoints are spread over the image. The
+/// detector keeps its buffers between calls, so that detecting on frames
+/// of the same size does not allocate.
+class FastDetector {
+ public:
+  /// Constructor: Creates a detector with the \p params.
+  /// \param[in] params The parameters of the detector.
+  explicit FastDetector(const FastParams& params = FastParams())
+  : Params(params) {
+    assert(Params.cellSize > 0 && Params.cellCorners > 0);
+  }
+
+  /// Returns the parameters of the detector.
+  const FastParams& params() const { return Params; }
+
+  /// Detects the corners of \p image and adds them to \p keypoints, which
+  /// is not cleared, so that the keypoints of each level of a pyramid can
+  /// be added to the same buffer. The keypoints are added in the row major
+  /// order of the grid cells, and the coordinates are multiplied by
+  /// \p scale. When \p policy is EP_PARALLEL, the rows of grid cells are
+  /// split across threads. Returns the number of keypoints which are added.
+  /// \param[in] image     The image to detect the corners of.
+  /// \param[in] keypoints The buffer to add the keypoints to.
+  /// \param[in] level     The pyramid level of the image.
+  /// \param[in] scale     The scale from the image to the base level.
+  /// \param[in] policy    The execution policy.
+  template <uint8_t F, typename A>
+  size_t detect(const Matrix<F, A>& image      ,
+                KeyPoints&          keypoints  ,
+                uint8_t             level  = 0 ,
+                float               scale  = 1.0f,
+                ExecutionPolicy     policy = EP_SERIAL);
+
+ private:
+  /// Defines the buffers of a thread: three rows of scores, which are zero
+  /// except at the corners, and the columns of the corners of each row.
+  struct Scratch {
+    std::vector<uint16_t> scores;       //!< The rolling rows of scores.
+    std::vector<uint32_t> corners[3];   //!< The corners of each row.
+  };
+
+  FastParams            Params;   //!< The parameters of the detector.
+  std::vector<Scratch>  Scratches;//!< The buffers of each thread.
+  std::vector<KeyPoint> Cells;    //!< The strongest corners of each cell.
+  std::vector<uint32_t> Counts;   //!< The number of corners in each cell.
+
+  /// Detects the corners of the rows [\p begin, \p end) of \p image into
+  /// the cells, using the buffers in \p scratch.
+  void detectRows(const detail::Region& image, size_t begin, size_t end,
+    size_t cellsX, Scratch& scratch);
+
+  /// Adds the corner at column \p x of row \p y with \p response to its
+  /// cell, replacing the weakest corner if the cell is full.
+  void addToCell(size_t cell, float x, float y, float response) {
+    KeyPoint* corners = &Cells[cell * Params.cellCorners];
+    uint32_t& count   = Counts[cell];
+    if (count < Params.cellCorners) {
+      corners[count++] = KeyPoint{x, y, response, 0};
+      return;
+    }
+    KeyPoint* weakest = std::min_element(corners, corners + count,
+      [] (const KeyPoint& a, const KeyPoint& b) {
+        return a.response < b.response;
+      });
+    if (response > weakest->response)
+      *weakest = KeyPoint{x, y, response, 0};
+  }
+};
+
+// ---- Implementation ----------------------------------------------------- //
+
+inline void FastDetector::detectRows(const detail::Region& image, size_t begin,
+    size_t end, size_t cellsX, Scratch& scratch) {
+  using namespace detail;
+  const size_t cols = image.cols;
+  const size_t top  = FEATURE_BORDER, bottom = image.rows - FEATURE_BORDER;
+  const size_t left = FEATURE_BORDER, right  = cols - FEATURE_BORDER;
+
+  scratch.scores.assign(3 * cols, 0);
+  for (auto& corners : scratch.corners)
+    corners.clear();
+
+  // The scores of row r are in slot r % 3. The rows above and below the
+  // band are scored too, so that the corners of the band are suppressed by
+  // their neighbours in other bands.
+  auto scoreRow = [&] (size_t r) {
+    const size_t slot    = r % 3;
+    uint16_t*    scores  = &scratch.scores[slot * cols];
+    auto&        corners = scratch.corners[slot];
+    for (const auto c : corners)
+      scores[c] = 0;
+    corners.clear();
+    if (r >= top && r < bottom) {
+      fast_row(image.row(r), image.stride, left, right, Params.threshold,
+        Params.type, scores, corners);
+    }
+  };
+
+  const size_t first = std::max(begin, top), last = std::min(end, bottom);
+  if (first >= last)
+    return;
+
+  scoreRow(first - 1);
+  scoreRow(first);
+  for (size_t r = first; r < last; ++r) {
+    scoreRow(r + 1);
+    const uint16_t* above = &scratch.scores[((r - 1) % 3) * cols];
+    const uint16_t* row   = &scratch.scores[(r % 3) * cols];
+    const uint16_t* below = &scratch.scores[((r + 1) % 3) * cols];
+
+    // Ties are broken in raster order, so only one of equal neighbours
+    // is kept.
+    for (const auto c : scratch.corners[r % 3]) {
+      const uint16_t s = row[c];
+      if (s <= above[c - 1] || s <= above[c] || s <= above[c + 1] ||
+          s <= row[c - 1]   || s <  row[c + 1] ||
+          s <  below[c - 1] || s <  below[c] || s <  below[c + 1])
+        continue;
+
+      const float response = Params.score == CS_FAST ? float(s) :
+        corner_response(image, c, r, Params.score, Params.harrisK);
+      addToCell((r / Params.cellSize) * cellsX + c / Params.cellSize,
+        float(c), float(r), response);
+    }
+  }
+}
+
+template <uint8_t F, typename A>
+size_t FastDetector::detect(const Matrix<F, A>& image    ,
+                            KeyPoints&          keypoints,
+                            uint8_t             level    ,
+                            float               scale    ,
+                            ExecutionPolicy     policy   ) {
+  const auto in = detail::make_region(image);
+  SNAP_INSTRUMENT_KERNEL("alg::FastDetector::detect", in.size(), in.size());
+  if (in.rows <= 2 * detail::FEATURE_BORDER ||
+      in.cols <= 2 * detail::FEATURE_BORDER)
+    return 0;
+
+  const size_t cellSize = Params.cellSize;
+  const size_t cellsX   = (in.cols + cellSize - 1) / cellSize;
+  const size_t cellsY   = (in.rows + cellSize - 1) / cellSize;
+  Cells.resize(cellsX * cellsY * Params.cellCorners);
+  Counts.assign(cellsX * cellsY, 0);
+
+  // Each thread detects whole rows of cells, so no two threads write to
+  // the same cell.
+  const size_t chunks = std::min(cellsY, util::par::chunk_count(in.size(),
+    policy, detail::MIN_PARALLEL_ELEMENTS));
+  if (Scratches.size() < chunks)
+    Scratches.resize(chunks);
+
+  util::par::parallel_for(0, cellsY, chunks,
+    [&] (size_t begin, size_t end, size_t chunk) {
+      detectRows(in, begin * cellSize, std::min(end * cellSize, in.rows),
+        cellsX, Scratches[chunk]);
+    }
+  );
+
+  size_t added = 0;
+  for (size_t cell = 0; cell < Counts.size(); ++cell) {
+    const KeyPoint* corners = &Cells[cell * Params.cellCorners];
+    for (size_t i = 0; i < Counts[cell]; ++i) {
+      added += keypoints.push(KeyPoint{corners[i].x * scale,
+        corners[i].y * scale, corners[i].response, level});
+    }
+  }
+  return added;
+}
+
+} // namespace alg
+} // namespace snap
+
+#endif // SNAP_ALGORITHM_FEATURES_HPP
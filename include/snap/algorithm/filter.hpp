@@ -0,0 +1,354 @@
+//---- snap/algorithm/filter.hpp --------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  filter.hpp
+/// \brief Defines the median filter. The 3x3 and 5x5 medians are selected
+///        with min/max networks on 16 elements at a time, and larger medians
+///        with the constant time histogram method of Perreault and Hébert,
+///        where the cost per element doesn't depend on the radius.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_ALGORITHM_FILTER_HPP
+#define SNAP_ALGORITHM_FILTER_HPP
+
+#include "transform.hpp"
+#include "snap/utility/performance.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+namespace snap {
+namespace alg  {
+
+namespace detail {
+
+/// Defines the max radius of the median filter, for which the counts of the
+/// histograms of the windows fit in 16 bits.
+static constexpr size_t MEDIAN_MAX_RADIUS = 127;
+
+/// Defines the comparators of a network which moves the median of 9 values
+/// to index 4.
+static constexpr uint8_t MEDIAN_9[19][2] = {
+  {1, 2}, {4, 5}, {7, 8}, {0, 1}, {3, 4}, {6, 7}, {1, 2}, {4, 5}, {7, 8},
+  {0, 3}, {5, 8}, {4, 7}, {3, 6}, {1, 4}, {2, 5}, {4, 7}, {4, 2}, {6, 4},
+  {4, 2}};
+
+/// Defines the comparators of a network which moves the median of 25 values
+/// to index 12.
+static constexpr uint8_t MEDIAN_25[99][2] = {
+  { 0,  1}, { 3,  4}, { 2,  4}, { 2,  3}, { 6,  7}, { 5,  7}, { 5,  6},
+  { 9, 10}, { 8, 10}, { 8,  9}, {12, 13}, {11, 13}, {11, 12}, {15, 16},
+  {14, 16}, {14, 15}, {18, 19}, {17, 19}, {17, 18}, {21, 22}, {20, 22},
+  {20, 21}, {23, 24}, { 2,  5}, { 3,  6}, { 0,  6}, { 0,  3}, { 4,  7},
+  { 1,  7}, { 1,  4}, {11, 14}, { 8, 14}, { 8, 11}, {12, 15}, { 9, 15},
+  { 9, 12}, {13, 16}, {10, 16}, {10, 13}, {20, 23}, {17, 23}, {17, 20},
+  {21, 24}, {18, 24}, {18, 21}, {19, 22}, { 8, 17}, { 9, 18}, { 0, 18},
+  { 0,  9}, {10, 19}, { 1, 19}, { 1, 10}, {11, 20}, { 2, 20}, { 2, 11},
+  {12, 21}, { 3, 21}, { 3, 12}, {13, 22}, { 4, 22}, { 4, 13}, {14, 23},
+  { 5, 23}, { 5, 14}, {15, 24}, { 6, 24}, { 6, 15}, { 7, 16}, { 7, 19},
+  {13, 21}, {15, 23}, { 7, 13}, { 7, 15}, { 1,  9}, { 3, 11}, { 5, 17},
+  {11, 17}, { 9, 17}, { 4, 10}, { 6, 12}, { 7, 14}, { 4,  6}, { 4,  7},
+  {12, 14}, {10, 14}, { 6,  7}, {10, 12}, { 6, 10}, { 6, 17}, {12, 17},
+  { 7, 17}, { 7, 10}, {12, 18}, { 7, 12}, {10, 18}, {12, 20}, {10, 20},
+  {10, 12}};
+
+/// Orders \p a and \p b so that \p a is the min and \p b is the max, for
+/// both elements and vectors of elements.
+/// \param[in] a The first value.
+/// \param[in] b The second value.
+template <typename T>
+static SNAP_INLINE void sort_pair(T& a, T& b) {
+  using std::min;
+  using std::max;
+  const T lo = min(a, b);
+  b = max(a, b);
+  a = lo;
+}
+
+/// Applies the comparators of the network \p net to the values \p p. The
+/// comparators are unrolled, so that the values stay in registers.
+/// \param[in] p   The values to apply the network to.
+/// \param[in] net The comparators of the network.
+template <typename T, size_t N>
+static SNAP_INLINE void apply_network(T* p, const uint8_t (&net)[N][2]) {
+  util::perf::unroll<0, N - 1>([&] (const UnrollIndex i) {
+    sort_pair(p[net[i][0]], p[net[i][1]]);
+  });
+}
+
+/// Moves the median of the 9 values \p p to index 4.
+/// \param[in] p The values.
+template <typename T>
+static SNAP_INLINE void select_median(T* p, std::integral_constant<size_t, 1>) {
+  apply_network(p, MEDIAN_9);
+}
+
+/// Moves the median of the 25 values \p p to index 12.
+/// \param[in] p The values.
+template <typename T>
+static SNAP_INLINE void select_median(T* p, std::integral_constant<size_t, 2>) {
+  apply_network(p, MEDIAN_25);
+}
+
+/// Computes the median of the (2R + 1) x (2R + 1) window around each element
+/// of rows \p begin to \p end with a median network, 16 elements at a time.
+/// The last vector of a row overlaps the previous one, so only rows with
+/// fewer than 16 elements are processed an element at a time.
+/// \param[in] in        A pointer to the first element of the input, which
+///                      must have a halo of at least R.
+/// \param[in] inStride  The stride of the input.
+/// \param[in] out       A pointer to the first element of the output.
+/// \param[in] outStride The stride of the output.
+/// \param[in] cols      The number of elements in each row.
+/// \param[in] begin     The first row to filter.
+/// \param[in] end       The end of the rows to filter.
+/// \tparam    R         The radius of the window, which must be 1 or 2.
+template <size_t R>
+static inline void median_network_rows(const uint8_t* in, size_t inStride,
+                                       uint8_t* out, size_t outStride,
+                                       size_t cols, size_t begin,
+                                       size_t end) {
+  constexpr size_t w = 2 * R + 1, n = w * w;
+
+  int64_t offsets[n];
+  for (size_t k = 0; k < n; ++k)
+    offsets[k] = (int64_t(k / w) - int64_t(R)) * int64_t(inStride) +
+                 int64_t(k % w) - int64_t(R);
+
+  for (size_t r = begin; r < end; ++r) {
+    const uint8_t* row = in + r * inStride;
+    uint8_t*       o   = out + r * outStride;
+    const auto vectorAt = [&] (size_t c) {
+      Vec16x8u p[n];
+      util::perf::unroll<0, n - 1>([&] (const UnrollIndex k) {
+        p[k].load(row + c + offsets[k]);
+      });
+      select_median(p, std::integral_constant<size_t, R>());
+      p[n / 2].storeu(o + c);
+    };
+
+    size_t c = 0;
+    for (; c + Vec16x8u::width <= cols; c += Vec16x8u::width)
+      vectorAt(c);
+    if (c < cols && cols >= Vec16x8u::width) {
+      vectorAt(cols - Vec16x8u::width);
+    } else {
+      for (; c < cols; ++c) {
+        uint8_t p[n];
+        for (size_t k = 0; k < n; ++k)
+          p[k] = row[int64_t(c) + offsets[k]];
+        select_median(p, std::integral_constant<size_t, R>());
+        o[c] = p[n / 2];
+      }
+    }
+  }
+}
+
+/// Defines a histogram for the histogram median filter, with 256 fine bins,
+/// and 16 coarse bins which each count the values of 16 fine bins, so that
+/// the median is found by scanning at most 32 bins.
+struct MedianHistogram {
+  uint16_t coarse[16];    //!< The counts of the values with each high nibble.
+  uint16_t fine[256];     //!< The counts of each value.
+};
+
+/// Adds the 16 counts at \p bins to the counts at \p acc when Add is true,
+/// otherwise subtracts them, 8 counts at a time.
+/// \param[in] acc  The counts to update.
+/// \param[in] bins The counts to add or subtract.
+/// \tparam    Add  If the counts are added.
+template <bool Add>
+static SNAP_INLINE void update_bins(uint16_t* acc, const uint16_t* bins) {
+  constexpr size_t width = Vec8x16u::width;
+  util::perf::unroll<0, 16 / width - 1>([&] (const UnrollIndex i) {
+    Vec8x16u a, b;
+    a.load(acc + i * width);
+    b.load(bins + i * width);
+    (Add ? a + b : a - b).storeu(acc + i * width);
+  });
+}
+
+/// Computes the median of the window around each element of rows \p begin
+/// to \p end with the method of Perreault and Hébert. There is a histogram
+/// for each column of the window of the row, which is updated with one
+/// element added and one removed when moving down a row. The histogram of
+/// the window is the sum of the column histograms, and is moved along the
+/// row by adding the column histogram which enters the window and
+/// subtracting the one which leaves it.
+///
+/// Only the coarse bins of the window are moved for every element. Each
+/// group of 16 fine bins is only brought up to date when the median is in
+/// its coarse bin, from the column it was last updated for, so the fine
+/// bins are rarely updated where the image is smooth.
+/// \param[in] in        A pointer to the first element of the input, which
+///                      must have a halo of at least \p radius.
+/// \param[in] inStride  The stride of the input.
+/// \param[in] out       A pointer to the first element of the output.
+/// \param[in] outStride The stride of the output.
+/// \param[in] cols      The number of elements in each row.
+/// \param[in] radius    The radius of the window.
+/// \param[in] begin     The first row to filter.
+/// \param[in] end       The end of the rows to filter.
+static inline void median_histogram_rows(const uint8_t* in, size_t inStride,
+                                         uint8_t* out, size_t outStride,
+                                         size_t cols, size_t radius,
+                                         size_t begin, size_t end) {
+  const int64_t  r      = int64_t(radius);
+  const int64_t  stride = int64_t(inStride);
+  const size_t   size   = 2 * radius + 1;
+  const size_t   width  = cols + 2 * radius;
+  const uint32_t rank   = uint32_t(size * size / 2);
+  const uint8_t* left   = in - r;
+
+  // Adds delta to the count of value v in the histogram of column j.
+  std::vector<MedianHistogram> columns(width);
+  const auto update = [&] (size_t j, uint8_t v, int delta) {
+    columns[j].coarse[v >> 4] += delta;
+    columns[j].fine[v]        += delta;
+  };
+  for (int64_t y = int64_t(begin) - r; y <= int64_t(begin) + r; ++y) {
+    for (size_t j = 0; j < width; ++j)
+      update(j, left[y * stride + int64_t(j)], 1);
+  }
+
+  // The column which each group of fine bins of the window is up to date
+  // for, where cols means that the group must be recomputed.
+  MedianHistogram window;
+  size_t          current[16];
+  const auto fineBins = [&] (size_t bin, size_t c) {
+    uint16_t* fine = window.fine + 16 * bin;
+    if (current[bin] >= cols || c - current[bin] >= size) {
+      std::memset(fine, 0, 16 * sizeof(uint16_t));
+      for (size_t j = c; j < c + size; ++j)
+        update_bins<true>(fine, columns[j].fine + 16 * bin);
+    } else {
+      for (size_t x = current[bin] + 1; x <= c; ++x) {
+        update_bins<true>(fine, columns[x + 2 * radius].fine + 16 * bin);
+        update_bins<false>(fine, columns[x - 1].fine + 16 * bin);
+      }
+    }
+    current[bin] = c;
+    return fine;
+  };
+
+  for (size_t y = begin; y < end; ++y) {
+    if (y > begin) {
+      const uint8_t* leaving  = left + (int64_t(y) - r - 1) * stride;
+      const uint8_t* entering = left + (int64_t(y) + r) * stride;
+      for (size_t j = 0; j < width; ++j) {
+        update(j, leaving[j] , -1);
+        update(j, entering[j],  1);
+      }
+    }
+
+    std::memset(window.coarse, 0, sizeof(window.coarse));
+    std::fill(current, current + 16, cols);
+    for (size_t j = 0; j < size; ++j)
+      update_bins<true>(window.coarse, columns[j].coarse);
+
+    uint8_t* o = out + y * outStride;
+    for (size_t c = 0; c < cols; ++c) {
+      if (c > 0) {
+        update_bins<true>(window.coarse, columns[c + 2 * radius].coarse);
+        update_bins<false>(window.coarse, columns[c - 1].coarse);
+      }
+
+      uint32_t sum = 0;
+      size_t   bin = 0;
+      for (; sum + window.coarse[bin] <= rank; ++bin)
+        sum += window.coarse[bin];
+      const uint16_t* fine  = fineBins(bin, c);
+      size_t          value = 0;
+      for (; sum + fine[value] <= rank; ++value)
+        sum += fine[value];
+      o[c] = static_cast<uint8_t>(bin * 16 + value);
+    }
+  }
+}
+
+} // namespace detail
+
+/// Computes the median of the (2 * radius + 1) x (2 * radius + 1) window
+/// around each element of matrix \p in, and writes it to matrix \p out,
+/// which must have the same dimensions and must not be \p in. The elements
+/// outside of the matrix are defined by the \p border. If \p in has a halo
+/// of at least \p radius it is read directly, and must have been set with
+/// fill_border, otherwise \p in is copied into a matrix with a halo which is
+/// set with the \p border and \p borderValue.
+///
+/// For a radius of 1 or 2 the medians of 16 elements are selected at a time
+/// with networks of 19 and 99 min/max comparators, which have no branches.
+/// For larger radii the medians are computed from histograms of the
+/// windows, with the method of Perreault and Hébert, for which the cost of
+/// each element is constant: the histograms are updated with a 16-bit
+/// vector add and subtract per element, and the median is found from 16
+/// coarse and 16 fine bins. When \p policy is EP_PARALLEL the rows are split
+/// across the threads.
+///
+/// \param[in] in          The matrix to filter.
+/// \param[in] out         The filtered matrix.
+/// \param[in] radius      The radius of the window, which must be at most
+///                        127.
+/// \param[in] border      The border mode.
+/// \param[in] borderValue The value of the elements outside the matrix for
+///                        BM_CONSTANT.
+/// \param[in] policy      The execution policy.
+template <typename A, typename B>
+static inline void median(const Matrix<mat::FM_GREY_8, A>& in          ,
+                          Matrix<mat::FM_GREY_8, B>&       out         ,
+                          size_t          radius                       ,
+                          BorderMode      border      = BM_REPLICATE   ,
+                          uint8_t         borderValue = 0              ,
+                          ExecutionPolicy policy      = EP_SERIAL      ) {
+  assert(in.rows() == out.rows() && in.cols() == out.cols());
+  assert(radius <= detail::MEDIAN_MAX_RADIUS);
+  SNAP_INSTRUMENT_KERNEL("alg::median", in.size(), 2 * in.size());
+
+  const uint8_t*         data   = in.data();
+  size_t                 stride = in.stride();
+  Matrix<mat::FM_GREY_8> padded;
+  if (radius > 0 && in.halo() < radius) {
+    padded = Matrix<mat::FM_GREY_8>(in.rows(), in.cols(), Halo{radius});
+    for (size_t r = 0; r < in.rows(); ++r)
+      std::memcpy(padded.data() + r * padded.stride(),
+                  in.data() + r * in.stride(), in.cols());
+    fill_border(padded, border, borderValue, policy);
+    data   = padded.data();
+    stride = padded.stride();
+  }
+
+  util::par::parallel_for(0, in.rows(),
+    util::par::chunk_count(in.size(), policy, detail::MIN_PARALLEL_ELEMENTS),
+    [&] (size_t begin, size_t end, size_t) {
+      if (radius == 0) {
+        for (size_t r = begin; r < end; ++r)
+          std::memcpy(out.data() + r * out.stride(), data + r * stride,
+                      in.cols());
+      } else if (radius == 1) {
+        detail::median_network_rows<1>(data, stride, out.data(),
+          out.stride(), in.cols(), begin, end);
+      } else if (radius == 2) {
+        detail::median_network_rows<2>(data, stride, out.data(),
+          out.stride(), in.cols(), begin, end);
+      } else {
+        detail::median_histogram_rows(data, stride, out.data(),
+          out.stride(), in.cols(), radius, begin, end);
+      }
+    }
+  );
+}
+
+} // namespace alg
+} // namespace snap
+
+#endif // SNAP_ALGORITHM_FILTER_HPP
@@ -0,0 +1,470 @@
+//---- snap/algorithm/match.hpp ---------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  match.hpp
+/// \brief Defines template matching, which scores a template at each
+///        position of an image with the sum of squared differences or the
+///        normalized cross correlation. The correlation of the template and
+///        each window is computed with 16-bit multiply-adds, and the sums of
+///        the windows come from integral images. The best match can be
+///        found with a coarse to fine search over an image pyramid.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_ALGORITHM_MATCH_HPP
+#define SNAP_ALGORITHM_MATCH_HPP
+
+#include "preprocess.hpp"
+#include "region.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace snap {
+namespace alg  {
+
+/// Defines the possible methods to score a template at a position.
+enum MatchMethod : uint8_t {
+  MM_SSD = 0,   //!< Sum of squared differences, where lower is better.
+  MM_NCC = 1    //!< Normalized cross correlation, where higher is better.
+};
+
+/// Defines the position of a match of a template in an image.
+struct TemplateMatch {
+  size_t x;       //!< The column of the top left element of the match.
+  size_t y;       //!< The row of the top left element of the match.
+  float  score;   //!< The score of the template at the position.
+};
+
+namespace detail {
+
+/// Defines the max number of elements in a template. Each 32-bit lane of
+/// the correlation accumulator sums at most a quarter of the products of
+/// the template and the window, each of which is at most 255^2.
+static constexpr size_t MATCH_MAX_ELEMENTS = 1 << 17;
+
+/// Defines the min number of rows and columns of the template in the
+/// coarsest level of a pyramid search.
+static constexpr size_t MATCH_MIN_SIZE = 8;
+
+/// Defines the number of positions around the upscaled match of a coarser
+/// level which are searched in each direction in the next level.
+static constexpr size_t MATCH_REFINE_RADIUS = 2;
+
+/// Defines a template which is prepared for matching, with the elements
+/// widened to 16 bits so that they can be multiplied with madd.
+struct MatchTemplate {
+  std::vector<uint16_t> values;   //!< The widened elements, row major.
+  size_t                rows;     //!< The number of rows.
+  size_t                cols;     //!< The number of elements in each row.
+  int64_t               sum;      //!< The sum of the elements.
+  int64_t               sumSq;    //!< The sum of the squares of elements.
+
+  /// Returns the number of elements in the template.
+  size_t size() const { return rows * cols; }
+};
+
+/// Defines the sum and the sum of the squares of the elements of a window.
+struct WindowSums {
+  int64_t sum;      //!< The sum of the elements.
+  int64_t sumSq;    //!< The sum of the squares of the elements.
+};
+
+/// Defines the integral images of the elements and of the squares of the
+/// elements of a region, each with a leading row and column of zeros. The
+/// sums of the elements wrap modulo 2^32, which doesn't change the sums of
+/// windows which fit in 32 bits, as the sums of templates do.
+struct IntegralImage {
+  std::vector<uint32_t> sums;     //!< The integral of the elements.
+  std::vector<uint64_t> squares;  //!< The integral of the squares.
+  size_t                stride;   //!< The number of sums in each row.
+
+  /// Returns the sums of the \p rows x \p cols window with top left element
+  /// (\p x, \p y).
+  /// \param[in] x    The column of the top left element of the window.
+  /// \param[in] y    The row of the top left element of the window.
+  /// \param[in] rows The number of rows in the window.
+  /// \param[in] cols The number of columns in the window.
+  WindowSums window(size_t x, size_t y, size_t rows, size_t cols) const {
+    const size_t a = y * stride + x    , b = a + cols;
+    const size_t c = a + rows * stride , d = c + cols;
+    return WindowSums{
+      int64_t(uint32_t(sums[d] - sums[b] - sums[c] + sums[a])),
+      int64_t(squares[d] - squares[b] - squares[c] + squares[a])
+    };
+  }
+};
+
+/// Prepares the template \p t for matching.
+/// \param[in] t The template.
+static inline MatchTemplate make_match_template(const Region& t) {
+  MatchTemplate m{std::vector<uint16_t>(t.size()), t.rows, t.cols, 0, 0};
+  for (size_t r = 0; r < t.rows; ++r) {
+    for (size_t c = 0; c < t.cols; ++c) {
+      const uint16_t v = t.row(r)[c];
+      m.values[r * t.cols + c] = v;
+      m.sum   += v;
+      m.sumSq += v * v;
+    }
+  }
+  return m;
+}
+
+/// Computes the integral images of \p image. The prefix sums of the rows
+/// are split across threads, and then the columns are accumulated down
+/// the rows, split across threads.
+/// \param[in] image  The region to compute the integral images of.
+/// \param[in] policy The execution policy.
+static inline IntegralImage make_integral(const Region& image,
+                                          ExecutionPolicy policy) {
+  const size_t  stride = image.cols + 1;
+  IntegralImage ii{std::vector<uint32_t>((image.rows + 1) * stride, 0),
+                   std::vector<uint64_t>((image.rows + 1) * stride, 0),
+                   stride};
+  const size_t chunks =
+    util::par::chunk_count(image.size(), policy, MIN_PARALLEL_ELEMENTS);
+
+  util::par::parallel_for(0, image.rows, chunks,
+    [&] (size_t begin, size_t end, size_t) {
+      for (size_t r = begin; r < end; ++r) {
+        const uint8_t* in      = image.row(r);
+        uint32_t*      sums    = &ii.sums[(r + 1) * stride + 1];
+        uint64_t*      squares = &ii.squares[(r + 1) * stride + 1];
+        uint32_t       sum     = 0;
+        uint64_t       sumSq   = 0;
+        for (size_t c = 0; c < image.cols; ++c) {
+          sum        += in[c];
+          sumSq      += uint32_t(in[c]) * in[c];
+          sums[c]     = sum;
+          squares[c]  = sumSq;
+        }
+      }
+    }
+  );
+
+  util::par::parallel_for(1, stride, chunks,
+    [&] (size_t begin, size_t end, size_t) {
+      for (size_t r = 2; r <= image.rows; ++r) {
+        const size_t row = r * stride, above = row - stride;
+        for (size_t c = begin; c < end; ++c) {
+          ii.sums[row + c]    += ii.sums[above + c];
+          ii.squares[row + c] += ii.squares[above + c];
+        }
+      }
+    }
+  );
+  return ii;
+}
+
+/// Computes the sums of the \p rows x \p cols window with top left element
+/// at \p p directly, for when only a few windows are scored.
+/// \param[in] p      A pointer to the top left element of the window.
+/// \param[in] stride The stride of the image.
+/// \param[in] rows   The number of rows in the window.
+/// \param[in] cols   The number of columns in the window.
+static inline WindowSums window_sums(const uint8_t* p, size_t stride,
+                                     size_t rows, size_t cols) {
+  WindowSums s{0, 0};
+  for (size_t r = 0; r < rows; ++r, p += stride) {
+    for (size_t c = 0; c < cols; ++c) {
+      s.sum   += p[c];
+      s.sumSq += uint32_t(p[c]) * p[c];
+    }
+  }
+  return s;
+}
+
+/// Returns the sum of the products of the elements of template \p t and the
+/// window with top left element at \p p. The elements of the window are
+/// widened to 16 bits and multiplied with the template with madd, 16 at a
+/// time, so only the columns past the last 8 are multiplied one at a time.
+/// \param[in] p      A pointer to the top left element of the window.
+/// \param[in] stride The stride of the image.
+/// \param[in] t      The template.
+static inline int64_t correlate(const uint8_t* p, size_t stride,
+                                const MatchTemplate& t) {
+  const uint16_t* v    = t.values.data();
+  Vec4x32s        acc(0);
+  int64_t         tail = 0;
+  for (size_t r = 0; r < t.rows; ++r, p += stride, v += t.cols) {
+    size_t c = 0;
+    for (; c + 16 <= t.cols; c += 16) {
+      Vec16x8u w;
+      Vec8x16u lo, hi;
+      w.load(p + c);
+      lo.load(v + c);
+      hi.load(v + c + 8);
+      acc = acc + madd(widen_lo(w), lo) + madd(widen_hi(w), hi);
+    }
+    if (c + 8 <= t.cols) {
+      Vec16x8u w;
+      Vec8x16u lo;
+      w.loadl(p + c);
+      lo.load(v + c);
+      acc = acc + madd(widen_lo(w), lo);
+      c  += 8;
+    }
+    for (; c < t.cols; ++c)
+      tail += int64_t(p[c]) * v[c];
+  }
+  return int64_t(acc.hsum()) + tail;
+}
+
+/// Returns the score of template \p t for a window with the sums \p w and
+/// the correlation \p cross with the template. The NCC of a window or a
+/// template with no variance is 0.
+/// \param[in] method The scoring method.
+/// \param[in] t      The template.
+/// \param[in] cross  The sum of the products of the template and window.
+/// \param[in] w      The sums of the window.
+static inline float match_score(MatchMethod method, const MatchTemplate& t,
+                                int64_t cross, const WindowSums& w) {
+  if (method == MM_SSD)
+    return float(w.sumSq - 2 * cross + t.sumSq);
+
+  const int64_t n   = int64_t(t.size());
+  const double  num = double(n * cross - w.sum * t.sum);
+  const double  den = double(n * w.sumSq - w.sum * w.sum) *
+                      double(n * t.sumSq - t.sum * t.sum);
+  return den > 0.0 ? float(num / std::sqrt(den)) : 0.0f;
+}
+
+/// Returns if score \p a is a better match than score \p b.
+/// \param[in] method The scoring method.
+/// \param[in] a      The first score.
+/// \param[in] b      The second score.
+static inline bool better_match(MatchMethod method, float a, float b) {
+  return method == MM_SSD ? a < b : a > b;
+}
+
+/// Returns a match which is worse than all the matches for the \p method.
+/// \param[in] method The scoring method.
+static inline TemplateMatch worst_match(MatchMethod method) {
+  return TemplateMatch{0, 0, method == MM_SSD
+    ?  std::numeric_limits<float>::max()
+    : -std::numeric_limits<float>::max()};
+}
+
+/// Returns the number of chunks to split the scoring of template \p t at
+/// all the positions in \p image into.
+/// \param[in] image  The image.
+/// \param[in] t      The template.
+/// \param[in] policy The execution policy.
+static inline size_t match_chunks(const Region& image, const MatchTemplate& t,
+                                  ExecutionPolicy policy) {
+  const size_t positions =
+    (image.rows - t.rows + 1) * (image.cols - t.cols + 1);
+  return util::par::chunk_count(positions * t.size(), policy,
+    MIN_PARALLEL_ELEMENTS);
+}
+
+/// Scores template \p t at all the positions in \p image, calling \p
+/// f(x, y, score, chunk) for each of them. The rows of positions are split
+/// into \p chunks contiguous chunks, each on a separate thread, and the
+/// positions of each chunk are scored in row major order.
+/// \param[in] image  The image.
+/// \param[in] t      The template.
+/// \param[in] method The scoring method.
+/// \param[in] chunks The number of chunks.
+/// \param[in] f      The function to call with each score.
+template <typename F>
+static inline void scan_template(const Region& image, const MatchTemplate& t,
+                                 MatchMethod method, size_t chunks, F&& f) {
+  const auto   ii   = make_integral(image, chunks > 1 ? EP_PARALLEL
+                                                      : EP_SERIAL);
+  const size_t cols = image.cols - t.cols + 1;
+  util::par::parallel_for(0, image.rows - t.rows + 1, chunks,
+    [&] (size_t begin, size_t end, size_t chunk) {
+      for (size_t y = begin; y < end; ++y) {
+        const uint8_t* row = image.row(y);
+        for (size_t x = 0; x < cols; ++x) {
+          const int64_t cross = correlate(row + x, image.stride, t);
+          f(x, y, match_score(method, t, cross,
+                              ii.window(x, y, t.rows, t.cols)), chunk);
+        }
+      }
+    }
+  );
+}
+
+/// Returns the best match of template \p t in \p image within
+/// MATCH_REFINE_RADIUS positions of \p center in each direction, where the
+/// sums of the few windows are computed directly.
+/// \param[in] image  The image.
+/// \param[in] t      The template.
+/// \param[in] method The scoring method.
+/// \param[in] center The position to search around.
+static inline TemplateMatch refine_match(const Region& image,
+                                         const MatchTemplate& t,
+                                         MatchMethod method,
+                                         const TemplateMatch& center) {
+  const size_t xMax = image.cols - t.cols, yMax = image.rows - t.rows;
+  const size_t x0   = std::min(center.x, xMax), y0 = std::min(center.y, yMax);
+  TemplateMatch best = worst_match(method);
+  for (size_t y = y0 - std::min(y0, MATCH_REFINE_RADIUS);
+       y <= std::min(y0 + MATCH_REFINE_RADIUS, yMax); ++y) {
+    for (size_t x = x0 - std::min(x0, MATCH_REFINE_RADIUS);
+         x <= std::min(x0 + MATCH_REFINE_RADIUS, xMax); ++x) {
+      const uint8_t* p     = image.row(y) + x;
+      const float    score = match_score(method, t,
+        correlate(p, image.stride, t),
+        window_sums(p, image.stride, t.rows, t.cols));
+      if (better_match(method, score, best.score))
+        best = TemplateMatch{x, y, score};
+    }
+  }
+  return best;
+}
+
+} // namespace detail
+
+/// Scores template \p templ at each position of \p image, where it fits
+/// inside the image, and stores the scores in row major order in \p
+/// scores, which is resized to (image.rows() - templ.rows() + 1) x
+/// (image.cols() - templ.cols() + 1). The score at (x, y) is for the
+/// window with top left element (x, y). The SSDs are exact while they fit
+/// in the 24 bits of the float mantissa. The NCC is in the range [-1, 1],
+/// and is 0 for windows with no variance.
+///
+/// The correlation of the template and each window is computed with madd,
+/// which multiplies and pairwise adds 8 16-bit elements, and the sums of
+/// each window come from integral images, so the cost of a position is
+/// independent of the method. When \p policy is EP_PARALLEL the rows of
+/// positions are split across the threads.
+///
+/// \param[in] image  The image to search.
+/// \param[in] templ  The template, which must not be larger than the image,
+///                   and must have at most 2^17 elements.
+/// \param[in] scores The output scores.
+/// \param[in] method The scoring method.
+/// \param[in] policy The execution policy.
+template <typename A, typename B>
+static inline void match_template(const Matrix<mat::FM_GREY_8, A>& image  ,
+                                  const Matrix<mat::FM_GREY_8, B>& templ  ,
+                                  std::vector<float>&              scores ,
+                                  MatchMethod     method = MM_NCC         ,
+                                  ExecutionPolicy policy = EP_SERIAL      ) {
+  assert(templ.rows() > 0 && templ.rows() <= image.rows() &&
+         templ.cols() > 0 && templ.cols() <= image.cols());
+  assert(templ.size() <= detail::MATCH_MAX_ELEMENTS);
+  SNAP_INSTRUMENT_KERNEL("alg::match_template", image.size(),
+    image.size() + templ.size());
+
+  const auto   region = detail::make_region(image);
+  const auto   t      = detail::make_match_template(detail::make_region(templ));
+  const size_t cols   = image.cols() - templ.cols() + 1;
+  scores.resize((image.rows() - templ.rows() + 1) * cols);
+  detail::scan_template(region, t, method,
+    detail::match_chunks(region, t, policy),
+    [&] (size_t x, size_t y, float score, size_t) {
+      scores[y * cols + x] = score;
+    }
+  );
+}
+
+/// Finds the best match of template \p templ in \p image, which is the
+/// position with the lowest SSD or the highest NCC, where ties are resolved
+/// in favour of the first position in row major order.
+///
+/// When \p levels is greater than 0, the image and the template are
+/// downsampled by 2 up to \p levels times, while the template has at least
+/// 8 rows and columns. All the positions are only scored in the coarsest
+/// level, and the match is then refined in each finer level by scoring the
+/// positions within 2 of the upscaled match of the coarser level, so the
+/// template should have detail which survives the downsampling. The score
+/// of the result is always for the full resolution image. When \p policy is
+/// EP_PARALLEL the downsampling and the scoring of the coarsest level are
+/// split across the threads.
+///
+/// \param[in] image  The image to search.
+/// \param[in] templ  The template, which must not be larger than the image,
+///                   and must have at most 2^17 elements.
+/// \param[in] method The scoring method.
+/// \param[in] levels The max number of downsampled levels to search.
+/// \param[in] policy The execution policy.
+template <typename A, typename B>
+static inline TemplateMatch
+find_template(const Matrix<mat::FM_GREY_8, A>& image             ,
+              const Matrix<mat::FM_GREY_8, B>& templ             ,
+              MatchMethod                      method = MM_NCC   ,
+              size_t                           levels = 0        ,
+              ExecutionPolicy                  policy = EP_SERIAL) {
+  assert(templ.rows() > 0 && templ.rows() <= image.rows() &&
+         templ.cols() > 0 && templ.cols() <= image.cols());
+  assert(templ.size() <= detail::MATCH_MAX_ELEMENTS);
+  SNAP_INSTRUMENT_KERNEL("alg::find_template", image.size(),
+    image.size() + templ.size());
+
+  size_t depth = 0;
+  while (depth < levels &&
+         (templ.rows() >> (depth + 1)) >= detail::MATCH_MIN_SIZE &&
+         (templ.cols() >> (depth + 1)) >= detail::MATCH_MIN_SIZE)
+    ++depth;
+
+  // Level l > 0 of each pyramid is element l - 1, and is reserved so that
+  // the references to the previous level stay valid.
+  std::vector<Matrix<mat::FM_GREY_8>> images, templs;
+  images.reserve(depth);
+  templs.reserve(depth);
+  auto downsample = [&] (std::vector<Matrix<mat::FM_GREY_8>>& pyramid,
+                         const auto&                          in     ) {
+    pyramid.emplace_back(in.rows() / 2, in.cols() / 2);
+    resize(in, pyramid.back(), policy);
+  };
+  for (size_t l = 0; l < depth; ++l) {
+    if (l == 0) {
+      downsample(images, image);
+      downsample(templs, templ);
+    } else {
+      downsample(images, images.back());
+      downsample(templs, templs.back());
+    }
+  }
+  auto imageLevel = [&] (size_t l) {
+    return l == 0 ? detail::make_region(image)
+                  : detail::make_region(images[l - 1]);
+  };
+  auto templLevel = [&] (size_t l) {
+    return detail::make_match_template(
+      l == 0 ? detail::make_region(templ) : detail::make_region(templs[l - 1]));
+  };
+
+  // Each chunk keeps its best match, and the chunks are merged in order so
+  // that the result doesn't depend on the number of threads.
+  const auto   coarse = imageLevel(depth);
+  const auto   t      = templLevel(depth);
+  const size_t chunks = detail::match_chunks(coarse, t, policy);
+  std::vector<TemplateMatch> bests(chunks, detail::worst_match(method));
+  detail::scan_template(coarse, t, method, chunks,
+    [&] (size_t x, size_t y, float score, size_t chunk) {
+      if (detail::better_match(method, score, bests[chunk].score))
+        bests[chunk] = TemplateMatch{x, y, score};
+    }
+  );
+  TemplateMatch best = detail::worst_match(method);
+  for (const auto& b : bests) {
+    if (detail::better_match(method, b.score, best.score))
+      best = b;
+  }
+
+  for (size_t l = depth; l-- > 0;) {
+    best = detail::refine_match(imageLevel(l), templLevel(l), method,
+      TemplateMatch{2 * best.x, 2 * best.y, best.score});
+  }
+  return best;
+}
+
+} // namespace alg
+} // namespace snap
+
+#endif // SNAP_ALGORITHM_MATCH_HPP
@@ -0,0 +1,550 @@
+//---- snap/algorithm/metrics.hpp -------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  metrics.hpp
+/// \brief Defines functions to compute difference metrics between two
+///        matrices: the sum of absolute differences (SAD), the sum of
+///        squared differences (SSD), the peak signal to noise ratio (PSNR)
+///        and the structural similarity index (SSIM). Each of the metrics
+///        can be computed globally, or for each block of a grid of blocks.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_ALGORITHM_METRICS_HPP
+#define SNAP_ALGORITHM_METRICS_HPP
+
+#include "region.hpp"
+#include "snap/utility/performance.hpp"
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace snap {
+namespace alg  {
+
+namespace detail {
+
+/// Defines the stabilizing constant C1 = (0.01 * 255)^2 for SSIM.
+static constexpr double SSIM_C1 = 6.5025;
+
+/// Defines the stabilizing constant C2 = (0.03 * 255)^2 for SSIM.
+static constexpr double SSIM_C2 = 58.5225;
+
+/// Defines the sums required to compute the SSIM of a window.
+template <typename T>
+struct SsimSums {
+  T a;    //!< The sum of the elements of the first matrix.
+  T b;    //!< The sum of the elements of the second matrix.
+  T aa;   //!< The sum of the squares of the elements of the first matrix.
+  T bb;   //!< The sum of the squares of the elements of the second matrix.
+  T ab;   //!< The sum of the products of the elements of both matrices.
+};
+
+/// Computes the SSIM of a window of \p n elements from the sums of the
+/// elements in the window.
+/// \param[in] s The sums of the window.
+/// \param[in] n The number of elements in the window.
+template <typename T>
+static inline double ssim_from_sums(const SsimSums<T>& s, double n) {
+  const double muA  = s.a / n, muB = s.b / n;
+  const double varA = s.aa / n - muA * muA;
+  const double varB = s.bb / n - muB * muB;
+  const double cov  = s.ab / n - muA * muB;
+  return ((2.0 * muA * muB + SSIM_C1) * (2.0 * cov + SSIM_C2)) /
+         ((muA * muA + muB * muB + SSIM_C1) * (varA + varB + SSIM_C2));
+}
+
+/// Adds the SAD of the \p n elements starting at \p pa and \p pb to \p
+/// partial.
+/// \param[in] pa      A pointer to the first element of the first segment.
+/// \param[in] pb      A pointer to the first element of the second segment.
+/// \param[in] n       The number of elements.
+/// \param[in] partial The partial SAD to add to.
+/// \tparam    Unroll  The number of independent accumulators.
+template <size_t Unroll>
+static inline void sad_kernel(const uint8_t* pa, const uint8_t* pb, size_t n,
+    uint64_t& partial) {
+  const size_t vectors = n / Vec16x8u::width;
+
+  for (size_t block = 0; block < vectors; block += FLUSH_VECTORS) {
+    const auto sums = util::perf::reduce_unrolled<Unroll>(
+      block, std::min(block + FLUSH_VECTORS, vectors), Vec4x32u(0u),
+      [&] (Vec4x32u& acc, size_t i) {
+        Vec16x8u a, b; 
+        a.load(pa + i * Vec16x8u::width);
+        b.load(pb + i * Vec16x8u::width);
+        acc = acc + sad(a, b);
+      },
+      [] (const Vec4x32u& a, const Vec4x32u& b) { return a + b; }
+    );
+    partial += sums.hsum();
+  }
+
+  for (size_t i = vectors * Vec16x8u::width; i < n; ++i)
+    partial += std::abs(int(pa[i]) - int(pb[i]));
+}
+
+/// Adds the SSD of the \p n elements starting at \p pa and \p pb to \p
+/// partial.
+/// \param[in] pa      A pointer to the first element of the first segment.
+/// \param[in] pb      A pointer to the first element of the second segment.
+/// \param[in] n       The number of elements.
+/// \param[in] partial The partial SSD to add to.
+/// \tparam    Unroll  The number of independent accumulators.
+template <size_t Unroll>
+static inline void ssd_kernel(const uint8_t* pa, const uint8_t* pb, size_t n,
+    uint64_t& partial) {
+  const size_t vectors = n / Vec16x8u::width;
+
+  for (size_t block = 0; block < vectors; block += FLUSH_VECTORS) {
+    const auto sums = util::perf::reduce_unrolled<Unroll>(
+      block, std::min(block + FLUSH_VECTORS, vectors), Vec4x32s(0),
+      [&] (Vec4x32s& acc, size_t i) {
+        Vec16x8u a, b; 
+        a.load(pa + i * Vec16x8u::width);
+        b.load(pb + i * Vec16x8u::width);
+        const auto d  = absdiff(a, b);
+        const auto lo = widen_lo(d), hi = widen_hi(d);
+        acc = acc + madd(lo, lo) + madd(hi, hi);
+      },
+      [] (const Vec4x32s& a, const Vec4x32s& b) { return a + b; }
+    );
+    partial += static_cast<uint64_t>(sums.hsum());
+  }
+
+  for (size_t i = vectors * Vec16x8u::width; i < n; ++i) {
+    const int d = int(pa[i]) - int(pb[i]);
+    partial += d * d;
+  }
+}
+
+/// Processes the blocks in row \p blockRow of a grid of BlockSize x BlockSize
+/// blocks over regions \p a and \p b. The columns are processed in strips of
+/// 16 elements, where for each strip the rows of the block row are
+/// accumulated into a single accumulator, which is then passed to \p finish
+/// along with the index of the strip. The low 8 elements of strip k are in
+/// block (16k) / BlockSize and the high 8 in block (16k + 8) / BlockSize. 
+/// Columns which don't fill a strip are passed to \p pixel individually. The
+/// signatures of the functions must be:
+///
+///   accumulate(Acc& acc, const Vec16x8u& a, const Vec16x8u& b)
+///   finish(size_t strip, const Acc& acc)
+///   pixel(size_t col, uint8_t a, uint8_t b)
+///
+/// \param[in] a          The first region.
+/// \param[in] b          The second region.
+/// \param[in] blockRow   The index of the row of blocks to process.
+/// \param[in] identity   The initial value of each strip accumulator.
+/// \param[in] accumulate The function to accumulate a row of a strip.
+/// \param[in] finish     The function to call with each strip's result.
+/// \param[in] pixel      The function for each remainder element.
+/// \tparam    BlockSize  The size of each block.
+template <size_t BlockSize, typename Acc, typename Accumulate, 
+          typename Finish, typename Pixel>
+static inline void block_row_strips(const Region& a       , 
+                                    const Region& b       , 
+                                    size_t        blockRow,
+                                    const Acc&    identity,
+                                    Accumulate&&  accumulate, 
+                                    Finish&&      finish  , 
+                                    Pixel&&       pixel   ) {
+  static_assert(BlockSize % 8 == 0, "Block size must be a multiple of 8!");
+
+  const size_t rowBegin = blockRow * BlockSize;
+  const size_t rowEnd   = std::min(rowBegin + BlockSize, a.rows);
+  const size_t strips   = a.cols / Vec16x8u::width;
+
+  for (size_t k = 0; k < strips; ++k) {
+    Acc acc = identity;
+    for (size_t r = rowBegin; r < rowEnd; ++r) {
+      Vec16x8u va, vb;
+      va.load(a.row(r) + k * Vec16x8u::width);
+      vb.load(b.row(r) + k * Vec16x8u::width);
+      accumulate(acc, va, vb);
+    }
+    finish(k, acc);
+  }
+
+  for (size_t r = rowBegin; r < rowEnd; ++r) 
+    for (size_t c = strips * Vec16x8u::width; c < a.cols; ++c)
+      pixel(c, a.row(r)[c], b.row(r)[c]);
+}
+
+/// Defines running column sums over a window of rows, which are used to
+/// compute the sums for each window for SSIM. Adding and removing rows is 
+/// vectorized, and the horizontal window sums are then computed by sliding 
+/// a window along the column sums, so each element is visited a constant 
+/// number of times regardless of the window size.
+struct SsimColumnSums {
+  /// Constructor: Creates zeroed column sums for \p cols columns.
+  /// \param[in] cols The number of columns.
+  explicit SsimColumnSums(size_t cols) 
+  : A(cols, 0), B(cols, 0), AA(cols, 0), BB(cols, 0), AB(cols, 0) {}
+
+  /// Adds (if \p add is true) or removes the row \p ra of the first matrix
+  /// and \p rb of the second matrix to or from the column sums.
+  /// \param[in] ra  The row of the first matrix.
+  /// \param[in] rb  The row of the second matrix.
+  /// \param[in] add If the row must be added, otherwise it is removed.
+  void update(const uint8_t* ra, const uint8_t* rb, bool add) {
+    const size_t vectors = A.size() / Vec16x8u::width;
+
+    // Updates 4 columns of one of the sums.
+    auto update4 = [add] (std::vector<uint32_t>& sums, size_t col, 
+                          const Vec4x32u& values) {
+      Vec4x32u current; current.load(&sums[col]);
+      (add ? current + values : current - values).storeu(&sums[col]);
+    };
+
+    std::vector<uint32_t>* sums[5] = {&A, &B, &AA, &BB, &AB};
+    for (size_t i = 0; i < vectors; ++i) {
+      const size_t col = i * Vec16x8u::width;
+      Vec16x8u va, vb;
+      va.load(ra + col);
+      vb.load(rb + col);
+
+      // The 8-bit products fit in 16 bits, the column sums need 32 bits.
+      const Vec8x16u a[2] = {widen_lo(va), widen_hi(va)};
+      const Vec8x16u b[2] = {widen_lo(vb), widen_hi(vb)};
+      for (size_t h = 0; h < 2; ++h) {
+        const Vec8x16u products[5] = {
+          a[h], b[h], a[h] * a[h], b[h] * b[h], a[h] * b[h]
+        };
+        for (size_t s = 0; s < 5; ++s) {
+          update4(*sums[s], col + 8 * h    , widen_lo(products[s]));
+          update4(*sums[s], col + 8 * h + 4, widen_hi(products[s]));
+        }
+      }
+    }
+
+    const uint32_t sign = add ? 1 : uint32_t(-1);
+    for (size_t c = vectors * Vec16x8u::width; c < A.size(); ++c) {
+      A[c]  += sign * ra[c];
+      B[c]  += sign * rb[c];
+      AA[c] += sign * ra[c] * ra[c];
+      BB[c] += sign * rb[c] * rb[c];
+      AB[c] += sign * ra[c] * rb[c];
+    }
+  }
+
+  std::vector<uint32_t> A;    //!< The column sums of the first matrix.
+  std::vector<uint32_t> B;    //!< The column sums of the second matrix.
+  std::vector<uint32_t> AA;   //!< The column sums of first matrix squares.
+  std::vector<uint32_t> BB;   //!< The column sums of second matrix squares.
+  std::vector<uint32_t> AB;   //!< The column sums of the products.
+};
+
+/// Returns the sum of the SSIM of each Window x Window window with its top
+/// left element in rows [\p begin, \p end) of regions \p a and \p b.
+/// \param[in] a     The first region.
+/// \param[in] b     The second region.
+/// \param[in] begin The first row of windows.
+/// \param[in] end   The end of the rows of windows.
+/// \tparam    Window The size of the window.
+template <size_t Window>
+static inline double ssim_rows(const Region& a, const Region& b, 
+    size_t begin, size_t end) {
+  SsimColumnSums columns(a.cols);
+  for (size_t r = begin; r < begin + Window; ++r)
+    columns.update(a.row(r), b.row(r), true);
+
+  const double n     = Window * Window;
+  double       total = 0.0;
+  for (size_t r = begin; r < end; ++r) {
+    SsimSums<uint64_t> window{0, 0, 0, 0, 0};
+    for (size_t c = 0; c < a.cols; ++c) {
+      window.a  += columns.A[c] ; window.b  += columns.B[c];
+      window.aa += columns.AA[c]; window.bb += columns.BB[c];
+      window.ab += columns.AB[c];
+      if (c + 1 < Window)
+        continue;
+
+      total += ssim_from_sums(window, n);
+
+      const size_t out = c + 1 - Window;
+      window.a  -= columns.A[out] ; window.b  -= columns.B[out];
+      window.aa -= columns.AA[out]; window.bb -= columns.BB[out];
+      window.ab -= columns.AB[out];
+    }
+
+    if (r + 1 < end) {
+      columns.update(a.row(r)         , b.row(r)         , false);
+      columns.update(a.row(r + Window), b.row(r + Window), true );
+    }
+  }
+  return total;
+}
+
+} // namespace detail
+
+/// Computes the sum of absolute differences between matrices \p a and \p b,
+/// which must have the same dimensions.
+/// \param[in] a      The first matrix.
+/// \param[in] b      The second matrix.
+/// \param[in] policy The execution policy for the computation.
+template <uint8_t F, typename A>
+static inline uint64_t sad(const Matrix<F, A>& a, const Matrix<F, A>& b,
+                           ExecutionPolicy policy = EP_SERIAL) {
+  assert(a.rows() == b.rows() && a.cols() == b.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::sad", a.size(), 2 * a.size());
+  static auto& entry = util::tune::entry("alg::sad", detail::DEFAULT_TUNING);
+  const auto tuning = entry.get();
+  return util::tune::dispatch_unroll(tuning.unroll, [&] (auto unroll) {
+    return detail::reduce_regions(detail::make_region(a), 
+      detail::make_region(b), uint64_t(0), policy, tuning, 
+      detail::sad_kernel<decltype(unroll)::value>, std::plus<uint64_t>());
+  });
+}
+
+/// Computes the sum of squared differences between matrices \p a and \p b,
+/// which must have the same dimensions.
+/// \param[in] a      The first matrix.
+/// \param[in] b      The second matrix.
+/// \param[in] policy The execution policy for the computation.
+template <uint8_t F, typename A>
+static inline uint64_t ssd(const Matrix<F, A>& a, const Matrix<F, A>& b,
+                           ExecutionPolicy policy = EP_SERIAL) {
+  assert(a.rows() == b.rows() && a.cols() == b.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::ssd", a.size(), 2 * a.size());
+  static auto& entry = util::tune::entry("alg::ssd", detail::DEFAULT_TUNING);
+  const auto tuning = entry.get();
+  return util::tune::dispatch_unroll(tuning.unroll, [&] (auto unroll) {
+    return detail::reduce_regions(detail::make_region(a), 
+      detail::make_region(b), uint64_t(0), policy, tuning, 
+      detail::ssd_kernel<decltype(unroll)::value>, std::plus<uint64_t>());
+  });
+}
+
+/// Computes the peak signal to noise ratio, in dB, between matrices \p a and
+/// \p b, which must have the same dimensions. If the matrices are identical
+/// the result is infinity.
+/// \param[in] a      The first matrix.
+/// \param[in] b      The second matrix.
+/// \param[in] policy The execution policy for the computation.
+template <uint8_t F, typename A>
+static inline double psnr(const Matrix<F, A>& a, const Matrix<F, A>& b,
+                          ExecutionPolicy policy = EP_SERIAL) {
+  const uint64_t error = ssd(a, b, policy);
+  if (error == 0 || a.size() == 0)
+    return std::numeric_limits<double>::infinity();
+
+  const double mse = static_cast<double>(error) / a.size();
+  return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+/// Computes the mean structural similarity index between matrices \p a and
+/// \p b, which must have the same dimensions. The SSIM is computed for each
+/// Window x Window box window (with a stride of 1) which fits in the
+/// matrices, and the mean over all of the windows is returned. The window 
+/// sums are computed with running column sums, so the cost per element does
+/// not depend on the window size.
+/// \param[in] a      The first matrix.
+/// \param[in] b      The second matrix.
+/// \param[in] policy The execution policy for the computation.
+/// \tparam    Window The size of the (square) window.
+template <size_t Window = 8, uint8_t F, typename A>
+static inline double ssim(const Matrix<F, A>& a, const Matrix<F, A>& b,
+                          ExecutionPolicy policy = EP_SERIAL) {
+  static_assert(Window > 0, "SSIM window can't be empty!");
+  assert(a.rows() == b.rows() && a.cols() == b.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::ssim", a.size(), 2 * a.size());
+
+  const auto ra = detail::make_region(a), rb = detail::make_region(b);
+  if (ra.rows < Window || ra.cols < Window)
+    return 1.0;
+
+  const size_t windowRows = ra.rows - Window + 1;
+  const size_t windowCols = ra.cols - Window + 1;
+  const size_t chunks     = std::min(windowRows, util::par::chunk_count(
+    ra.size(), policy, detail::MIN_PARALLEL_ELEMENTS));
+
+  std::vector<double> partials(chunks, 0.0);
+  util::par::parallel_for(0, windowRows, chunks, 
+    [&] (size_t begin, size_t end, size_t chunk) {
+      partials[chunk] = detail::ssim_rows<Window>(ra, rb, begin, end);
+    }
+  );
+
+  double total = 0.0;
+  for (const auto partial : partials)
+    total += partial;
+  return total / (windowRows * windowCols);
+}
+
+/// Computes the sum of absolute differences between each BlockSize x
+/// BlockSize block of matrices \p a and \p b, which must have the same
+/// dimensions. The results are stored in row major order in \p out, which is
+/// resized to block_count(rows, BlockSize) x block_count(cols, BlockSize),
+/// where the blocks in the last row and column may be partial.
+/// \param[in] a      The first matrix.
+/// \param[in] b      The second matrix.
+/// \param[in] out    The output for the SAD of each block.
+/// \param[in] policy The execution policy for the computation.
+/// \tparam BlockSize The size of each block, which must be a multiple of 8.
+template <size_t BlockSize, uint8_t F, typename A>
+static inline void sad_blocks(const Matrix<F, A>&    a                 , 
+                              const Matrix<F, A>&    b                 ,
+                              std::vector<uint32_t>& out               ,
+                              ExecutionPolicy        policy = EP_SERIAL) {
+  assert(a.rows() == b.rows() && a.cols() == b.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::sad_blocks", a.size(), 2 * a.size());
+  const auto   ra      = detail::make_region(a), rb = detail::make_region(b);
+  const size_t blocksX = block_count(ra.cols, BlockSize);
+
+  out.assign(block_count(ra.rows, BlockSize) * blocksX, 0);
+  detail::for_each_block_row(block_count(ra.rows, BlockSize), ra.size(), 
+    policy, [&] (size_t blockRow) {
+      uint32_t* blocks = &out[blockRow * blocksX];
+      detail::block_row_strips<BlockSize>(ra, rb, blockRow, Vec4x32u(0u),
+        [] (Vec4x32u& acc, const Vec16x8u& va, const Vec16x8u& vb) {
+          acc = acc + sad(va, vb);
+        },
+        [&] (size_t k, const Vec4x32u& acc) {
+          SNAP_ALIGN(16) uint32_t sums[4]; acc.store(sums);
+          blocks[(16 * k)     / BlockSize] += sums[0];
+          blocks[(16 * k + 8) / BlockSize] += sums[2];
+        },
+        [&] (size_t c, uint8_t va, uint8_t vb) {
+          blocks[c / BlockSize] += std::abs(int(va) - int(vb));
+        }
+      );
+    }
+  );
+}
+
+/// Computes the sum of squared differences between each BlockSize x
+/// BlockSize block of matrices \p a and \p b, with the same layout of \p out
+/// as sad_blocks.
+/// \param[in] a      The first matrix.
+/// \param[in] b      The second matrix.
+/// \param[in] out    The output for the SSD of each block.
+/// \param[in] policy The execution policy for the computation.
+/// \tparam BlockSize The size of each block, which must be a multiple of 8.
+template <size_t BlockSize, uint8_t F, typename A>
+static inline void ssd_blocks(const Matrix<F, A>&    a                 , 
+                              const Matrix<F, A>&    b                 ,
+                              std::vector<uint32_t>& out               ,
+                              ExecutionPolicy        policy = EP_SERIAL) {
+  assert(a.rows() == b.rows() && a.cols() == b.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::ssd_blocks", a.size(), 2 * a.size());
+  const auto   ra      = detail::make_region(a), rb = detail::make_region(b);
+  const size_t blocksX = block_count(ra.cols, BlockSize);
+
+  // Accumulators for the low and high 8 elements of a strip.
+  struct Acc { Vec4x32s lo, hi; };
+
+  out.assign(block_count(ra.rows, BlockSize) * blocksX, 0);
+  detail::for_each_block_row(block_count(ra.rows, BlockSize), ra.size(), 
+    policy, [&] (size_t blockRow) {
+      uint32_t* blocks = &out[blockRow * blocksX];
+      detail::block_row_strips<BlockSize>(ra, rb, blockRow, 
+        Acc{Vec4x32s(0), Vec4x32s(0)},
+        [] (Acc& acc, const Vec16x8u& va, const Vec16x8u& vb) {
+          const auto d  = absdiff(va, vb);
+          const auto lo = widen_lo(d), hi = widen_hi(d);
+          acc.lo = acc.lo + madd(lo, lo);
+          acc.hi = acc.hi + madd(hi, hi);
+        },
+        [&] (size_t k, const Acc& acc) {
+          blocks[(16 * k)     / BlockSize] += acc.lo.hsum();
+          blocks[(16 * k + 8) / BlockSize] += acc.hi.hsum();
+        },
+        [&] (size_t c, uint8_t va, uint8_t vb) {
+          const int d = int(va) - int(vb);
+          blocks[c / BlockSize] += d * d;
+        }
+      );
+    }
+  );
+}
+
+/// Computes the structural similarity index of each BlockSize x BlockSize
+/// block of matrices \p a and \p b, where each block is used as a single
+/// window, with the same layout of \p out as sad_blocks.
+/// \param[in] a      The first matrix.
+/// \param[in] b      The second matrix.
+/// \param[in] out    The output for the SSIM of each block.
+/// \param[in] policy The execution policy for the computation.
+/// \tparam BlockSize The size of each block, which must be a multiple of 8.
+template <size_t BlockSize, uint8_t F, typename A>
+static inline void ssim_blocks(const Matrix<F, A>& a                 , 
+                               const Matrix<F, A>& b                 ,
+                               std::vector<float>& out               ,
+                               ExecutionPolicy     policy = EP_SERIAL) {
+  assert(a.rows() == b.rows() && a.cols() == b.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::ssim_blocks", a.size(), 2 * a.size());
+  const auto   ra      = detail::make_region(a), rb = detail::make_region(b);
+  const size_t blocksX = block_count(ra.cols, BlockSize);
+
+  // Accumulators for a strip, the sums are in lanes 0 and 2 for the low and
+  // high 8 elements, and the products are split into low and high halves.
+  struct Acc { Vec4x32u a, b; Vec4x32s aa[2], bb[2], ab[2]; };
+  const Vec16x8u zero(uint8_t(0));
+  const Vec4x32s zero32(0);
+
+  out.assign(block_count(ra.rows, BlockSize) * blocksX, 0.0f);
+  detail::for_each_block_row(block_count(ra.rows, BlockSize), ra.size(), 
+    policy, [&] (size_t blockRow) {
+      using Sums = detail::SsimSums<uint32_t>;
+      std::vector<Sums> sums(blocksX, Sums{0, 0, 0, 0, 0});
+
+      detail::block_row_strips<BlockSize>(ra, rb, blockRow, 
+        Acc{Vec4x32u(0u), Vec4x32u(0u), {zero32, zero32}, {zero32, zero32},
+            {zero32, zero32}},
+        [&] (Acc& acc, const Vec16x8u& va, const Vec16x8u& vb) {
+          acc.a = acc.a + sad(va, zero);
+          acc.b = acc.b + sad(vb, zero);
+          const Vec8x16u a[2] = {widen_lo(va), widen_hi(va)};
+          const Vec8x16u b[2] = {widen_lo(vb), widen_hi(vb)};
+          for (size_t h = 0; h < 2; ++h) {
+            acc.aa[h] = acc.aa[h] + madd(a[h], a[h]);
+            acc.bb[h] = acc.bb[h] + madd(b[h], b[h]);
+            acc.ab[h] = acc.ab[h] + madd(a[h], b[h]);
+          }
+        },
+        [&] (size_t k, const Acc& acc) {
+          SNAP_ALIGN(16) uint32_t sumA[4], sumB[4];
+          acc.a.store(sumA);
+          acc.b.store(sumB);
+          for (size_t h = 0; h < 2; ++h) {
+            auto& block = sums[(16 * k + 8 * h) / BlockSize];
+            block.a  += sumA[2 * h];
+            block.b  += sumB[2 * h];
+            block.aa += acc.aa[h].hsum();
+            block.bb += acc.bb[h].hsum();
+            block.ab += acc.ab[h].hsum();
+          }
+        },
+        [&] (size_t c, uint8_t va, uint8_t vb) {
+          auto& block = sums[c / BlockSize];
+          block.a  += va     ; block.b  += vb;
+          block.aa += va * va; block.bb += vb * vb;
+          block.ab += va * vb;
+        }
+      );
+
+      const size_t rowBegin = blockRow * BlockSize;
+      const size_t rows     = std::min(BlockSize, ra.rows - rowBegin);
+      for (size_t bx = 0; bx < blocksX; ++bx) {
+        const size_t cols = std::min(BlockSize, ra.cols - bx * BlockSize);
+        out[blockRow * blocksX + bx] = static_cast<float>(
+          detail::ssim_from_sums(sums[bx], double(rows * cols)));
+      }
+    }
+  );
+}
+
+} // namespace alg
+} // namespace snap
+
+#endif // SNAP_ALGORITHM_METRICS_HPP
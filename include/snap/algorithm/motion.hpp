@@ -0,0 +1,325 @@
+//---- snap/algorithm/motion.hpp --------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  motion.hpp
+/// \brief Defines a block matching motion estimation engine, which finds
+///        the motion vector of each block of a frame relative to a reference
+///        frame using full, diamond or hexagon search.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_ALGORITHM_MOTION_HPP
+#define SNAP_ALGORITHM_MOTION_HPP
+
+#include "region.hpp"
+#include "snap/utility/performance.hpp"
+#include <cassert>
+#include <limits>
+#include <vector>
+
+namespace snap {
+namespace alg  {
+
+/// Defines the possible search methods for block matching.
+enum SearchMethod : uint8_t {
+  SM_FULL    = 0,   //!< Exhaustive search of every candidate in the range.
+  SM_DIAMOND = 1,   //!< Large then small diamond pattern search.
+  SM_HEXAGON = 2    //!< Large hexagon then 3x3 square pattern search.
+};
+
+/// Defines the motion vector of a block, which is the displacement from the
+/// block in the current frame to the best matching block in the reference
+/// frame.
+struct MotionVector {
+  int16_t  x;       //!< The horizontal displacement.
+  int16_t  y;       //!< The vertical displacement.
+  uint32_t sad;     //!< The SAD of the block for the displacement.
+};
+
+namespace detail {
+
+/// Defines a displacement in a search pattern.
+struct Offset {
+  int x;    //!< The horizontal displacement.
+  int y;    //!< The vertical displacement.
+};
+
+/// Defines the data for the search of a single block.
+template <size_t BlockSize>
+struct BlockSearch {
+  /// Defines the cost of a candidate which can't be evaluated.
+  static constexpr uint32_t INVALID = std::numeric_limits<uint32_t>::max();
+
+  const Region& ref;    //!< The reference frame.
+  const Region& cur;    //!< The current frame.
+  int           bx;     //!< The column of the block.
+  int           by;     //!< The row of the block.
+  int           xMin;   //!< The min valid candidate column.
+  int           xMax;   //!< The max valid candidate column.
+  int           yMin;   //!< The min valid candidate row.
+  int           yMax;   //!< The max valid candidate row.
+
+  /// Constructor: Sets up the search for the block with top left element
+  /// (\p x, \p y), with displacements of up to \p range in each direction,
+  /// where candidates are restricted to the bounds of the reference frame.
+  BlockSearch(const Region& r, const Region& c, int x, int y, int range)
+  : ref(r), cur(c), bx(x), by(y), 
+    xMin(std::max(0, x - range)), 
+    xMax(std::min(int(r.cols - BlockSize), x + range)),
+    yMin(std::max(0, y - range)), 
+    yMax(std::min(int(r.rows - BlockSize), y + range)) {}
+
+  /// Returns if the displacement (\p dx, \p dy) is a valid candidate.
+  bool valid(int dx, int dy) const {
+    return bx + dx >= xMin && bx + dx <= xMax && 
+           by + dy >= yMin && by + dy <= yMax;
+  }
+
+  /// Returns the SAD of the block for displacement (\p dx, \p dy), or 
+  /// INVALID if the displacement is not a valid candidate.
+  uint32_t cost(int dx, int dy) const {
+    if (!valid(dx, dy))
+      return INVALID;
+
+    const uint8_t* c = cur.row(by) + bx;
+    const uint8_t* r = ref.row(by + dy) + bx + dx;
+
+    Vec4x32u acc(0u);
+    util::perf::unroll<0, BlockSize - 1>([&] (const UnrollIndex i) {
+      Vec16x8u vc, vr;
+      if (BlockSize == 16) {
+        vc.load(c + i * cur.stride);
+        vr.load(r + i * ref.stride);
+      } else {
+        vc.loadl(c + i * cur.stride);
+        vr.loadl(r + i * ref.stride);
+      }
+      acc = acc + sad(vc, vr);
+    });
+    return static_cast<uint32_t>(acc.hsum());
+  }
+};
+
+/// Updates \p best with the candidate (\p dx, \p dy) if its SAD is lower.
+/// \param[in] best The best candidate so far.
+/// \param[in] dx   The horizontal displacement of the candidate.
+/// \param[in] dy   The vertical displacement of the candidate.
+/// \param[in] sad  The SAD of the candidate.
+static inline void update_best(MotionVector& best, int dx, int dy, 
+    uint32_t sad) {
+  if (sad < best.sad)
+    best = MotionVector{int16_t(dx), int16_t(dy), sad};
+}
+
+#if defined(SSE_ENABLED) && defined(__SSE4_1__)
+
+/// Computes the SADs of the block at \p cur against the 8 horizontally
+/// consecutive candidates starting at \p ref, using mpsadbw, which computes
+/// 8 sums of 4 absolute differences per instruction. The reference rows are
+/// read from ref to ref + 8 + BlockSize - 1.
+/// \param[in] cur       A pointer to the top left element of the block.
+/// \param[in] curStride The stride of the current frame.
+/// \param[in] ref       A pointer to the top left element of the first
+///                      candidate.
+/// \param[in] refStride The stride of the reference frame.
+template <size_t BlockSize>
+static SNAP_INLINE __m128i sad8_candidates(const uint8_t* cur, 
+    size_t curStride, const uint8_t* ref, size_t refStride) {
+  // The sums are at most BlockSize * BlockSize * 255, which fits in 16 bits.
+  __m128i sums = _mm_setzero_si128();
+  util::perf::unroll<0, BlockSize - 1>([&] (const UnrollIndex i) {
+    const uint8_t* r = ref + i * refStride;
+    const __m128i  c = BlockSize == 16 
+      ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + i * curStride))
+      : _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cur + i * curStride));
+    const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r));
+
+    // Quads 0 and 1 of the block against ref + k and ref + k + 4.
+    sums = _mm_adds_epu16(sums, _mm_mpsadbw_epu8(r0, c, 0));
+    sums = _mm_adds_epu16(sums, _mm_mpsadbw_epu8(r0, c, 5));
+    if (BlockSize == 16) {
+      // Quads 2 and 3 of the block against ref + k + 8 and ref + k + 12.
+      const __m128i r8 = 
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + 8));
+      sums = _mm_adds_epu16(sums, _mm_mpsadbw_epu8(r8, c, 2));
+      sums = _mm_adds_epu16(sums, _mm_mpsadbw_epu8(r8, c, 7));
+    }
+  });
+  return sums;
+}
+
+/// Searches the candidates in row \p dy with displacements starting at
+/// \p dxBegin, 8 candidates at a time. The SADs of the 8 candidates are
+/// computed with mpsadbw, and the min and its index are found with
+/// phminposuw. Returns the first displacement which was not searched.
+/// \param[in] s       The block search.
+/// \param[in] dy      The vertical displacement of the row.
+/// \param[in] dxBegin The first horizontal displacement.
+/// \param[in] best    The best candidate so far.
+template <size_t BlockSize>
+static inline int search_row_sad8(const BlockSearch<BlockSize>& s, int dy,
+    int dxBegin, MotionVector& best) {
+  // The loads of the reference rows must be in the bounds of the row.
+  const int lastLoad = int(s.ref.cols) - int(BlockSize) - 8;
+  const __m128i lanes = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+
+  int dx = dxBegin;
+  for (; s.bx + dx <= s.xMax && s.bx + dx <= lastLoad; dx += 8) {
+    __m128i sums = sad8_candidates<BlockSize>(
+      s.cur.row(s.by) + s.bx     , s.cur.stride, 
+      s.ref.row(s.by + dy) + s.bx + dx, s.ref.stride);
+
+    // Candidates past the end of the range must not be selected.
+    const __m128i invalid = _mm_cmpgt_epi16(
+      lanes, _mm_set1_epi16(int16_t(s.xMax - s.bx - dx)));
+    sums = _mm_or_si128(sums, invalid);
+
+    const uint32_t result = _mm_cvtsi128_si32(_mm_minpos_epu16(sums));
+    update_best(best, dx + int(result >> 16), dy, result & 0xffff);
+  }
+  return dx;
+}
+
+#endif // SSE_ENABLED && __SSE4_1__
+
+/// Performs a full search of all candidates for the block search \p s.
+/// \param[in] s    The block search.
+/// \param[in] best The best candidate, which must be initialized with the
+///                 SAD of the zero vector.
+template <size_t BlockSize>
+static inline void full_search(const BlockSearch<BlockSize>& s, 
+    MotionVector& best) {
+  for (int dy = s.yMin - s.by; dy <= s.yMax - s.by; ++dy) {
+    int dx = s.xMin - s.bx;
+#if defined(SSE_ENABLED) && defined(__SSE4_1__)
+    dx = search_row_sad8(s, dy, dx, best);
+#endif
+    for (; dx <= s.xMax - s.bx; ++dx)
+      update_best(best, dx, dy, s.cost(dx, dy));
+  }
+}
+
+/// Performs a pattern search for the block search \p s. The large pattern
+/// is repeated, moving the center to the best candidate, until the center is
+/// the best candidate, after which the small pattern is used once to refine
+/// the result.
+/// \param[in] s     The block search.
+/// \param[in] large The large search pattern.
+/// \param[in] small The small refinement pattern.
+/// \param[in] range The max number of steps of the large pattern.
+/// \param[in] best  The best candidate, which is used as the start.
+template <size_t BlockSize, size_t Large, size_t Small>
+static inline void pattern_search(const BlockSearch<BlockSize>& s, 
+                                  const Offset (&large)[Large],
+                                  const Offset (&small)[Small],
+                                  int           range,
+                                  MotionVector& best) {
+  for (int step = 0; step < range; ++step) {
+    const MotionVector center = best;
+    for (const auto& o : large)
+      update_best(best, center.x + o.x, center.y + o.y, 
+        s.cost(center.x + o.x, center.y + o.y));
+    if (best.x == center.x && best.y == center.y)
+      break;
+  }
+
+  const MotionVector center = best;
+  for (const auto& o : small)
+    update_best(best, center.x + o.x, center.y + o.y, 
+      s.cost(center.x + o.x, center.y + o.y));
+}
+
+} // namespace detail
+
+/// Estimates the motion of each BlockSize x BlockSize block in frame \p
+/// current relative to frame \p reference, which must have the same
+/// dimensions. The motion vector of a block is the displacement of the block
+/// with the lowest SAD in the reference frame, within \p range elements in
+/// each direction, and within the bounds of the reference frame. Only full 
+/// blocks are searched, and the motion vectors are stored in row major order
+/// in \p field, which is resized to (rows / BlockSize) x (cols / BlockSize).
+/// 
+/// For SM_FULL, the candidates of each row are evaluated 8 at a time with
+/// mpsadbw when SSE4.1 is available, otherwise each candidate is evaluated
+/// with psadbw. For SM_DIAMOND and SM_HEXAGON the search starts from the 
+/// better of the zero vector and the vector of the block to the left, so the
+/// rows of blocks can be searched in parallel when \p policy is EP_PARALLEL.
+/// Ties are resolved in favour of the starting vector.
+///
+/// \param[in] reference The reference frame.
+/// \param[in] current   The current frame.
+/// \param[in] field     The output motion vector field.
+/// \param[in] method    The search method.
+/// \param[in] range     The max displacement in each direction.
+/// \param[in] policy    The execution policy.
+/// \tparam    BlockSize The size of the blocks, which must be 8 or 16.
+template <size_t BlockSize = 16, uint8_t F, typename A>
+static inline void estimate_motion(const Matrix<F, A>&        reference, 
+                                   const Matrix<F, A>&        current  ,
+                                   std::vector<MotionVector>& field    , 
+                                   SearchMethod    method = SM_DIAMOND , 
+                                   int             range  = 16         ,
+                                   ExecutionPolicy policy = EP_SERIAL  ) {
+  static_assert(BlockSize == 8 || BlockSize == 16, 
+    "Block size must be 8 or 16!");
+  assert(reference.rows() == current.rows() && 
+         reference.cols() == current.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::estimate_motion", current.size(), 
+    2 * current.size());
+
+  static constexpr detail::Offset smallDiamond[4] = 
+    {{0, -1}, {1, 0}, {0, 1}, {-1, 0}};
+  static constexpr detail::Offset largeDiamond[8] = 
+    {{0, -2}, {1, -1}, {2, 0}, {1, 1}, {0, 2}, {-1, 1}, {-2, 0}, {-1, -1}};
+  static constexpr detail::Offset largeHexagon[6] = 
+    {{-2, 0}, {-1, -2}, {1, -2}, {2, 0}, {1, 2}, {-1, 2}};
+  static constexpr detail::Offset smallSquare[8] = 
+    {{-1, -1}, {0, -1}, {1, -1}, {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}};
+
+  const auto   ref     = detail::make_region(reference);
+  const auto   cur     = detail::make_region(current);
+  const size_t blocksX = cur.cols / BlockSize;
+  const size_t blocksY = cur.rows / BlockSize;
+
+  field.resize(blocksX * blocksY);
+  detail::for_each_block_row(blocksY, cur.size(), policy, 
+    [&] (size_t blockRow) {
+      MotionVector* vectors = &field[blockRow * blocksX];
+      for (size_t blockCol = 0; blockCol < blocksX; ++blockCol) {
+        const detail::BlockSearch<BlockSize> search(ref, cur, 
+          int(blockCol * BlockSize), int(blockRow * BlockSize), range);
+
+        MotionVector best{0, 0, search.cost(0, 0)};
+        if (method == SM_FULL) {
+          detail::full_search(search, best);
+        } else {
+          if (blockCol > 0) {
+            const auto& left = vectors[blockCol - 1];
+            detail::update_best(best, left.x, left.y, 
+              search.cost(left.x, left.y));
+          }
+          if (method == SM_DIAMOND)
+            detail::pattern_search(search, largeDiamond, smallDiamond, 
+              range, best);
+          else 
+            detail::pattern_search(search, largeHexagon, smallSquare, 
+              range, best);
+        }
+        vectors[blockCol] = best;
+      }
+    }
+  );
+}
+
+} // namespace alg
+} // namespace snap
+
+#endif // SNAP_ALGORITHM_MOTION_HPP
@@ -0,0 +1,516 @@
+//---- snap/algorithm/preprocess.hpp ----------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  preprocess.hpp
+/// \brief Defines the kernels used to prepare images as network inputs: 
+///        colour conversion, bilinear resizing and normalization to floating
+///        point, which is fused with the conversion of BGR elements to 
+///        planar or interleaved tensors. Each kernel has a version for a 
+///        single Matrix and a version for a MatrixBatch. The batched 
+///        versions compute any coefficients once for all the frames, and 
+///        split the rows of all the frames across threads, so that batches 
+///        of small frames still use all the threads.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_ALGORITHM_PREPROCESS_HPP
+#define SNAP_ALGORITHM_PREPROCESS_HPP
+
+#include "region.hpp"
+#include "snap/matrix/matrix_batch.hpp"
+#include "snap/utility/performance.hpp"
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace snap   {
+namespace alg    {
+
+/// Defines the possible layouts of the floating point tensors which images 
+/// are normalized into.
+enum TensorLayout : uint8_t {
+  TL_CHW = 0,   //!< Planar, with all the values of a channel together.
+  TL_HWC = 1    //!< Interleaved, with the channels of an element together.
+};
+
+namespace detail {
+
+/// Defines the number of fractional bits of the BGR to greyscale weights.
+static constexpr uint32_t GREY_SHIFT = 14;
+
+/// Defines the BT.601 weights of the blue, green and red channels for the
+/// conversion to greyscale, which sum to 1 << GREY_SHIFT.
+static constexpr uint32_t GREY_WEIGHT_B = 1868;
+static constexpr uint32_t GREY_WEIGHT_G = 9617;
+static constexpr uint32_t GREY_WEIGHT_R = 4899;
+
+/// Defines the number of fractional bits of the bilinear weights. The
+/// product of two weights and a sample must fit in 32 bits.
+static constexpr uint32_t RESIZE_SHIFT = 11;
+
+/// Defines the coefficients for bilinear resizing along one dimension: each
+/// output index i interpolates between input indices offset[i] and 
+/// offset[i] + step[i] with weight[i] for the second input.
+struct ResizeAxis {
+  std::vector<uint32_t> offset;  //!< The first input index.
+  std::vector<uint8_t>  step;    //!< The distance to the second index.
+  std::vector<uint16_t> weight;  //!< The weight of the second input.
+};
+
+/// Computes the coefficients to resize a dimension of \p in elements to \p
+/// out elements, where the centers of the elements are aligned.
+/// \param[in] in  The number of input elements.
+/// \param[in] out The number of output elements.
+static inline ResizeAxis make_resize_axis(size_t in, size_t out) {
+  constexpr uint32_t one = 1 << RESIZE_SHIFT;
+  const double scale = double(in) / double(out);
+
+  ResizeAxis axis;
+  axis.offset.resize(out);
+  axis.step.resize(out);
+  axis.weight.resize(out);
+  for (size_t i = 0; i < out; ++i) {
+    const double position = std::min(std::max((i + 0.5) * scale - 0.5, 0.0),
+                                      double(in - 1));
+    const size_t first    = std::min(size_t(position), in - 1);
+    axis.offset[i] = static_cast<uint32_t>(first);
+    axis.step[i]   = first + 1 < in ? 1 : 0;
+    axis.weight[i] = static_cast<uint16_t>(
+      std::min<uint32_t>(uint32_t((position - first) * one + 0.5), one));
+  }
+  return axis;
+}
+
+/// Converts \p cols BGR elements at \p in to greyscale elements at \p out.
+/// \param[in] in   A pointer to the BGR elements.
+/// \param[in] out  A pointer to the greyscale elements.
+/// \param[in] cols The number of elements.
+static inline void convert_row(const uint8_t* in, uint8_t* out, size_t cols) {
+  constexpr uint32_t half = 1 << (GREY_SHIFT - 1);
+  for (size_t c = 0; c < cols; ++c, in += 3) {
+    out[c] = static_cast<uint8_t>((in[0] * GREY_WEIGHT_B + 
+      in[1] * GREY_WEIGHT_G + in[2] * GREY_WEIGHT_R + half) >> GREY_SHIFT);
+  }
+}
+
+/// Computes row \p r of an image resized from \p in into \p out.
+/// \param[in] in       A pointer to the first input element.
+/// \param[in] inStride The number of elements between input rows.
+/// \param[in] out      A pointer to the first element of the output row.
+/// \param[in] r        The index of the output row.
+/// \param[in] x        The coefficients for the columns.
+/// \param[in] y        The coefficients for the rows.
+static inline void resize_row(const uint8_t* in, size_t inStride, 
+                              uint8_t* out, size_t r, const ResizeAxis& x,
+                              const ResizeAxis& y) {
+  constexpr uint32_t one  = 1 << RESIZE_SHIFT;
+  constexpr uint32_t half = 1 << (2 * RESIZE_SHIFT - 1);
+
+  const uint8_t* top    = in + y.offset[r] * inStride;
+  const uint8_t* bottom = top + y.step[r] * inStride;
+  const uint32_t wy     = y.weight[r];
+  for (size_t c = 0; c < x.offset.size(); ++c) {
+    const uint32_t first = x.offset[c];
+    const uint32_t last  = first + x.step[c];
+    const uint32_t wx    = x.weight[c];
+    const uint32_t t     = top[first]    * (one - wx) + top[last]    * wx;
+    const uint32_t b     = bottom[first] * (one - wx) + bottom[last] * wx;
+    out[c] = static_cast<uint8_t>(
+      (t * (one - wy) + b * wy + half) >> (2 * RESIZE_SHIFT));
+  }
+}
+
+/// Normalizes the \p n elements at \p in as in * scale + bias, to \p out.
+/// The loop has no dependencies between iterations, so it is vectorized by
+/// the compiler, since the Vector interface has no floating point types.
+/// \param[in] in    A pointer to the elements to normalize.
+/// \param[in] out   A pointer to the normalized elements.
+/// \param[in] n     The number of elements.
+/// \param[in] scale The scale for the elements.
+/// \param[in] bias  The bias to add to the scaled elements.
+static inline void normalize_row(const uint8_t* in, float* out, size_t n,
+                                 float scale, float bias) {
+  for (size_t i = 0; i < n; ++i)
+    out[i] = float(in[i]) * scale + bias;
+}
+
+/// Defines the per channel scale and bias which normalize BGR elements to
+/// floating point as (value - mean) / stddev = value * scale + bias.
+struct ChannelNorm {
+  float scale[3];   //!< The scale of the B, G and R channels.
+  float bias[3];    //!< The bias of the B, G and R channels.
+};
+
+/// Computes the normalization of BGR channels with means \p mean and 
+/// standard deviations \p stddev.
+/// \param[in] mean   The mean of the B, G and R channels.
+/// \param[in] stddev The standard deviation of the B, G and R channels.
+static inline ChannelNorm make_channel_norm(const float (&mean)[3], 
+                                            const float (&stddev)[3]) {
+  ChannelNorm norm;
+  for (size_t k = 0; k < 3; ++k) {
+    norm.scale[k] = 1.0f / stddev[k];
+    norm.bias[k]  = -mean[k] / stddev[k];
+  }
+  return norm;
+}
+
+#if defined(SSE_ENABLED) && defined(__SSE4_1__)
+
+/// Returns the pshufb mask which moves the bytes of channel \p k of 16
+/// interleaved BGR elements which are in input vector \p v of the 3 vectors
+/// holding the elements to their element index, and zeros the other bytes.
+/// \param[in] k The channel to gather.
+/// \param[in] v The index of the input vector.
+static inline __m128i deinterleave_mask(size_t k, size_t v) {
+  alignas(16) int8_t mask[16];
+  for (size_t i = 0; i < 16; ++i) {
+    const size_t byte = 3 * i + k;
+    mask[i] = byte / 16 == v ? static_cast<int8_t>(byte % 16) : int8_t(-128);
+  }
+  return _mm_load_si128(reinterpret_cast<const __m128i*>(mask));
+}
+
+/// Widens the 16 bytes of \p v to floats, and stores value * scale + bias
+/// for the 4 groups of 4 values to \p out, with scale[j] and bias[j] for
+/// group j.
+/// \param[in] v     The bytes to normalize.
+/// \param[in] out   A pointer to the 16 normalized values.
+/// \param[in] scale The scales for each group of 4 values.
+/// \param[in] bias  The biases for each group of 4 values.
+static SNAP_INLINE void store_normalized(__m128i v, float* out, 
+                                         const __m128* scale, 
+                                         const __m128* bias) {
+  util::perf::unroll<0, 3>([&] (size_t j) {
+    const __m128 x = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(v));
+    _mm_storeu_ps(out + 4 * j, _mm_add_ps(_mm_mul_ps(x, scale[j]), bias[j]));
+    v = _mm_srli_si128(v, 4);
+  });
+}
+
+#endif // SSE_ENABLED && __SSE4_1__
+
+/// Normalizes \p cols BGR elements at \p in, writing each channel to the
+/// corresponding plane of \p out, where the planes are \p plane values
+/// apart. With SSE4.1, 16 elements are deinterleaved with pshufb and 
+/// widened to floats per iteration, so there are no intermediate buffers.
+/// \param[in] in    A pointer to the BGR elements.
+/// \param[in] out   A pointer to the first value of the B plane.
+/// \param[in] plane The number of values between planes.
+/// \param[in] cols  The number of elements.
+/// \param[in] norm  The normalization of each channel.
+static inline void normalize_planar_row(const uint8_t* in, float* out, 
+                                        size_t plane, size_t cols, 
+                                        const ChannelNorm& norm) {
+  size_t c = 0;
+#if defined(SSE_ENABLED) && defined(__SSE4_1__)
+  __m128i masks[3][3];
+  __m128  scale[3][4], bias[3][4];
+  for (size_t k = 0; k < 3; ++k) {
+    for (size_t v = 0; v < 3; ++v) 
+      masks[k][v] = deinterleave_mask(k, v);
+    for (size_t j = 0; j < 4; ++j) {
+      scale[k][j] = _mm_set1_ps(norm.scale[k]);
+      bias[k][j]  = _mm_set1_ps(norm.bias[k]);
+    }
+  }
+
+  for (; c + 16 <= cols; c += 16) {
+    const auto*   p  = reinterpret_cast<const __m128i*>(in + 3 * c);
+    const __m128i v0 = _mm_loadu_si128(p);
+    const __m128i v1 = _mm_loadu_si128(p + 1);
+    const __m128i v2 = _mm_loadu_si128(p + 2);
+    for (size_t k = 0; k < 3; ++k) {
+      const __m128i channel = _mm_or_si128(
+        _mm_or_si128(_mm_shuffle_epi8(v0, masks[k][0]), 
+                     _mm_shuffle_epi8(v1, masks[k][1])),
+        _mm_shuffle_epi8(v2, masks[k][2]));
+      store_normalized(channel, out + k * plane + c, scale[k], bias[k]);
+    }
+  }
+#endif
+  for (; c < cols; ++c) {
+    for (size_t k = 0; k < 3; ++k) 
+      out[k * plane + c] = float(in[3 * c + k]) * norm.scale[k] + norm.bias[k];
+  }
+}
+
+/// Normalizes \p cols BGR elements at \p in, writing the channels of each
+/// element together to \p out. With SSE4.1, 16 elements are widened to 
+/// floats per iteration in the order of the input, where the channels of 
+/// each group of 4 values repeat every 3 groups, so no shuffles are needed.
+/// \param[in] in    A pointer to the BGR elements.
+/// \param[in] out   A pointer to the first normalized value.
+/// \param[in] cols  The number of elements.
+/// \param[in] norm  The normalization of each channel.
+static inline void normalize_interleaved_row(const uint8_t* in, float* out, 
+                                             size_t cols, 
+                                             const ChannelNorm& norm) {
+  const size_t n = cols * 3;
+  size_t       i = 0;
+#if defined(SSE_ENABLED) && defined(__SSE4_1__)
+  // Group g of 4 values starts at channel g % 3, and vector v holds groups
+  // 4v to 4v + 3, so group j of vector v starts at channel (v + j) % 3.
+  __m128 scale[6], bias[6];
+  for (size_t g = 0; g < 6; ++g) {
+    scale[g] = _mm_setr_ps(norm.scale[g % 3], norm.scale[(g + 1) % 3], 
+                           norm.scale[(g + 2) % 3], norm.scale[g % 3]);
+    bias[g]  = _mm_setr_ps(norm.bias[g % 3], norm.bias[(g + 1) % 3], 
+                           norm.bias[(g + 2) % 3], norm.bias[g % 3]);
+  }
+
+  for (; i + 48 <= n; i += 48) {
+    const auto* p = reinterpret_cast<const __m128i*>(in + i);
+    for (size_t v = 0; v < 3; ++v) 
+      store_normalized(_mm_loadu_si128(p + v), out + i + 16 * v, 
+                       scale + v, bias + v);
+  }
+#endif
+  for (; i < n; ++i) 
+    out[i] = float(in[i]) * norm.scale[i % 3] + norm.bias[i % 3];
+}
+
+/// Calls \p f(frame, row) for all the \p rows rows of each of the \p frames
+/// frames, where each row has \p cols elements. When \p policy is 
+/// EP_PARALLEL the rows of all the frames are split across the threads, so 
+/// that both large frames and batches of small frames are split evenly.
+/// \param[in] frames The number of frames.
+/// \param[in] rows   The number of rows in each frame.
+/// \param[in] cols   The number of elements in each row.
+/// \param[in] policy The execution policy.
+/// \param[in] f      The function to call for each row.
+template <typename F>
+static inline void for_each_frame_row(size_t frames, size_t rows, 
+                                      size_t cols, ExecutionPolicy policy,
+                                      F&& f) {
+  const size_t total  = frames * rows;
+  const size_t chunks = 
+    util::par::chunk_count(total * cols, policy, MIN_PARALLEL_ELEMENTS);
+
+  util::par::parallel_for(0, total, chunks,
+    [&] (size_t begin, size_t end, size_t) {
+      for (size_t i = begin; i < end; ++i)
+        f(i / rows, i % rows);
+    }
+  );
+}
+
+} // namespace detail
+
+/// Converts the BGR matrix \p in to the greyscale matrix \p out, which must
+/// have the same dimensions, using the BT.601 luma weights.
+/// \param[in] in     The matrix to convert.
+/// \param[in] out    The converted matrix.
+/// \param[in] policy The execution policy.
+template <typename A, typename B>
+static inline void convert(const Matrix<mat::FM_BGR_24, A>& in     , 
+                           Matrix<mat::FM_GREY_8, B>&       out    ,
+                           ExecutionPolicy policy = EP_SERIAL      ) {
+  assert(in.rows() == out.rows() && in.cols() == out.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::convert", in.size(), 4 * in.size());
+  detail::for_each_frame_row(1, in.rows(), in.cols(), policy, 
+    [&] (size_t, size_t r) {
+      detail::convert_row(in.data() + r * in.stride(), 
+                          out.data() + r * out.stride(), in.cols());
+    }
+  );
+}
+
+/// Converts each frame of the BGR batch \p in to the corresponding frame of
+/// the greyscale batch \p out, which must have the same number of frames 
+/// and dimensions.
+/// \param[in] in     The batch to convert.
+/// \param[in] out    The converted batch.
+/// \param[in] policy The execution policy.
+template <typename A, typename B>
+static inline void convert(const MatrixBatch<mat::FM_BGR_24, A>& in     , 
+                           MatrixBatch<mat::FM_GREY_8, B>&       out    ,
+                           ExecutionPolicy policy = EP_SERIAL           ) {
+  assert(in.count() == out.count() && 
+         in.rows()  == out.rows()  && in.cols() == out.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::convert", in.count() * in.size(), 
+    4 * in.count() * in.size());
+  detail::for_each_frame_row(in.count(), in.rows(), in.cols(), policy, 
+    [&] (size_t n, size_t r) {
+      detail::convert_row(in.data(n) + r * in.stride(), 
+                          out.data(n) + r * out.stride(), in.cols());
+    }
+  );
+}
+
+/// Resizes the greyscale matrix \p in to the dimensions of matrix \p out,
+/// with bilinear interpolation.
+/// \param[in] in     The matrix to resize.
+/// \param[in] out    The resized matrix.
+/// \param[in] policy The execution policy.
+template <typename A, typename B>
+static inline void resize(const Matrix<mat::FM_GREY_8, A>& in     , 
+                          Matrix<mat::FM_GREY_8, B>&       out    ,
+                          ExecutionPolicy policy = EP_SERIAL      ) {
+  assert(in.size() > 0);
+  SNAP_INSTRUMENT_KERNEL("alg::resize", out.size(), in.size() + out.size());
+  const auto x = detail::make_resize_axis(in.cols(), out.cols());
+  const auto y = detail::make_resize_axis(in.rows(), out.rows());
+  detail::for_each_frame_row(1, out.rows(), out.cols(), policy, 
+    [&] (size_t, size_t r) {
+      detail::resize_row(in.data(), in.stride(), 
+                         out.data() + r * out.stride(), r, x, y);
+    }
+  );
+}
+
+/// Resizes each frame of the greyscale batch \p in to the dimensions of the
+/// frames of batch \p out, which must have the same number of frames, with
+/// bilinear interpolation. The coefficients are computed once for all the
+/// frames.
+/// \param[in] in     The batch to resize.
+/// \param[in] out    The resized batch.
+/// \param[in] policy The execution policy.
+template <typename A, typename B>
+static inline void resize(const MatrixBatch<mat::FM_GREY_8, A>& in     , 
+                          MatrixBatch<mat::FM_GREY_8, B>&       out    ,
+                          ExecutionPolicy policy = EP_SERIAL           ) {
+  assert(in.count() == out.count() && in.size() > 0);
+  SNAP_INSTRUMENT_KERNEL("alg::resize", out.count() * out.size(), 
+    in.count() * in.size() + out.count() * out.size());
+  const auto x = detail::make_resize_axis(in.cols(), out.cols());
+  const auto y = detail::make_resize_axis(in.rows(), out.rows());
+  detail::for_each_frame_row(out.count(), out.rows(), out.cols(), policy, 
+    [&] (size_t n, size_t r) {
+      detail::resize_row(in.data(n), in.stride(), 
+                         out.data(n) + r * out.stride(), r, x, y);
+    }
+  );
+}
+
+/// Normalizes the elements of the greyscale matrix \p in to floating point
+/// as in * scale + bias, writing the rows of the result contiguously to \p
+/// out, which must have space for in.size() values.
+/// \param[in] in     The matrix to normalize.
+/// \param[in] out    A pointer to the normalized values.
+/// \param[in] scale  The scale for the elements.
+/// \param[in] bias   The bias to add to the scaled elements.
+/// \param[in] policy The execution policy.
+template <typename A>
+static inline void normalize(const Matrix<mat::FM_GREY_8, A>& in     , 
+                             float*                           out    ,
+                             float                            scale  ,
+                             float                            bias   ,
+                             ExecutionPolicy policy = EP_SERIAL      ) {
+  SNAP_INSTRUMENT_KERNEL("alg::normalize", in.size(), 5 * in.size());
+  detail::for_each_frame_row(1, in.rows(), in.cols(), policy, 
+    [&] (size_t, size_t r) {
+      detail::normalize_row(in.data() + r * in.stride(), 
+        out + r * in.cols(), in.cols(), scale, bias);
+    }
+  );
+}
+
+/// Normalizes the elements of each frame of the greyscale batch \p in to
+/// floating point as in * scale + bias, writing the frames contiguously to
+/// \p out, which must have space for in.count() * in.size() values. This is
+/// the NCHW layout with a single channel.
+/// \param[in] in     The batch to normalize.
+/// \param[in] out    A pointer to the normalized values.
+/// \param[in] scale  The scale for the elements.
+/// \param[in] bias   The bias to add to the scaled elements.
+/// \param[in] policy The execution policy.
+template <typename A>
+static inline void normalize(const MatrixBatch<mat::FM_GREY_8, A>& in     , 
+                             float*                                out    ,
+                             float                                 scale  ,
+                             float                                 bias   ,
+                             ExecutionPolicy policy = EP_SERIAL           ) {
+  SNAP_INSTRUMENT_KERNEL("alg::normalize", in.count() * in.size(), 
+    5 * in.count() * in.size());
+  detail::for_each_frame_row(in.count(), in.rows(), in.cols(), policy, 
+    [&] (size_t n, size_t r) {
+      detail::normalize_row(in.data(n) + r * in.stride(), 
+        out + (n * in.rows() + r) * in.cols(), in.cols(), scale, bias);
+    }
+  );
+}
+
+/// Normalizes the BGR matrix \p in to the floating point tensor \p out, as
+/// (value - mean) / stddev for each channel, in a single pass over the 
+/// matrix. The channels are written in B, G, R order, either as 3 planes 
+/// (TL_CHW) or interleaved (TL_HWC). The tensor must have space for 
+/// 3 * in.size() values.
+/// \param[in] in     The matrix to normalize.
+/// \param[in] out    A pointer to the tensor.
+/// \param[in] mean   The mean of the B, G and R channels.
+/// \param[in] stddev The standard deviation of the B, G and R channels.
+/// \param[in] layout The layout of the tensor.
+/// \param[in] policy The execution policy.
+template <typename A>
+static inline void to_tensor(const Matrix<mat::FM_BGR_24, A>& in          , 
+                             float*                           out         ,
+                             const float                      (&mean)[3]  ,
+                             const float                      (&stddev)[3],
+                             TensorLayout    layout = TL_CHW              ,
+                             ExecutionPolicy policy = EP_SERIAL           ) {
+  SNAP_INSTRUMENT_KERNEL("alg::to_tensor", in.size(), 15 * in.size());
+  const auto norm = detail::make_channel_norm(mean, stddev);
+  detail::for_each_frame_row(1, in.rows(), in.cols() * 3, policy, 
+    [&] (size_t, size_t r) {
+      const uint8_t* row = in.data() + r * in.stride();
+      if (layout == TL_CHW) {
+        detail::normalize_planar_row(row, out + r * in.cols(), in.size(), 
+          in.cols(), norm);
+      } else {
+        detail::normalize_interleaved_row(row, out + r * in.cols() * 3, 
+          in.cols(), norm);
+      }
+    }
+  );
+}
+
+/// Normalizes each frame of the BGR batch \p in to the floating point 
+/// tensor \p out, as (value - mean) / stddev for each channel, in a single
+/// pass over the batch. The frames are written one after the other, with
+/// the channels in B, G, R order, either as 3 planes per frame (TL_CHW, for
+/// an NCHW tensor) or interleaved (TL_HWC, for an NHWC tensor). The tensor
+/// must have space for 3 * in.count() * in.size() values.
+/// \param[in] in     The batch to normalize.
+/// \param[in] out    A pointer to the tensor.
+/// \param[in] mean   The mean of the B, G and R channels.
+/// \param[in] stddev The standard deviation of the B, G and R channels.
+/// \param[in] layout The layout of each frame in the tensor.
+/// \param[in] policy The execution policy.
+template <typename A>
+static inline void to_tensor(const MatrixBatch<mat::FM_BGR_24, A>& in    , 
+                             float*                                out   ,
+                             const float (&mean)[3]                      ,
+                             const float (&stddev)[3]                    ,
+                             TensorLayout    layout = TL_CHW             ,
+                             ExecutionPolicy policy = EP_SERIAL          ) {
+  SNAP_INSTRUMENT_KERNEL("alg::to_tensor", in.count() * in.size(), 
+    15 * in.count() * in.size());
+  const auto norm = detail::make_channel_norm(mean, stddev);
+  detail::for_each_frame_row(in.count(), in.rows(), in.cols() * 3, policy, 
+    [&] (size_t n, size_t r) {
+      const uint8_t* row   = in.data(n) + r * in.stride();
+      float*         frame = out + n * in.size() * 3;
+      if (layout == TL_CHW) {
+        detail::normalize_planar_row(row, frame + r * in.cols(), in.size(), 
+          in.cols(), norm);
+      } else {
+        detail::normalize_interleaved_row(row, frame + r * in.cols() * 3, 
+          in.cols(), norm);
+      }
+    }
+  );
+}
+
+} // namespace alg
+} // namespace snap
+
+#endif // SNAP_ALGORITHM_PREPROCESS_HPP
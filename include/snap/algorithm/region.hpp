@@ -0,0 +1,270 @@
+//---- snap/algorithm/region.hpp --------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  region.hpp
+/// \brief Defines a strided view of a region of matrix data, and functions
+///        to reduce the rows of such a region, serially or in parallel.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_ALGORITHM_REGION_HPP
+#define SNAP_ALGORITHM_REGION_HPP
+
+#include "snap/matrix/matrix.hpp"
+#include "snap/utility/instrument.hpp"
+#include "snap/utility/parallel.hpp"
+#include "snap/utility/tuning.hpp"
+#include <utility>
+#include <vector>
+
+namespace snap   {
+namespace alg    {
+
+/// Defines the possible modes for the elements outside of a matrix, which
+/// are read by kernels which sample neighbourhoods or arbitrary positions.
+enum BorderMode : uint8_t {
+  BM_CONSTANT  = 0,   //!< Elements outside the matrix are a constant value.
+  BM_REPLICATE = 1,   //!< Elements outside the matrix repeat the edge.
+  BM_REFLECT   = 2,   //!< Elements outside mirror the matrix about the edge
+                      //!< element, which is not repeated: dcb|abcd|cba.
+  BM_WRAP      = 3    //!< Elements outside the matrix wrap around it.
+};
+
+/// Returns the index of the element which is read for the index \p i of a
+/// dimension with \p n elements, with the \p border, which is \p i if it is
+/// inside the dimension, and -1 for elements outside with BM_CONSTANT.
+/// \param[in] i      The index, which may be outside the dimension.
+/// \param[in] n      The number of elements in the dimension.
+/// \param[in] border The border mode.
+static inline int64_t border_index(int64_t i, int64_t n, BorderMode border) {
+  if (i >= 0 && i < n)
+    return i;
+
+  switch (border) {
+    case BM_REPLICATE:
+      return i < 0 ? 0 : n - 1;
+    case BM_REFLECT: {
+      if (n == 1)
+        return 0;
+      const int64_t period = 2 * n - 2;
+      i = (i % period + period) % period;
+      return i < n ? i : period - i;
+    }
+    case BM_WRAP:
+      return (i % n + n) % n;
+    default:
+      return -1;
+  }
+}
+
+/// Returns the number of blocks of size \p blockSize required to cover \p
+/// elements elements, including a partial block at the end.
+/// \param[in] elements  The number of elements to cover.
+/// \param[in] blockSize The size of each block.
+static constexpr size_t block_count(size_t elements, size_t blockSize) {
+  return (elements + blockSize - 1) / blockSize;
+}
+
+namespace detail {
+
+/// Defines a strided region of 8-bit matrix data. Each of the rows of the
+/// region is contiguous, and the start of consecutive rows are stride
+/// elements apart.
+struct Region {
+  const uint8_t* data;    //!< Pointer to the first element in the region.
+  size_t         rows;    //!< The number of rows in the region.
+  size_t         cols;    //!< The number of elements in each row.
+  size_t         stride;  //!< The number of elements between row starts.
+
+  /// Returns the number of elements in the region.
+  size_t size() const { return rows * cols; }
+
+  /// Returns a pointer to the first element in row \p r.
+  /// \param[in] r The index of the row.
+  const uint8_t* row(size_t r) const { return data + r * stride; }
+};
+
+/// Creates a region for the \p roi of matrix \p m. The region of interest is
+/// clamped to the bounds of the matrix.
+/// \param[in] m    The matrix to create the region for.
+/// \param[in] roi  The region of interest in the matrix.
+/// \tparam    F    The format of the matrix.
+/// \tparam    A    The allocator of the matrix.
+template <uint8_t F, typename A>
+static inline Region make_region(const Matrix<F, A>& m, const Rect& roi) {
+  static_assert(F == mat::FM_GREY_8, "Only FM_GREY_8 regions are supported!");
+
+  const size_t x = std::min(roi.x, m.cols());
+  const size_t y = std::min(roi.y, m.rows());
+  return Region{
+    m.data() + y * m.stride() + x     , 
+    std::min(roi.height, m.rows() - y), 
+    std::min(roi.width , m.cols() - x),
+    m.stride()
+  };
+}
+
+/// Creates a region which covers all of matrix \p m.
+/// \param[in] m    The matrix to create the region for.
+/// \tparam    F    The format of the matrix.
+/// \tparam    A    The allocator of the matrix.
+template <uint8_t F, typename A>
+static inline Region make_region(const Matrix<F, A>& m) {
+  return make_region(m, Rect{0, 0, m.cols(), m.rows()});
+}
+
+/// Defines the minimum number of elements each thread must process when a
+/// reduction is run in parallel, so that small regions are not split.
+static constexpr size_t MIN_PARALLEL_ELEMENTS = 1 << 16;
+
+/// Defines the number of independent accumulators used by the reduction
+/// kernels, so that consecutive vectors do not depend on the same register.
+static constexpr size_t ACCUMULATORS = 4;
+
+/// Defines the max number of vectors which are accumulated before the 32-bit
+/// accumulators are flushed into a 64-bit result. This is chosen such that
+/// sums of squares of 8-bit values can't overflow: each vector adds at most 
+/// 4 * 255^2 = 260100 to each 32-bit lane.
+static constexpr size_t FLUSH_VECTORS = 4096;
+
+/// Defines the default tuning of the reduction kernels, which is used when
+/// they have not been tuned for the machine.
+static constexpr util::tune::Params DEFAULT_TUNING = 
+  {ACCUMULATORS, 0, MIN_PARALLEL_ELEMENTS};
+
+/// Reduces two regions with the same dimensions by calling \p kernel for the
+/// corresponding contiguous segments of the regions, accumulating each pair
+/// of segments into a partial result. When the rows of both regions are
+/// contiguous in memory, the regions are collapsed into a single segment so
+/// that the kernels run over as many elements as possible. When the \p 
+/// policy is EP_PARALLEL the segments are split across threads, each with its
+/// own partial result, and the partial results are combined with \p combine.
+/// The max number of threads, and the min number of elements for each of 
+/// them, are given by the \p tuning of the kernel.
+/// The signature of the kernel must be:
+///
+///   kernel(const uint8_t* segmentA, const uint8_t* segmentB, 
+///          size_t elements, T& partial)
+///
+/// \param[in] a        The first region to reduce.
+/// \param[in] b        The second region to reduce.
+/// \param[in] identity The initial value of each partial result.
+/// \param[in] policy   The execution policy for the reduction.
+/// \param[in] tuning   The tuned parameters of the kernel.
+/// \param[in] kernel   The kernel which reduces a pair of segments.
+/// \param[in] combine  The function which combines two partial results.
+template <typename T, typename Kernel, typename Combine>
+static inline T reduce_regions(Region                    a       , 
+                               Region                    b       , 
+                               T                         identity, 
+                               ExecutionPolicy           policy  ,
+                               const util::tune::Params& tuning  ,
+                               Kernel&&                  kernel  , 
+                               Combine&&                 combine ) {
+  if (a.size() == 0)
+    return identity;
+
+  auto contiguous = [] (const Region& r) {
+    return r.stride == r.cols || r.rows == 1;
+  };
+
+  if (contiguous(a) && contiguous(b)) {
+    for (auto* r : {&a, &b}) {
+      r->cols   = r->size();
+      r->rows   = 1;
+      r->stride = r->cols;
+    }
+  }
+
+  const bool   singleRow = a.rows == 1;
+  const size_t elements  = singleRow ? a.cols : a.rows;
+  const size_t chunks    = util::tune::chunk_count(a.size(), policy, tuning);
+
+  auto reduceChunk = [&] (size_t begin, size_t end, T& partial) {
+    if (singleRow) {
+      kernel(a.data + begin, b.data + begin, end - begin, partial);
+      return;
+    }
+    for (size_t r = begin; r < end; ++r)
+      kernel(a.row(r), b.row(r), a.cols, partial);
+  };
+
+  if (chunks == 1) {
+    T result = identity;
+    reduceChunk(0, elements, result);
+    return result;
+  }
+
+  std::vector<T> partials(chunks, identity);
+  util::par::parallel_for(0, elements, chunks, 
+    [&] (size_t begin, size_t end, size_t chunk) {
+      reduceChunk(begin, end, partials[chunk]);
+    }
+  );
+
+  T result = partials[0];
+  for (size_t i = 1; i < partials.size(); ++i)
+    result = combine(result, partials[i]);
+  return result;
+}
+
+/// Reduces a region by calling \p kernel for contiguous segments of the
+/// region, as for reduce_regions. The signature of the kernel must be:
+///
+///   kernel(const uint8_t* segment, size_t elements, T& partial)
+///
+/// \param[in] region   The region to reduce.
+/// \param[in] identity The initial value of each partial result.
+/// \param[in] policy   The execution policy for the reduction.
+/// \param[in] tuning   The tuned parameters of the kernel.
+/// \param[in] kernel   The kernel which reduces a segment.
+/// \param[in] combine  The function which combines two partial results.
+template <typename T, typename Kernel, typename Combine>
+static inline T reduce_region(const Region&             region  , 
+                              T                         identity, 
+                              ExecutionPolicy           policy  ,
+                              const util::tune::Params& tuning  ,
+                              Kernel&&                  kernel  , 
+                              Combine&&                 combine ) {
+  return reduce_regions(region, region, identity, policy, tuning,
+    [&kernel] (const uint8_t* p, const uint8_t*, size_t n, T& partial) {
+      kernel(p, n, partial);
+    },
+    std::forward<Combine>(combine)
+  );
+}
+
+/// Calls \p f for each of the \p blockRows rows of blocks which cover a
+/// region of \p elements elements, splitting the block rows across threads
+/// if \p policy is EP_PARALLEL.
+/// \param[in] blockRows The number of rows of blocks.
+/// \param[in] elements  The number of elements covered by the blocks.
+/// \param[in] policy    The execution policy.
+/// \param[in] f         The function to call for each block row.
+template <typename F>
+static inline void for_each_block_row(size_t blockRows, size_t elements,
+    ExecutionPolicy policy, F&& f) {
+  const size_t chunks = util::par::chunk_count(elements, policy, 
+    MIN_PARALLEL_ELEMENTS);
+
+  util::par::parallel_for(0, blockRows, chunks, 
+    [&] (size_t begin, size_t end, size_t) {
+      for (size_t blockRow = begin; blockRow < end; ++blockRow)
+        f(blockRow);
+    }
+  );
+}
+
+} // namespace detail
+} // namespace alg
+} // namespace snap
+
+#endif // SNAP_ALGORITHM_REGION_HPP
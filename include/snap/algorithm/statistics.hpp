@@ -0,0 +1,405 @@
+//---- snap/algorithm/statistics.hpp ----------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  statistics.hpp
+/// \brief Defines functions to compute statistics of matrices, or regions of
+///        interest in matrices, such as the sum, mean, standard deviation,
+///        min and max values and their locations, and the number of non zero
+///        elements.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_ALGORITHM_STATISTICS_HPP
+#define SNAP_ALGORITHM_STATISTICS_HPP
+
+#include "region.hpp"
+#include "snap/utility/performance.hpp"
+#include <cmath>
+#include <functional>
+
+namespace snap {
+namespace alg  {
+
+/// Defines the result of a min max location search.
+struct MinMaxLoc {
+  uint8_t minVal;   //!< The minimum value.
+  uint8_t maxVal;   //!< The maximum value.
+  Point   minLoc;   //!< The location of the first minimum value.
+  Point   maxLoc;   //!< The location of the first maximum value.
+};
+
+/// Defines the result of a mean and standard deviation computation.
+struct MeanStdDev {
+  double mean;      //!< The mean of the elements.
+  double stddev;    //!< The (population) standard deviation of the elements.
+};
+
+namespace detail {
+
+/// Defines the partial result of a sum and sum of squares reduction.
+struct SumSq {
+  uint64_t sum;     //!< The sum of the elements.
+  uint64_t sumSq;   //!< The sum of the squares of the elements.
+};
+
+/// Defines the vector accumulators for a sum and sum of squares reduction.
+struct SumSqAccumulator {
+  Vec4x32u sum;     //!< The accumulated sums.
+  Vec4x32s sumSq;   //!< The accumulated sums of squares.
+};
+
+/// Adds the sum of the \p n elements starting at \p p to \p partial.
+/// \param[in] p       A pointer to the first element.
+/// \param[in] n       The number of elements.
+/// \param[in] partial The partial sum to add to.
+/// \tparam    Unroll  The number of independent accumulators.
+template <size_t Unroll>
+static inline void sum_kernel(const uint8_t* p, size_t n, uint64_t& partial) {
+  const size_t   vectors = n / Vec16x8u::width;
+  const Vec16x8u zero(uint8_t(0));
+
+  for (size_t block = 0; block < vectors; block += FLUSH_VECTORS) {
+    const auto sums = util::perf::reduce_unrolled<Unroll>(
+      block, std::min(block + FLUSH_VECTORS, vectors), Vec4x32u(0u),
+      [&] (Vec4x32u& acc, size_t i) {
+        Vec16x8u v; v.load(p + i * Vec16x8u::width);
+        acc = acc + sad(v, zero);
+      },
+      [] (const Vec4x32u& a, const Vec4x32u& b) { return a + b; }
+    );
+    partial += sums.hsum();
+  }
+
+  for (size_t i = vectors * Vec16x8u::width; i < n; ++i)
+    partial += p[i];
+}
+
+/// Adds the sum and the sum of squares of the \p n elements starting at \p p
+/// to \p partial.
+/// \param[in] p       A pointer to the first element.
+/// \param[in] n       The number of elements.
+/// \param[in] partial The partial sums to add to.
+/// \tparam    Unroll  The number of independent accumulators.
+template <size_t Unroll>
+static inline void sum_sq_kernel(const uint8_t* p, size_t n, SumSq& partial) {
+  const size_t   vectors = n / Vec16x8u::width;
+  const Vec16x8u zero(uint8_t(0));
+
+  for (size_t block = 0; block < vectors; block += FLUSH_VECTORS) {
+    const auto sums = util::perf::reduce_unrolled<Unroll>(
+      block, std::min(block + FLUSH_VECTORS, vectors), 
+      SumSqAccumulator{Vec4x32u(0u), Vec4x32s(0)},
+      [&] (SumSqAccumulator& acc, size_t i) {
+        Vec16x8u v; v.load(p + i * Vec16x8u::width);
+        const auto lo = widen_lo(v), hi = widen_hi(v);
+        acc.sum   = acc.sum   + sad(v, zero);
+        acc.sumSq = acc.sumSq + madd(lo, lo) + madd(hi, hi);
+      },
+      [] (const SumSqAccumulator& a, const SumSqAccumulator& b) {
+        return SumSqAccumulator{a.sum + b.sum, a.sumSq + b.sumSq};
+      }
+    );
+    partial.sum   += sums.sum.hsum();
+    partial.sumSq += static_cast<uint64_t>(sums.sumSq.hsum());
+  }
+
+  for (size_t i = vectors * Vec16x8u::width; i < n; ++i) {
+    partial.sum   += p[i];
+    partial.sumSq += uint32_t(p[i]) * p[i];
+  }
+}
+
+/// Defines the vector accumulators for a min max reduction.
+struct MinMaxAccumulator {
+  Vec16x8u min;     //!< The accumulated minimums.
+  Vec16x8u max;     //!< The accumulated maximums.
+};
+
+/// Updates the min and max in \p partial with the min and max of the \p n 
+/// elements starting at \p p.
+/// \param[in] p       A pointer to the first element.
+/// \param[in] n       The number of elements.
+/// \param[in] partial The partial min and max to update.
+/// \tparam    Unroll  The number of independent accumulators.
+template <size_t Unroll>
+static inline void min_max_kernel(const uint8_t* p, size_t n, 
+    MinMaxLoc& partial) {
+  const size_t vectors = n / Vec16x8u::width;
+  
+  if (vectors != 0) {
+    const auto minMax = util::perf::reduce_unrolled<Unroll>(
+      size_t(0), vectors, 
+      MinMaxAccumulator{Vec16x8u(uint8_t(255)), Vec16x8u(uint8_t(0))},
+      [&] (MinMaxAccumulator& acc, size_t i) {
+        Vec16x8u v; v.load(p + i * Vec16x8u::width);
+        acc.min = min(acc.min, v);
+        acc.max = max(acc.max, v);
+      },
+      [] (const MinMaxAccumulator& a, const MinMaxAccumulator& b) {
+        return MinMaxAccumulator{min(a.min, b.min), max(a.max, b.max)};
+      }
+    );
+    partial.minVal = std::min(partial.minVal, minMax.min.hmin());
+    partial.maxVal = std::max(partial.maxVal, minMax.max.hmax());
+  }
+
+  for (size_t i = vectors * Vec16x8u::width; i < n; ++i) {
+    partial.minVal = std::min(partial.minVal, p[i]);
+    partial.maxVal = std::max(partial.maxVal, p[i]);
+  }
+}
+
+/// Defines the accumulators for a zero count reduction. The zeros are
+/// counted in the 8-bit lanes of count, which are flushed into total when
+/// two accumulators are combined.
+struct ZeroCountAccumulator {
+  Vec16x8u count;   //!< The per lane zero counts.
+  Vec4x32u total;   //!< The flushed zero counts.
+};
+
+/// Adds the number of the \p n elements starting at \p p which are zero to 
+/// \p partial. The zeros are counted in 8-bit lanes, and each block is small
+/// enough that none of the lanes can overflow.
+/// \param[in] p       A pointer to the first element.
+/// \param[in] n       The number of elements.
+/// \param[in] partial The partial zero count to add to.
+/// \tparam    Unroll  The number of independent accumulators.
+template <size_t Unroll>
+static inline void count_zero_kernel(const uint8_t* p, size_t n, 
+    uint64_t& partial) {
+  constexpr size_t blockVectors = Unroll * 255;
+  const size_t     vectors      = n / Vec16x8u::width;
+  const Vec16x8u   zero(uint8_t(0));
+
+  for (size_t block = 0; block < vectors; block += blockVectors) {
+    const auto counts = util::perf::reduce_unrolled<Unroll>(
+      block, std::min(block + blockVectors, vectors), 
+      ZeroCountAccumulator{zero, Vec4x32u(0u)},
+      [&] (ZeroCountAccumulator& acc, size_t i) {
+        Vec16x8u v; v.load(p + i * Vec16x8u::width);
+        // Each equal element is 0xff (-1), so subtracting it adds 1.
+        acc.count = acc.count - cmpeq(v, zero);
+      },
+      [&] (const ZeroCountAccumulator& a, const ZeroCountAccumulator& b) {
+        return ZeroCountAccumulator{
+          zero, a.total + b.total + sad(a.count, zero) + sad(b.count, zero)
+        };
+      }
+    );
+    partial += counts.total.hsum() + sad(counts.count, zero).hsum();
+  }
+
+  for (size_t i = vectors * Vec16x8u::width; i < n; ++i)
+    partial += p[i] == 0;
+}
+
+/// Returns the location of the first element in \p region with \p value. The
+/// region is searched row by row, 16 elements at a time, and the search stops
+/// at the first match.
+/// \param[in] region The region to search.
+/// \param[in] value  The value to search for.
+static inline Point locate(const Region& region, uint8_t value) {
+  const Vec16x8u target(value);
+  const size_t   vectors = region.cols / Vec16x8u::width;
+
+  for (size_t r = 0; r < region.rows; ++r) {
+    const uint8_t* row = region.row(r);
+    for (size_t i = 0; i < vectors; ++i) {
+      Vec16x8u v; v.load(row + i * Vec16x8u::width);
+      const uint32_t mask = movemask(cmpeq(v, target));
+      if (mask != 0) 
+        return Point{i * Vec16x8u::width + __builtin_ctz(mask), r};
+    }
+    for (size_t c = vectors * Vec16x8u::width; c < region.cols; ++c) {
+      if (row[c] == value)
+        return Point{c, r};
+    }
+  }
+  return Point{0, 0};
+}
+
+} // namespace detail
+
+/// Computes the sum of the elements in the \p roi of matrix \p m.
+/// \param[in] m      The matrix to compute the sum of.
+/// \param[in] roi    The region of interest in the matrix.
+/// \param[in] policy The execution policy for the computation.
+template <uint8_t F, typename A>
+static inline uint64_t sum(const Matrix<F, A>& m                     , 
+                           const Rect&         roi                   ,
+                           ExecutionPolicy     policy = EP_SERIAL) {
+  const auto region = detail::make_region(m, roi);
+  SNAP_INSTRUMENT_KERNEL("alg::sum", region.size(), region.size());
+  static auto& entry = util::tune::entry("alg::sum", detail::DEFAULT_TUNING);
+  const auto tuning = entry.get();
+  return util::tune::dispatch_unroll(tuning.unroll, [&] (auto unroll) {
+    return detail::reduce_region(region, uint64_t(0), policy, tuning,
+      detail::sum_kernel<decltype(unroll)::value>, std::plus<uint64_t>());
+  });
+}
+
+/// Computes the sum of all the elements in matrix \p m.
+/// \param[in] m      The matrix to compute the sum of.
+/// \param[in] policy The execution policy for the computation.
+template <uint8_t F, typename A>
+static inline uint64_t sum(const Matrix<F, A>& m, 
+                           ExecutionPolicy policy = EP_SERIAL) {
+  return sum(m, Rect{0, 0, m.cols(), m.rows()}, policy);
+}
+
+/// Computes the mean and the population standard deviation of the elements
+/// in the \p roi of matrix \p m, in a single pass.
+/// \param[in] m      The matrix to compute the mean and stddev of.
+/// \param[in] roi    The region of interest in the matrix.
+/// \param[in] policy The execution policy for the computation.
+template <uint8_t F, typename A>
+static inline MeanStdDev mean_stddev(const Matrix<F, A>& m                 , 
+                                     const Rect&         roi               ,
+                                     ExecutionPolicy     policy = EP_SERIAL) {
+  const auto region = detail::make_region(m, roi);
+  SNAP_INSTRUMENT_KERNEL("alg::mean_stddev", region.size(), region.size());
+  if (region.size() == 0)
+    return MeanStdDev{0.0, 0.0};
+
+  static auto& entry = 
+    util::tune::entry("alg::mean_stddev", detail::DEFAULT_TUNING);
+  const auto tuning = entry.get();
+  const auto sums   = util::tune::dispatch_unroll(tuning.unroll, 
+    [&] (auto unroll) {
+      return detail::reduce_region(region, detail::SumSq{0, 0}, policy, 
+        tuning, detail::sum_sq_kernel<decltype(unroll)::value>, 
+        [] (const detail::SumSq& a, const detail::SumSq& b) {
+          return detail::SumSq{a.sum + b.sum, a.sumSq + b.sumSq};
+        }
+      );
+    }
+  );
+
+  const double n        = static_cast<double>(region.size());
+  const double mean     = sums.sum / n;
+  const double variance = sums.sumSq / n - mean * mean;
+  return MeanStdDev{mean, std::sqrt(std::max(variance, 0.0))};
+}
+
+/// Computes the mean and the population standard deviation of all the
+/// elements in matrix \p m, in a single pass.
+/// \param[in] m      The matrix to compute the mean and stddev of.
+/// \param[in] policy The execution policy for the computation.
+template <uint8_t F, typename A>
+static inline MeanStdDev mean_stddev(const Matrix<F, A>& m, 
+                                     ExecutionPolicy policy = EP_SERIAL) {
+  return mean_stddev(m, Rect{0, 0, m.cols(), m.rows()}, policy);
+}
+
+/// Computes the mean of the elements in the \p roi of matrix \p m.
+/// \param[in] m      The matrix to compute the mean of.
+/// \param[in] roi    The region of interest in the matrix.
+/// \param[in] policy The execution policy for the computation.
+template <uint8_t F, typename A>
+static inline double mean(const Matrix<F, A>& m                     , 
+                          const Rect&         roi                   ,
+                          ExecutionPolicy     policy = EP_SERIAL) {
+  const auto region = detail::make_region(m, roi);
+  return region.size() == 0 
+    ? 0.0 
+    : static_cast<double>(sum(m, roi, policy)) / region.size();
+}
+
+/// Computes the mean of all the elements in matrix \p m.
+/// \param[in] m      The matrix to compute the mean of.
+/// \param[in] policy The execution policy for the computation.
+template <uint8_t F, typename A>
+static inline double mean(const Matrix<F, A>& m, 
+                          ExecutionPolicy policy = EP_SERIAL) {
+  return mean(m, Rect{0, 0, m.cols(), m.rows()}, policy);
+}
+
+/// Finds the min and max values of the elements in the \p roi of matrix \p m,
+/// and the locations (relative to the roi) of their first occurrences in row
+/// major order.
+/// \param[in] m      The matrix to find the min and max values of.
+/// \param[in] roi    The region of interest in the matrix.
+/// \param[in] policy The execution policy for the computation.
+template <uint8_t F, typename A>
+static inline MinMaxLoc min_max_loc(const Matrix<F, A>& m                 , 
+                                    const Rect&         roi               ,
+                                    ExecutionPolicy     policy = EP_SERIAL) {
+  const auto region = detail::make_region(m, roi);
+  SNAP_INSTRUMENT_KERNEL("alg::min_max_loc", region.size(), region.size());
+  const auto identity = MinMaxLoc{255, 0, Point{0, 0}, Point{0, 0}};
+  if (region.size() == 0)
+    return identity;
+
+  static auto& entry = 
+    util::tune::entry("alg::min_max_loc", detail::DEFAULT_TUNING);
+  const auto tuning = entry.get();
+  auto result = util::tune::dispatch_unroll(tuning.unroll, 
+    [&] (auto unroll) {
+      return detail::reduce_region(region, identity, policy, tuning, 
+        detail::min_max_kernel<decltype(unroll)::value>, 
+        [] (const MinMaxLoc& a, const MinMaxLoc& b) {
+          return MinMaxLoc{std::min(a.minVal, b.minVal), 
+            std::max(a.maxVal, b.maxVal), Point{0, 0}, Point{0, 0}};
+        }
+      );
+    }
+  );
+
+  result.minLoc = detail::locate(region, result.minVal);
+  result.maxLoc = detail::locate(region, result.maxVal);
+  return result;
+}
+
+/// Finds the min and max values of all the elements in matrix \p m, and the
+/// locations of their first occurrences in row major order.
+/// \param[in] m      The matrix to find the min and max values of.
+/// \param[in] policy The execution policy for the computation.
+template <uint8_t F, typename A>
+static inline MinMaxLoc min_max_loc(const Matrix<F, A>& m, 
+                                    ExecutionPolicy policy = EP_SERIAL) {
+  return min_max_loc(m, Rect{0, 0, m.cols(), m.rows()}, policy);
+}
+
+/// Counts the number of non zero elements in the \p roi of matrix \p m.
+/// \param[in] m      The matrix to count the non zero elements of.
+/// \param[in] roi    The region of interest in the matrix.
+/// \param[in] policy The execution policy for the computation.
+template <uint8_t F, typename A>
+static inline size_t count_non_zero(const Matrix<F, A>& m                 , 
+                                    const Rect&         roi               ,
+                                    ExecutionPolicy     policy = EP_SERIAL) {
+  const auto region = detail::make_region(m, roi);
+  SNAP_INSTRUMENT_KERNEL("alg::count_non_zero", region.size(), region.size());
+  static auto& entry = 
+    util::tune::entry("alg::count_non_zero", detail::DEFAULT_TUNING);
+  const auto tuning = entry.get();
+  return region.size() - util::tune::dispatch_unroll(tuning.unroll, 
+    [&] (auto unroll) {
+      return detail::reduce_region(region, uint64_t(0), policy, tuning,
+        detail::count_zero_kernel<decltype(unroll)::value>, 
+        std::plus<uint64_t>());
+    }
+  );
+}
+
+/// Counts the number of non zero elements in matrix \p m.
+/// \param[in] m      The matrix to count the non zero elements of.
+/// \param[in] policy The execution policy for the computation.
+template <uint8_t F, typename A>
+static inline size_t count_non_zero(const Matrix<F, A>& m, 
+                                    ExecutionPolicy policy = EP_SERIAL) {
+  return count_non_zero(m, Rect{0, 0, m.cols(), m.rows()}, policy);
+}
+
+} // namespace alg
+} // namespace snap
+
+#endif // SNAP_ALGORITHM_STATISTICS_HPP
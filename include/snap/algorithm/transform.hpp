@@ -0,0 +1,457 @@
+//---- snap/algorithm/transform.hpp ------------------------ -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  transform.hpp
+/// \brief Defines elementwise kernels which write a full output matrix, such
+///        as fill, copy and absdiff. These kernels are bound by memory
+///        bandwidth, so for outputs which are larger than the last level
+///        cache they use non-temporal stores, which avoid the read for
+///        ownership of the output and the eviction of useful data from the
+///        cache, and prefetch the inputs ahead of the current position.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_ALGORITHM_TRANSFORM_HPP
+#define SNAP_ALGORITHM_TRANSFORM_HPP
+
+#include "region.hpp"
+#include "snap/utility/performance.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace snap   {
+namespace alg    {
+
+/// Defines the possible policies for the stores of kernels which write a
+/// full output matrix.
+enum WritePolicy : uint8_t {
+  WP_AUTO   = 0,  //!< Stream if the output is at least NON_TEMPORAL_BYTES.
+  WP_CACHED = 1,  //!< Always use regular stores.
+  WP_STREAM = 2   //!< Always use non-temporal stores.
+};
+
+/// Defines the size of the output, in bytes, above which WP_AUTO uses
+/// non-temporal stores. This is around the size of the last level cache, 
+/// above which the output can't stay in the cache anyway.
+static constexpr size_t NON_TEMPORAL_BYTES = size_t(8) << 20;
+
+/// Defines how many bytes ahead of the current position the inputs are
+/// prefetched when streaming. This needs to cover the memory latency, and is 
+/// 8 cache lines, which is a good fit for most x86 machines. It is a fixed
+/// distance, rather than a tuned parameter in util::tune, since the tuner
+/// only has the parameters of the reductions.
+static constexpr size_t PREFETCH_DISTANCE = 512;
+
+/// Defines the size of a cache line. Streaming kernels process the output a
+/// cache line at a time, and split work across threads on cache lines so
+/// that threads never write to the same line.
+static constexpr size_t CACHE_LINE_BYTES = 64;
+
+namespace detail {
+
+/// Returns true if an output of \p bytes bytes should be written with
+/// non-temporal stores for the write \p policy.
+/// \param[in] bytes  The number of bytes in the output.
+/// \param[in] policy The write policy.
+static constexpr bool use_streaming(size_t bytes, WritePolicy policy) {
+  return policy == WP_STREAM || 
+        (policy == WP_AUTO && bytes >= NON_TEMPORAL_BYTES);
+}
+
+/// Writes the \p n elements of \p out, where vecAt(i) returns the vector
+/// of output elements starting at offset i, scalarAt(i) returns the output
+/// element at offset i, and prefetchAt(i) prefetches the inputs at offset i.
+/// When \p streaming, the elements are written with non-temporal stores, a
+/// cache line at a time, with a scalar head to align the stores.
+/// \param[in] out        A pointer to the output elements.
+/// \param[in] n          The number of output elements.
+/// \param[in] streaming  If non-temporal stores must be used.
+/// \param[in] vecAt      The function which computes a vector of output.
+/// \param[in] scalarAt   The function which computes a single output.
+/// \param[in] prefetchAt The function which prefetches the inputs.
+template <typename VecAt, typename ScalarAt, typename PrefetchAt>
+static inline void write_span(uint8_t* out, size_t n, bool streaming,
+    VecAt&& vecAt, ScalarAt&& scalarAt, PrefetchAt&& prefetchAt) {
+  constexpr size_t width       = Vec16x8u::width;
+  constexpr size_t lineVectors = CACHE_LINE_BYTES / width;
+
+  size_t i = 0;
+  if (streaming) {
+    const size_t misalignment = reinterpret_cast<uintptr_t>(out) % ALIGNMENT;
+    const size_t head         = 
+      std::min(n, misalignment == 0 ? 0 : ALIGNMENT - misalignment);
+    for (; i < head; ++i) 
+      out[i] = scalarAt(i);
+
+    for (; i + CACHE_LINE_BYTES <= n; i += CACHE_LINE_BYTES) {
+      prefetchAt(i + PREFETCH_DISTANCE);
+      util::perf::unroll<0, lineVectors - 1>([&] (size_t v) {
+        vecAt(i + v * width).stream(out + i + v * width);
+      });
+    }
+    for (; i + width <= n; i += width)
+      vecAt(i).stream(out + i);
+    stream_fence();
+  } else {
+    for (; i + width <= n; i += width)
+      vecAt(i).storeu(out + i);
+  }
+
+  for (; i < n; ++i) 
+    out[i] = scalarAt(i);
+}
+
+/// Writes the \p n elements of \p out using write_span, splitting the
+/// output across threads on cache line boundaries if \p policy is
+/// EP_PARALLEL. The functions take the offset from the start of \p out.
+/// \param[in] out         A pointer to the output elements.
+/// \param[in] n           The number of output elements.
+/// \param[in] policy      The execution policy.
+/// \param[in] writePolicy The write policy.
+/// \param[in] vecAt       The function which computes a vector of output.
+/// \param[in] scalarAt    The function which computes a single output.
+/// \param[in] prefetchAt  The function which prefetches the inputs.
+template <typename VecAt, typename ScalarAt, typename PrefetchAt>
+static inline void write_elements(uint8_t* out, size_t n, 
+    ExecutionPolicy policy, WritePolicy writePolicy, VecAt&& vecAt, 
+    ScalarAt&& scalarAt, PrefetchAt&& prefetchAt) {
+  const bool   streaming = use_streaming(n, writePolicy);
+  const size_t chunks    = 
+    util::par::chunk_count(n, policy, MIN_PARALLEL_ELEMENTS);
+
+  // The matrix data is only ALIGNMENT aligned, so the chunks are split on
+  // the cache lines of the addresses, rather than of the offsets.
+  const size_t lead = reinterpret_cast<uintptr_t>(out) % CACHE_LINE_BYTES;
+  util::par::parallel_for(0, block_count(lead + n, CACHE_LINE_BYTES), chunks,
+    [&] (size_t begin, size_t end, size_t) {
+      const size_t offset = 
+        begin == 0 ? 0 : begin * CACHE_LINE_BYTES - lead;
+      const size_t last   = std::min(end * CACHE_LINE_BYTES - lead, n);
+      write_span(out + offset, last - offset, streaming,
+        [&] (size_t i) { return vecAt(offset + i);      },
+        [&] (size_t i) { return scalarAt(offset + i);   },
+        [&] (size_t i) { return prefetchAt(offset + i); });
+    }
+  );
+}
+
+/// Writes the \p cols values of each of the \p rows rows at \p out, which
+/// are \p stride values apart, using write_span, so that the halo and the
+/// padding between the rows are not written. The functions take the row
+/// and the offset in the row, and the rows are split across threads if
+/// \p policy is EP_PARALLEL.
+/// \param[in] out         A pointer to the first output row.
+/// \param[in] stride      The number of values between the output rows.
+/// \param[in] rows        The number of output rows.
+/// \param[in] cols        The number of output values in each row.
+/// \param[in] policy      The execution policy.
+/// \param[in] writePolicy The write policy.
+/// \param[in] vecAt       The function which computes a vector of output.
+/// \param[in] scalarAt    The function which computes a single output.
+/// \param[in] prefetchAt  The function which prefetches the inputs.
+template <typename VecAt, typename ScalarAt, typename PrefetchAt>
+static inline void write_rows(uint8_t* out, size_t stride, size_t rows, 
+    size_t cols, ExecutionPolicy policy, WritePolicy writePolicy, 
+    VecAt&& vecAt, ScalarAt&& scalarAt, PrefetchAt&& prefetchAt) {
+  const bool streaming = use_streaming(rows * stride, writePolicy);
+  util::par::parallel_for(0, rows,
+    util::par::chunk_count(rows * cols, policy, MIN_PARALLEL_ELEMENTS),
+    [&] (size_t begin, size_t end, size_t) {
+      for (size_t r = begin; r < end; ++r) {
+        write_span(out + r * stride, cols, streaming,
+          [&] (size_t i) { return vecAt(r, i);     },
+          [&] (size_t i) { return scalarAt(r, i);  },
+          [&] (size_t i) { return prefetchAt(r, i); });
+      }
+    }
+  );
+}
+
+/// Sets the \p n values at \p out to \p value, a vector at a time, where
+/// the last vector overlaps the previous one if \p n is not a multiple of
+/// the vector width.
+/// \param[in] out   A pointer to the values to set.
+/// \param[in] n     The number of values to set.
+/// \param[in] value The value to set.
+static inline void fill_span(uint8_t* out, size_t n, uint8_t value) {
+  constexpr size_t width = Vec16x8u::width;
+  const Vec16x8u   v(value);
+  if (n < width) {
+    std::memset(out, value, n);
+    return;
+  }
+  for (size_t i = 0; i + width < n; i += width)
+    v.storeu(out + i);
+  v.storeu(out + n - width);
+}
+
+/// Defines the vector stores which set a side halo of each row of a matrix.
+/// Each store sets a vector of values, and a halo narrower than a vector is
+/// set with a single store which overlaps the padding of the row, which the
+/// Halo constructor of Matrix reserves.
+struct SideStores {
+  /// The offset of each store from the first value of the halo.
+  std::vector<int64_t> offsets;
+  /// The offset in the row of the value of each lane of each store, or -1
+  /// for the lanes which are in the padding rather than in the halo.
+  std::vector<int64_t> sources;
+};
+
+/// Gets the stores which set a side halo, where \p index has the column of
+/// the row which is copied to each column of the halo, from border_index.
+/// The stores of a \p left halo which is narrower than a vector end at the
+/// first element of the row, and otherwise start at the first halo value.
+/// \param[in] index The column copied to each column of the halo.
+/// \param[in] left  If the stores are for the left halo.
+/// \tparam    C     The number of channels of each element.
+template <size_t C>
+static inline SideStores 
+side_stores(const std::vector<int64_t>& index, bool left) {
+  constexpr int64_t width = Vec16x8u::width;
+  const int64_t     side  = static_cast<int64_t>(index.size() * C);
+
+  SideStores stores;
+  for (int64_t offset = 0; offset + width < side; offset += width)
+    stores.offsets.push_back(offset);
+  stores.offsets.push_back(side >= width || left ? side - width : 0);
+  for (const auto offset : stores.offsets) {
+    for (int64_t lane = 0; lane < width; ++lane) {
+      const int64_t i = offset + lane;
+      stores.sources.push_back(i < 0 || i >= side 
+        ? -1 : index[i / C] * int64_t(C) + i % int64_t(C));
+    }
+  }
+  return stores;
+}
+
+/// Sets the side halo at \p out of the \p row of a matrix with \p cols
+/// elements of C channels with the \p stores from side_stores. Constant and
+/// replicated greyscale halos are a broadcast, wrapped halos are a single
+/// copy, and the lanes of the other halos are gathered from the row.
+/// \param[in] out    A pointer to the first value of the halo.
+/// \param[in] row    A pointer to the first element of the row.
+/// \param[in] cols   The number of elements in the row.
+/// \param[in] index  The column copied to each column of the halo.
+/// \param[in] stores The stores which set the halo.
+/// \param[in] border The border mode.
+/// \param[in] value  The value of the halo for BM_CONSTANT.
+/// \tparam    C      The number of channels of each element.
+template <size_t C>
+static inline void fill_side(uint8_t* out, const uint8_t* row, size_t cols,
+    const std::vector<int64_t>& index, const SideStores& stores, 
+    BorderMode border, uint8_t value) {
+  constexpr size_t width = Vec16x8u::width;
+  const size_t     halo  = index.size();
+  if (border == BM_WRAP && halo <= cols) {
+    std::memcpy(out, row + index[0] * C, halo * C);
+  } else if (border == BM_CONSTANT || (border == BM_REPLICATE && C == 1)) {
+    const Vec16x8u v(border == BM_CONSTANT ? value : row[index[0]]);
+    for (const auto offset : stores.offsets)
+      v.storeu(out + offset);
+  } else {
+    const int64_t* source = stores.sources.data();
+    for (const auto offset : stores.offsets) {
+      alignas(ALIGNMENT) uint8_t lanes[width];
+      for (size_t lane = 0; lane < width; ++lane, ++source)
+        lanes[lane] = *source < 0 ? 0 : row[*source];
+      Vec16x8u v;
+      v.loada(lanes);
+      v.storeu(out + offset);
+    }
+  }
+}
+
+} // namespace detail
+
+/// Sets all the elements of matrix \p m to \p value.
+/// \param[in] m           The matrix to fill.
+/// \param[in] value       The value to set the elements to.
+/// \param[in] policy      The execution policy.
+/// \param[in] writePolicy The policy for the stores.
+template <uint8_t F, typename A>
+static inline void fill(Matrix<F, A>&   m                    ,
+                        uint8_t         value                ,
+                        ExecutionPolicy policy      = EP_SERIAL,
+                        WritePolicy     writePolicy = WP_AUTO  ) {
+  static_assert(F == mat::FM_GREY_8, "Only FM_GREY_8 is supported!");
+  SNAP_INSTRUMENT_KERNEL("alg::fill", m.size(), m.size());
+  const Vec16x8u v(value);
+  if (m.halo() == 0) {
+    detail::write_elements(m.data(), m.rows() * m.stride(), policy, 
+      writePolicy, 
+      [&] (size_t)   { return v;     }, 
+      [&] (size_t)   { return value; }, 
+      [ ] (size_t)   {});
+    return;
+  }
+  detail::write_rows(m.data(), m.stride(), m.rows(), m.cols(), policy,
+    writePolicy,
+    [&] (size_t, size_t) { return v;     },
+    [&] (size_t, size_t) { return value; },
+    [ ] (size_t, size_t) {});
+}
+
+/// Copies the elements of matrix \p src into matrix \p dst, which must have
+/// the same dimensions.
+/// \param[in] src         The matrix to copy from.
+/// \param[in] dst         The matrix to copy to.
+/// \param[in] policy      The execution policy.
+/// \param[in] writePolicy The policy for the stores.
+template <uint8_t F, typename A>
+static inline void copy(const Matrix<F, A>& src                  ,
+                        Matrix<F, A>&       dst                  ,
+                        ExecutionPolicy     policy      = EP_SERIAL,
+                        WritePolicy         writePolicy = WP_AUTO  ) {
+  static_assert(F == mat::FM_GREY_8, "Only FM_GREY_8 is supported!");
+  assert(src.rows() == dst.rows() && src.cols() == dst.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::copy", src.size(), 2 * src.size());
+  const uint8_t* in = src.data();
+  if (src.halo() == 0 && dst.halo() == 0 && src.stride() == dst.stride()) {
+    detail::write_elements(dst.data(), dst.rows() * dst.stride(), policy, 
+      writePolicy, 
+      [in] (size_t i) { Vec16x8u v; v.load(in + i); return v; }, 
+      [in] (size_t i) { return in[i]; }, 
+      [in] (size_t i) { prefetch(in + i); });
+    return;
+  }
+  const size_t stride = src.stride();
+  detail::write_rows(dst.data(), dst.stride(), dst.rows(), dst.cols(), 
+    policy, writePolicy,
+    [=] (size_t r, size_t i) { 
+      Vec16x8u v; v.load(in + r * stride + i); return v; 
+    },
+    [=] (size_t r, size_t i) { return in[r * stride + i]; },
+    [=] (size_t r, size_t i) { prefetch(in + r * stride + i); });
+}
+
+/// Computes the absolute difference of each of the elements of matrices \p
+/// a and \p b, and writes the result to matrix \p out. All the matrices must
+/// have the same dimensions.
+/// \param[in] a           The first matrix.
+/// \param[in] b           The second matrix.
+/// \param[in] out         The matrix to write the differences to.
+/// \param[in] policy      The execution policy.
+/// \param[in] writePolicy The policy for the stores.
+template <uint8_t F, typename A>
+static inline void absdiff(const Matrix<F, A>& a                    , 
+                           const Matrix<F, A>& b                    ,
+                           Matrix<F, A>&       out                  ,
+                           ExecutionPolicy     policy      = EP_SERIAL,
+                           WritePolicy         writePolicy = WP_AUTO  ) {
+  static_assert(F == mat::FM_GREY_8, "Only FM_GREY_8 is supported!");
+  assert(a.rows() == b.rows()   && a.cols() == b.cols() &&
+         a.rows() == out.rows() && a.cols() == out.cols());
+  SNAP_INSTRUMENT_KERNEL("alg::absdiff", a.size(), 3 * a.size());
+  const uint8_t* pa = a.data();
+  const uint8_t* pb = b.data();
+  if (a.halo() == 0 && b.halo() == 0 && out.halo() == 0 &&
+      a.stride() == b.stride() && a.stride() == out.stride()) {
+    detail::write_elements(out.data(), out.rows() * out.stride(), policy, 
+      writePolicy, 
+      [pa, pb] (size_t i) { 
+        Vec16x8u va, vb; va.load(pa + i); vb.load(pb + i); 
+        return absdiff(va, vb); 
+      }, 
+      [pa, pb] (size_t i) { 
+        return static_cast<uint8_t>(std::abs(int(pa[i]) - int(pb[i]))); 
+      }, 
+      [pa, pb] (size_t i) { prefetch(pa + i); prefetch(pb + i); });
+    return;
+  }
+  const size_t sa = a.stride(), sb = b.stride();
+  detail::write_rows(out.data(), out.stride(), out.rows(), out.cols(), 
+    policy, writePolicy,
+    [=] (size_t r, size_t i) { 
+      Vec16x8u va, vb; va.load(pa + r * sa + i); vb.load(pb + r * sb + i); 
+      return absdiff(va, vb); 
+    },
+    [=] (size_t r, size_t i) { 
+      return static_cast<uint8_t>(
+        std::abs(int(pa[r * sa + i]) - int(pb[r * sb + i]))); 
+    },
+    [=] (size_t r, size_t i) { 
+      prefetch(pa + r * sa + i); prefetch(pb + r * sb + i); 
+    });
+}
+
+/// Sets the halo of matrix \p m, which was created with a Halo, from its
+/// elements with the \p border, so that stencil kernels can read the
+/// neighbours of the edge elements without bounds checks. The side halos of
+/// each row are set first, and then the rows of the top and bottom halos
+/// are copies of the padded rows they map to, so the corners are also set.
+/// \param[in] m      The matrix to set the halo of.
+/// \param[in] border The border mode.
+/// \param[in] value  The value of the halo for BM_CONSTANT.
+/// \param[in] policy The execution policy.
+template <uint8_t F, typename A>
+static inline void fill_border(Matrix<F, A>&   m                  ,
+                               BorderMode      border             ,
+                               uint8_t         value  = 0         ,
+                               ExecutionPolicy policy = EP_SERIAL ) {
+  static_assert(F == mat::FM_GREY_8 || F == mat::FM_BGR_24,
+                "Only FM_GREY_8 and FM_BGR_24 halos can be filled!");
+  constexpr size_t channels = format_traits<F>::channels;
+  const size_t     halo     = m.halo();
+  const int64_t    rows     = static_cast<int64_t>(m.rows());
+  const int64_t    cols     = static_cast<int64_t>(m.cols());
+  const size_t     side     = halo * channels;
+  const size_t     width    = m.cols() * channels + 2 * side;
+  SNAP_INSTRUMENT_KERNEL("alg::fill_border", 
+    (m.rows() + 2 * halo) * (m.cols() + 2 * halo) - m.size(),
+    2 * (m.rows() + 2 * halo) * width);
+  if (halo == 0 || m.size() == 0)
+    return;
+
+  std::vector<int64_t> left(halo), right(halo);
+  for (size_t j = 0; j < halo; ++j) {
+    left[j]  = border_index(int64_t(j) - int64_t(halo), cols, border);
+    right[j] = border_index(cols + int64_t(j), cols, border);
+  }
+
+  const auto leftStores  = detail::side_stores<channels>(left, true);
+  const auto rightStores = detail::side_stores<channels>(right, false);
+
+  uint8_t* data = m.data();
+  util::par::parallel_for(0, m.rows(),
+    util::par::chunk_count(m.rows() * side, policy, 
+      detail::MIN_PARALLEL_ELEMENTS),
+    [&] (size_t begin, size_t end, size_t) {
+      for (size_t r = begin; r < end; ++r) {
+        uint8_t* row = data + r * m.stride();
+        detail::fill_side<channels>(row - side, row, m.cols(), left, 
+          leftStores, border, value);
+        detail::fill_side<channels>(row + m.cols() * channels, row, 
+          m.cols(), right, rightStores, border, value);
+      }
+    }
+  );
+
+  const auto fillRow = [&] (int64_t r) {
+    uint8_t*      out    = data + r * int64_t(m.stride()) - int64_t(side);
+    const int64_t source = border_index(r, rows, border);
+    if (source < 0)
+      detail::fill_span(out, width, value);
+    else
+      std::memcpy(out, data + source * m.stride() - side, width);
+  };
+  for (int64_t i = 1; i <= int64_t(halo); ++i) {
+    fillRow(-i);
+    fillRow(rows - 1 + i);
+  }
+}
+
+} // namespace alg
+} // namespace snap
+
+#endif // SNAP_ALGORITHM_TRANSFORM_HPP
@@ -0,0 +1,402 @@
+//---- snap/algorithm/warp.hpp ----------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  warp.hpp
+/// \brief Defines geometric warps: affine and perspective warps, and remap
+///        with arbitrary coordinate maps, all with fixed point bilinear
+///        interpolation. The output is processed in square tiles, so that
+///        the input elements which are read for a tile stay in the cache for
+///        rotations and other warps which don't follow the rows of the
+///        input, and the tiles are split across threads.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_ALGORITHM_WARP_HPP
+#define SNAP_ALGORITHM_WARP_HPP
+
+#include "region.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace snap {
+namespace alg  {
+
+namespace detail {
+
+/// Defines the number of fractional bits of the sampling coordinates, which
+/// are also the bilinear weights. The product of two weights and a sample
+/// must fit in 32 bits.
+static constexpr uint32_t WARP_SHIFT = 11;
+
+/// Defines the number of fractional bits of the affine coordinates, which
+/// are computed incrementally with integer adds, so that they accumulate no
+/// error along a row.
+static constexpr uint32_t WARP_AFFINE_SHIFT = 16;
+
+/// Defines the max magnitude of the row offset and the column offset of the
+/// affine coordinates which can be computed incrementally, such that their
+/// sum fits in 32 bits with WARP_AFFINE_SHIFT fractional bits.
+static constexpr double WARP_AFFINE_LIMIT = double(1 << 13);
+
+/// Defines the max magnitude of a sampling coordinate, such that it fits
+/// in 32 bits with WARP_SHIFT fractional bits. Coordinates beyond this are
+/// far outside any input, and are clamped.
+static constexpr double WARP_LIMIT = double(1 << 19);
+
+/// Defines the number of rows and columns of the output tiles. The inputs
+/// which are read for a 64x64 tile fit in the L1 cache for most warps.
+static constexpr size_t WARP_TILE = 64;
+
+/// Defines the input of a warp.
+struct WarpSource {
+  const uint8_t* data;    //!< Pointer to the first element.
+  size_t         rows;    //!< The number of rows.
+  size_t         cols;    //!< The number of elements in each row.
+  size_t         stride;  //!< The number of values between row starts.
+};
+
+/// Converts the coordinate \p x to fixed point with WARP_SHIFT fractional
+/// bits, rounding to nearest, and clamping it to WARP_LIMIT. NaNs, which
+/// come from points at infinity, are mapped outside the input.
+/// \param[in] x The coordinate to convert.
+static inline int32_t to_fixed(double x) {
+  const double clamped = x >= -WARP_LIMIT
+                       ? (x <= WARP_LIMIT ? x : WARP_LIMIT)
+                       : -WARP_LIMIT;
+  const double scaled  = clamped * (1 << WARP_SHIFT);
+  return static_cast<int32_t>(scaled < 0.0 ? scaled - 0.5 : scaled + 0.5);
+}
+
+/// Returns channel \p k of the element at column \p x and row \p y of \p s,
+/// or the value for the \p border if the element is outside \p s.
+/// \param[in] s      The input of the warp.
+/// \param[in] x      The column of the element.
+/// \param[in] y      The row of the element.
+/// \param[in] k      The channel of the element.
+/// \param[in] border The border mode.
+/// \param[in] value  The value of the elements outside for BM_CONSTANT.
+/// \tparam    C      The number of channels of each element.
+template <size_t C>
+static inline uint32_t border_at(const WarpSource& s, int64_t x, int64_t y,
+    size_t k, BorderMode border, uint8_t value) {
+  x = border_index(x, static_cast<int64_t>(s.cols), border);
+  y = border_index(y, static_cast<int64_t>(s.rows), border);
+  if (x < 0 || y < 0)
+    return value;
+  return s.data[size_t(y) * s.stride + size_t(x) * C + k];
+}
+
+/// Samples \p s at the \p n fixed point coordinates \p xs and \p ys with
+/// bilinear interpolation, and writes the elements to \p out. Samples whose
+/// 2x2 neighbourhood is inside \p s read the elements directly, and the
+/// others read them with the \p border.
+/// \param[in] s      The input of the warp.
+/// \param[in] xs     The columns of the samples.
+/// \param[in] ys     The rows of the samples.
+/// \param[in] n      The number of samples.
+/// \param[in] out    A pointer to the output elements.
+/// \param[in] border The border mode.
+/// \param[in] value  The value of the elements outside for BM_CONSTANT.
+/// \tparam    C      The number of channels of each element.
+template <size_t C>
+static inline void sample_row(const WarpSource& s, const int32_t* xs,
+    const int32_t* ys, size_t n, uint8_t* out, BorderMode border,
+    uint8_t value) {
+  constexpr uint32_t one  = 1 << WARP_SHIFT;
+  constexpr uint32_t mask = one - 1;
+  constexpr uint32_t half = 1 << (2 * WARP_SHIFT - 1);
+  const auto blend = [] (uint32_t p00, uint32_t p01, uint32_t p10,
+                         uint32_t p11, uint32_t wx, uint32_t wy) {
+    const uint32_t t = p00 * (one - wx) + p01 * wx;
+    const uint32_t b = p10 * (one - wx) + p11 * wx;
+    return static_cast<uint8_t>((t * (one - wy) + b * wy + half) >>
+                                (2 * WARP_SHIFT));
+  };
+
+  for (size_t i = 0; i < n; ++i, out += C) {
+    const int32_t  ix = xs[i] >> WARP_SHIFT;
+    const int32_t  iy = ys[i] >> WARP_SHIFT;
+    const uint32_t wx = static_cast<uint32_t>(xs[i]) & mask;
+    const uint32_t wy = static_cast<uint32_t>(ys[i]) & mask;
+    if (ix >= 0 && iy >= 0 && size_t(ix) + 1 < s.cols &&
+        size_t(iy) + 1 < s.rows) {
+      const uint8_t* p = s.data + size_t(iy) * s.stride + size_t(ix) * C;
+      for (size_t k = 0; k < C; ++k) {
+        out[k] = blend(p[k], p[k + C], p[k + s.stride], p[k + s.stride + C],
+                       wx, wy);
+      }
+      continue;
+    }
+    for (size_t k = 0; k < C; ++k) {
+      out[k] = blend(border_at<C>(s, ix    , iy    , k, border, value),
+                     border_at<C>(s, ix + 1, iy    , k, border, value),
+                     border_at<C>(s, ix    , iy + 1, k, border, value),
+                     border_at<C>(s, ix + 1, iy + 1, k, border, value),
+                     wx, wy);
+    }
+  }
+}
+
+/// Warps \p s into the \p rows x \p cols output at \p out, where the rows
+/// of the output are \p outStride values apart, a tile at a time. For each
+/// row of each tile, coordinates(r, c, n, xs, ys) must write the fixed
+/// point input coordinates of the \p n output elements from column c of
+/// row r to xs and ys.
+/// \param[in] s           The input of the warp.
+/// \param[in] out         A pointer to the first output element.
+/// \param[in] outStride   The number of values between output rows.
+/// \param[in] rows        The number of output rows.
+/// \param[in] cols        The number of output columns.
+/// \param[in] border      The border mode.
+/// \param[in] value       The value of the elements outside for BM_CONSTANT.
+/// \param[in] policy      The execution policy.
+/// \param[in] coordinates The function which computes the coordinates.
+/// \tparam    C           The number of channels of each element.
+template <size_t C, typename Coordinates>
+static inline void warp(const WarpSource& s, uint8_t* out, size_t outStride,
+    size_t rows, size_t cols, BorderMode border, uint8_t value,
+    ExecutionPolicy policy, Coordinates&& coordinates) {
+  const size_t tilesX = block_count(cols, WARP_TILE);
+  const size_t tiles  = block_count(rows, WARP_TILE) * tilesX;
+  util::par::parallel_for(0, tiles,
+    util::par::chunk_count(rows * cols, policy, MIN_PARALLEL_ELEMENTS),
+    [&] (size_t begin, size_t end, size_t) {
+      int32_t xs[WARP_TILE], ys[WARP_TILE];
+      for (size_t t = begin; t < end; ++t) {
+        const size_t r0 = t / tilesX * WARP_TILE;
+        const size_t c0 = t % tilesX * WARP_TILE;
+        const size_t n  = std::min(WARP_TILE, cols - c0);
+        for (size_t r = r0; r < std::min(r0 + WARP_TILE, rows); ++r) {
+          coordinates(r, c0, n, xs, ys);
+          sample_row<C>(s, xs, ys, n, out + r * outStride + c0 * C, border,
+                        value);
+        }
+      }
+    }
+  );
+}
+
+/// Creates the warp input for matrix \p m.
+/// \param[in] m The matrix to create the input for.
+template <uint8_t F, typename A>
+static inline WarpSource make_warp_source(const Matrix<F, A>& m) {
+  static_assert(F == mat::FM_GREY_8 || F == mat::FM_BGR_24,
+                "Only FM_GREY_8 and FM_BGR_24 can be warped!");
+  return WarpSource{m.data(), m.rows(), m.cols(), m.stride()};
+}
+
+} // namespace detail
+
+/// Inverts the 2x3 affine transform \p m, which is stored by rows, into
+/// \p inverse. Returns false, and leaves \p inverse unchanged, if \p m is
+/// singular.
+/// \param[in] m       The transform to invert.
+/// \param[in] inverse The inverse of the transform.
+static inline bool invert_affine(const double (&m)[6], double (&inverse)[6]) {
+  const double det = m[0] * m[4] - m[1] * m[3];
+  if (det == 0.0)
+    return false;
+
+  inverse[0] =  m[4] / det;
+  inverse[1] = -m[1] / det;
+  inverse[3] = -m[3] / det;
+  inverse[4] =  m[0] / det;
+  inverse[2] = -(inverse[0] * m[2] + inverse[1] * m[5]);
+  inverse[5] = -(inverse[3] * m[2] + inverse[4] * m[5]);
+  return true;
+}
+
+/// Inverts the 3x3 perspective transform \p m, which is stored by rows,
+/// into \p inverse. Returns false, and leaves \p inverse unchanged, if \p m
+/// is singular.
+/// \param[in] m       The transform to invert.
+/// \param[in] inverse The inverse of the transform.
+static inline bool invert_perspective(const double (&m)[9],
+                                      double (&inverse)[9]) {
+  const double a = m[4] * m[8] - m[5] * m[7];
+  const double b = m[5] * m[6] - m[3] * m[8];
+  const double c = m[3] * m[7] - m[4] * m[6];
+  const double det = m[0] * a + m[1] * b + m[2] * c;
+  if (det == 0.0)
+    return false;
+
+  inverse[0] = a / det;
+  inverse[1] = (m[2] * m[7] - m[1] * m[8]) / det;
+  inverse[2] = (m[1] * m[5] - m[2] * m[4]) / det;
+  inverse[3] = b / det;
+  inverse[4] = (m[0] * m[8] - m[2] * m[6]) / det;
+  inverse[5] = (m[2] * m[3] - m[0] * m[5]) / det;
+  inverse[6] = c / det;
+  inverse[7] = (m[1] * m[6] - m[0] * m[7]) / det;
+  inverse[8] = (m[0] * m[4] - m[1] * m[3]) / det;
+  return true;
+}
+
+/// Warps matrix \p in into matrix \p out with the affine transform \p m,
+/// which maps the column and row of each output element to the position
+/// in \p in which is sampled for it, with bilinear interpolation:
+///
+///   x = m[0] * c + m[1] * r + m[2],  y = m[3] * c + m[4] * r + m[5].
+///
+/// Use invert_affine for a transform from the input to the output. The
+/// coordinates of a row are the coordinates of its first element plus a
+/// table of the per column offsets, in fixed point, so each element takes
+/// two integer adds, which the compiler vectorizes.
+/// \param[in] in          The matrix to warp.
+/// \param[in] out         The warped matrix.
+/// \param[in] m           The transform from the output to the input.
+/// \param[in] border      The border mode.
+/// \param[in] borderValue The value of the elements outside for BM_CONSTANT.
+/// \param[in] policy      The execution policy.
+template <uint8_t F, typename A, typename B>
+static inline void warp_affine(const Matrix<F, A>& in                       ,
+                               Matrix<F, B>&       out                      ,
+                               const double        (&m)[6]                  ,
+                               BorderMode          border      = BM_CONSTANT,
+                               uint8_t             borderValue = 0          ,
+                               ExecutionPolicy     policy      = EP_SERIAL  ) {
+  assert(in.size() > 0);
+  constexpr size_t   channels = format_traits<F>::channels;
+  constexpr uint32_t shift    =
+    detail::WARP_AFFINE_SHIFT - detail::WARP_SHIFT;
+  constexpr double   scale    = double(1 << detail::WARP_AFFINE_SHIFT);
+  SNAP_INSTRUMENT_KERNEL("alg::warp_affine", out.size(),
+    channels * (in.size() + out.size()));
+
+  // The per column offsets can only be used if all the coordinates fit in
+  // 32 bits, otherwise the coordinates are computed for each element.
+  const size_t cols  = out.cols();
+  const double reach = std::max(std::abs(m[0]), std::abs(m[3])) * cols;
+  const bool   table = reach < detail::WARP_AFFINE_LIMIT;
+  std::vector<int32_t> dx(table ? cols : 0), dy(table ? cols : 0);
+  for (size_t c = 0; c < dx.size(); ++c) {
+    dx[c] = static_cast<int32_t>(std::lround(m[0] * c * scale));
+    dy[c] = static_cast<int32_t>(std::lround(m[3] * c * scale));
+  }
+
+  detail::warp<channels>(detail::make_warp_source(in), out.data(),
+    out.stride(), out.rows(), cols, border, borderValue, policy,
+    [&] (size_t r, size_t c0, size_t n, int32_t* xs, int32_t* ys) {
+      const double x0 = m[1] * r + m[2];
+      const double y0 = m[4] * r + m[5];
+      if (table && std::abs(x0) < detail::WARP_AFFINE_LIMIT &&
+                   std::abs(y0) < detail::WARP_AFFINE_LIMIT) {
+        // The row offsets include the rounding for the shift.
+        const int32_t bx = static_cast<int32_t>(std::lround(x0 * scale)) +
+                           (1 << (shift - 1));
+        const int32_t by = static_cast<int32_t>(std::lround(y0 * scale)) +
+                           (1 << (shift - 1));
+        const int32_t* px = dx.data() + c0;
+        const int32_t* py = dy.data() + c0;
+        for (size_t i = 0; i < n; ++i) {
+          xs[i] = (bx + px[i]) >> shift;
+          ys[i] = (by + py[i]) >> shift;
+        }
+        return;
+      }
+      for (size_t i = 0; i < n; ++i) {
+        xs[i] = detail::to_fixed(m[0] * (c0 + i) + x0);
+        ys[i] = detail::to_fixed(m[3] * (c0 + i) + y0);
+      }
+    }
+  );
+}
+
+/// Warps matrix \p in into matrix \p out with the perspective transform
+/// \p m, which maps the column and row of each output element to the
+/// position in \p in which is sampled for it, with bilinear interpolation:
+///
+///   w = m[6] * c + m[7] * r + m[8],
+///   x = (m[0] * c + m[1] * r + m[2]) / w,
+///   y = (m[3] * c + m[4] * r + m[5]) / w.
+///
+/// Use invert_perspective for a transform from the input to the output.
+/// The numerators and the denominator are updated incrementally along each
+/// row, so each element takes three adds and a division.
+/// \param[in] in          The matrix to warp.
+/// \param[in] out         The warped matrix.
+/// \param[in] m           The transform from the output to the input.
+/// \param[in] border      The border mode.
+/// \param[in] borderValue The value of the elements outside for BM_CONSTANT.
+/// \param[in] policy      The execution policy.
+template <uint8_t F, typename A, typename B>
+static inline void warp_perspective(const Matrix<F, A>& in             ,
+                                    Matrix<F, B>&       out            ,
+                                    const double        (&m)[9]        ,
+                                    BorderMode      border = BM_CONSTANT,
+                                    uint8_t         borderValue = 0     ,
+                                    ExecutionPolicy policy = EP_SERIAL  ) {
+  assert(in.size() > 0);
+  constexpr size_t channels = format_traits<F>::channels;
+  SNAP_INSTRUMENT_KERNEL("alg::warp_perspective", out.size(),
+    channels * (in.size() + out.size()));
+
+  detail::warp<channels>(detail::make_warp_source(in), out.data(),
+    out.stride(), out.rows(), out.cols(), border, borderValue, policy,
+    [&] (size_t r, size_t c0, size_t n, int32_t* xs, int32_t* ys) {
+      double x = m[0] * c0 + m[1] * r + m[2];
+      double y = m[3] * c0 + m[4] * r + m[5];
+      double w = m[6] * c0 + m[7] * r + m[8];
+      for (size_t i = 0; i < n; ++i) {
+        const double inv = w != 0.0 ? 1.0 / w : 0.0;
+        xs[i] = detail::to_fixed(w != 0.0 ? x * inv : -detail::WARP_LIMIT);
+        ys[i] = detail::to_fixed(w != 0.0 ? y * inv : -detail::WARP_LIMIT);
+        x += m[0];
+        y += m[3];
+        w += m[6];
+      }
+    }
+  );
+}
+
+/// Remaps matrix \p in into matrix \p out, where each output element is
+/// sampled from \p in at column mapX[i] and row mapY[i] with bilinear
+/// interpolation, for the element with index i = r * out.cols() + c. The
+/// maps must have out.rows() * out.cols() values.
+/// \param[in] in          The matrix to remap.
+/// \param[in] out         The remapped matrix.
+/// \param[in] mapX        The input column of each output element.
+/// \param[in] mapY        The input row of each output element.
+/// \param[in] border      The border mode.
+/// \param[in] borderValue The value of the elements outside for BM_CONSTANT.
+/// \param[in] policy      The execution policy.
+template <uint8_t F, typename A, typename B>
+static inline void remap(const Matrix<F, A>& in                       ,
+                         Matrix<F, B>&       out                      ,
+                         const float*        mapX                     ,
+                         const float*        mapY                     ,
+                         BorderMode          border      = BM_CONSTANT,
+                         uint8_t             borderValue = 0          ,
+                         ExecutionPolicy     policy      = EP_SERIAL  ) {
+  assert(in.size() > 0);
+  constexpr size_t channels = format_traits<F>::channels;
+  const size_t     cols     = out.cols();
+  SNAP_INSTRUMENT_KERNEL("alg::remap", out.size(),
+    channels * (in.size() + out.size()) + 8 * out.size());
+
+  detail::warp<channels>(detail::make_warp_source(in), out.data(),
+    out.stride(), out.rows(), cols, border, borderValue, policy,
+    [&] (size_t r, size_t c0, size_t n, int32_t* xs, int32_t* ys) {
+      const float* px = mapX + r * cols + c0;
+      const float* py = mapY + r * cols + c0;
+      for (size_t i = 0; i < n; ++i) {
+        xs[i] = detail::to_fixed(px[i]);
+        ys[i] = detail::to_fixed(py[i]);
+      }
+    }
+  );
+}
+
+} // namespace alg
+} // namespace snap
+
+#endif // SNAP_ALGORITHM_WARP_HPP
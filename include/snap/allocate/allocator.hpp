@@ -17,6 +17,12 @@
 #ifndef SNAP_ALLOCATE_ALLOCATOR_HPP
 #define SNAP_ALLOCATE_ALLOCATOR_HPP
 
+#include "snap/config/simd_instruction_detect.h"
+
+#if defined(SSE_ENABLED)
 #include "allocator_sse.hpp"
+#else
+#include "allocator_general.hpp"
+#endif
 
 #endif // SNAP_ALLOCATE_ALLOCATOR_HPP
@@ -10,16 +10,41 @@
 // ========================================================================= //
 //
 /// \file  allocator_general.hpp
-/// \brief Defines the allocator struct which can be specialized for the
-///        different implementations.
+/// \brief Defines the portable allocator, which uses posix_memalign, for the
+///        backends which do not have their own allocator (NEON and scalar).
 //
 //---------------------------------------------------------------------------//
 
 #ifndef SNAP_ALLOCATE_ALLOCATOR_GENERAL_HPP
 #define SNAP_ALLOCATE_ALLOCATOR_GENERAL_HPP
 
+#include "snap/config/simd_instruction_detect.h"
+#include <cstdlib>
+
 namespace snap {
 
+/// Defines a specialization of the allocator class to allocate aligned
+/// vectorized data when the data type is 8-bit greyscale.
+/// \tparam DataType The type of data to allocate in an aligned manner.
+template <typename DataType>
+struct AlignedAllocator {
+  /// Defines a function to allocate \p bytes of \p alignment aligned data.
+  /// \param bytes     The number of bytes to allocate.
+  /// \param alignment The alignment of the allocated data, which must be a
+  ///                  power of two multiple of sizeof(void*).
+  static inline DataType* alloc(size_t bytes, size_t alignment) {
+    void* p = nullptr;
+    return posix_memalign(&p, alignment, bytes) == 0 
+      ? static_cast<DataType*>(p) : nullptr;
+  }
+
+  /// Frees aligned data.
+  /// \param p A pointer to the data to free.
+  static inline void free(DataType* p) {
+    std::free(static_cast<void*>(p));
+  }
+};
+
 } // namespace snap
 
-#endif // SNAP_ALLOCATE_ALLOCATOR_HPP
+#endif // SNAP_ALLOCATE_ALLOCATOR_GENERAL_HPP
@@ -50,7 +50,8 @@ enum SimdType : uint8_t {
   ST_AVX    = 7 ,
   ST_AVX2   = 8 ,
   ST_NEON   = 9 ,
-  ST_NEON64 = 10
+  ST_NEON64 = 10,
+  ST_SCALAR = 11
 };
 
 /// Defines all possible alignments.
@@ -63,23 +64,27 @@ enum Alignments : uint8_t {
 } // namespace snap
 
 /// Defines the highest level of SIMD 
-/// instructions detected by the compiler.
-#if defined(__arm__)
+/// instructions detected by the compiler. SNAP_FORCE_SCALAR can be defined to
+/// use the portable scalar implementation even when SIMD is available.
+#if defined(SNAP_FORCE_SCALAR)
+#define SCALAR_ENABLED 1
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
 #include <arm_neon.h>
+#define NEON_ENABLED 1
 
 namespace snap {
 #if defined(__aarch64__)
 #define NEON64_ENABLED 1
 
   /// Defines memory alignment.
-  static constexpr uint8_t ALIGNMENT = AL_8;
+  static constexpr uint8_t ALIGNMENT = AL_16;
 
   /// Defines highest level of SIMD instructions.
   static constexpr uint8_t SIMD_TYPE = ST_NEON64;
 #else 
-#define NEON_ENABLED 1
   /// Defines memory alignment.
-  static constexpr uint8_t ALIGNMENT = AL_4;
+  static constexpr uint8_t ALIGNMENT = AL_16;
 
   /// Defines highest level of SIMD instructions.
   static constexpr uint8_t SIMD_TYPE = ST_NEON; 
@@ -167,7 +172,7 @@ namespace snap {
   static constexpr uint8_t ALIGNMENT = AL_16;
 
   /// Defines highest level if SIMD instructions.
-  static constexpr uint8_t SIND_TYPE = ST_SSE2;
+  static constexpr uint8_t SIMD_TYPE = ST_SSE2;
 } // namespace snap
 
 #elif defined(__SSE)
@@ -183,7 +188,18 @@ namespace snap {
 } // namespace snap
 
 #else
- #error "No SIMD Instructions found! Snap can't function!"
+#define SCALAR_ENABLED 1
+#endif
+
+#if defined(SCALAR_ENABLED)
+namespace snap {
+  /// Defines memory alignment, which is kept the same as for SSE and NEON so
+  /// that the matrix layout does not depend on the backend.
+  static constexpr uint8_t ALIGNMENT = AL_16;
+
+  /// Defines highest level of SIMD instructions.
+  static constexpr uint8_t SIMD_TYPE = ST_SCALAR;
+} // namespace snap
 #endif
 
 #define SNAP_ALIGNED SNAP_ALIGN(snap::ALIGNMENT)
@@ -0,0 +1,218 @@
+//---- snap/io/band_reader.hpp ----------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  band_reader.hpp
+/// \brief Defines a streaming image reader which provides a memory mapped 
+///        image as bands of rows, and hints to the kernel to read the next
+///        bands ahead and to drop the bands which have been processed.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_IO_BAND_READER_HPP
+#define SNAP_IO_BAND_READER_HPP
+
+#include "mapped_file.hpp"
+#include "pnm.hpp"
+#include "snap/matrix/matrix.hpp"
+
+namespace snap {
+namespace io   {
+
+/// Defines a reader which streams a memory mapped image as bands of rows, so
+/// that images larger than memory can be processed with a bounded resident
+/// size. When the image samples have the layout of the matrix format, each 
+/// band wraps the mapped samples without a copy, otherwise each band is 
+/// decoded into a buffer which is reused for all bands.
+///
+/// \tparam Format The format of the bands.
+template <uint8_t Format>
+class RowBandReader {
+ public:
+  /// Defines the type of the band matrices.
+  using MatrixType = Matrix<Format>;
+
+  /// Defines the type of each of the channels of an element.
+  using ElementType = typename format_traits<Format>::element_type;
+
+  /// Constructor: Creates a reader which is not open.
+  /// \param[in] bandRows  The number of rows in each band.
+  /// \param[in] readahead The number of bands to read ahead of the current
+  ///            band.
+  explicit RowBandReader(size_t bandRows = 64, size_t readahead = 2) 
+  : BandRows(bandRows == 0 ? 1 : bandRows), Readahead(readahead), Rows(0), 
+    Cols(0), Offset(0), Row(0), NextRow(0), Decode(false) {}
+
+  /// Open operation: Opens a binary PGM image for a greyscale reader, or a
+  /// binary PPM image for a BGR reader, whose bands are decoded from RGB.
+  /// Returns false if the file can't be mapped, or is not a valid image 
+  /// with the format of the reader.
+  /// \param[in] path The path to the image file.
+  bool openPnm(const std::string& path);
+
+  /// Open operation: Opens a raw image file, with \p rows rows of \p cols 
+  /// elements in the format of the reader starting at byte \p offset.
+  /// Returns false if the file can't be mapped or is too small.
+  /// \param[in] path   The path to the image file.
+  /// \param[in] rows   The number of rows in the image.
+  /// \param[in] cols   The number of columns in the image.
+  /// \param[in] offset The offset of the first element in the file.
+  bool openRaw(const std::string& path, size_t rows, size_t cols, 
+               size_t offset = 0);
+
+  /// Close operation: Unmaps the image file and empties the band.
+  void close();
+
+  /// Returns true if an image is open.
+  bool isOpen() const { return File.isOpen(); }
+
+  /// Next operation: Moves to the next band of the image. Returns false 
+  /// when there are no more bands.
+  bool next();
+
+  /// Band operation: Gets the current band, which is valid until the next
+  /// call to next().
+  const MatrixType& band() const { return Band; }
+
+  /// Band row operation: Gets the image row of the first row of the band.
+  size_t bandRow() const { return Row; }
+
+  /// Row size operation: Gets the number of rows in the image.
+  size_t rows() const { return Rows; }
+
+  /// Col size operation: Gets the number of columns in the image.
+  size_t cols() const { return Cols; }
+
+  /// Returns true if the bands are decoded rather than wrapped.
+  bool decoding() const { return Decode; }
+
+ private:
+  MappedFile File;       //!< The mapped image file.
+  MatrixType Band;       //!< The current band.
+  MatrixType Buffer;     //!< The buffer for decoded bands.
+  size_t     BandRows;   //!< The number of rows per band.
+  size_t     Readahead;  //!< The number of bands to read ahead.
+  size_t     Rows;       //!< The number of rows in the image.
+  size_t     Cols;       //!< The number of columns in the image.
+  size_t     Offset;     //!< The offset of the first sample in the file.
+  size_t     Row;        //!< The first row of the current band.
+  size_t     NextRow;    //!< The first row of the next band.
+  bool       Decode;     //!< If the bands are decoded from RGB to BGR.
+
+  /// Returns the number of bytes in a row of the image file.
+  size_t rowBytes() const { 
+    return format_traits<Format>::stride(Cols) * sizeof(ElementType);
+  }
+
+  /// Starts reading the image from \p offset, if the file is big enough.
+  /// \param[in] rows   The number of rows in the image.
+  /// \param[in] cols   The number of columns in the image.
+  /// \param[in] offset The offset of the first element in the file.
+  /// \param[in] decode If the bands must be decoded.
+  bool start(size_t rows, size_t cols, size_t offset, bool decode);
+};
+
+// ---- Implementation ----------------------------------------------------- //
+
+template <uint8_t F>
+bool RowBandReader<F>::openPnm(const std::string& path) {
+  close();
+  if (!File.open(path))
+    return false;
+
+  PnmHeader header;
+  const bool valid = parse_pnm_header(File.data(), File.size(), header) &&
+    ((F == mat::FM_GREY_8 && header.channels == 1) ||
+     (F == mat::FM_BGR_24 && header.channels == 3));
+  if (!valid) {
+    close();
+    return false;
+  }
+  return start(header.height, header.width, header.dataOffset, 
+               header.channels == 3);
+}
+
+template <uint8_t F>
+bool RowBandReader<F>::openRaw(const std::string& path, size_t rows, 
+                               size_t cols, size_t offset) {
+  close();
+  return File.open(path) && start(rows, cols, offset, false);
+}
+
+template <uint8_t F>
+void RowBandReader<F>::close() {
+  Band   = MatrixType();
+  Buffer = MatrixType();
+  File.close();
+  Rows = Cols = Offset = Row = NextRow = 0;
+  Decode = false;
+}
+
+template <uint8_t F>
+bool RowBandReader<F>::start(size_t rows, size_t cols, size_t offset, 
+                             bool decode) {
+  Rows = rows; Cols = cols; Offset = offset; Decode = decode;
+  // As for MappedMatrix::wrap, the checks divide so that they can't 
+  // overflow.
+  if (rows == 0 || cols == 0 || offset > File.size() || 
+      cols > File.size() - offset || 
+      rowBytes() > (File.size() - offset) / rows) {
+    close();
+    return false;
+  }
+
+  if (Decode)
+    Buffer = MatrixType(std::min(BandRows, Rows), Cols);
+
+  File.adviseSequential();
+  File.willNeed(Offset, (Readahead + 1) * BandRows * rowBytes());
+  return true;
+}
+
+template <uint8_t F>
+bool RowBandReader<F>::next() {
+  if (NextRow >= Rows) {
+    Band = MatrixType();
+    return false;
+  }
+
+  // The previous band has been processed, so its pages can be dropped, and
+  // the band at the end of the readahead window can start to be read.
+  if (NextRow > 0)
+    File.dontNeed(Offset + Row * rowBytes(), (NextRow - Row) * rowBytes());
+  File.willNeed(Offset + (NextRow + Readahead * BandRows) * rowBytes(), 
+                BandRows * rowBytes());
+
+  Row     = NextRow;
+  NextRow = std::min(Row + BandRows, Rows);
+
+  const size_t   bandRows = NextRow - Row;
+  const uint8_t* samples  = File.data() + Offset + Row * rowBytes();
+  if (!Decode) {
+    Band = MatrixType(bandRows, Cols, reinterpret_cast<ElementType*>(
+                        const_cast<uint8_t*>(samples)));
+    return true;
+  }
+
+  // Swap the RGB samples to BGR into the start of the buffer.
+  uint8_t* out = reinterpret_cast<uint8_t*>(Buffer.data());
+  for (size_t i = 0; i < bandRows * Cols * 3; i += 3) {
+    out[i]     = samples[i + 2];
+    out[i + 1] = samples[i + 1];
+    out[i + 2] = samples[i];
+  }
+  Band = MatrixType(bandRows, Cols, Buffer.data());
+  return true;
+}
+
+} // namespace io
+} // namespace snap
+
+#endif // SNAP_IO_BAND_READER_HPP
@@ -0,0 +1,184 @@
+//---- snap/io/mapped_file.hpp ----------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  mapped_file.hpp
+/// \brief Defines a read-only memory mapped file, with hints to the kernel
+///        for which parts of the file will be needed next, and which parts
+///        are no longer needed. This uses the POSIX mmap interface.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_IO_MAPPED_FILE_HPP
+#define SNAP_IO_MAPPED_FILE_HPP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace snap {
+namespace io   {
+
+/// Defines a read-only memory mapping of a whole file. The data of the file 
+/// is paged in from the page cache on access, so there is no copy from the 
+/// kernel into a user buffer.
+class MappedFile {
+ public:
+  /// Constructor: Creates a mapped file which is not open.
+  MappedFile() : Data(nullptr), Size(0) {}
+
+  /// Constructor: Moves the mapping from \p other, which is left closed.
+  /// \param[in] other The mapped file to move from.
+  MappedFile(MappedFile&& other) : Data(other.Data), Size(other.Size) {
+    other.Data = nullptr;
+    other.Size = 0;
+  }
+
+  /// Assignment operator: Moves the mapping from \p other, which is left
+  /// closed, closing the mapping of this file.
+  /// \param[in] other The mapped file to move from.
+  MappedFile& operator=(MappedFile&& other) {
+    if (this != &other) {
+      close();
+      Data = other.Data; other.Data = nullptr;
+      Size = other.Size; other.Size = 0;
+    }
+    return *this;
+  }
+
+  /// The mapped file owns the mapping, so it can't be copied.
+  MappedFile(const MappedFile&)            = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /// Destructor: Unmaps the file.
+  ~MappedFile() { close(); }
+
+  /// Open operation: Maps the file at \p path, closing any open mapping. 
+  /// Returns false if the file can't be opened or mapped, or is empty.
+  /// \param[in] path The path to the file to map.
+  bool open(const std::string& path);
+
+  /// Close operation: Unmaps the file, if it is mapped.
+  void close();
+
+  /// Returns true if a file is mapped.
+  bool isOpen() const { return Data != nullptr; }
+
+  /// Returns a pointer to the first byte of the file.
+  const uint8_t* data() const { return Data; }
+
+  /// Returns the size of the file, in bytes.
+  size_t size() const { return Size; }
+
+  /// Hints that the file will be read sequentially, so the kernel can read
+  /// ahead aggressively and free pages soon after they have been read.
+  void adviseSequential() const;
+
+  /// Hints that the \p bytes bytes at \p offset will be needed soon, so that
+  /// the kernel starts to read them in the background.
+  /// \param[in] offset The offset of the first byte which will be needed.
+  /// \param[in] bytes  The number of bytes which will be needed.
+  void willNeed(size_t offset, size_t bytes) const;
+
+  /// Hints that the \p bytes bytes at \p offset are no longer needed, so 
+  /// that their pages can be unmapped. They are still valid, and will be 
+  /// paged in again if they are accessed. Only pages which are completely
+  /// inside the range are released.
+  /// \param[in] offset The offset of the first byte which is not needed.
+  /// \param[in] bytes  The number of bytes which are not needed.
+  void dontNeed(size_t offset, size_t bytes) const;
+
+ private:
+  const uint8_t* Data;  //!< Pointer to the start of the mapping.
+  size_t         Size;  //!< The size of the mapping, in bytes.
+
+  /// Returns the size of a page.
+  static size_t pageSize() { 
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+  }
+
+  /// Calls madvise with \p advice for the pages from \p begin to \p end.
+  /// \param[in] begin  The offset of the start of the first page.
+  /// \param[in] end    The offset of the end of the range.
+  /// \param[in] advice The advice for the pages.
+  void advise(size_t begin, size_t end, int advice) const;
+};
+
+// ---- Implementation ----------------------------------------------------- //
+
+inline bool MappedFile::open(const std::string& path) {
+  close();
+
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+
+  void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                       MAP_PRIVATE, fd, 0);
+  // The mapping keeps a reference to the file, so it can be closed here.
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    return false;
+
+  Data = static_cast<const uint8_t*>(mapping);
+  Size = static_cast<size_t>(info.st_size);
+  return true;
+}
+
+inline void MappedFile::close() {
+  if (Data != nullptr)
+    munmap(const_cast<uint8_t*>(Data), Size);
+  Data = nullptr;
+  Size = 0;
+}
+
+inline void MappedFile::adviseSequential() const {
+  advise(0, Size, MADV_SEQUENTIAL);
+}
+
+inline void MappedFile::willNeed(size_t offset, size_t bytes) const {
+  if (offset >= Size)
+    return;
+  advise(offset - offset % pageSize(), 
+         offset + std::min(bytes, Size - offset), MADV_WILLNEED);
+}
+
+inline void MappedFile::dontNeed(size_t offset, size_t bytes) const {
+  if (offset >= Size)
+    return;
+  // Pages which are partially in the range may still be needed.
+  const size_t begin = (offset + pageSize() - 1) / pageSize() * pageSize();
+  const size_t end   = offset + std::min(bytes, Size - offset);
+  const size_t last  = end == Size ? end : end - end % pageSize();
+  if (begin < last)
+    advise(begin, last, MADV_DONTNEED);
+}
+
+inline void MappedFile::advise(size_t begin, size_t end, int advice) const {
+  if (Data != nullptr && begin < end)
+    madvise(const_cast<uint8_t*>(Data) + begin, end - begin, advice);
+}
+
+} // namespace io
+} // namespace snap
+
+#endif // SNAP_IO_MAPPED_FILE_HPP
@@ -0,0 +1,141 @@
+//---- snap/io/mapped_matrix.hpp --------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  mapped_matrix.hpp
+/// \brief Defines zero-copy loading of images into a read-only Matrix, by
+///        memory mapping the image file and wrapping the mapped samples.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_IO_MAPPED_MATRIX_HPP
+#define SNAP_IO_MAPPED_MATRIX_HPP
+
+#include "mapped_file.hpp"
+#include "pnm.hpp"
+#include "snap/matrix/matrix.hpp"
+
+namespace snap {
+namespace io   {
+
+/// Defines a read-only Matrix which wraps the samples of a memory mapped
+/// image file, so that the image is never copied. The samples are paged in
+/// on first access. Since the samples start at the offset of the image 
+/// header, the matrix data is only aligned when the header size is a 
+/// multiple of the alignment, which can be checked with aligned(), so the
+/// kernels must use unaligned loads on the matrix.
+///
+/// \tparam Format The format of the matrix.
+template <uint8_t Format>
+class MappedMatrix {
+ public:
+  /// Defines the type of the matrix.
+  using MatrixType = Matrix<Format>;
+
+  /// Defines the type of each of the channels of an element.
+  using ElementType = typename format_traits<Format>::element_type;
+
+  /// Open operation: Maps a binary PGM image file. Only the greyscale format
+  /// can be mapped, since the RGB channel order of PPM images can't be used
+  /// as BGR without a copy -- RowBandReader decodes PPM images. Returns 
+  /// false if the file can't be mapped, or is not a valid image with the
+  /// format of the matrix.
+  /// \param[in] path The path to the image file.
+  bool openPnm(const std::string& path);
+
+  /// Open operation: Maps a raw image file, with \p rows rows of \p cols 
+  /// elements in the format of the matrix starting at byte \p offset.
+  /// Returns false if the file can't be mapped or is too small.
+  /// \param[in] path   The path to the image file.
+  /// \param[in] rows   The number of rows in the image.
+  /// \param[in] cols   The number of columns in the image.
+  /// \param[in] offset The offset of the first element in the file.
+  bool openRaw(const std::string& path, size_t rows, size_t cols, 
+               size_t offset = 0);
+
+  /// Close operation: Unmaps the image file and empties the matrix.
+  void close() { 
+    View = MatrixType();
+    File.close();
+  }
+
+  /// Returns true if an image is mapped.
+  bool isOpen() const { return File.isOpen(); }
+
+  /// Returns true if the matrix data is aligned for aligned vector loads.
+  bool aligned() const {
+    return reinterpret_cast<uintptr_t>(View.data()) % ALIGNMENT == 0;
+  }
+
+  /// Matrix operation: Gets the matrix which wraps the mapped image.
+  const MatrixType& matrix() const { return View; }
+
+  /// File operation: Gets the mapped image file.
+  const MappedFile& file() const { return File; }
+
+ private:
+  MappedFile File;  //!< The mapped image file.
+  MatrixType View;  //!< The matrix which wraps the mapped samples.
+
+  /// Wraps the mapped samples from \p offset, if the file is big enough.
+  /// \param[in] rows   The number of rows in the image.
+  /// \param[in] cols   The number of columns in the image.
+  /// \param[in] offset The offset of the first element in the file.
+  bool wrap(size_t rows, size_t cols, size_t offset);
+};
+
+// ---- Implementation ----------------------------------------------------- //
+
+template <uint8_t F>
+bool MappedMatrix<F>::openPnm(const std::string& path) {
+  close();
+  if (!File.open(path))
+    return false;
+
+  PnmHeader header;
+  if (F != mat::FM_GREY_8 || 
+      !parse_pnm_header(File.data(), File.size(), header) ||
+      header.channels != 1) {
+    close();
+    return false;
+  }
+  return wrap(header.height, header.width, header.dataOffset);
+}
+
+template <uint8_t F>
+bool MappedMatrix<F>::openRaw(const std::string& path, size_t rows, 
+                              size_t cols, size_t offset) {
+  close();
+  return File.open(path) && wrap(rows, cols, offset);
+}
+
+template <uint8_t F>
+bool MappedMatrix<F>::wrap(size_t rows, size_t cols, size_t offset) {
+  // Each column takes at least a byte, so bounding the columns by the size 
+  // of the file keeps the row size from overflowing, and dividing by the
+  // rows keeps the image size from overflowing.
+  if (rows == 0 || cols == 0 || offset > File.size() || 
+      cols > File.size() - offset ||
+      format_traits<F>::stride(cols) * sizeof(ElementType) > 
+        (File.size() - offset) / rows) {
+    close();
+    return false;
+  }
+
+  // The mapping is read-only, which the const accessors of the view enforce.
+  View = MatrixType(rows, cols, reinterpret_cast<ElementType*>(
+                      const_cast<uint8_t*>(File.data() + offset)));
+  return true;
+}
+
+} // namespace io
+} // namespace snap
+
+#endif // SNAP_IO_MAPPED_MATRIX_HPP
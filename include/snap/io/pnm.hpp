@@ -0,0 +1,115 @@
+//---- snap/io/pnm.hpp ------------------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  pnm.hpp
+/// \brief Defines parsing of the headers of binary PGM (P5) and PPM (P6)
+///        images with 8-bit samples.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_IO_PNM_HPP
+#define SNAP_IO_PNM_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace snap {
+namespace io   {
+
+/// Defines the header of a binary PGM or PPM image.
+struct PnmHeader {
+  size_t width;       //!< The number of columns in the image.
+  size_t height;      //!< The number of rows in the image.
+  size_t maxval;      //!< The maximum sample value.
+  size_t channels;    //!< The number of channels, 1 for PGM and 3 for PPM.
+  size_t dataOffset;  //!< The offset of the first sample in the file.
+};
+
+namespace detail {
+
+/// Returns true if \p c is a PNM whitespace character.
+/// \param[in] c The character to check.
+static constexpr bool is_pnm_space(uint8_t c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || 
+         c == '\f';
+}
+
+/// The bound on each field of a PNM header, which keeps the image size from
+/// overflowing when the dimensions are multiplied.
+static constexpr size_t PNM_FIELD_LIMIT = size_t(1) << 31;
+
+/// Parses the next unsigned integer field of a PNM header from \p data,
+/// starting at offset \p pos, skipping any leading whitespace and comments.
+/// Returns false if there is no valid field, or if the field is not less 
+/// than PNM_FIELD_LIMIT.
+/// \param[in] data  The header data.
+/// \param[in] size  The number of bytes of data.
+/// \param[in] pos   The offset to start parsing from, which is updated to 
+///                  one past the end of the field.
+/// \param[in] value The value of the field.
+static inline bool parse_pnm_field(const uint8_t* data, size_t size, 
+                                   size_t& pos, size_t& value) {
+  while (pos < size && (is_pnm_space(data[pos]) || data[pos] == '#')) {
+    if (data[pos] == '#') {
+      while (pos < size && data[pos] != '\n' && data[pos] != '\r') 
+        ++pos;
+    } else {
+      ++pos;
+    }
+  }
+
+  const size_t start = pos;
+  value = 0;
+  while (pos < size && data[pos] >= '0' && data[pos] <= '9') {
+    value = value * 10 + (data[pos++] - '0');
+    if (value >= PNM_FIELD_LIMIT)
+      return false;
+  }
+  return pos > start && pos < size && is_pnm_space(data[pos]);
+}
+
+} // namespace detail
+
+/// Parses the header of a binary PGM (P5) or PPM (P6) image from \p data.
+/// Returns false if the header is not valid, if the samples are not 8-bit
+/// (maxval > 255), or if \p data is too small to hold all the samples.
+/// \param[in] data   A pointer to the start of the image file.
+/// \param[in] size   The size of the image file, in bytes.
+/// \param[in] header The parsed header.
+static inline bool parse_pnm_header(const uint8_t* data, size_t size, 
+                                    PnmHeader& header) {
+  if (size < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '6'))
+    return false;
+
+  header.channels = data[1] == '5' ? 1 : 3;
+
+  size_t pos = 2;
+  if (!detail::parse_pnm_field(data, size, pos, header.width)  ||
+      !detail::parse_pnm_field(data, size, pos, header.height) ||
+      !detail::parse_pnm_field(data, size, pos, header.maxval))
+    return false;
+
+  // A single whitespace character separates the header from the samples.
+  header.dataOffset = pos + 1;
+
+  // Dividing the available bytes, rather than multiplying the dimensions,
+  // means that the size check can't overflow.
+  return header.width > 0 && header.height > 0 && 
+         header.maxval > 0 && header.maxval <= 255 &&
+         header.dataOffset <= size && 
+         header.width <= 
+           (size - header.dataOffset) / header.height / header.channels;
+}
+
+} // namespace io
+} // namespace snap
+
+#endif // SNAP_IO_PNM_HPP
@@ -15,8 +15,10 @@
 //---------------------------------------------------------------------------//
 
 #ifndef SNAP_MATRIX_MATRIX_HPP
-#define SNAP_MATRix_MATRIX_HPP
+#define SNAP_MATRIX_MATRIX_HPP
 
+// The matrix implementation only uses the Vector interface, so it is shared
+// by all the backends.
 #include "matrix_sse.hpp"
 
 #endif // SNAP_MATRIX_MATRIX_HPP
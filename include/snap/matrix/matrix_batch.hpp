@@ -0,0 +1,220 @@
+//---- snap/matrix/matrix_batch.hpp ------------------------ -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  matrix_batch.hpp
+/// \brief Defines a batch of matrices with the same format and dimensions,
+///        which are stored in a single aligned allocation.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_MATRIX_MATRIX_BATCH_HPP
+#define SNAP_MATRIX_MATRIX_BATCH_HPP
+
+#include "matrix.hpp"
+#include <algorithm>
+
+namespace snap {
+
+/// Defines a batch of frames with the same format and dimensions. Rather
+/// than an array of matrices, each with its own allocation, the frames are
+/// stored one after the other in a single allocation, so that kernels can
+/// process the whole batch in one call, sharing any setup between frames,
+/// and can split the frames and the rows of the frames across threads.
+///
+/// Each frame starts on a cache line boundary, so the frames are aligned
+/// and threads which write to different frames never write to the same
+/// cache line. Each frame can be accessed as a Matrix which wraps the frame
+/// data without copying it.
+///
+/// \tparam Format    The format of the frames.
+/// \tparam Allocator The allocator for the data.
+template <
+  uint8_t  Format, 
+  typename Allocator = AlignedAllocator<typename format_traits<Format>::type>
+  >
+class MatrixBatch {
+ public:
+  /// The data type of each vectorized element in the batch.
+  using DataType    = typename format_traits<Format>::type;
+
+  /// The data type of each channel of each element in the batch.
+  using ElementType = typename format_traits<Format>::element_type;
+
+  /// The type of the matrix which wraps a frame.
+  using MatrixType  = Matrix<Format, Allocator>;
+
+  /// Defines the alignment of the start of each frame, in bytes.
+  static constexpr size_t FRAME_ALIGNMENT = 64;
+
+  /// Constructor: Creates an empty batch.
+  MatrixBatch() : Data(nullptr), Count(0), Rows(0), Cols(0) {}
+
+  /// Constructor: Creates a batch of \p count frames of a specific size.
+  /// \param[in] count The number of frames in the batch.
+  /// \param[in] rows  The number of rows in each frame.
+  /// \param[in] cols  The number of columns in each frame.
+  MatrixBatch(size_t count, size_t rows, size_t cols);
+
+  /// Constructor: Moves the data from \p other, which is left empty.
+  /// \param[in] other The batch to move from.
+  MatrixBatch(MatrixBatch&& other);
+
+  /// Assignment operator: Moves the data from \p other, which is left 
+  /// empty, freeing the data of this batch.
+  /// \param[in] other The batch to move from.
+  MatrixBatch& operator=(MatrixBatch&& other);
+
+  /// The batch owns its data, so it can't be copied.
+  MatrixBatch(const MatrixBatch&)            = delete;
+  MatrixBatch& operator=(const MatrixBatch&) = delete;
+
+  /// Destructor: Cleans up batch memory.
+  ~MatrixBatch();
+
+  /// Count operation: Gets the number of frames in the batch.
+  size_t count() const { return Count; }
+
+  /// Row size operation: Gets the number of rows in each frame.
+  size_t rows() const { return Rows; }
+
+  /// Col size operation: Gets the number of columns in each frame.
+  size_t cols() const { return Cols; }
+
+  /// Size operation: Gets the number of elements in each frame.
+  size_t size() const { return Rows * Cols; }
+
+  /// Stride operation: Gets the number of ElementType values between the
+  /// start of two consecutive rows of a frame.
+  size_t stride() const { return format_traits<Format>::stride(Cols); }
+
+  /// Frame stride operation: Gets the number of ElementType values between
+  /// the start of two consecutive frames.
+  size_t frameStride() const {
+    constexpr size_t alignment = FRAME_ALIGNMENT / sizeof(ElementType);
+    return (Rows * stride() + alignment - 1) / alignment * alignment;
+  }
+
+  /// Data operation: Gets a pointer to the first channel of the first
+  /// element of the first frame.
+  ElementType* data() { return reinterpret_cast<ElementType*>(Data); }
+
+  /// Data operation: Gets a const pointer to the first channel of the first
+  /// element of the first frame.
+  const ElementType* data() const { 
+    return reinterpret_cast<const ElementType*>(Data); 
+  }
+
+  /// Data operation: Gets a pointer to the first channel of the first 
+  /// element of frame \p n. This does not check bounds.
+  /// \param[in] n The index of the frame.
+  ElementType* data(size_t n) { return data() + n * frameStride(); }
+
+  /// Data operation: Gets a const pointer to the first channel of the first 
+  /// element of frame \p n. This does not check bounds.
+  /// \param[in] n The index of the frame.
+  const ElementType* data(size_t n) const { 
+    return data() + n * frameStride(); 
+  }
+
+  /// Frame operation: Gets a matrix which wraps frame \p n, without copying
+  /// it. The matrix is valid for the lifetime of the batch.
+  /// \param[in] n The index of the frame.
+  MatrixType frame(size_t n) { return MatrixType(Rows, Cols, data(n)); }
+
+  /// Frame operation: Gets a read-only matrix which wraps frame \p n, 
+  /// without copying it. The matrix is valid for the lifetime of the batch.
+  /// \param[in] n The index of the frame.
+  const MatrixType frame(size_t n) const { 
+    return MatrixType(Rows, Cols, const_cast<ElementType*>(data(n))); 
+  }
+
+  /// Access operator: Gets a reference to the first channel of the element
+  /// at row \p r and column \p c of frame \p n. This does not check bounds.
+  /// \param[in] n The index of the frame.
+  /// \param[in] r The row of the element.
+  /// \param[in] c The column of the element.
+  ElementType& operator()(size_t n, size_t r, size_t c) {
+    return data(n)[r * stride() + c * format_traits<Format>::channels];
+  }
+
+  /// Access operator: Gets the value of the first channel of the element at
+  /// row \p r and column \p c of frame \p n. This does not check bounds.
+  /// \param[in] n The index of the frame.
+  /// \param[in] r The row of the element.
+  /// \param[in] c The column of the element.
+  ElementType operator()(size_t n, size_t r, size_t c) const {
+    return data(n)[r * stride() + c * format_traits<Format>::channels];
+  }
+
+ private:
+  DataType*  Data;    //!< Pointer to the raw vectorized data.
+  size_t     Count;   //!< Number of frames in the batch.
+  size_t     Rows;    //!< Number of rows in each frame.
+  size_t     Cols;    //!< Number of columns in each frame.
+};
+
+// ---- Implementation ----------------------------------------------------- //
+
+template <uint8_t F, typename A>
+constexpr size_t MatrixBatch<F, A>::FRAME_ALIGNMENT;
+
+template <uint8_t F, typename A>
+MatrixBatch<F, A>::MatrixBatch(size_t count, size_t rows, size_t cols)
+    : Count(count), Rows(rows), Cols(cols) {
+  using Allocator = A;
+
+  // The frame stride is a multiple of the frame alignment, so the total size
+  // is a multiple of the alignment of the vectorized data.
+  Data = Allocator::alloc(
+    std::max<size_t>(Count * frameStride() * sizeof(ElementType), 
+                     FRAME_ALIGNMENT),
+    FRAME_ALIGNMENT
+  );
+}
+
+template <uint8_t F, typename A>
+MatrixBatch<F, A>::MatrixBatch(MatrixBatch&& other) 
+    : Data(other.Data), Count(other.Count), Rows(other.Rows), 
+      Cols(other.Cols) {
+  other.Data  = nullptr;
+  other.Count = other.Rows = other.Cols = 0;
+}
+
+template <uint8_t F, typename A>
+MatrixBatch<F, A>& MatrixBatch<F, A>::operator=(MatrixBatch&& other) {
+  using Allocator = A;
+
+  if (this != &other) {
+    if (Data != nullptr)
+      Allocator::free(Data);
+
+    Data  = other.Data;
+    Count = other.Count;
+    Rows  = other.Rows;
+    Cols  = other.Cols;
+
+    other.Data  = nullptr;
+    other.Count = other.Rows = other.Cols = 0;
+  }
+  return *this;
+}
+
+template <uint8_t F, typename A>
+MatrixBatch<F, A>::~MatrixBatch() {
+  using Allocator = A;
+
+  if (Data != nullptr) 
+    Allocator::free(Data);
+}
+
+} // namespace snap
+
+#endif // SNAP_MATRIX_MATRIX_BATCH_HPP
@@ -18,6 +18,9 @@
 #ifndef SNAP_MATRIX_MATRIX_GENERAL_HPP
 #define SNAP_MATRIX_MATRIX_GENERAL_HPP
 
+#include <cstddef>
+#include <cstdint>
+
 namespace snap {
 namespace mat  {
 
@@ -25,11 +28,33 @@ namespace mat  {
 enum Format : uint8_t {
   FM_GREY_8  = 0,
   FM_BGR_24  = 1, 
-  FM_BGRA_32 = 2
+  FM_BGRA_32 = 2,
+  FM_BIN_1   = 3
 };
 
 } // namespace mat
 
+/// Defines the location of an element in a matrix.
+struct Point {
+  size_t x;   //!< The column of the element.
+  size_t y;   //!< The row of the element.
+};
+
+/// Defines a rectangular region of interest in a matrix.
+struct Rect {
+  size_t x;       //!< The column of the top left element.
+  size_t y;       //!< The row of the top left element.
+  size_t width;   //!< The number of columns in the region.
+  size_t height;  //!< The number of rows in the region.
+};
+
+/// Defines the number of elements reserved around each side of a matrix,
+/// which stencil kernels can read instead of checking bounds. This is a
+/// type rather than a size so that the constructors can't be confused.
+struct Halo {
+  size_t size;  //!< The number of elements on each side.
+};
+
 /// Defines a metaclass to get traits for a specific format.
 /// \tparam Format The format to get the traits of.
 template <uint8_t Format>
@@ -30,6 +30,70 @@ template <>
 struct format_traits<mat::FM_GREY_8> {
   /// Defines the data type used for 8-bit greyscale values.
   using type = Vec16x8u;
+
+  /// Defines the type of each of the channels of an element.
+  using element_type = uint8_t;
+
+  /// Defines the number of channels per element.
+  static constexpr size_t channels = 1;
+
+  /// Returns the number of element_type values in a row of \p cols elements.
+  static constexpr size_t stride(size_t cols) { return cols * channels; }
+};
+
+// Specialization for when the format is 24-bit BGR, with 3 interleaved 8-bit
+// channels per element.
+template <>
+struct format_traits<mat::FM_BGR_24> {
+  /// Defines the data type used for the vectorized channel values.
+  using type = Vec16x8u;
+
+  /// Defines the type of each of the channels of an element.
+  using element_type = uint8_t;
+
+  /// Defines the number of channels per element.
+  static constexpr size_t channels = 3;
+
+  /// Returns the number of element_type values in a row of \p cols elements.
+  static constexpr size_t stride(size_t cols) { return cols * channels; }
+};
+
+// Specialization for when the format is 32-bit BGRA, with 4 interleaved 8-bit
+// channels per element, so that a vector holds 4 whole elements.
+template <>
+struct format_traits<mat::FM_BGRA_32> {
+  /// Defines the data type used for the vectorized channel values.
+  using type = Vec16x8u;
+
+  /// Defines the type of each of the channels of an element.
+  using element_type = uint8_t;
+
+  /// Defines the number of channels per element.
+  static constexpr size_t channels = 4;
+
+  /// Returns the number of element_type values in a row of \p cols elements.
+  static constexpr size_t stride(size_t cols) { return cols * channels; }
+};
+
+// Specialization for when the format is a binary mask, with one bit per
+// element. Bit k of byte j of a row is the element in column 8j + k, and the
+// rows are padded to a whole number of 64-bit words, so that the kernels can
+// process 64 elements at a time. The padding bits have unspecified values,
+// and the kernels ignore them, so element access must use the functions in
+// snap/algorithm/binary.hpp rather than the access operators.
+template <>
+struct format_traits<mat::FM_BIN_1> {
+  /// Defines the data type used for the vectorized values.
+  using type = Vec16x8u;
+
+  /// Defines the type of the storage of each group of 8 elements.
+  using element_type = uint8_t;
+
+  /// Defines the number of channels per element.
+  static constexpr size_t channels = 1;
+
+  /// Returns the number of bytes in a row of \p cols elements.
+  static constexpr size_t stride(size_t cols) { return (cols + 63) / 64 * 8; }
 };
 
 /// Defines a matrix class for which SIMD operations can be used to improve
@@ -56,7 +120,10 @@ template <
 class Matrix {
  public:
   /// The data type of each vectorized element in the matrix.
-  using DataType  = typename format_traits<Format>::type;
+  using DataType    = typename format_traits<Format>::type;
+
+  /// The data type of each channel of each element in the matrix.
+  using ElementType = typename format_traits<Format>::element_type;
 
   /// Constructor: Creates an empty matrix.
   Matrix();
@@ -64,9 +131,46 @@ class Matrix {
   /// Constructor: Creates a matrix with a specific size.
   Matrix(size_t rows, size_t cols);
 
+  /// Constructor: Creates a matrix with a specific size, and a halo of
+  /// elements around it, which are at negative and past the end indices of
+  /// the rows and columns, and which are set with alg::fill_border. The
+  /// rows are padded to a multiple of ALIGNMENT, the first element of each
+  /// row is aligned, and there are at least ALIGNMENT values around each
+  /// side, so that vector loops over the rows and the halo need no bounds
+  /// checks.
+  /// \param[in] rows The number of rows in the matrix.
+  /// \param[in] cols The number of columns in the matrix.
+  /// \param[in] halo The number of elements around each side.
+  Matrix(size_t rows, size_t cols, Halo halo);
+
+  /// Constructor: Creates a matrix which wraps existing data, without
+  /// copying it. The matrix does not own the data, which must outlive the
+  /// matrix, and which does not need to be aligned.
+  /// \param[in] rows The number of rows in the data.
+  /// \param[in] cols The number of columns in the data.
+  /// \param[in] data A pointer to the first channel of the first element.
+  Matrix(size_t rows, size_t cols, ElementType* data);
+
+  /// Constructor: Moves the data from \p other, which is left empty.
+  /// \param[in] other The matrix to move from.
+  Matrix(Matrix&& other);
+
+  /// Assignment operator: Moves the data from \p other, which is left 
+  /// empty, freeing the data of this matrix.
+  /// \param[in] other The matrix to move from.
+  Matrix& operator=(Matrix&& other);
+
+  /// The matrix owns its data, so it can't be copied.
+  Matrix(const Matrix&)            = delete;
+  Matrix& operator=(const Matrix&) = delete;
+
   /// Destructor: Cleans up matrix memory.
   ~Matrix();
 
+  /// Owner operation: Returns true if the matrix owns its data, and false if
+  /// it wraps existing data.
+  bool owner() const { return Owner; }
+
   /// Row size operation: Gets the number of rows in the matrix.
   size_t rows() const { return Rows; }
 
@@ -74,16 +178,56 @@ class Matrix {
   size_t cols() const { return Cols; }
 
   /// Size operation: Gets the total number of elements in the matrix.
-  size_t size() const { 
-    return (Rows * Cols % ALIGNMENT == 0) 
-      ? Rows * Cols 
-      : Rows * Cols / ALIGNMENT + 1; 
+  size_t size() const { return Rows * Cols; }
+
+  /// Halo operation: Gets the number of halo elements around each side of
+  /// the matrix.
+  size_t halo() const { return HaloSize; }
+
+  /// Stride operation: Gets the number of ElementType values between the
+  /// start of two consecutive rows.
+  size_t stride() const { return Stride; }
+
+  /// Data operation: Gets a pointer to the first channel of the first
+  /// element in the matrix, which is after the halo.
+  ElementType* data() { 
+    return reinterpret_cast<ElementType*>(Data) + Offset; 
+  }
+
+  /// Data operation: Gets a const pointer to the first channel of the first
+  /// element in the matrix, which is after the halo.
+  const ElementType* data() const { 
+    return reinterpret_cast<const ElementType*>(Data) + Offset; 
+  }
+
+  /// Access operator: Gets a reference to the first channel of the element
+  /// at row \p r and column \p c. This does not check bounds.
+  /// \param[in] r The row of the element.
+  /// \param[in] c The column of the element.
+  ElementType& operator()(size_t r, size_t c) {
+    return data()[r * stride() + c * format_traits<Format>::channels];
+  }
+
+  /// Access operator: Gets the value of the first channel of the element at
+  /// row \p r and column \p c. This does not check bounds.
+  /// \param[in] r The row of the element.
+  /// \param[in] c The column of the element.
+  ElementType operator()(size_t r, size_t c) const {
+    return data()[r * stride() + c * format_traits<Format>::channels];
   }
 
  private:
-  DataType*  Data;    //!< Pointer to the raw matrix vectorized data. 
-  size_t     Rows;    //!< Number of rows in the matrix.
-  size_t     Cols;    //!< Number of columns in the matrix.
+  DataType*  Data;     //!< Pointer to the raw matrix vectorized data. 
+  size_t     Rows;     //!< Number of rows in the matrix.
+  size_t     Cols;     //!< Number of columns in the matrix.
+  size_t     HaloSize; //!< Number of halo elements around each side.
+  size_t     Stride;   //!< Number of values between row starts.
+  size_t     Offset;   //!< Number of values before the first element.
+  bool       Owner;    //!< If the matrix must free the data.
+
+  /// Allocates \p bytes bytes, rounded up to a multiple of ALIGNMENT.
+  /// \param[in] bytes The number of bytes to allocate.
+  static DataType* allocate(size_t bytes);
 };
 
 
@@ -91,30 +235,98 @@ class Matrix {
 
 
 template <uint8_t F, typename A>
-Matrix<F, A>::Matrix() : Data(nullptr), Rows(0), Cols(0) {}
+Matrix<F, A>::Matrix() 
+    : Data(nullptr), Rows(0), Cols(0), HaloSize(0), Stride(0), Offset(0), 
+      Owner(false) {}
 
 template <uint8_t F, typename A>
 Matrix<F, A>::Matrix(size_t rows, size_t cols)
-    : Rows(rows), Cols(cols) {
+    : Rows(rows), Cols(cols), HaloSize(0), 
+      Stride(format_traits<F>::stride(cols)), Offset(0), Owner(true) {
+  Data = allocate(Rows * Stride * sizeof(ElementType));
+}
+
+template <uint8_t F, typename A>
+Matrix<F, A>::Matrix(size_t rows, size_t cols, Halo halo)
+    : Rows(rows), Cols(cols), HaloSize(halo.size), Owner(true) {
+  static_assert(F != mat::FM_BIN_1, "FM_BIN_1 matrices can't have a halo!");
+  constexpr size_t channels = format_traits<F>::channels;
+  constexpr size_t aligned  = ALIGNMENT / sizeof(ElementType);
+
+  // The rows are padded so that each row start is aligned if the first is,
+  // and the first element is aligned by the values in front of the halo.
+  // There are at least ALIGNMENT values in front of and behind each row, so
+  // that a side halo narrower than a vector can be set with one store.
+  const size_t side  = HaloSize * channels;
+  const size_t front = (side + aligned - 1) / aligned * aligned;
+  const size_t back  = side == 0 ? 0 : (side < aligned ? aligned : side);
+  const size_t width = format_traits<F>::stride(Cols) + back;
+  Stride = front + (width + aligned - 1) / aligned * aligned;
+  Offset = HaloSize * Stride + front;
+  Data   = allocate(
+    (Offset + (Rows + HaloSize) * Stride) * sizeof(ElementType));
+}
+
+template <uint8_t F, typename A>
+Matrix<F, A>::Matrix(size_t rows, size_t cols, ElementType* data)
+    : Data(reinterpret_cast<DataType*>(data)), Rows(rows), Cols(cols), 
+      HaloSize(0), Stride(format_traits<F>::stride(cols)), Offset(0), 
+      Owner(false) {}
+
+template <uint8_t F, typename A>
+Matrix<F, A>::Matrix(Matrix&& other) 
+    : Data(other.Data), Rows(other.Rows), Cols(other.Cols), 
+      HaloSize(other.HaloSize), Stride(other.Stride), Offset(other.Offset),
+      Owner(other.Owner) {
+  other.Data     = nullptr;
+  other.Rows     = other.Cols = 0;
+  other.HaloSize = other.Stride = other.Offset = 0;
+  other.Owner    = false;
+}
+
+template <uint8_t F, typename A>
+Matrix<F, A>& Matrix<F, A>::operator=(Matrix&& other) {
   using Allocator = A;
 
-  const size_t totalElements = Rows * Cols;
-  const size_t alignmentDiff = totalElements % ALIGNMENT;
+  if (this != &other) {
+    if (Owner && Data != nullptr)
+      Allocator::free(Data);
 
-  Data = Allocator::alloc(
-    totalElements + (alignmentDiff == 0 ? 0 : ALIGNMENT - alignmentDiff),
-    ALIGNMENT
-  );
+    Data     = other.Data;
+    Rows     = other.Rows;
+    Cols     = other.Cols;
+    HaloSize = other.HaloSize;
+    Stride   = other.Stride;
+    Offset   = other.Offset;
+    Owner    = other.Owner;
+
+    other.Data     = nullptr;
+    other.Rows     = other.Cols = 0;
+    other.HaloSize = other.Stride = other.Offset = 0;
+    other.Owner    = false;
+  }
+  return *this;
 }
 
 template <uint8_t F, typename A>
 Matrix<F, A>::~Matrix() {
   using Allocator = A;
 
-  if (Data != nullptr) 
+  if (Owner && Data != nullptr) 
     Allocator::free(Data);
 }
 
+template <uint8_t F, typename A>
+typename Matrix<F, A>::DataType* Matrix<F, A>::allocate(size_t bytes) {
+  using Allocator = A;
+
+  const size_t alignmentDiff = bytes % ALIGNMENT;
+  return Allocator::alloc(
+    bytes + (alignmentDiff == 0 ? 0 : ALIGNMENT - alignmentDiff),
+    ALIGNMENT
+  );
+}
+
 } // namespace snap
 
 #endif // SNAP_MATRIX_MATRIX_SSE_HPP
@@ -0,0 +1,235 @@
+//---- snap/utility/hardware_counters.hpp ------------------ -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  hardware_counters.hpp
+/// \brief Defines reading of hardware performance counters (cycles, 
+///        instructions, cache misses and branch misses) around a section of
+///        code, using the Linux perf_event_open interface. The counters are
+///        often unavailable, for example in containers or when the kernel
+///        restricts access, in which case open() fails with a reason and the
+///        values are marked as invalid, rather than stopping the program.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_UTILITY_HARDWARE_COUNTERS_HPP
+#define SNAP_UTILITY_HARDWARE_COUNTERS_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__linux__)
+ #include <cerrno>
+ #include <linux/perf_event.h>
+ #include <sys/ioctl.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#endif
+
+namespace snap {
+namespace util {
+namespace perf {
+
+/// Defines the hardware events which can be counted.
+enum HardwareEvent : uint8_t {
+  HE_CYCLES        = 0,   //!< CPU cycles.
+  HE_INSTRUCTIONS  = 1,   //!< Retired instructions.
+  HE_L1D_MISSES    = 2,   //!< Level 1 data cache read misses.
+  HE_LLC_MISSES    = 3,   //!< Last level cache misses.
+  HE_BRANCH_MISSES = 4,   //!< Mispredicted branches.
+  HE_COUNT         = 5    //!< The number of events.
+};
+
+/// Defines the values of the hardware events counted over a section of code.
+/// Events which could not be counted are not valid.
+struct CounterValues {
+  uint64_t value[HE_COUNT];   //!< The count of each event.
+  bool     valid[HE_COUNT];   //!< If each count is valid.
+
+  /// Returns true if the count of \p event is valid.
+  /// \param[in] event The event to check.
+  bool has(HardwareEvent event) const { return valid[event]; }
+
+  /// Returns the instructions per cycle, or 0 if either count is invalid.
+  double ipc() const {
+    return has(HE_CYCLES) && has(HE_INSTRUCTIONS) && value[HE_CYCLES] != 0
+      ? double(value[HE_INSTRUCTIONS]) / value[HE_CYCLES] : 0.0;
+  }
+};
+
+/// Defines a set of hardware counters, one for each HardwareEvent, which
+/// count the events of the calling thread and of the threads it creates 
+/// while the counters are running, in user space only. Each event is opened
+/// separately, so that events which a machine does not support do not stop
+/// the others from being counted. When the kernel multiplexes the counters,
+/// the counts are scaled by the fraction of the time each was running.
+class HardwareCounters {
+ public:
+  /// Constructor: Creates counters which are not open.
+  HardwareCounters() {
+    for (auto& fd : Fds) fd = -1;
+  }
+
+  /// Destructor: Closes the counters.
+  ~HardwareCounters() { close(); }
+
+  /// The counters own file descriptors, so they can't be copied.
+  HardwareCounters(const HardwareCounters&)            = delete;
+  HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+  /// Open operation: Opens the counters for each event. Returns true if any
+  /// of the events can be counted, otherwise the reason is given by error().
+  bool open();
+
+  /// Close operation: Closes the counters.
+  void close();
+
+  /// Returns true if any of the events can be counted.
+  bool available() const { 
+    for (const auto fd : Fds) 
+      if (fd >= 0) return true;
+    return false;
+  }
+
+  /// Returns true if \p event can be counted.
+  /// \param[in] event The event to check.
+  bool available(HardwareEvent event) const { return Fds[event] >= 0; }
+
+  /// Returns the reason the first event which could not be opened failed.
+  const std::string& error() const { return Error; }
+
+  /// Start operation: Resets and starts the counters.
+  void start();
+
+  /// Stop operation: Stops the counters, and returns the counts since the
+  /// last call to start().
+  CounterValues stop();
+
+ private:
+  int         Fds[HE_COUNT];  //!< The file descriptor for each event.
+  std::string Error;          //!< The reason an event failed to open.
+};
+
+// ---- Implementation ----------------------------------------------------- //
+
+#if defined(__linux__)
+
+namespace detail {
+
+/// Returns the perf type and config of \p event.
+/// \param[in] event  The event to get the type and config of.
+/// \param[in] type   The perf type of the event.
+/// \param[in] config The perf config of the event.
+static inline void perf_event_config(HardwareEvent event, uint32_t& type, 
+                                     uint64_t& config) {
+  type = PERF_TYPE_HARDWARE;
+  switch (event) {
+    case HE_CYCLES       : config = PERF_COUNT_HW_CPU_CYCLES;       break;
+    case HE_INSTRUCTIONS : config = PERF_COUNT_HW_INSTRUCTIONS;     break;
+    case HE_LLC_MISSES   : config = PERF_COUNT_HW_CACHE_MISSES;     break;
+    case HE_BRANCH_MISSES: config = PERF_COUNT_HW_BRANCH_MISSES;    break;
+    default:
+      type   = PERF_TYPE_HW_CACHE;
+      config = PERF_COUNT_HW_CACHE_L1D                 | 
+               (PERF_COUNT_HW_CACHE_OP_READ     << 8)  |
+               (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  }
+}
+
+} // namespace detail
+
+inline bool HardwareCounters::open() {
+  close();
+  for (size_t i = 0; i < HE_COUNT; ++i) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.disabled       = 1;
+    attr.inherit        = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | 
+                          PERF_FORMAT_TOTAL_TIME_RUNNING;
+    uint32_t type; 
+    uint64_t config;
+    detail::perf_event_config(HardwareEvent(i), type, config);
+    attr.type   = type;
+    attr.config = config;
+
+    Fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+                                      0));
+    if (Fds[i] < 0 && Error.empty())
+      Error = std::string("perf_event_open: ") + std::strerror(errno);
+  }
+  return available();
+}
+
+inline void HardwareCounters::close() {
+  for (auto& fd : Fds) {
+    if (fd >= 0) 
+      ::close(fd);
+    fd = -1;
+  }
+  Error.clear();
+}
+
+inline void HardwareCounters::start() {
+  for (const auto fd : Fds) {
+    if (fd < 0) continue;
+    ioctl(fd, PERF_EVENT_IOC_RESET , 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+inline CounterValues HardwareCounters::stop() {
+  for (const auto fd : Fds)
+    if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+  CounterValues values;
+  for (size_t i = 0; i < HE_COUNT; ++i) {
+    // The value, the time enabled and the time running.
+    uint64_t data[3] = {0, 0, 0};
+    values.valid[i] = Fds[i] >= 0 && 
+      read(Fds[i], data, sizeof(data)) == ssize_t(sizeof(data)) && 
+      data[2] != 0;
+    values.value[i] = values.valid[i] 
+      ? uint64_t(double(data[0]) * data[1] / data[2]) : 0;
+  }
+  return values;
+}
+
+#else
+
+inline bool HardwareCounters::open() {
+  Error = "hardware counters are only supported on Linux";
+  return false;
+}
+
+inline void HardwareCounters::close() {}
+
+inline void HardwareCounters::start() {}
+
+inline CounterValues HardwareCounters::stop() {
+  CounterValues values;
+  for (size_t i = 0; i < HE_COUNT; ++i) {
+    values.value[i] = 0;
+    values.valid[i] = false;
+  }
+  return values;
+}
+
+#endif // __linux__
+
+} // namespace perf
+} // namespace util
+} // namespace snap
+
+#endif // SNAP_UTILITY_HARDWARE_COUNTERS_HPP
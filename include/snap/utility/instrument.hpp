@@ -0,0 +1,379 @@
+//---- snap/utility/instrument.hpp ------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  instrument.hpp
+/// \brief Defines opt-in instrumentation of the kernels, which records the
+///        number of calls, the number of elements and bytes processed, and
+///        the time spent in each kernel.
+///
+///        The instrumentation is enabled by defining SNAP_INSTRUMENT before
+///        including any snap headers (or with the INSTRUMENT CMake option).
+///        When it is not defined, the SNAP_INSTRUMENT_KERNEL macro expands
+///        to nothing, so its arguments are never evaluated and the kernels
+///        are exactly the same as without the instrumentation.
+///
+///        When enabled, each thread records into its own counters, which
+///        only that thread writes, so recording needs no locks or atomic
+///        read-modify-write instructions. Snapshots sum the counters of all
+///        the threads, including threads which have exited.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_UTILITY_INSTRUMENT_HPP
+#define SNAP_UTILITY_INSTRUMENT_HPP
+
+#include "snap/config/simd_instruction_detect.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(SNAP_INSTRUMENT)
+ #include <algorithm>
+ #include <atomic>
+ #include <chrono>
+ #include <mutex>
+ #if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+ #endif
+#endif
+
+namespace snap {
+namespace util {
+namespace inst {
+
+/// Defines the statistics recorded for a kernel.
+struct KernelStats {
+  std::string name;       //!< The name of the kernel.
+  uint64_t    calls;      //!< The number of calls to the kernel.
+  uint64_t    elements;   //!< The number of elements processed.
+  uint64_t    bytes;      //!< The number of bytes read and written.
+  uint64_t    ticks;      //!< The time spent in the kernel, in ticks.
+  double      seconds;    //!< The time spent in the kernel, in seconds.
+};
+
+/// Defines a snapshot of the statistics of all the instrumented kernels.
+using Snapshot = std::vector<KernelStats>;
+
+/// Returns true if the instrumentation is compiled in.
+static constexpr bool enabled() {
+#if defined(SNAP_INSTRUMENT)
+  return true;
+#else
+  return false;
+#endif
+}
+
+#if defined(SNAP_INSTRUMENT)
+
+/// Defines the max number of kernels which can be instrumented. Any kernels
+/// after this share the last slot.
+static constexpr size_t MAX_KERNELS = 128;
+
+namespace detail {
+
+/// Returns the current time in ticks, which is the time stamp counter on x86
+/// and nanoseconds of the steady clock otherwise.
+static SNAP_INLINE uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/// Defines the counters of a kernel for a single thread. Only the owning
+/// thread writes the counters, so the updates are a relaxed load and store,
+/// and the atomics only make the reads from snapshots well defined.
+struct Counter {
+  std::atomic<uint64_t> calls;      //!< The number of calls.
+  std::atomic<uint64_t> elements;   //!< The number of elements.
+  std::atomic<uint64_t> bytes;      //!< The number of bytes.
+  std::atomic<uint64_t> ticks;      //!< The number of ticks.
+
+  /// Adds \p value to \p counter, which only this thread writes.
+  /// \param[in] counter The counter to add to.
+  /// \param[in] value   The value to add.
+  static SNAP_INLINE void add(std::atomic<uint64_t>& counter,
+                              uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+  }
+};
+
+/// Defines the sums of the counters of a kernel.
+struct Totals {
+  uint64_t calls;      //!< The number of calls.
+  uint64_t elements;   //!< The number of elements.
+  uint64_t bytes;      //!< The number of bytes.
+  uint64_t ticks;      //!< The number of ticks.
+};
+
+/// Defines the counters of all the kernels for a single thread.
+struct ThreadCounters {
+  Counter kernels[MAX_KERNELS];   //!< The counters of each kernel.
+
+  /// Constructor: Sets all the counters to zero.
+  ThreadCounters() {
+    for (auto& kernel : kernels)
+      kernel.calls = kernel.elements = kernel.bytes = kernel.ticks = 0;
+  }
+};
+
+/// Defines the registry of the kernel names and the counters of all the
+/// threads. The mutex is only taken when a kernel is first used, when a
+/// thread records for the first time or exits, and for snapshots.
+class Registry {
+ public:
+  /// Returns the registry, which is never destroyed, so that threads which
+  /// exit after static destruction can still detach.
+  static Registry& instance() {
+    static Registry* registry = new Registry();
+    return *registry;
+  }
+
+  /// Returns the index of the kernel with \p name, adding it if necessary.
+  /// \param[in] name The name of the kernel.
+  size_t kernelId(const char* name) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    const auto it = std::find(Names.begin(), Names.end(), name);
+    if (it != Names.end())
+      return it - Names.begin();
+    if (Names.size() == MAX_KERNELS)
+      return MAX_KERNELS - 1;
+    Names.push_back(name);
+    return Names.size() - 1;
+  }
+
+  /// Adds the counters of a thread to the registry.
+  /// \param[in] counters The counters of the thread.
+  void attach(ThreadCounters* counters) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Threads.push_back(counters);
+  }
+
+  /// Removes the counters of a thread which is exiting from the registry,
+  /// keeping their values.
+  /// \param[in] counters The counters of the thread.
+  void detach(ThreadCounters* counters) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    accumulate(*counters, Retired);
+    Threads.erase(std::find(Threads.begin(), Threads.end(), counters));
+  }
+
+  /// Returns the totals of each kernel since the last reset.
+  Snapshot snapshot() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    const auto   totals  = current();
+    const double seconds = tickSeconds();
+
+    Snapshot result;
+    for (size_t i = 0; i < Names.size(); ++i) {
+      const auto& t = totals[i];
+      const auto& b = Baseline[i];
+      const uint64_t elapsed = t.ticks - b.ticks;
+      result.push_back(KernelStats{Names[i], t.calls - b.calls,
+        t.elements - b.elements, t.bytes - b.bytes, elapsed, 
+        elapsed * seconds});
+    }
+    return result;
+  }
+
+  /// Makes the current totals the baseline for future snapshots. The
+  /// counters themselves are never written by other threads.
+  void reset() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Baseline = current();
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  std::mutex                   Mutex;        //!< Mutex for the registry.
+  std::vector<std::string>     Names;        //!< The names of the kernels.
+  std::vector<ThreadCounters*> Threads;      //!< The counters of each thread.
+  std::vector<Totals>          Retired;      //!< The totals of exited threads.
+  std::vector<Totals>          Baseline;     //!< The totals at the reset.
+  uint64_t                     StartTicks;   //!< The ticks at creation.
+  Clock::time_point            StartTime;    //!< The time at creation.
+
+  /// Constructor: Creates an empty registry.
+  Registry()
+  : Retired(MAX_KERNELS, Totals{0, 0, 0, 0}),
+    Baseline(MAX_KERNELS, Totals{0, 0, 0, 0}), StartTicks(ticks()),
+    StartTime(Clock::now()) {}
+
+  /// Adds the values of \p counters to \p totals.
+  /// \param[in] counters The counters to add.
+  /// \param[in] totals   The totals to add to.
+  static void accumulate(const ThreadCounters& counters,
+                         std::vector<Totals>&  totals) {
+    for (size_t i = 0; i < MAX_KERNELS; ++i) {
+      const auto& c = counters.kernels[i];
+      totals[i].calls    += c.calls.load(std::memory_order_relaxed);
+      totals[i].elements += c.elements.load(std::memory_order_relaxed);
+      totals[i].bytes    += c.bytes.load(std::memory_order_relaxed);
+      totals[i].ticks    += c.ticks.load(std::memory_order_relaxed);
+    }
+  }
+
+  /// Returns the totals of all the threads, including those which exited.
+  std::vector<Totals> current() const {
+    auto totals = Retired;
+    for (const auto* counters : Threads)
+      accumulate(*counters, totals);
+    return totals;
+  }
+
+  /// Returns the number of seconds per tick. For the time stamp counter
+  /// this is measured against the steady clock since the registry was
+  /// created, which assumes an invariant time stamp counter.
+  double tickSeconds() const {
+#if defined(__x86_64__) || defined(__i386__)
+    const uint64_t elapsedTicks = ticks() - StartTicks;
+    const double   elapsed      =
+      std::chrono::duration<double>(Clock::now() - StartTime).count();
+    return elapsedTicks == 0 ? 0.0 : elapsed / elapsedTicks;
+#else
+    return 1e-9;
+#endif
+  }
+};
+
+/// Defines the owner of the counters of a thread, which attaches them to
+/// the registry when the thread first records, and detaches them when the
+/// thread exits.
+class ThreadHandle {
+ public:
+  /// Constructor: Creates and attaches the counters of the thread.
+  ThreadHandle() : Counters(new ThreadCounters()) {
+    Registry::instance().attach(Counters);
+  }
+
+  /// Destructor: Detaches and frees the counters of the thread.
+  ~ThreadHandle() {
+    Registry::instance().detach(Counters);
+    delete Counters;
+  }
+
+  ThreadHandle(const ThreadHandle&)            = delete;
+  ThreadHandle& operator=(const ThreadHandle&) = delete;
+
+  /// Returns the counters of the thread.
+  ThreadCounters& counters() { return *Counters; }
+
+ private:
+  ThreadCounters* Counters;   //!< The counters of the thread.
+};
+
+/// Returns the counters of the calling thread.
+static inline ThreadCounters& thread_counters() {
+  static thread_local ThreadHandle handle;
+  return handle.counters();
+}
+
+/// Defines a timer which records a call to a kernel, with the time from its
+/// construction to its destruction, into the counters of the thread.
+class ScopedTimer {
+ public:
+  /// Constructor: Starts timing a call to a kernel.
+  /// \param[in] id       The index of the kernel.
+  /// \param[in] elements The number of elements the call processes.
+  /// \param[in] bytes    The number of bytes the call reads and writes.
+  ScopedTimer(size_t id, uint64_t elements, uint64_t bytes)
+  : Id(id), Elements(elements), Bytes(bytes), Start(ticks()) {}
+
+  /// Destructor: Records the call.
+  ~ScopedTimer() {
+    const uint64_t end     = ticks();
+    auto&          counter = thread_counters().kernels[Id];
+    Counter::add(counter.calls   , 1);
+    Counter::add(counter.elements, Elements);
+    Counter::add(counter.bytes   , Bytes);
+    Counter::add(counter.ticks   , end - Start);
+  }
+
+  ScopedTimer(const ScopedTimer&)            = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  size_t   Id;        //!< The index of the kernel.
+  uint64_t Elements;  //!< The number of elements processed.
+  uint64_t Bytes;     //!< The number of bytes read and written.
+  uint64_t Start;     //!< The ticks at the start of the call.
+};
+
+/// Returns the index of the kernel with \p name.
+/// \param[in] name The name of the kernel.
+static inline size_t kernel_id(const char* name) {
+  return Registry::instance().kernelId(name);
+}
+
+} // namespace detail
+
+/// Returns the statistics of all the kernels which have been called since
+/// the start of the program, or since the last reset.
+static inline Snapshot snapshot() {
+  return detail::Registry::instance().snapshot();
+}
+
+/// Resets the statistics of all the kernels, so that later snapshots only
+/// include calls after the reset.
+static inline void reset() { detail::Registry::instance().reset(); }
+
+#else
+
+/// Returns an empty snapshot, since the instrumentation is disabled.
+static inline Snapshot snapshot() { return Snapshot(); }
+
+/// Does nothing, since the instrumentation is disabled.
+static inline void reset() {}
+
+#endif // SNAP_INSTRUMENT
+
+/// Writes \p snapshot to \p stream as CSV, with a header row, and one row
+/// per kernel.
+/// \param[in] stream   The stream to write to.
+/// \param[in] snapshot The snapshot to write.
+static inline void write_csv(std::ostream& stream, const Snapshot& snapshot) {
+  stream << "kernel,calls,elements,bytes,ticks,seconds\n";
+  for (const auto& kernel : snapshot) {
+    stream << kernel.name     << ',' << kernel.calls << ','
+           << kernel.elements << ',' << kernel.bytes << ','
+           << kernel.ticks    << ',' << kernel.seconds << '\n';
+  }
+}
+
+} // namespace inst
+} // namespace util
+} // namespace snap
+
+// ---- Macros ------------------------------------------------------------- //
+
+#define SNAP_INSTRUMENT_CONCAT_IMPL(a, b) a##b
+#define SNAP_INSTRUMENT_CONCAT(a, b)      SNAP_INSTRUMENT_CONCAT_IMPL(a, b)
+
+/// Records the call of the enclosing scope as a call to the kernel \p name,
+/// which processes \p elements elements and reads and writes \p bytes bytes.
+/// The kernel is timed until the end of the scope. When SNAP_INSTRUMENT is
+/// not defined this expands to nothing.
+#if defined(SNAP_INSTRUMENT)
+ #define SNAP_INSTRUMENT_KERNEL(name, elements, bytes)                         \
+  static const size_t SNAP_INSTRUMENT_CONCAT(snapKernelId, __LINE__) =         \
+    ::snap::util::inst::detail::kernel_id(name);                               \
+  const ::snap::util::inst::detail::ScopedTimer                                \
+    SNAP_INSTRUMENT_CONCAT(snapKernelTimer, __LINE__)(                         \
+      SNAP_INSTRUMENT_CONCAT(snapKernelId, __LINE__), (elements), (bytes))
+#else
+ #define SNAP_INSTRUMENT_KERNEL(name, elements, bytes)
+#endif
+
+#endif // SNAP_UTILITY_INSTRUMENT_HPP
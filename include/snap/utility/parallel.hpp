@@ -0,0 +1,133 @@
+//---- snap/utility/parallel.hpp --------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  parallel.hpp
+/// \brief Defines utility functions for splitting work across threads.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_UTILITY_PARALLEL_HPP
+#define SNAP_UTILITY_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace snap {
+
+/// Defines the possible execution policies for algorithms which can split
+/// their work across multiple threads.
+enum ExecutionPolicy : uint8_t {
+  EP_SERIAL   = 0,        //!< Run on the calling thread.
+  EP_PARALLEL = 1         //!< Split the work across all hardware threads.
+};
+
+namespace util {
+namespace par  {
+
+namespace detail {
+
+/// Returns a reference to the number of threads requested with
+/// set_thread_count, which is 0 if no number has been requested.
+static inline std::atomic<size_t>& requested_threads() {
+  static std::atomic<size_t> threads(0);
+  return threads;
+}
+
+} // namespace detail
+
+/// Sets the number of threads to use for parallel execution. Setting the
+/// number of threads to 0 uses the number of hardware threads.
+/// \param[in] threads The number of threads to use.
+static inline void set_thread_count(size_t threads) {
+  detail::requested_threads() = threads;
+}
+
+/// Returns the number of threads which should be used for parallel execution,
+/// which is the number set with set_thread_count, or otherwise the number of
+/// hardware threads, or 1 if that can't be determined.
+static inline size_t thread_count() {
+  const size_t requested = detail::requested_threads();
+  if (requested != 0)
+    return requested;
+
+  const size_t threads = std::thread::hardware_concurrency();
+  return threads == 0 ? 1 : threads;
+}
+
+/// Returns the number of chunks to split \p elements elements into for the
+/// execution \p policy, such that each chunk has at least \p minChunkSize
+/// elements.
+/// \param[in] elements     The number of elements to split.
+/// \param[in] policy       The execution policy.
+/// \param[in] minChunkSize The minimum number of elements per chunk.
+static inline size_t chunk_count(size_t          elements    , 
+                                 ExecutionPolicy policy      , 
+                                 size_t          minChunkSize = 1) {
+  if (policy == EP_SERIAL || elements == 0)
+    return 1;
+
+  const size_t maxChunks = std::max<size_t>(elements / minChunkSize, 1);
+  return std::min(thread_count(), maxChunks);
+}
+
+/// Splits the range [\p begin, \p end) into \p chunks contiguous chunks of
+/// (almost) equal size, and calls \p f for each of the chunks, each on a
+/// separate thread. The calling thread processes the first chunk. The
+/// signature of \p f must be:
+///
+///   f(size_t chunkBegin, size_t chunkEnd, size_t chunkIndex)
+///
+/// The function returns once all chunks have been processed.
+///
+/// \param[in] begin  The start of the range.
+/// \param[in] end    The end of the range (exclusive).
+/// \param[in] chunks The number of chunks to split the range into.
+/// \param[in] f      The function to call for each chunk.
+/// \tparam    F      The type of the function.
+template <typename F>
+static inline void parallel_for(size_t begin, size_t end, size_t chunks,
+                                F&& f) {
+  if (end <= begin)
+    return;
+
+  const size_t elements = end - begin;
+  chunks = std::max<size_t>(std::min(chunks, elements), 1);
+
+  const size_t chunkSize = elements / chunks;
+  const size_t remainder = elements % chunks;
+
+  // The first remainder chunks get an additional element.
+  auto chunkStart = [&] (size_t chunk) {
+    return begin + chunk * chunkSize + std::min(chunk, remainder);
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(chunks - 1);
+  for (size_t chunk = 1; chunk < chunks; ++chunk) {
+    threads.emplace_back([&f, &chunkStart, chunk] {
+      f(chunkStart(chunk), chunkStart(chunk + 1), chunk);
+    });
+  }
+
+  f(chunkStart(0), chunkStart(1), size_t(0));
+
+  for (auto& thread : threads)
+    thread.join();
+}
+
+} // namespace par
+} // namespace util
+} // namespace snap
+
+#endif // SNAP_UTILITY_PARALLEL_HPP
@@ -18,12 +18,14 @@
 #define SNAP_UTILITY_PERFORMANCE_HPP  
 
 #include "traits.hpp"
+#include "snap/config/simd_instruction_detect.h"
+#include <utility>
 
 namespace snap {
 
 /// Defines a type which can be used in unrolled lambda functions as a variable
 /// . The class is designed spcifically for use with the unroll functions, but
-/// can be used as an 8 bit unsigned integer.
+/// can be used as an unsigned integer.
 class UnrollIndex {
  public:
   /// Constructor: Sets the value of the unrolling index to 0.
@@ -31,85 +33,91 @@ class UnrollIndex {
 
   /// Constructor: Allows the value of the unrolling index to be set.
   /// \param[in] value The value to set the unrolling index to.
-  constexpr UnrollIndex(uint8_t value) : Value(value) {}
+  constexpr UnrollIndex(size_t value) : Value(value) {}
 
-  /// Operator uint8_t: Allows the unrolling constant to be used as an 8-bit
-  /// unsigned integer, and as a constexpr value where it is defined to be
-  /// such.
-  constexpr operator uint8_t() const { return Value; }
+  /// Operator size_t: Allows the unrolling constant to be used as an unsigned
+  /// integer, and as a constexpr value where it is defined to be such.
+  constexpr operator size_t() const { return Value; }
 
  private:
-  uint8_t Value;  //!< The value of the unrolling index.
+  size_t Value;  //!< The value of the unrolling index.
 };
 
 namespace util   {
 namespace perf   {
-
-/// Defines the types of unroll functions. The following bits are used to
-/// determine the type of the unroll function:
-///
-///         -----------------------------------------
-/// Bit     |  7 |  6 |  5 |  4 |  3 |  2 |  1 |  0 |
-///         -----------------------------------------
-/// Field   | NA | NA | NA | NA | NA | AR | ST | UI |
-///         -----------------------------------------
-///
-/// Where
-///         ST = Span Type    : The type of span, options are:
-///            - 1  : Valid span (Start < End).
-///            - 0  : End span (Start = End).
-///
-///         UI = Unroll Index : If an unroll index is being used, options are:
-///            - 1  : Unroll index is being used.
-///            - 0  : No unroll index is being used.
-enum UnrollType : uint8_t {
-  END_SPAN_WO_UROLL = 0,
-  END_SPAN_WI_UROLL = 1,
-  VAL_SPAN_WO_UROLL = 2, 
-  VAL_SPAN_WI_UROLL = 3
-};
-
 namespace detail {
 
-/// Defines a struct to help select the correct version of the unrolling
-/// functions.
-/// \tparam F     The function type to check for an UnrollIndex type.
-/// \tparam Start The starting value of the span.
-/// \tparam End   The end value of the span.
-template <typename F, uint8_t Start, uint8_t End>
-struct unroll_enable {
-  /// Defines the type of the function.
-  using Arg0Type = typename traits::function_traits<F>::template arg<0>::type;
+/// Calls \p l once for each index in the sequence, passing the unrolling
+/// index as the first argument. The calls are expanded in an initializer list,
+/// which guarantees that they are made in order, and which does not need any
+/// recursion, so the template depth does not grow with the span.
+/// \param[in] l     The lambda to unroll.
+/// \param[in] args  The additional arguments for the lambda.
+/// \tparam    Start The offset of the unrolling indices.
+/// \tparam    I     The sequence of unrolling indices.
+template <size_t Start, typename Lambda, size_t... I, typename... Args>
+static SNAP_INLINE
+void unroll_impl(std::true_type, Lambda& l, std::index_sequence<I...>,
+    Args&... args) {
+  using Expander = int[];
+  (void)Expander{0, ((void)l(UnrollIndex(Start + I), args...), 0)...};
+}
 
-  /// Defines the arity (number of arguments) of the function.
-  static constexpr uint8_t arity = traits::function_traits<F>::arity;
+/// Calls \p l once for each index in the sequence, without passing the
+/// unrolling index.
+/// \param[in] l     The lambda to unroll.
+/// \param[in] args  The arguments for the lambda.
+/// \tparam    Start The offset of the unrolling indices.
+/// \tparam    I     The sequence of unrolling indices.
+template <size_t Start, typename Lambda, size_t... I, typename... Args>
+static SNAP_INLINE
+void unroll_impl(std::false_type, Lambda& l, std::index_sequence<I...>,
+    Args&... args) {
+  using Expander = int[];
+  (void)Expander{0, ((void)I, (void)l(args...), 0)...};
+}
 
-  /// Returns the UnrollType of the function by bit shifting the properties of
-  /// the function to the correct positions.
-  static constexpr uint8_t value = 
-    (std::is_same<Arg0Type, UnrollIndex>::value)            |   // Bit 0
-    (traits::check_unroll_span<Start, End>::isValid() << 1);    // Bit 1
-};
+/// Defines if the unrolling index must be passed to a lambda of type Lambda
+/// when called with arguments of type Args, which is the case when the
+/// lambda can not be invoked with only the arguments.
+/// \tparam Lambda The type of the lambda being unrolled.
+/// \tparam Args   The types of the additional arguments.
+template <typename Lambda, typename... Args>
+using pass_unroll_index = std::integral_constant<bool,
+  !traits::is_invocable<Lambda&, Args&...>::value &&
+   traits::is_invocable<Lambda&, UnrollIndex, Args&...>::value
+>;
 
 } // namespace detail
 
 /// Defines a function that can unroll a lambda function to improve performance 
 /// in critical sections of code. The function is valid for a span (the range
 /// of Start -> End template paramters) where the start of the span is less
-/// than or equal to the end of the span. The span is non inclusive, so the
+/// than or equal to the end of the span. The span is inclusive, so the
 /// number of unrolls is: 
 ///
 ///   unrolls = End - Start + 1
 ///
+/// The unrolled calls are generated from an index sequence rather than by
+/// recursion, so spans of hundreds of elements do not increase the template
+/// instantiation depth.
+///
 /// The function will pass the span value as the first argument in the lambda, 
-/// if the lambda has a first parameter of type const snap::UnrollIndex or 
-/// snap::UnrollIndex, which is how the unrolling index can be accessed inside
-/// the unrolled lambda. For example, the following:
+/// if the lambda can not be called with only the additional arguments, which
+/// is the case when it has a first parameter of type snap::UnrollIndex (or
+/// a generic first parameter, i.e auto), which is how the unrolling index can
+/// be accessed inside the unrolled lambda. For example, the following:
 ///
 ///   snap::util::perf::unroll<0, 3>( [&someArray] (snap::UnrollIndex u) {
 ///     someArray[u] = u * u;
 ///   });
 ///
+/// or, equivalently, using a generic lambda:
+///
+///   snap::util::perf::unroll<0, 3>( [&someArray] (auto u) {
+///     someArray[u] = u * u;
+///   });
+///
 /// is equivalent to:
 ///
 ///   someArray[0] = 0 * 0;
@@ -150,177 +158,128 @@ struct unroll_enable {
 ///   offset
 /// );
 ///
-/// \tparam Start  The start valud of the unroll_index.
-/// \tparam End    The end valud of the unroll index (inclusive).
-/// \tparam Lambda The type of the lambda function.
-/// \tparam Args   The type of the arguments for the lambda functions.
- 
-// This case is enabled when the unrolling uses an unroll_index constant but
-// when there are no additional arguments for the lambda function. This
-// terminates the unrolling.
-template <uint8_t Start, uint8_t End, typename Lambda>
-static inline constexpr 
-void unroll(Lambda l, 
-    typename std::enable_if_t<
-        (detail::unroll_enable<decltype(l), Start, End>::arity == 1) &&
-        (detail::unroll_enable<decltype(l), Start, End>::value 
-         == END_SPAN_WI_UROLL),
-        typename traits::function_traits<decltype(l)>::template arg<1>::type> 
-    arg = traits::function_traits<decltype(l)>::template arg<1>::defaultArg()
-  ) {
-  // Call the lambda and give pass it the unroll_index value.
-  l(UnrollIndex(Start));
-}
-
-template <uint8_t Start, uint8_t End, typename Lambda>
-static inline constexpr 
-void unroll(Lambda l, 
-    typename std::enable_if_t<
-        (detail::unroll_enable<decltype(l), Start, End>::arity == 1) &&
-        (detail::unroll_enable<decltype(l), Start, End>::value 
-         == VAL_SPAN_WI_UROLL),
-        typename traits::function_traits<decltype(l)>::template arg<1>::type> 
-    arg = traits::function_traits<decltype(l)>::template arg<1>::defaultArg()
-  ) {
-  // Call the lambda and pass it the unroll_index_value.
-  l(UnrollIndex(Start));
-
-  // Invoke the next iteration of the unrolling.
-  unroll<Start + 1, End>(l);
-}
-
-// This case is enabled when the span is an end span, the first argument of the
-// lambda function is of type unroll_index, and the lambda has additional
-// arguments.
-template <uint8_t Start, uint8_t End, typename Lambda, typename... Args>
-static inline constexpr 
-void unroll(Lambda l, 
-    typename std::enable_if_t<
-        (detail::unroll_enable<decltype(l), Start, End>::arity > 1) &&
-        (detail::unroll_enable<decltype(l), Start, End>::value 
-         == END_SPAN_WI_UROLL),
-        typename traits::function_traits<decltype(l)>::template arg<1>::type>
-    arg = traits::function_traits<decltype(l)>::template arg<1>::defaultArg(), 
-    Args&&... args) {
-  // Define the type of the first argument.
-  using ArgType = 
-    typename traits::function_traits<decltype(l)>::template arg<1>::type;
-
-  // Call the lambda and pass it the unroll const as well as the args.
-  l(UnrollIndex(Start)        , 
-    std::forward<ArgType>(arg), 
-    std::forward<Args>(args)...
+/// \param[in] l      The lambda to unroll.
+/// \param[in] args   The additional arguments for the lambda.
+/// \tparam    Start  The start valud of the unroll_index.
+/// \tparam    End    The end valud of the unroll index (inclusive).
+/// \tparam    Lambda The type of the lambda function.
+/// \tparam    Args   The type of the arguments for the lambda functions.
+template <size_t Start, size_t End, typename Lambda, typename... Args>
+static SNAP_INLINE void unroll(Lambda&& l, Args&&... args) {
+  static_assert(traits::check_unroll_span<Start, End>::isValid() ||
+                traits::check_unroll_span<Start, End>::isEnd()  ,
+                "Unroll span requires Start <= End!");
+
+  detail::unroll_impl<Start>(
+    detail::pass_unroll_index<Lambda, Args...>(), 
+    l                                           , 
+    std::make_index_sequence<End - Start + 1>() , 
+    args...
   );
 }
 
-// This case is enabled when the span is valid, the first argument of the
-// lambda function is of type unroll_index, and the lambda function has
-// additional arguments.
-template <uint8_t Start, uint8_t End, typename Lambda, typename... Args>
-static inline constexpr 
-void unroll(Lambda l, 
-    typename std::enable_if_t<
-        (detail::unroll_enable<decltype(l), Start, End>::arity > 1) &&
-        (detail::unroll_enable<decltype(l), Start, End>::value 
-         == VAL_SPAN_WI_UROLL),
-        typename traits::function_traits<decltype(l)>::template arg<1>::type>
-    arg = traits::function_traits<decltype(l)>::template arg<1>::defaultArg(), 
-    Args&&... args) {
-  // Define the type of the first argument.
-  using ArgType = 
-    typename traits::function_traits<decltype(l)>::template arg<1>::type;
-
-  // Call the lambda and pass it the unroll const as well as the args.
-  l(UnrollIndex(Start)         , 
-    std::forward<ArgType>(arg) , 
-    std::forward<Args>(args)...
-  );
-
-  // Invoke the next iteration of the unrolling.
-  unroll<Start + 1, End>(
-    l                            , 
-    std::forward<ArgType&&>(arg) , 
-    std::forward<Args&&>(args)...
-  );
-}
-
-// This case is enabled when the span is the end of the span and the first
-// argument of the lambda is not an unroll_idx, and the lambda does not take
-// any arguments.
-template <uint8_t Start, uint8_t End, typename Lambda>
-static inline constexpr 
-void unroll(Lambda l,
-    typename std::enable_if_t<
-    (detail::unroll_enable<decltype(l), Start, End>::arity == 0) &&
-    (detail::unroll_enable<decltype(l), Start, End>::value 
-     == END_SPAN_WO_UROLL), 
-    typename traits::function_traits<decltype(l)>::template arg<0>::type> 
-    arg = traits::function_traits<decltype(l)>::template arg<0>::defaultArg()
-  ) { 
-  l();
-}
-
-// This case is enabled when the span is a valid span and the first argument of
-// the lamda is not an unroll_index type, and the lambda has no arguments.
-template <uint8_t Start, uint8_t End, typename Lambda>
-static inline constexpr 
-void unroll(Lambda l, 
-    typename std::enable_if_t<
-        (detail::unroll_enable<decltype(l), Start, End>::arity == 0) &&
-        (detail::unroll_enable<decltype(l), Start, End>::value 
-         == VAL_SPAN_WO_UROLL),
-        typename traits::function_traits<decltype(l)>::template arg<0>::type>
-    arg = traits::function_traits<decltype(l)>::template arg<0>::defaultArg()
-  ) {
-  l();
-
-  // Invoke the next iteration of the unrolling.
-  unroll<Start + 1, End>(l);
-}
-
-// This case is enabled when the span is the end of the span and the first
-// argument of the lambda is not an unroll_idx, and the lambda takes additional
-// arguments.
-template <uint8_t Start, uint8_t End, typename Lambda, typename... Args>
-static inline constexpr 
-void unroll(Lambda l,
-    typename std::enable_if_t<
-    (detail::unroll_enable<decltype(l), Start, End>::arity >= 1) &&
-    (detail::unroll_enable<decltype(l), Start, End>::value 
-     == END_SPAN_WO_UROLL), 
-    typename traits::function_traits<decltype(l)>::template arg<0>::type> 
-    arg = traits::function_traits<decltype(l)>::template arg<0>::defaultArg(),
-    Args&&... args) {
-  // Define the type of the first argument.
-  using ArgType = 
-    typename traits::function_traits<decltype(l)>::template arg<0>::type;
-
-  // Call the lambda and pass the arguments.
-  l(std::forward<ArgType>(arg));
+/// Defines a function which applies \p f to every index in the runtime range
+/// [\p begin, \p end), unrolling the main body of the loop by a factor of N
+/// and handling the remaining (end - begin) % N indices with a scalar
+/// epilogue, so that the caller does not have to write the outer loop or the
+/// remainder by hand. For example, the following:
+///
+///   snap::util::perf::for_each_unrolled<4>(0, 10, [&] (size_t i) {
+///     someArray[i] = i;
+///   });
+///
+/// is equivalent to two iterations of a loop which is unrolled 4 times,
+/// followed by the two remaining iterations for i = 8 and i = 9.
+///
+/// \param[in] begin  The first index of the range.
+/// \param[in] end    The end of the range (exclusive).
+/// \param[in] f      The function to apply to each index.
+/// \tparam    N      The unroll factor.
+/// \tparam    Index  The type of the index.
+/// \tparam    F      The type of the function.
+template <size_t N, typename Index, typename F>
+static inline void for_each_unrolled(Index begin, Index end, F&& f) {
+  static_assert(N > 0, "Unroll factor must be greater than 0!");
+
+  if (end <= begin) 
+    return;
+
+  const Index mainEnd = begin + (end - begin) / N * N;
+
+  Index i = begin;
+  for (; i < mainEnd; i += N) {
+    unroll<0, N - 1>([&] (const UnrollIndex u) { 
+      f(static_cast<Index>(i + u));
+    });
+  }
+
+  // Scalar epilogue for the remaining elements.
+  for (; i < end; ++i) 
+    f(i);
 }
 
-// This case is enabled when the span is a valid span and the first argument of
-// the lamda is not an unroll_index type, and the lambda has no arguments.
-template <uint8_t Start, uint8_t End, typename Lambda, typename... Args>
-static inline constexpr 
-void unroll(Lambda l, 
-    typename std::enable_if_t<
-        (detail::unroll_enable<decltype(l), Start, End>::arity >= 1) &&
-        (detail::unroll_enable<decltype(l), Start, End>::value 
-         == VAL_SPAN_WO_UROLL),
-        typename traits::function_traits<decltype(l)>::template arg<0>::type>
-    arg = traits::function_traits<decltype(l)>::template arg<0>::defaultArg(),
-    Args&&... args) {
-  // Define the type of the first argument.
-  using ArgType = 
-    typename traits::function_traits<decltype(l)>::template arg<0>::type;
-
-  // Call the lambda and pass it the unroll const as well as the args.
-  l(std::forward<ArgType>(arg), std::forward<Args>(args)...);
-
-  // Invoke the next iteration of the unrolling.
-  unroll<Start + 1, End>(l, std::forward<ArgType&&>(arg), 
-    std::forward<Args&&>(args)...);
+/// Defines a function which reduces the runtime range [\p begin, \p end) by
+/// unrolling the main body of the loop N times, where each of the N unrolled
+/// lanes updates its own independent accumulator. This removes the loop
+/// carried dependency on a single accumulator, allowing the unrolled
+/// iterations to execute in parallel (instruction level parallelism). The
+/// accumulators are combined using \p combine once the range is processed.
+/// For example, the following sums an array:
+///
+///   auto sum = snap::util::perf::reduce_unrolled<4>(
+///     size_t(0), size, uint64_t(0),
+///     [&] (uint64_t& acc, size_t i) { acc += someArray[i]; },
+///     [ ] (uint64_t a, uint64_t b) { return a + b; }
+///   );
+///
+/// The remainder elements are accumulated into the first 
+/// (end - begin) % N lanes by a scalar epilogue.
+///
+/// \param[in] begin    The first index of the range.
+/// \param[in] end      The end of the range (exclusive).
+/// \param[in] identity The value each lane accumulator is initialized with,
+///                     this must be the identity of \p combine.
+/// \param[in] f        The function which updates an accumulator for an
+///                     index, with signature f(T& accumulator, Index i).
+/// \param[in] combine  The function which combines two accumulators.
+/// \tparam    N        The unroll factor (number of accumulators).
+/// \tparam    Index    The type of the index.
+/// \tparam    T        The type of the accumulators.
+/// \tparam    F        The type of the accumulation function.
+/// \tparam    Combine  The type of the combination function.
+template <size_t N, typename Index, typename T, typename F, typename Combine>
+static inline T reduce_unrolled(Index     begin   , 
+                                Index     end     , 
+                                T         identity, 
+                                F&&       f       ,
+                                Combine&& combine ) {
+  static_assert(N > 0, "Unroll factor must be greater than 0!");
+
+  T accumulators[N];
+  unroll<0, N - 1>([&] (const UnrollIndex u) { 
+    accumulators[u] = identity; 
+  });
+
+  if (end <= begin) 
+    return identity;
+
+  const Index mainEnd = begin + (end - begin) / N * N;
+
+  Index i = begin;
+  for (; i < mainEnd; i += N) {
+    unroll<0, N - 1>([&] (const UnrollIndex u) { 
+      f(accumulators[u], static_cast<Index>(i + u));
+    });
+  }
+
+  // Scalar epilogue, each remaining element goes into its own lane.
+  for (size_t lane = 0; i < end; ++i, ++lane) 
+    f(accumulators[lane], i);
+
+  T result = accumulators[0];
+  for (size_t lane = 1; lane < N; ++lane)
+    result = combine(result, accumulators[lane]);
+  return result;
 }
 
 } // namespace perf
@@ -18,6 +18,8 @@
 #define SNAP_UTILITY_TRAITS_HPP
 
 #include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace snap   {
 namespace util   {
@@ -129,11 +131,35 @@ struct function_traits<ReturnType(ClassType::*)(Args...) const> {
   };
 };
 
+namespace detail {
+
+/// Defines the result of a check for if F can be invoked with arguments of
+/// type Args, for the case that it can't.
+template <typename Enable, typename F, typename... Args>
+struct invocable_check : std::false_type {};
+
+/// Specialization for when F can be invoked with arguments of type Args.
+template <typename F, typename... Args>
+struct invocable_check<
+  decltype((void)std::declval<F>()(std::declval<Args>()...)), F, Args...
+> : std::true_type {};
+
+} // namespace detail
+
+/// Defines a struct to check if a callable of type F can be invoked with
+/// arguments of type Args. Unlike function_traits, this works for generic
+/// lambdas and overloaded function objects, since the call operator does not
+/// have to be inspected.
+/// \tparam F    The type of the callable.
+/// \tparam Args The types of the arguments.
+template <typename F, typename... Args>
+struct is_invocable : detail::invocable_check<void, F, Args...> {};
+
 /// Defines a struct to check if a span (range of numbers) is valid for
 /// unrolling, or if the span specifies the end of the range of numbers.
 /// \tparam Start The start value of the range to unroll.
 /// tparam  End   The end value of the range to unroll.
-template <uint8_t Start, uint8_t End>
+template <size_t Start, size_t End>
 struct check_unroll_span {
 
   /// Checks if the span is valid for unrolling (Start < End).
@@ -0,0 +1,442 @@
+//---- snap/utility/tuning.hpp ----------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  tuning.hpp
+/// \brief Defines the tuning parameters of the kernels, and an auto-tuner
+///        which finds the best parameters for each kernel on the host. 
+///
+///        The parameters are kept in a registry which the kernels look up
+///        when they are dispatched. The registry loads the tuned parameters 
+///        from the cache file given by the SNAP_TUNING_CACHE environment 
+///        variable, or otherwise from $HOME/.cache/snap_tuning.cache, when 
+///        it is first used. Setting SNAP_TUNING_CACHE to an empty string, or
+///        defining SNAP_NO_TUNING_CACHE when compiling, disables the 
+///        automatic load, so that the kernels use their defaults unless
+///        load() or set() is called. The cache file has a section for each
+///        machine profile, so that one file can be shared by different 
+///        machines:
+///
+///          [profile]
+///          kernel unroll threads grain
+///
+///        Kernels which are not in the section use their defaults.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_UTILITY_TUNING_HPP
+#define SNAP_UTILITY_TUNING_HPP
+
+#include "parallel.hpp"
+#include "snap/config/simd_instruction_detect.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace snap {
+namespace util {
+namespace tune {
+
+/// Defines the tunable parameters of a kernel.
+struct Params {
+  uint32_t unroll;    //!< The unroll factor (independent accumulators).
+  uint32_t threads;   //!< The max number of threads, 0 for all of them.
+  uint64_t grain;     //!< The min number of elements for each thread.
+};
+
+/// Returns true if \p a and \p b are the same parameters.
+/// \param[in] a The first parameters.
+/// \param[in] b The second parameters.
+static inline bool operator==(const Params& a, const Params& b) {
+  return a.unroll == b.unroll && a.threads == b.threads && a.grain == b.grain;
+}
+
+/// Defines the unroll factors which kernels are instantiated for.
+static constexpr uint32_t UNROLL_FACTORS[] = {1, 2, 4, 8};
+
+/// Defines the parameters of a kernel in the registry, which can be read by
+/// kernels while they are updated by a load or the tuner.
+class Entry {
+ public:
+  /// Constructor: Creates an entry with the \p defaults.
+  /// \param[in] defaults The default parameters of the kernel.
+  explicit Entry(const Params& defaults) 
+  : Defaults(defaults), Unroll(defaults.unroll), Threads(defaults.threads),
+    Grain(defaults.grain) {}
+
+  /// Returns the current parameters.
+  Params get() const {
+    return Params{Unroll.load(std::memory_order_relaxed), 
+                  Threads.load(std::memory_order_relaxed),
+                  Grain.load(std::memory_order_relaxed)};
+  }
+
+  /// Sets the current parameters to \p params.
+  /// \param[in] params The parameters to set.
+  void set(const Params& params) {
+    Unroll.store(params.unroll, std::memory_order_relaxed);
+    Threads.store(params.threads, std::memory_order_relaxed);
+    Grain.store(params.grain, std::memory_order_relaxed);
+  }
+
+  /// Returns the default parameters.
+  const Params& defaults() const { return Defaults; }
+
+ private:
+  Params                Defaults;   //!< The default parameters.
+  std::atomic<uint32_t> Unroll;     //!< The current unroll factor.
+  std::atomic<uint32_t> Threads;    //!< The current max thread count.
+  std::atomic<uint64_t> Grain;      //!< The current min elements per thread.
+};
+
+namespace detail {
+
+/// Returns the text with only lower case letters, digits and dashes, where 
+/// runs of other characters are replaced by a single dash.
+/// \param[in] text The text to sanitize.
+static inline std::string sanitize(const std::string& text) {
+  std::string result;
+  for (const char c : text) {
+    if (std::isalnum(static_cast<unsigned char>(c)))
+      result += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    else if (!result.empty() && result.back() != '-')
+      result += '-';
+  }
+  while (!result.empty() && result.back() == '-')
+    result.pop_back();
+  return result;
+}
+
+/// Returns the lines of the sections of the cache file at \p path which are
+/// not for \p profile, so that they can be kept when the file is rewritten.
+/// \param[in] path    The path of the cache file.
+/// \param[in] profile The profile whose section is skipped.
+static inline std::string other_sections(const std::string& path   , 
+                                         const std::string& profile) {
+  std::ifstream     file(path);
+  std::string       result;
+  bool              skip = false;
+  for (std::string line; std::getline(file, line); ) {
+    if (!line.empty() && line[0] == '[')
+      skip = line == "[" + profile + "]";
+    if (!skip && !line.empty())
+      result += line + "\n";
+  }
+  return result;
+}
+
+/// Defines the registry of the parameters of each kernel.
+class Registry {
+ public:
+  /// Returns the registry, which is never destroyed, so that kernels which
+  /// run during static destruction can still look up their parameters.
+  static Registry& instance() {
+    static Registry* registry = new Registry();
+    return *registry;
+  }
+
+  /// Returns the entry of the kernel with \p name, adding it with the 
+  /// \p defaults, and any parameters loaded for it, if necessary. The entry 
+  /// is never moved, so references to it can be cached.
+  /// \param[in] name     The name of the kernel.
+  /// \param[in] defaults The default parameters of the kernel.
+  Entry& entry(const std::string& name, const Params& defaults) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    auto it = Entries.find(name);
+    if (it == Entries.end()) {
+      it = Entries.emplace(std::piecewise_construct, 
+        std::forward_as_tuple(name), std::forward_as_tuple(defaults)).first;
+      const auto loaded = Loaded.find(name);
+      if (loaded != Loaded.end())
+        it->second.set(loaded->second);
+    }
+    return it->second;
+  }
+
+  /// Sets the parameters of the kernel with \p name to \p params. If the
+  /// kernel has not been used, they are applied when it is.
+  /// \param[in] name   The name of the kernel.
+  /// \param[in] params The parameters of the kernel.
+  void set(const std::string& name, const Params& params) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Loaded[name] = params;
+    const auto it = Entries.find(name);
+    if (it != Entries.end())
+      it->second.set(params);
+  }
+
+  /// Loads the parameters for \p profile from the cache file at \p path, 
+  /// returning false if the file can't be read.
+  /// \param[in] path    The path of the cache file.
+  /// \param[in] profile The machine profile to load the parameters for.
+  bool load(const std::string& path, const std::string& profile) {
+    std::ifstream file(path);
+    if (!file)
+      return false;
+
+    bool inProfile = false;
+    for (std::string line; std::getline(file, line); ) {
+      if (!line.empty() && line[0] == '[') {
+        inProfile = line == "[" + profile + "]";
+        continue;
+      }
+      std::istringstream fields(line);
+      std::string        name;
+      Params             params;
+      if (inProfile && fields >> name >> params.unroll >> params.threads 
+                                      >> params.grain && params.unroll > 0)
+        set(name, params);
+    }
+    return true;
+  }
+
+  /// Saves the current parameters of all the kernels which are not their 
+  /// defaults as the section for \p profile of the cache file at \p path, 
+  /// keeping the sections of other profiles. Returns false if the file 
+  /// can't be written.
+  /// \param[in] path    The path of the cache file.
+  /// \param[in] profile The machine profile to save the parameters for.
+  bool save(const std::string& path, const std::string& profile) {
+    const auto others = other_sections(path, profile);
+
+    std::lock_guard<std::mutex> lock(Mutex);
+    auto params = Loaded;
+    for (const auto& entry : Entries) {
+      const auto current = entry.second.get();
+      if (current == entry.second.defaults())
+        params.erase(entry.first);
+      else
+        params[entry.first] = current;
+    }
+
+    std::ofstream file(path);
+    file << others << "[" << profile << "]\n";
+    for (const auto& p : params) {
+      file << p.first << " " << p.second.unroll << " " << p.second.threads
+           << " " << p.second.grain << "\n";
+    }
+    return bool(file);
+  }
+
+ private:
+  std::mutex                    Mutex;    //!< Mutex for the registry.
+  std::map<std::string, Entry>  Entries;  //!< The entries of used kernels.
+  std::map<std::string, Params> Loaded;   //!< The loaded and set params.
+
+  /// Constructor: Creates the registry, loading the cache file.
+  Registry();
+};
+
+} // namespace detail
+
+/// Returns the name of the profile of this machine, from the CPU model, 
+/// the number of hardware threads and the vector backend, since tuned
+/// parameters (and timings) only apply to machines with the same profile.
+static inline std::string machine_profile() {
+  std::string model = "unknown-cpu";
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  for (std::string line; std::getline(cpuinfo, line); ) {
+    if (line.compare(0, 10, "model name") == 0 ||
+        line.compare(0, 9 , "Processor" ) == 0) {
+      model = line.substr(line.find(':') + 1);
+      break;
+    }
+  }
+
+#if defined(SCALAR_ENABLED)
+  const char* backend = "scalar";
+#elif defined(NEON_ENABLED)
+  const char* backend = "neon";
+#else
+  const char* backend = "sse";
+#endif
+
+  return detail::sanitize(model + " " + 
+    std::to_string(std::thread::hardware_concurrency()) + "t " + backend);
+}
+
+/// Returns the path of the cache file, which is the SNAP_TUNING_CACHE 
+/// environment variable if it is set, or $HOME/.cache/snap_tuning.cache. 
+/// The path is empty if SNAP_TUNING_CACHE is set to an empty string.
+static inline std::string cache_path() {
+  if (const char* path = std::getenv("SNAP_TUNING_CACHE"))
+    return path;
+  const char* home = std::getenv("HOME");
+  return std::string(home ? home : ".") + "/.cache/snap_tuning.cache";
+}
+
+/// Returns the registry entry for the kernel with \p name, which has the
+/// \p defaults if it has not been tuned. The entry should be cached by the
+/// kernel, for example in a function local static.
+/// \param[in] name     The name of the kernel.
+/// \param[in] defaults The default parameters of the kernel.
+static inline Entry& entry(const std::string& name, const Params& defaults) {
+  return detail::Registry::instance().entry(name, defaults);
+}
+
+/// Sets the parameters of the kernel with \p name to \p params.
+/// \param[in] name   The name of the kernel.
+/// \param[in] params The parameters of the kernel.
+static inline void set(const std::string& name, const Params& params) {
+  detail::Registry::instance().set(name, params);
+}
+
+/// Loads the parameters for this machine from the cache file at \p path,
+/// returning false if the file can't be read, or if \p path is empty.
+/// \param[in] path The path of the cache file.
+static inline bool load(const std::string& path = cache_path()) {
+  return !path.empty() && 
+    detail::Registry::instance().load(path, machine_profile());
+}
+
+/// Saves the tuned parameters for this machine to the cache file at 
+/// \p path, returning false if the file can't be written.
+/// \param[in] path The path of the cache file.
+static inline bool save(const std::string& path = cache_path()) {
+  return detail::Registry::instance().save(path, machine_profile());
+}
+
+/// Returns the number of chunks to split \p elements elements into for the
+/// execution \p policy with the tuned \p params, such that each chunk has 
+/// at least params.grain elements, and there are at most params.threads 
+/// chunks if it is not 0.
+/// \param[in] elements The number of elements to split.
+/// \param[in] policy   The execution policy.
+/// \param[in] params   The tuned parameters.
+static inline size_t chunk_count(size_t          elements, 
+                                 ExecutionPolicy policy  , 
+                                 const Params&   params  ) {
+  const size_t chunks = 
+    par::chunk_count(elements, policy, std::max<uint64_t>(params.grain, 1));
+  return params.threads == 0 
+    ? chunks : std::min<size_t>(chunks, params.threads);
+}
+
+/// Calls \p f with a std::integral_constant for the largest of the 
+/// UNROLL_FACTORS which is not larger than \p unroll, so that kernels can
+/// be instantiated for each unroll factor and selected at runtime, and 
+/// returns the result. The signature of \p f must be:
+///
+///   f(std::integral_constant<size_t, Unroll>)
+///
+/// \param[in] unroll The unroll factor.
+/// \param[in] f      The function to call.
+template <typename F>
+static inline auto dispatch_unroll(uint32_t unroll, F&& f)
+-> decltype(f(std::integral_constant<size_t, 1>())) {
+  if (unroll >= 8) return f(std::integral_constant<size_t, 8>());
+  if (unroll >= 4) return f(std::integral_constant<size_t, 4>());
+  if (unroll >= 2) return f(std::integral_constant<size_t, 2>());
+  return f(std::integral_constant<size_t, 1>());
+}
+
+/// Returns the candidate parameters which the tuner tries by default: each
+/// of the UNROLL_FACTORS, with a single thread, half the threads and all the
+/// threads, and grains from 16K to 256K elements.
+static inline std::vector<Params> default_candidates() {
+  const uint32_t threads = static_cast<uint32_t>(par::thread_count());
+
+  std::vector<uint32_t> threadCounts = {1};
+  if (threads / 2 > 1) threadCounts.push_back(threads / 2);
+  if (threads     > 1) threadCounts.push_back(threads);
+
+  std::vector<Params> candidates;
+  for (const auto unroll : UNROLL_FACTORS) {
+    for (const auto t : threadCounts) {
+      for (const uint64_t grain : {1 << 14, 1 << 16, 1 << 18}) {
+        candidates.push_back(Params{unroll, t, grain});
+        if (t == 1) break;
+      }
+    }
+  }
+  return candidates;
+}
+
+/// Defines the result of tuning a kernel.
+struct TuneResult {
+  Params best;      //!< The fastest parameters.
+  double seconds;   //!< The median time of the fastest parameters.
+  double baseline;  //!< The median time of the default parameters.
+};
+
+/// Tunes the kernel with \p name by setting each of the \p candidates and 
+/// the defaults in turn, timing \p repetitions calls of \p run, and setting
+/// the parameters with the lowest median time. Kernels which run in other
+/// threads while the kernel is tuned use the candidates too. The signature 
+/// of \p run must be:
+///
+///   run()
+///
+/// and it must call the kernel with the execution policy being tuned.
+///
+/// \param[in] name        The name of the kernel.
+/// \param[in] defaults    The default parameters of the kernel.
+/// \param[in] candidates  The candidate parameters.
+/// \param[in] run         The function which runs the kernel.
+/// \param[in] repetitions The number of timed calls for each candidate.
+/// \tparam    Clock       The clock which times the calls, which has the
+///                        interface of the std::chrono clocks.
+template <typename Clock = std::chrono::steady_clock, typename F>
+static inline TuneResult tune(const std::string&         name       , 
+                              const Params&              defaults   ,
+                              const std::vector<Params>& candidates ,
+                              F&&                        run        ,
+                              size_t                     repetitions = 7) {
+  auto& kernel = entry(name, defaults);
+
+  auto time = [&] (const Params& params) {
+    kernel.set(params);
+    run();
+    std::vector<double> seconds;
+    for (size_t i = 0; i < std::max<size_t>(repetitions, 1); ++i) {
+      const auto start = Clock::now();
+      run();
+      seconds.push_back(
+        std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    std::sort(seconds.begin(), seconds.end());
+    return seconds[seconds.size() / 2];
+  };
+
+  TuneResult result{defaults, time(defaults), 0.0};
+  result.baseline = result.seconds;
+  for (const auto& candidate : candidates) {
+    const double seconds = time(candidate);
+    if (seconds < result.seconds)
+      result = TuneResult{candidate, seconds, result.baseline};
+  }
+  set(name, result.best);
+  return result;
+}
+
+// ---- Implementation ----------------------------------------------------- //
+
+inline detail::Registry::Registry() {
+#if !defined(SNAP_NO_TUNING_CACHE)
+  const auto path = cache_path();
+  if (!path.empty())
+    load(path, machine_profile());
+#endif
+}
+
+} // namespace tune
+} // namespace util
+} // namespace snap
+
+#endif // SNAP_UTILITY_TUNING_HPP
@@ -18,5 +18,8 @@
 
 #include "traits.hpp"
 #include "performance.hpp"
+#include "parallel.hpp"
+#include "hardware_counters.hpp"
+#include "tuning.hpp"
 
 #endif // SNAP_UTILITY_UTILITY_HPP
@@ -0,0 +1,316 @@
+//---- snap/vector/intrinsics_neon.hpp --------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  intrinsics_neon.hpp
+/// \brief Defines overloads of the NEON intrinsics for each of the element
+///        types, so that the NEON Vector implementations can be written
+///        once for all the element types of a given width. Unlike SSE, which
+///        uses __m128i for all integer vectors, NEON has a distinct vector
+///        type for each element type.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_VECTOR_INTRINSICS_NEON_HPP
+#define SNAP_VECTOR_INTRINSICS_NEON_HPP
+
+#include "snap/config/simd_instruction_detect.h"
+
+namespace snap   {
+namespace detail {
+namespace neon   {
+
+/// Defines the NEON q register type for elements of type DT.
+/// \tparam DT The type of the elements.
+template <typename DT> struct vector_type;
+
+template <> struct vector_type<uint8_t>  { using type = uint8x16_t; };
+template <> struct vector_type<int8_t>   { using type = int8x16_t;  };
+template <> struct vector_type<uint16_t> { using type = uint16x8_t; };
+template <> struct vector_type<int16_t>  { using type = int16x8_t;  };
+template <> struct vector_type<uint32_t> { using type = uint32x4_t; };
+template <> struct vector_type<int32_t>  { using type = int32x4_t;  };
+
+// ---- Load and store ----------------------------------------------------- //
+
+SNAP_INLINE uint8x16_t load(const uint8_t*  p) { return vld1q_u8(p);  }
+SNAP_INLINE int8x16_t  load(const int8_t*   p) { return vld1q_s8(p);  }
+SNAP_INLINE uint16x8_t load(const uint16_t* p) { return vld1q_u16(p); }
+SNAP_INLINE int16x8_t  load(const int16_t*  p) { return vld1q_s16(p); }
+SNAP_INLINE uint32x4_t load(const uint32_t* p) { return vld1q_u32(p); }
+SNAP_INLINE int32x4_t  load(const int32_t*  p) { return vld1q_s32(p); }
+
+SNAP_INLINE uint8x16_t load_low(const uint8_t* p) {
+  return vcombine_u8(vld1_u8(p), vdup_n_u8(0));
+}
+SNAP_INLINE int8x16_t load_low(const int8_t* p) {
+  return vcombine_s8(vld1_s8(p), vdup_n_s8(0));
+}
+
+SNAP_INLINE void store(uint8_t*  p, uint8x16_t x) { vst1q_u8(p, x);  }
+SNAP_INLINE void store(int8_t*   p, int8x16_t  x) { vst1q_s8(p, x);  }
+SNAP_INLINE void store(uint16_t* p, uint16x8_t x) { vst1q_u16(p, x); }
+SNAP_INLINE void store(int16_t*  p, int16x8_t  x) { vst1q_s16(p, x); }
+SNAP_INLINE void store(uint32_t* p, uint32x4_t x) { vst1q_u32(p, x); }
+SNAP_INLINE void store(int32_t*  p, int32x4_t  x) { vst1q_s32(p, x); }
+
+// ---- Broadcast ---------------------------------------------------------- //
+
+SNAP_INLINE uint8x16_t dup(uint8_t  x) { return vdupq_n_u8(x);  }
+SNAP_INLINE int8x16_t  dup(int8_t   x) { return vdupq_n_s8(x);  }
+SNAP_INLINE uint16x8_t dup(uint16_t x) { return vdupq_n_u16(x); }
+SNAP_INLINE int16x8_t  dup(int16_t  x) { return vdupq_n_s16(x); }
+SNAP_INLINE uint32x4_t dup(uint32_t x) { return vdupq_n_u32(x); }
+SNAP_INLINE int32x4_t  dup(int32_t  x) { return vdupq_n_s32(x); }
+
+// ---- Arithmetic --------------------------------------------------------- //
+
+SNAP_INLINE uint8x16_t add(uint8x16_t a, uint8x16_t b) {
+  return vaddq_u8(a, b);
+}
+SNAP_INLINE int8x16_t  add(int8x16_t  a, int8x16_t  b) {
+  return vaddq_s8(a, b);
+}
+SNAP_INLINE uint16x8_t add(uint16x8_t a, uint16x8_t b) {
+  return vaddq_u16(a, b);
+}
+SNAP_INLINE int16x8_t  add(int16x8_t  a, int16x8_t  b) {
+  return vaddq_s16(a, b);
+}
+SNAP_INLINE uint32x4_t add(uint32x4_t a, uint32x4_t b) {
+  return vaddq_u32(a, b);
+}
+SNAP_INLINE int32x4_t  add(int32x4_t  a, int32x4_t  b) {
+  return vaddq_s32(a, b);
+}
+
+SNAP_INLINE uint8x16_t sub(uint8x16_t a, uint8x16_t b) {
+  return vsubq_u8(a, b);
+}
+SNAP_INLINE int8x16_t  sub(int8x16_t  a, int8x16_t  b) {
+  return vsubq_s8(a, b);
+}
+SNAP_INLINE uint16x8_t sub(uint16x8_t a, uint16x8_t b) {
+  return vsubq_u16(a, b);
+}
+SNAP_INLINE int16x8_t  sub(int16x8_t  a, int16x8_t  b) {
+  return vsubq_s16(a, b);
+}
+SNAP_INLINE uint32x4_t sub(uint32x4_t a, uint32x4_t b) {
+  return vsubq_u32(a, b);
+}
+SNAP_INLINE int32x4_t  sub(int32x4_t  a, int32x4_t  b) {
+  return vsubq_s32(a, b);
+}
+
+SNAP_INLINE uint16x8_t mul(uint16x8_t a, uint16x8_t b) {
+  return vmulq_u16(a, b);
+}
+SNAP_INLINE int16x8_t  mul(int16x8_t  a, int16x8_t  b) {
+  return vmulq_s16(a, b);
+}
+
+SNAP_INLINE uint8x16_t adds(uint8x16_t a, uint8x16_t b) {
+  return vqaddq_u8(a, b);
+}
+SNAP_INLINE int8x16_t  adds(int8x16_t  a, int8x16_t  b) {
+  return vqaddq_s8(a, b);
+}
+SNAP_INLINE uint8x16_t subs(uint8x16_t a, uint8x16_t b) {
+  return vqsubq_u8(a, b);
+}
+SNAP_INLINE int8x16_t  subs(int8x16_t  a, int8x16_t  b) {
+  return vqsubq_s8(a, b);
+}
+
+SNAP_INLINE uint16x8_t subs(uint16x8_t a, uint16x8_t b) {
+  return vqsubq_u16(a, b);
+}
+
+SNAP_INLINE uint8x16_t min(uint8x16_t a, uint8x16_t b) {
+  return vminq_u8(a, b);
+}
+SNAP_INLINE int8x16_t  min(int8x16_t  a, int8x16_t  b) {
+  return vminq_s8(a, b);
+}
+SNAP_INLINE uint8x16_t max(uint8x16_t a, uint8x16_t b) {
+  return vmaxq_u8(a, b);
+}
+SNAP_INLINE int8x16_t  max(int8x16_t  a, int8x16_t  b) {
+  return vmaxq_s8(a, b);
+}
+
+// ---- Bitwise ------------------------------------------------------------ //
+
+SNAP_INLINE uint8x16_t bit_and(uint8x16_t a, uint8x16_t b) {
+  return vandq_u8(a, b);
+}
+SNAP_INLINE int8x16_t  bit_and(int8x16_t  a, int8x16_t  b) {
+  return vandq_s8(a, b);
+}
+SNAP_INLINE uint8x16_t bit_or(uint8x16_t a, uint8x16_t b) {
+  return vorrq_u8(a, b);
+}
+SNAP_INLINE int8x16_t  bit_or(int8x16_t  a, int8x16_t  b) {
+  return vorrq_s8(a, b);
+}
+SNAP_INLINE uint8x16_t bit_xor(uint8x16_t a, uint8x16_t b) {
+  return veorq_u8(a, b);
+}
+SNAP_INLINE int8x16_t  bit_xor(int8x16_t  a, int8x16_t  b) {
+  return veorq_s8(a, b);
+}
+SNAP_INLINE uint16x8_t bit_and(uint16x8_t a, uint16x8_t b) {
+  return vandq_u16(a, b);
+}
+SNAP_INLINE int16x8_t  bit_and(int16x8_t  a, int16x8_t  b) {
+  return vandq_s16(a, b);
+}
+SNAP_INLINE uint16x8_t bit_or(uint16x8_t a, uint16x8_t b) {
+  return vorrq_u16(a, b);
+}
+SNAP_INLINE int16x8_t  bit_or(int16x8_t  a, int16x8_t  b) {
+  return vorrq_s16(a, b);
+}
+SNAP_INLINE uint16x8_t bit_xor(uint16x8_t a, uint16x8_t b) {
+  return veorq_u16(a, b);
+}
+SNAP_INLINE int16x8_t  bit_xor(int16x8_t  a, int16x8_t  b) {
+  return veorq_s16(a, b);
+}
+SNAP_INLINE uint8x16_t bit_not(uint8x16_t a) { return vmvnq_u8(a);  }
+SNAP_INLINE int8x16_t  bit_not(int8x16_t  a) { return vmvnq_s8(a);  }
+SNAP_INLINE uint16x8_t bit_not(uint16x8_t a) { return vmvnq_u16(a); }
+SNAP_INLINE int16x8_t  bit_not(int16x8_t  a) { return vmvnq_s16(a); }
+
+// ---- Comparison and masks ----------------------------------------------- //
+
+SNAP_INLINE uint8x16_t cmpeq(uint8x16_t a, uint8x16_t b) { 
+  return vceqq_u8(a, b); 
+}
+SNAP_INLINE int8x16_t cmpeq(int8x16_t a, int8x16_t b) { 
+  return vreinterpretq_s8_u8(vceqq_s8(a, b)); 
+}
+
+SNAP_INLINE uint16x8_t cmpeq(uint16x8_t a, uint16x8_t b) { 
+  return vceqq_u16(a, b); 
+}
+SNAP_INLINE int16x8_t cmpeq(int16x8_t a, int16x8_t b) { 
+  return vreinterpretq_s16_u16(vceqq_s16(a, b)); 
+}
+
+SNAP_INLINE uint8x16_t as_u8(uint8x16_t x) { return x; }
+SNAP_INLINE uint8x16_t as_u8(int8x16_t  x) { return vreinterpretq_u8_s8(x); }
+
+SNAP_INLINE int16x8_t as_s16(uint16x8_t x) { return vreinterpretq_s16_u16(x); }
+SNAP_INLINE int16x8_t as_s16(int16x8_t  x) { return x; }
+
+/// Returns a 16-bit mask of the most significant bits of the elements of x,
+/// which is the equivalent of SSE's movemask.
+SNAP_INLINE uint32_t movemask(uint8x16_t x) {
+  static const int8_t shifts[16] = 
+    {0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7};
+  const uint8x16_t bits = vshlq_u8(vshrq_n_u8(x, 7), vld1q_s8(shifts));
+#if defined(__aarch64__)
+  return vaddv_u8(vget_low_u8(bits)) | (vaddv_u8(vget_high_u8(bits)) << 8);
+#else
+  uint8x8_t sums = vpadd_u8(vget_low_u8(bits), vget_high_u8(bits));
+  sums = vpadd_u8(sums, sums);
+  sums = vpadd_u8(sums, sums);
+  return vget_lane_u8(sums, 0) | (vget_lane_u8(sums, 1) << 8);
+#endif
+}
+
+/// Returns the elements of x at the byte indices of idx, where the elements
+/// for indices of 16 or more are zero.
+SNAP_INLINE uint8x16_t lookup(uint8x16_t x, uint8x16_t idx) {
+#if defined(__aarch64__)
+  return vqtbl1q_u8(x, idx);
+#else
+  const uint8x8x2_t table = {{vget_low_u8(x), vget_high_u8(x)}};
+  return vcombine_u8(vtbl2_u8(table, vget_low_u8(idx)), 
+                     vtbl2_u8(table, vget_high_u8(idx)));
+#endif
+}
+SNAP_INLINE int8x16_t lookup(int8x16_t x, uint8x16_t idx) {
+  return vreinterpretq_s8_u8(lookup(as_u8(x), idx));
+}
+
+/// Returns the elements of the concatenation of a and b at the byte indices
+/// of idx, where the elements for indices of 32 or more are zero.
+SNAP_INLINE uint8x16_t lookup(uint8x16_t a, uint8x16_t b, uint8x16_t idx) {
+#if defined(__aarch64__)
+  const uint8x16x2_t table = {{a, b}};
+  return vqtbl2q_u8(table, idx);
+#else
+  const uint8x8x4_t table = 
+    {{vget_low_u8(a), vget_high_u8(a), vget_low_u8(b), vget_high_u8(b)}};
+  return vcombine_u8(vtbl4_u8(table, vget_low_u8(idx)), 
+                     vtbl4_u8(table, vget_high_u8(idx)));
+#endif
+}
+SNAP_INLINE int8x16_t lookup(int8x16_t a, int8x16_t b, uint8x16_t idx) {
+  return vreinterpretq_s8_u8(lookup(as_u8(a), as_u8(b), idx));
+}
+
+// ---- Reductions --------------------------------------------------------- //
+
+SNAP_INLINE uint32_t hsum(uint8x16_t x) {
+  const uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(x)));
+  return uint32_t(vgetq_lane_u64(sums, 0) + vgetq_lane_u64(sums, 1));
+}
+SNAP_INLINE int32_t hsum(int8x16_t x) {
+  const int64x2_t sums = vpaddlq_s32(vpaddlq_s16(vpaddlq_s8(x)));
+  return int32_t(vgetq_lane_s64(sums, 0) + vgetq_lane_s64(sums, 1));
+}
+
+SNAP_INLINE uint8_t hmin(uint8x16_t x) {
+#if defined(__aarch64__)
+  return vminvq_u8(x);
+#else
+  uint8x8_t m = vpmin_u8(vget_low_u8(x), vget_high_u8(x));
+  m = vpmin_u8(m, m); m = vpmin_u8(m, m); m = vpmin_u8(m, m);
+  return vget_lane_u8(m, 0);
+#endif
+}
+SNAP_INLINE int8_t hmin(int8x16_t x) {
+#if defined(__aarch64__)
+  return vminvq_s8(x);
+#else
+  int8x8_t m = vpmin_s8(vget_low_s8(x), vget_high_s8(x));
+  m = vpmin_s8(m, m); m = vpmin_s8(m, m); m = vpmin_s8(m, m);
+  return vget_lane_s8(m, 0);
+#endif
+}
+
+SNAP_INLINE uint8_t hmax(uint8x16_t x) {
+#if defined(__aarch64__)
+  return vmaxvq_u8(x);
+#else
+  uint8x8_t m = vpmax_u8(vget_low_u8(x), vget_high_u8(x));
+  m = vpmax_u8(m, m); m = vpmax_u8(m, m); m = vpmax_u8(m, m);
+  return vget_lane_u8(m, 0);
+#endif
+}
+SNAP_INLINE int8_t hmax(int8x16_t x) {
+#if defined(__aarch64__)
+  return vmaxvq_s8(x);
+#else
+  int8x8_t m = vpmax_s8(vget_low_s8(x), vget_high_s8(x));
+  m = vpmax_s8(m, m); m = vpmax_s8(m, m); m = vpmax_s8(m, m);
+  return vget_lane_s8(m, 0);
+#endif
+}
+
+} // namespace neon
+} // namespace detail
+} // namespace snap
+
+#endif // SNAP_VECTOR_INTRINSICS_NEON_HPP
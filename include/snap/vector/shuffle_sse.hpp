@@ -0,0 +1,460 @@
+//---- snap/vector/shuffle_sse.hpp ------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  shuffle_sse.hpp
+/// \brief Defines the SSE implementation of the compile time byte shuffles
+///        and permutes of 16 element vectors. The indices are classified by
+///        constexpr functions, and each class of pattern is implemented by
+///        the cheapest instruction sequence for it, so that the common
+///        shifts, rotations, interleaves and dword shuffles don't need a
+///        pshufb control vector, and the SSE2 builds still have a fast path
+///        for them.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_VECTOR_SHUFFLE_SSE_HPP
+#define SNAP_VECTOR_SHUFFLE_SSE_HPP
+
+#include "vector_general.hpp"
+#include "snap/config/simd_instruction_detect.h"
+#include <type_traits>
+
+namespace snap   {
+namespace detail {
+
+/// Defines the classes of shuffle and permute patterns, each of which has a
+/// different implementation.
+enum ShuffleKind : uint8_t {
+  SK_IDENTITY    = 0,   //!< The first source unchanged.
+  SK_ZERO        = 1,   //!< All elements zero.
+  SK_SHIFT_RIGHT = 2,   //!< A byte shift towards element 0 (psrldq).
+  SK_SHIFT_LEFT  = 3,   //!< A byte shift away from element 0 (pslldq).
+  SK_PSHUFD      = 4,   //!< A shuffle of whole dwords (pshufd).
+  SK_PSHUFLHW    = 5,   //!< A shuffle of words in each half (pshuflw/hw).
+  SK_UNPACK_LO   = 6,   //!< An interleave of the low halves (punpckl).
+  SK_UNPACK_HI   = 7,   //!< An interleave of the high halves (punpckh).
+  SK_ALIGNR      = 8,   //!< A window of the concatenation (palignr).
+  SK_SHUFPS      = 9,   //!< Two dwords from each source (shufps).
+  SK_SELECT      = 10,  //!< Each element from either source in place.
+  SK_SWAP        = 11,  //!< A pattern of the sources in the other order.
+  SK_FIRST       = 12,  //!< A shuffle of only the first source.
+  SK_SECOND      = 13,  //!< A shuffle of only the second source.
+  SK_PSHUFB      = 14,  //!< A general shuffle (pshufb).
+  SK_PSHUFB2     = 15,  //!< A general permute (two pshufb and an or).
+  SK_GATHER      = 16   //!< Element by element through memory.
+};
+
+/// Defines a type for each kind of pattern, to select the implementation.
+template <ShuffleKind Kind>
+using ShuffleTag = std::integral_constant<ShuffleKind, Kind>;
+
+#if defined(__SSSE3__)
+static constexpr bool SHUFFLE_PSHUFB = true;
+#else
+static constexpr bool SHUFFLE_PSHUFB = false;
+#endif
+
+/// Returns true if element \p i of the result of \p m is element \p source
+/// of the concatenation of the sources. When \p same is true the sources are
+/// the same vector, so the source is only compared modulo 16.
+/// \param[in] m      The mask to check.
+/// \param[in] i      The index of the element of the result.
+/// \param[in] source The index of the element of the sources.
+/// \param[in] same   If both sources are the same vector.
+constexpr bool lane_is(const ShuffleMask& m, uint8_t i, uint8_t source,
+                       bool same) {
+  return !is_zero_lane(m, i) &&
+    (same ? m.index[i] % 16 == source % 16 : m.index[i] == source);
+}
+
+/// Returns true if no element of \p m is zero.
+/// \param[in] m The mask to check.
+constexpr bool has_no_zeros(const ShuffleMask& m) {
+  for (uint8_t i = 0; i < 16; ++i) {
+    if (is_zero_lane(m, i))
+      return false;
+  }
+  return true;
+}
+
+/// Returns true if \p m uses an element of source \p source.
+/// \param[in] m      The mask to check.
+/// \param[in] source The index of the source, 0 or 1.
+constexpr bool uses_source(const ShuffleMask& m, uint8_t source) {
+  for (uint8_t i = 0; i < 16; ++i) {
+    if (!is_zero_lane(m, i) && m.index[i] / 16 == source)
+      return true;
+  }
+  return false;
+}
+
+/// Returns true if \p m moves whole groups of \p g aligned elements, with no
+/// zeros.
+/// \param[in] m The mask to check.
+/// \param[in] g The number of elements in each group.
+constexpr bool is_granular(const ShuffleMask& m, uint8_t g) {
+  for (uint8_t i = 0; i < 16; ++i) {
+    if (is_zero_lane(m, i) || m.index[i] % g != i % g ||
+        m.index[i] - i % g != m.index[i - i % g])
+      return false;
+  }
+  return true;
+}
+
+/// Returns \p m with the sources swapped.
+/// \param[in] m The mask to swap the sources of.
+constexpr ShuffleMask swap_sources(ShuffleMask m) {
+  for (uint8_t i = 0; i < 16; ++i) {
+    if (!is_zero_lane(m, i))
+      m.index[i] ^= 16;
+  }
+  return m;
+}
+
+/// Returns the number of elements \p m shifts the source by, towards
+/// element 0 when \p right is true, with zeros shifted in, or 0 if \p m is
+/// not a shift.
+/// \param[in] m     The mask to check.
+/// \param[in] right The direction of the shift.
+constexpr uint8_t shift_amount(const ShuffleMask& m, bool right) {
+  for (uint8_t n = 1; n < 16; ++n) {
+    bool shift = true;
+    for (uint8_t i = 0; i < 16 && shift; ++i) {
+      const int source = right ? i + n : i - n;
+      shift = source >= 0 && source < 16
+            ? lane_is(m, i, uint8_t(source), false) : is_zero_lane(m, i);
+    }
+    if (shift)
+      return n;
+  }
+  return 0;
+}
+
+/// Returns the offset of the window of the concatenation of the sources
+/// which \p m selects, or 0 if \p m is not such a window.
+/// \param[in] m    The mask to check.
+/// \param[in] same If both sources are the same vector.
+constexpr uint8_t alignr_amount(const ShuffleMask& m, bool same) {
+  for (uint8_t n = 1; n < 16; ++n) {
+    bool window = true;
+    for (uint8_t i = 0; i < 16 && window; ++i)
+      window = lane_is(m, i, i + n, same);
+    if (window)
+      return n;
+  }
+  return 0;
+}
+
+/// Returns the size of the groups of elements which \p m interleaves from
+/// the low (or high) halves of the sources, or 0 if \p m is not an
+/// interleave.
+/// \param[in] m    The mask to check.
+/// \param[in] high If the high halves are interleaved.
+/// \param[in] same If both sources are the same vector.
+constexpr uint8_t unpack_granularity(const ShuffleMask& m, bool high,
+                                     bool same) {
+  for (uint8_t g = 1; g <= 8; g *= 2) {
+    bool unpack = true;
+    for (uint8_t i = 0; i < 16 && unpack; ++i) {
+      const uint8_t group = i / g;
+      const uint8_t source = (group % 2) * 16 + (high ? 8 : 0) +
+                             (group / 2) * g + i % g;
+      unpack = lane_is(m, i, source, same);
+    }
+    if (unpack)
+      return g;
+  }
+  return 0;
+}
+
+/// Returns true if \p m is a shuffle of words within each half of a single
+/// source, which pshuflw and pshufhw can do.
+/// \param[in] m The mask to check.
+constexpr bool is_pshuflhw(const ShuffleMask& m) {
+  if (!is_granular(m, 2))
+    return false;
+  for (uint8_t i = 0; i < 16; ++i) {
+    if (m.index[i] / 8 != i / 8)
+      return false;
+  }
+  return true;
+}
+
+/// Returns true if \p m takes the low two dwords from the first source and
+/// the high two from the second, which shufps can do.
+/// \param[in] m The mask to check.
+constexpr bool is_shufps(const ShuffleMask& m) {
+  if (!is_granular(m, 4))
+    return false;
+  for (uint8_t i = 0; i < 16; ++i) {
+    if (m.index[i] / 16 != i / 8)
+      return false;
+  }
+  return true;
+}
+
+/// Returns true if each element of \p m is the element in the same place of
+/// one of the sources, so that \p m is a blend.
+/// \param[in] m The mask to check.
+constexpr bool is_select(const ShuffleMask& m) {
+  for (uint8_t i = 0; i < 16; ++i) {
+    if (!lane_is(m, i, i, false) && !lane_is(m, i, i + 16, false))
+      return false;
+  }
+  return true;
+}
+
+/// Returns the immediate which shuffles the dwords of \p m, modulo 4, so
+/// that it is the same for pshufd and for shufps.
+/// \param[in] m The mask to get the immediate for.
+constexpr int dword_immediate(const ShuffleMask& m) {
+  int imm = 0;
+  for (uint8_t k = 0; k < 4; ++k)
+    imm |= ((m.index[4 * k] / 4) % 4) << (2 * k);
+  return imm;
+}
+
+/// Returns the immediate for pshuflw, when \p high is false, or for pshufhw.
+/// \param[in] m    The mask to get the immediate for.
+/// \param[in] high If the immediate is for the high half.
+constexpr int word_immediate(const ShuffleMask& m, bool high) {
+  int imm = 0;
+  for (uint8_t k = 0; k < 4; ++k)
+    imm |= ((m.index[2 * k + (high ? 8 : 0)] / 2) % 4) << (2 * k);
+  return imm;
+}
+
+/// Returns the immediate for pblendw, for a select of whole words.
+/// \param[in] m The mask to get the immediate for.
+constexpr int blend_immediate(const ShuffleMask& m) {
+  int imm = 0;
+  for (uint8_t k = 0; k < 8; ++k)
+    imm |= (m.index[2 * k] / 16) << k;
+  return imm;
+}
+
+/// Returns the kind of the shuffle of a single source with mask \p m.
+/// \param[in] m The mask to classify.
+constexpr ShuffleKind shuffle_kind(const ShuffleMask& m) {
+  bool identity = true, zero = true;
+  for (uint8_t i = 0; i < 16; ++i) {
+    identity = identity && lane_is(m, i, i, false);
+    zero     = zero && is_zero_lane(m, i);
+  }
+  if (identity)                          return SK_IDENTITY;
+  if (zero)                              return SK_ZERO;
+  if (shift_amount(m, true))             return SK_SHIFT_RIGHT;
+  if (shift_amount(m, false))            return SK_SHIFT_LEFT;
+  if (is_granular(m, 4))                 return SK_PSHUFD;
+  if (is_pshuflhw(m))                    return SK_PSHUFLHW;
+  if (unpack_granularity(m, false, true)) return SK_UNPACK_LO;
+  if (unpack_granularity(m, true, true))  return SK_UNPACK_HI;
+  if (alignr_amount(m, true))            return SK_ALIGNR;
+  return SHUFFLE_PSHUFB ? SK_PSHUFB : SK_GATHER;
+}
+
+/// Returns the kind of the permute of two sources with mask \p m.
+/// \param[in] m The mask to classify.
+constexpr ShuffleKind permute_kind(const ShuffleMask& m) {
+  const ShuffleMask swapped = swap_sources(m);
+  if (!uses_source(m, 1))                   return SK_FIRST;
+  if (!uses_source(m, 0))                   return SK_SECOND;
+  if (unpack_granularity(m, false, false))  return SK_UNPACK_LO;
+  if (unpack_granularity(m, true, false))   return SK_UNPACK_HI;
+  if (alignr_amount(m, false))              return SK_ALIGNR;
+  if (is_shufps(m))                         return SK_SHUFPS;
+  if (is_select(m))                         return SK_SELECT;
+  if (unpack_granularity(swapped, false, false) ||
+      unpack_granularity(swapped, true, false)  ||
+      alignr_amount(swapped, false) || is_shufps(swapped))
+    return SK_SWAP;
+  return SHUFFLE_PSHUFB ? SK_PSHUFB2 : SK_GATHER;
+}
+
+// ---- Implementations ---------------------------------------------------- //
+
+// Each implementation takes both sources, which are the same vector for a
+// shuffle, so that the patterns which are common to shuffles and permutes
+// have a single implementation.
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i, ShuffleTag<SK_IDENTITY>) {
+  return a;
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i, __m128i, ShuffleTag<SK_ZERO>) {
+  return _mm_setzero_si128();
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i, ShuffleTag<SK_SHIFT_RIGHT>) {
+  constexpr int n = shift_amount(ShuffleMask{{I...}}, true);
+  return _mm_srli_si128(a, n);
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i, ShuffleTag<SK_SHIFT_LEFT>) {
+  constexpr int n = shift_amount(ShuffleMask{{I...}}, false);
+  return _mm_slli_si128(a, n);
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i, ShuffleTag<SK_PSHUFD>) {
+  constexpr int imm = dword_immediate(ShuffleMask{{I...}});
+  return _mm_shuffle_epi32(a, imm);
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i, ShuffleTag<SK_PSHUFLHW>) {
+  // An identity immediate leaves its half unchanged, and is skipped.
+  constexpr int lo = word_immediate(ShuffleMask{{I...}}, false);
+  constexpr int hi = word_immediate(ShuffleMask{{I...}}, true);
+  if (lo != 0xE4)
+    a = _mm_shufflelo_epi16(a, lo);
+  if (hi != 0xE4)
+    a = _mm_shufflehi_epi16(a, hi);
+  return a;
+}
+
+/// Interleaves the groups of \p G elements of the low, or \p High, halves
+/// of \p a and \p b.
+/// \param[in] a The first source.
+/// \param[in] b The second source.
+template <bool High, uint8_t G> SNAP_INLINE
+__m128i unpack_sse(__m128i a, __m128i b) {
+  return G == 1 ? (High ? _mm_unpackhi_epi8(a, b)  : _mm_unpacklo_epi8(a, b))
+       : G == 2 ? (High ? _mm_unpackhi_epi16(a, b) : _mm_unpacklo_epi16(a, b))
+       : G == 4 ? (High ? _mm_unpackhi_epi32(a, b) : _mm_unpacklo_epi32(a, b))
+       :          (High ? _mm_unpackhi_epi64(a, b) : _mm_unpacklo_epi64(a, b));
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i b, ShuffleTag<SK_UNPACK_LO>) {
+  constexpr ShuffleMask m{{I...}};
+  constexpr uint8_t     g = unpack_granularity(m, false, !uses_source(m, 1));
+  return unpack_sse<false, g>(a, b);
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i b, ShuffleTag<SK_UNPACK_HI>) {
+  constexpr ShuffleMask m{{I...}};
+  constexpr uint8_t     g = unpack_granularity(m, true, !uses_source(m, 1));
+  return unpack_sse<true, g>(a, b);
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i b, ShuffleTag<SK_ALIGNR>) {
+  constexpr ShuffleMask m{{I...}};
+  constexpr int         n = alignr_amount(m, !uses_source(m, 1));
+#if defined(__SSSE3__)
+  return _mm_alignr_epi8(b, a, n);
+#else
+  return _mm_or_si128(_mm_srli_si128(a, n), _mm_slli_si128(b, 16 - n));
+#endif
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i b, ShuffleTag<SK_SHUFPS>) {
+  constexpr int imm = dword_immediate(ShuffleMask{{I...}});
+  return _mm_castps_si128(
+    _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), imm));
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i b, ShuffleTag<SK_SELECT>) {
+  const __m128i mask = _mm_setr_epi8(static_cast<char>(I >= 16 ? -1 : 0)...);
+#if defined(__SSE4_1__)
+  constexpr ShuffleMask m{{I...}};
+  constexpr int         imm = blend_immediate(m);
+  return is_granular(m, 2) ? _mm_blend_epi16(a, b, imm)
+                           : _mm_blendv_epi8(a, b, mask);
+#else
+  return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+#endif
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i, ShuffleTag<SK_FIRST>);
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i, __m128i b, ShuffleTag<SK_SECOND>);
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i b, ShuffleTag<SK_SWAP>);
+
+#if defined(__SSSE3__)
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i, ShuffleTag<SK_PSHUFB>) {
+  return _mm_shuffle_epi8(a, _mm_setr_epi8(
+    static_cast<char>(I & SHUFFLE_ZERO ? -128 : I)...));
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i b, ShuffleTag<SK_PSHUFB2>) {
+  return _mm_or_si128(
+    _mm_shuffle_epi8(a, _mm_setr_epi8(
+      static_cast<char>(I & SHUFFLE_ZERO || I >= 16 ? -128 : I)...)),
+    _mm_shuffle_epi8(b, _mm_setr_epi8(
+      static_cast<char>(I & SHUFFLE_ZERO || I < 16 ? -128 : I - 16)...)));
+}
+
+#endif // __SSSE3__
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i b, ShuffleTag<SK_GATHER>) {
+  // The indices are expanded into the set, so there are no branches.
+  SNAP_ALIGN(16) uint8_t in[32];
+  _mm_store_si128(reinterpret_cast<__m128i*>(in), a);
+  _mm_store_si128(reinterpret_cast<__m128i*>(in + 16), b);
+  return _mm_setr_epi8(
+    static_cast<char>(I & SHUFFLE_ZERO ? 0 : in[I % 32])...);
+}
+
+/// Returns the elements of \p v at the indices \p I, choosing the
+/// implementation for the pattern at compile time.
+/// \param[in] v The vector to shuffle.
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_epi8(__m128i v) {
+  return shuffle_sse<I...>(v, v,
+    ShuffleTag<shuffle_kind(ShuffleMask{{I...}})>());
+}
+
+/// Returns the elements of the concatenation of \p a and \p b at the indices
+/// \p I, choosing the implementation for the pattern at compile time.
+/// \param[in] a The first source.
+/// \param[in] b The second source.
+template <uint8_t... I> SNAP_INLINE
+__m128i permute_epi8(__m128i a, __m128i b) {
+  return shuffle_sse<I...>(a, b,
+    ShuffleTag<permute_kind(ShuffleMask{{I...}})>());
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i, ShuffleTag<SK_FIRST>) {
+  return shuffle_epi8<I...>(a);
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i, __m128i b, ShuffleTag<SK_SECOND>) {
+  return shuffle_epi8<(I & SHUFFLE_ZERO ? I : I - 16)...>(b);
+}
+
+template <uint8_t... I> SNAP_INLINE
+__m128i shuffle_sse(__m128i a, __m128i b, ShuffleTag<SK_SWAP>) {
+  return permute_epi8<(I & SHUFFLE_ZERO ? I : I ^ 16)...>(b, a);
+}
+
+} // namespace detail
+} // namespace snap
+
+#endif // SNAP_VECTOR_SHUFFLE_SSE_HPP
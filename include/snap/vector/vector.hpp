@@ -33,28 +33,25 @@
 
 #include "snap/config/simd_instruction_detect.h"
 
-#ifdef NEON_ENABLED
-
-#ifdef NEON64_ENABLED
-
-#endif // NEON64_ENABLED
-
-#elif SSE_ENABLED 
+#if defined(SCALAR_ENABLED)
+#include "vector_scalar.hpp"
+#elif defined(NEON_ENABLED)
+#include "vector_neon.hpp"
+#elif defined(SSE_ENABLED)
 #include "vector_sse.hpp"
+#else 
+ #error "No vector instructions are enabled"
+#endif
 
 namespace snap {
 
 using Vec16x8u = Vector<uint8_t, 16>; //!< A 16 element vec of 8-bit uints.
 using Vec16x8s = Vector<int8_t , 16>; //!< A 16 element vec of 8-bit sints.
+using Vec8x16u = Vector<uint16_t, 8>; //!< An 8 element vec of 16-bit uints.
+using Vec8x16s = Vector<int16_t , 8>; //!< An 8 element vec of 16-bit sints.
+using Vec4x32u = Vector<uint32_t, 4>; //!< A 4 element vec of 32-bit uints.
+using Vec4x32s = Vector<int32_t , 4>; //!< A 4 element vec of 32-bit sints.
 
 } // namespace snap
 
-#elif AVX_ENABLED 
-
-#elif AVX2_ENABLED 
-
-#else 
- #error "No vector instructions are enabled"
-#endif
-
 #endif // SNAP_SVEC_SVEC_HPP
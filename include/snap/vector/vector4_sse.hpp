@@ -0,0 +1,169 @@
+//---- snap/vector/vector4_sse.hpp ------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  vector4_sse.hpp
+/// \brief Defiition of Vector class SSE implementation for vectors with 4
+///        32-bit integer elements. These are mostly used as accumulators for
+///        the results of operations on vectors with narrower elements.
+///
+///        -) Vec<uint32_t|int32_t, 4> : Vec of 4 32 bit ints. 
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_VECTOR_VECTOR4_SSE_HPP
+#define SNAP_VECTOR_VECTOR4_SSE_HPP
+
+#include "vector_general.hpp"
+#include "snap/config/simd_instruction_detect.h"
+#include <type_traits>
+
+namespace snap {
+
+/// Implementation of Vector class for integer cases and SSE instructions where
+/// the width of the vector is 4 elements and the data type can be either a
+/// 32-bit signed or unsigned integer.
+/// \tparam DType The type of the data elements.
+template <typename DType>
+class Vector<DType, 4> {
+ public:
+  using VecDType = __m128i;               //!< Alias for the vector data type.
+  using VecType  = Vector<DType, 4>;      //!< Alias for the type of vector.
+
+  /// Alias for the type of the result of a horizontal sum.
+  using SumType  = 
+    std::conditional_t<std::is_signed<DType>::value, int64_t, uint64_t>;
+
+  static constexpr uint8_t width = 4;     //!< Width of the vector.
+
+  // ---- Constructors ----------------------------------------------------- //
+
+  /// Default constructor: does nothing.
+  Vector() {}
+
+  /// Constructor: Create vector from iternal intrinsic type.
+  /// \param[in] x The intrinsic variable to use to initialize the internal 
+  ///              vector.
+  Vector(const VecDType& x);
+
+  /// Constructor: Broadcasts a single 32 bit int of type DType into the 
+  /// vector. 
+  /// \param[in] x The 32 bit int to broadcast.
+  Vector(DType x);
+
+  // ---- Operators -------------------------------------------------------- //
+  
+  /// Cast operator: Allow conversion to the intrinsic type.
+  /// \return The internal intrinsic vector.
+  operator __m128i() const;
+
+  /// Access operator: Allows a specific element of the vector to be fetched.
+  /// This does not check bounds due to performance implications.
+  /// \param[in] idx The index of the element to fetch.
+  DType operator[](uint8_t idx) const;
+
+  // ---- General Operations ----------------------------------------------- //
+
+  /// Load operation: Loads the vector from contiguous, aligned or unaligned
+  /// memory.
+  /// \param[in] p A pointer to the start of the memory to load.
+  void load(const void* p);
+
+  /// Store operation: Stores the vector into contiguous memory, which must
+  /// be aligned on a 16 byte boundary.
+  /// \param[in] p A pointer to the start of the aligned memory.
+  void store(void* p) const;
+
+  /// Store operation: Stores the vector into contiguous aligned or unaligned
+  /// memory.
+  /// \param[in] p A pointer to the start of the memory.
+  void storeu(void* p) const;
+
+  // ---- Reductions ------------------------------------------------------- //
+
+  /// Horizontal sum: Returns the sum of all the elements in the vector,
+  /// widened so that the sum can not overflow.
+  SumType hsum() const;
+
+ private:
+  VecDType Data;                            //!< Data for the vector.
+
+} SNAP_ALIGNED;
+
+// ---- Implementation ----------------------------------------------------- //
+
+template <typename DT> SNAP_INLINE
+Vector<DT, 4>::Vector(const VecDType& x) {
+  Data = x;
+}
+
+template <typename DT> SNAP_INLINE 
+Vector<DT, 4>::Vector(DT x) {
+  Data = _mm_set1_epi32(static_cast<int32_t>(x));
+}
+
+template <typename DT> SNAP_INLINE
+Vector<DT, 4>::operator __m128i() const {
+  return Data;
+}
+
+template <typename DT> SNAP_INLINE
+DT Vector<DT, 4>::operator[](uint8_t idx) const {
+  SNAP_ALIGN(16) DT dataArray[4];
+  store(dataArray);
+  return dataArray[idx];
+}
+
+template <typename DT> SNAP_INLINE
+void Vector<DT, 4>::load(const void* p) {
+  Data = _mm_loadu_si128(reinterpret_cast<VecDType const*>(p));
+}
+
+template <typename DT> SNAP_INLINE 
+void Vector<DT, 4>::store(void* p) const {
+  _mm_store_si128(reinterpret_cast<VecDType*>(p), Data);
+}
+
+template <typename DT> SNAP_INLINE 
+void Vector<DT, 4>::storeu(void* p) const {
+  _mm_storeu_si128(reinterpret_cast<VecDType*>(p), Data);
+}
+
+template <typename DT> SNAP_INLINE
+typename Vector<DT, 4>::SumType Vector<DT, 4>::hsum() const {
+  SNAP_ALIGN(16) DT dataArray[4];
+  store(dataArray);
+  return SumType(dataArray[0]) + SumType(dataArray[1]) + 
+         SumType(dataArray[2]) + SumType(dataArray[3]);
+}
+
+// ---- Arithmetic --------------------------------------------------------- //
+
+/// Addition operator: Adds each of the elements in \p a and \p b, wrapping
+/// on overflow.
+/// \param[in] a The first vector to add.
+/// \param[in] b The second vector to add.
+template <typename DT> SNAP_INLINE
+Vector<DT, 4> operator+(const Vector<DT, 4>& a, const Vector<DT, 4>& b) {
+  return _mm_add_epi32(a, b);
+}
+
+/// Subtraction operator: Subtracts each of the elements in \p b from the
+/// corresponding elements in \p a, wrapping on overflow.
+/// \param[in] a The vector to subtract from.
+/// \param[in] b The vector to subtract.
+template <typename DT> SNAP_INLINE
+Vector<DT, 4> operator-(const Vector<DT, 4>& a, const Vector<DT, 4>& b) {
+  return _mm_sub_epi32(a, b);
+}
+
+} // namespace snap
+
+#endif // SNAP_VECTOR_VECTOR4_SSE_HPP
@@ -0,0 +1,252 @@
+//---- snap/vector/vector8_neon.hpp ------------------------ -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  vector8_neon.hpp
+/// \brief Defiition of Vector class NEON implementation for vectors with 8
+///        16-bit integer elements. The interface is the same as the SSE
+///        implementation in vector8_sse.hpp.
+///
+///        -) Vec<uint16_t|int16_t, 8> : Vec of 8 16 bit ints. 
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_VECTOR_VECTOR8_NEON_HPP
+#define SNAP_VECTOR_VECTOR8_NEON_HPP
+
+#include "vector4_neon.hpp"
+
+namespace snap {
+
+/// Implementation of Vector class for integer cases and NEON instructions
+/// where the width of the vector is 8 elements and the data type can be 
+/// either a 16-bit signed or unsigned integer.
+/// \tparam DType The type of the data elements.
+template <typename DType>
+class Vector<DType, 8> {
+ public:
+  /// Alias for the vector data type.
+  using VecDType = typename detail::neon::vector_type<DType>::type;
+  using VecType  = Vector<DType, 8>;      //!< Alias for the type of vector.
+
+  static constexpr uint8_t width = 8;     //!< Width of the vector.
+
+  // ---- Constructors ----------------------------------------------------- //
+
+  /// Default constructor: does nothing.
+  Vector() {}
+
+  /// Constructor: Create vector from iternal intrinsic type.
+  /// \param[in] x The intrinsic variable to use to initialize the internal 
+  ///              vector.
+  Vector(const VecDType& x);
+
+  /// Constructor: Broadcasts a single 16 bit int of type DType into the 
+  /// vector. 
+  /// \param[in] x The 16 bit int to broadcast.
+  Vector(DType x);
+
+  // ---- Operators -------------------------------------------------------- //
+  
+  /// Cast operator: Allow conversion to the intrinsic type.
+  /// \return The internal intrinsic vector.
+  operator VecDType() const;
+
+  /// Access operator: Allows a specific element of the vector to be fetched.
+  /// This does not check bounds due to performance implications.
+  /// \param[in] idx The index of the element to fetch.
+  DType operator[](uint8_t idx) const;
+
+  // ---- General Operations ----------------------------------------------- //
+
+  /// Load operation: Loads the vector from contiguous, aligned or unaligned
+  /// memory.
+  /// \param[in] p A pointer to the start of the memory to load.
+  void load(const void* p);
+
+  /// Store operation: Stores the vector into contiguous memory, which must
+  /// be aligned on a 16 byte boundary.
+  /// \param[in] p A pointer to the start of the aligned memory.
+  void store(void* p) const;
+
+  /// Store operation: Stores the vector into contiguous aligned or unaligned
+  /// memory.
+  /// \param[in] p A pointer to the start of the memory.
+  void storeu(void* p) const;
+
+ private:
+  VecDType Data;                            //!< Data for the vector.
+
+} SNAP_ALIGNED;
+
+// ---- Implementation ----------------------------------------------------- //
+
+template <typename DT> SNAP_INLINE
+Vector<DT, 8>::Vector(const VecDType& x) {
+  Data = x;
+}
+
+template <typename DT> SNAP_INLINE 
+Vector<DT, 8>::Vector(DT x) {
+  Data = detail::neon::dup(x);
+}
+
+template <typename DT> SNAP_INLINE
+Vector<DT, 8>::operator VecDType() const {
+  return Data;
+}
+
+template <typename DT> SNAP_INLINE
+DT Vector<DT, 8>::operator[](uint8_t idx) const {
+  SNAP_ALIGN(16) DT dataArray[8];
+  store(dataArray);
+  return dataArray[idx];
+}
+
+template <typename DT> SNAP_INLINE
+void Vector<DT, 8>::load(const void* p) {
+  Data = detail::neon::load(static_cast<const DT*>(p));
+}
+
+template <typename DT> SNAP_INLINE 
+void Vector<DT, 8>::store(void* p) const {
+  detail::neon::store(static_cast<DT*>(p), Data);
+}
+
+template <typename DT> SNAP_INLINE 
+void Vector<DT, 8>::storeu(void* p) const {
+  detail::neon::store(static_cast<DT*>(p), Data);
+}
+
+// ---- Arithmetic --------------------------------------------------------- //
+
+/// Addition operator: Adds each of the elements in \p a and \p b, wrapping
+/// on overflow.
+/// \param[in] a The first vector to add.
+/// \param[in] b The second vector to add.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator+(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  using V = typename Vector<DT, 8>::VecDType;
+  return detail::neon::add(V(a), V(b));
+}
+
+/// Subtraction operator: Subtracts each of the elements in \p b from the
+/// corresponding elements in \p a, wrapping on overflow.
+/// \param[in] a The vector to subtract from.
+/// \param[in] b The vector to subtract.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator-(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  using V = typename Vector<DT, 8>::VecDType;
+  return detail::neon::sub(V(a), V(b));
+}
+
+/// Multiplication operator: Multiplies each of the elements in \p a and \p
+/// b, keeping the low 16 bits of each product.
+/// \param[in] a The first vector to multiply.
+/// \param[in] b The second vector to multiply.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator*(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  using V = typename Vector<DT, 8>::VecDType;
+  return detail::neon::mul(V(a), V(b));
+}
+
+/// Saturating subtract: Subtracts each of the elements in \p b from the
+/// corresponding elements in \p a, saturating at zero.
+/// \param[in] a The vector to subtract from.
+/// \param[in] b The vector to subtract.
+SNAP_INLINE Vector<uint16_t, 8> 
+subs(const Vector<uint16_t, 8>& a, const Vector<uint16_t, 8>& b) {
+  return detail::neon::subs(uint16x8_t(a), uint16x8_t(b));
+}
+
+/// Widen low: Returns the low 4 elements of \p a zero extended to 32 bits.
+/// \param[in] a The vector to widen.
+SNAP_INLINE Vector<uint32_t, 4> widen_lo(const Vector<uint16_t, 8>& a) {
+  return vmovl_u16(vget_low_u16(a));
+}
+
+/// Widen high: Returns the high 4 elements of \p a zero extended to 32 bits.
+/// \param[in] a The vector to widen.
+SNAP_INLINE Vector<uint32_t, 4> widen_hi(const Vector<uint16_t, 8>& a) {
+  return vmovl_u16(vget_high_u16(a));
+}
+
+/// Multiply add: Multiplies the signed 16-bit elements of \p a and \p b and
+/// then adds each adjacent pair of the 32-bit products, i.e element i of the
+/// result is a[2i] * b[2i] + a[2i + 1] * b[2i + 1].
+/// \param[in] a The first vector to multiply.
+/// \param[in] b The second vector to multiply.
+template <typename DT> SNAP_INLINE
+Vector<int32_t, 4> madd(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  using V = typename Vector<DT, 8>::VecDType;
+  const int16x8_t x  = detail::neon::as_s16(V(a));
+  const int16x8_t y  = detail::neon::as_s16(V(b));
+  const int32x4_t lo = vmull_s16(vget_low_s16(x) , vget_low_s16(y));
+  const int32x4_t hi = vmull_s16(vget_high_s16(x), vget_high_s16(y));
+#if defined(__aarch64__)
+  return vpaddq_s32(lo, hi);
+#else
+  return vcombine_s32(vpadd_s32(vget_low_s32(lo), vget_high_s32(lo)),
+                      vpadd_s32(vget_low_s32(hi), vget_high_s32(hi)));
+#endif
+}
+
+// ---- Bitwise ------------------------------------------------------------ //
+
+/// Bitwise and operator: Returns the bitwise and of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator&(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  using V = typename Vector<DT, 8>::VecDType;
+  return detail::neon::bit_and(V(a), V(b));
+}
+
+/// Bitwise or operator: Returns the bitwise or of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator|(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  using V = typename Vector<DT, 8>::VecDType;
+  return detail::neon::bit_or(V(a), V(b));
+}
+
+/// Bitwise xor operator: Returns the bitwise exclusive or of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator^(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  using V = typename Vector<DT, 8>::VecDType;
+  return detail::neon::bit_xor(V(a), V(b));
+}
+
+/// Bitwise not operator: Returns the bitwise complement of \p a.
+/// \param[in] a The vector to complement.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator~(const Vector<DT, 8>& a) {
+  using V = typename Vector<DT, 8>::VecDType;
+  return detail::neon::bit_not(V(a));
+}
+
+// ---- Comparison --------------------------------------------------------- //
+
+/// Compare equal: Returns a vector where each element is all ones if the
+/// corresponding elements in \p a and \p b are equal, and zero otherwise.
+/// \param[in] a The first vector to compare.
+/// \param[in] b The second vector to compare.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> cmpeq(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  using V = typename Vector<DT, 8>::VecDType;
+  return detail::neon::cmpeq(V(a), V(b));
+}
+
+} // namespace snap
+
+#endif // SNAP_VECTOR_VECTOR8_NEON_HPP
@@ -0,0 +1,233 @@
+//---- snap/vector/vector8_sse.hpp ------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  vector8_sse.hpp
+/// \brief Defiition of Vector class SSE implementation for vectors with 8
+///        16-bit integer elements. These are mostly used for intermediate
+///        results when operations on 8-bit elements need more precision.
+///
+///        -) Vec<uint16_t|int16_t, 8> : Vec of 8 16 bit ints. 
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_VECTOR_VECTOR8_SSE_HPP
+#define SNAP_VECTOR_VECTOR8_SSE_HPP
+
+#include "vector4_sse.hpp"
+
+namespace snap {
+
+/// Implementation of Vector class for integer cases and SSE instructions where
+/// the width of the vector is 8 elements and the data type can be either a
+/// 16-bit signed or unsigned integer.
+/// \tparam DType The type of the data elements.
+template <typename DType>
+class Vector<DType, 8> {
+ public:
+  using VecDType = __m128i;               //!< Alias for the vector data type.
+  using VecType  = Vector<DType, 8>;      //!< Alias for the type of vector.
+
+  static constexpr uint8_t width = 8;     //!< Width of the vector.
+
+  // ---- Constructors ----------------------------------------------------- //
+
+  /// Default constructor: does nothing.
+  Vector() {}
+
+  /// Constructor: Create vector from iternal intrinsic type.
+  /// \param[in] x The intrinsic variable to use to initialize the internal 
+  ///              vector.
+  Vector(const VecDType& x);
+
+  /// Constructor: Broadcasts a single 16 bit int of type DType into the 
+  /// vector. 
+  /// \param[in] x The 16 bit int to broadcast.
+  Vector(DType x);
+
+  // ---- Operators -------------------------------------------------------- //
+  
+  /// Cast operator: Allow conversion to the intrinsic type.
+  /// \return The internal intrinsic vector.
+  operator __m128i() const;
+
+  /// Access operator: Allows a specific element of the vector to be fetched.
+  /// This does not check bounds due to performance implications.
+  /// \param[in] idx The index of the element to fetch.
+  DType operator[](uint8_t idx) const;
+
+  // ---- General Operations ----------------------------------------------- //
+
+  /// Load operation: Loads the vector from contiguous, aligned or unaligned
+  /// memory.
+  /// \param[in] p A pointer to the start of the memory to load.
+  void load(const void* p);
+
+  /// Store operation: Stores the vector into contiguous memory, which must
+  /// be aligned on a 16 byte boundary.
+  /// \param[in] p A pointer to the start of the aligned memory.
+  void store(void* p) const;
+
+  /// Store operation: Stores the vector into contiguous aligned or unaligned
+  /// memory.
+  /// \param[in] p A pointer to the start of the memory.
+  void storeu(void* p) const;
+
+ private:
+  VecDType Data;                            //!< Data for the vector.
+
+} SNAP_ALIGNED;
+
+// ---- Implementation ----------------------------------------------------- //
+
+template <typename DT> SNAP_INLINE
+Vector<DT, 8>::Vector(const VecDType& x) {
+  Data = x;
+}
+
+template <typename DT> SNAP_INLINE 
+Vector<DT, 8>::Vector(DT x) {
+  Data = _mm_set1_epi16(static_cast<int16_t>(x));
+}
+
+template <typename DT> SNAP_INLINE
+Vector<DT, 8>::operator __m128i() const {
+  return Data;
+}
+
+template <typename DT> SNAP_INLINE
+DT Vector<DT, 8>::operator[](uint8_t idx) const {
+  SNAP_ALIGN(16) DT dataArray[8];
+  store(dataArray);
+  return dataArray[idx];
+}
+
+template <typename DT> SNAP_INLINE
+void Vector<DT, 8>::load(const void* p) {
+  Data = _mm_loadu_si128(reinterpret_cast<VecDType const*>(p));
+}
+
+template <typename DT> SNAP_INLINE 
+void Vector<DT, 8>::store(void* p) const {
+  _mm_store_si128(reinterpret_cast<VecDType*>(p), Data);
+}
+
+template <typename DT> SNAP_INLINE 
+void Vector<DT, 8>::storeu(void* p) const {
+  _mm_storeu_si128(reinterpret_cast<VecDType*>(p), Data);
+}
+
+// ---- Arithmetic --------------------------------------------------------- //
+
+/// Addition operator: Adds each of the elements in \p a and \p b, wrapping
+/// on overflow.
+/// \param[in] a The first vector to add.
+/// \param[in] b The second vector to add.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator+(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  return _mm_add_epi16(a, b);
+}
+
+/// Subtraction operator: Subtracts each of the elements in \p b from the
+/// corresponding elements in \p a, wrapping on overflow.
+/// \param[in] a The vector to subtract from.
+/// \param[in] b The vector to subtract.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator-(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  return _mm_sub_epi16(a, b);
+}
+
+/// Multiplication operator: Multiplies each of the elements in \p a and \p
+/// b, keeping the low 16 bits of each product.
+/// \param[in] a The first vector to multiply.
+/// \param[in] b The second vector to multiply.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator*(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  return _mm_mullo_epi16(a, b);
+}
+
+/// Saturating subtract: Subtracts each of the elements in \p b from the
+/// corresponding elements in \p a, saturating at zero.
+/// \param[in] a The vector to subtract from.
+/// \param[in] b The vector to subtract.
+SNAP_INLINE Vector<uint16_t, 8> 
+subs(const Vector<uint16_t, 8>& a, const Vector<uint16_t, 8>& b) {
+  return _mm_subs_epu16(a, b);
+}
+
+/// Widen low: Returns the low 4 elements of \p a zero extended to 32 bits.
+/// \param[in] a The vector to widen.
+SNAP_INLINE Vector<uint32_t, 4> widen_lo(const Vector<uint16_t, 8>& a) {
+  return _mm_unpacklo_epi16(a, _mm_setzero_si128());
+}
+
+/// Widen high: Returns the high 4 elements of \p a zero extended to 32 bits.
+/// \param[in] a The vector to widen.
+SNAP_INLINE Vector<uint32_t, 4> widen_hi(const Vector<uint16_t, 8>& a) {
+  return _mm_unpackhi_epi16(a, _mm_setzero_si128());
+}
+
+/// Multiply add: Multiplies the signed 16-bit elements of \p a and \p b and
+/// then adds each adjacent pair of the 32-bit products, i.e element i of the
+/// result is a[2i] * b[2i] + a[2i + 1] * b[2i + 1].
+/// \param[in] a The first vector to multiply.
+/// \param[in] b The second vector to multiply.
+template <typename DT> SNAP_INLINE
+Vector<int32_t, 4> madd(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  return _mm_madd_epi16(a, b);
+}
+
+// ---- Bitwise ------------------------------------------------------------ //
+
+/// Bitwise and operator: Returns the bitwise and of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator&(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  return _mm_and_si128(a, b);
+}
+
+/// Bitwise or operator: Returns the bitwise or of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator|(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  return _mm_or_si128(a, b);
+}
+
+/// Bitwise xor operator: Returns the bitwise exclusive or of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator^(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  return _mm_xor_si128(a, b);
+}
+
+/// Bitwise not operator: Returns the bitwise complement of \p a.
+/// \param[in] a The vector to complement.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator~(const Vector<DT, 8>& a) {
+  return _mm_xor_si128(a, _mm_set1_epi16(-1));
+}
+
+// ---- Comparison --------------------------------------------------------- //
+
+/// Compare equal: Returns a vector where each element is all ones if the
+/// corresponding elements in \p a and \p b are equal, and zero otherwise.
+/// \param[in] a The first vector to compare.
+/// \param[in] b The second vector to compare.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> cmpeq(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  return _mm_cmpeq_epi16(a, b);
+}
+
+} // namespace snap
+
+#endif // SNAP_VECTOR_VECTOR8_SSE_HPP
@@ -18,6 +18,7 @@
 #ifndef SNAP_VECTOR_VECTOR_GENERAL_HPP
 #define SNAP_VECTOR_VECTOR_GENERAL_HPP
 
+#include <cstdint>
 #include <limits>
 
 namespace snap {
@@ -57,6 +58,39 @@ namespace snap {
 template <typename DType, uint8_t Width>
 class Vector;
 
+/// Defines the index which sets an element of the result of a shuffle or a
+/// permute to zero. Any index with the high bit set is also zero.
+static constexpr uint8_t SHUFFLE_ZERO = 0x80;
+
+namespace detail {
+
+/// Defines the indices of a shuffle or permute of 16 element vectors, as a
+/// literal type, so that the patterns can be classified at compile time.
+struct ShuffleMask {
+  uint8_t index[16];  //!< The source index of each element of the result.
+};
+
+/// Returns true if element \p i of the result of mask \p m is zero.
+/// \param[in] m The mask to check.
+/// \param[in] i The index of the element.
+constexpr bool is_zero_lane(const ShuffleMask& m, uint8_t i) {
+  return (m.index[i] & SHUFFLE_ZERO) != 0;
+}
+
+/// Returns true if all the indices of \p m which are not zero index one of
+/// \p sources source vectors.
+/// \param[in] m       The mask to check.
+/// \param[in] sources The number of source vectors.
+constexpr bool is_valid_mask(const ShuffleMask& m, uint8_t sources) {
+  for (uint8_t i = 0; i < 16; ++i) {
+    if (!is_zero_lane(m, i) && m.index[i] >= 16 * sources)
+      return false;
+  }
+  return true;
+}
+
+} // namespace detail
+
 /*
 
 /// Provides masks to use to extract elements from AoS to SoA based on the
@@ -0,0 +1,458 @@
+//---- snap/vector/vector_neon.hpp ------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  vector_neon.hpp
+/// \brief Defiition of Vector class NEON implementation. The interface is the
+///        same as the SSE implementation, so that code written against the
+///        Vector interface runs unmodified on ARM. The possible options for
+///        snap vector types when using NEON instructions are the following:
+///
+///        -) Vec<uint8_t|int8_t, 16>   : Vec of 16 8 bit ints. 
+///        -) Vec<uint16_t|int16_t, 8>  : Vec of 8 16 bit ints. 
+///        -) Vec<uint32_t|int32_t, 4>  : Vec of 4 32 bit ints. 
+///
+///\note   The aliases are defined in vector.hpp.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_VECTOR_VECTOR_NEON_HPP
+#define SNAP_VECTOR_VECTOR_NEON_HPP
+
+#include "intrinsics_neon.hpp"
+#include "vector_general.hpp"
+#include "vector4_neon.hpp"
+#include "vector8_neon.hpp"
+#include "snap/config/simd_instruction_detect.h"
+#include <type_traits>
+
+namespace snap {
+
+/// Implementation of Vector class for integer cases and NEON instructions
+/// where the width of the vector is 16 elements and the data type can be 
+/// either an 8-bit signed or unsigned integer.
+/// \tparam DType The type of the data elements.
+template <typename DType>
+class Vector<DType, 16> {
+ public:
+  /// Alias for the vector data type.
+  using VecDType = typename detail::neon::vector_type<DType>::type;
+  using VecType  = Vector<DType, 16>;     //!< Alias for the type of vector.
+
+  /// Alias for the type of the result of a horizontal sum.
+  using SumType  = 
+    std::conditional_t<std::is_signed<DType>::value, int32_t, uint32_t>;
+
+  static constexpr uint8_t width = 16;    //!< Width of the vector.
+
+  // ---- Constructors ----------------------------------------------------- //
+
+  /// Default constructor: does nothing.
+  Vector() {}
+
+  /// Constructor: Create vector from iternal intrinsic type.
+  /// \param[in] x The intrinsic variable to use to initialize the internal 
+  ///              vector.
+  Vector(const VecDType& x);
+
+  /// Constructor: Broadcasts a single 8 bit int of type DType into the vector. 
+  /// \param[in] x The 8 bit int to broadcast.
+  Vector(DType x);
+
+  /// Constructor: Sets a pointer to an array of elements as vector elements.
+  /// \param[in] p A pointer to the start of the elements to load into to
+  ///              vector.
+  Vector(DType* p);
+
+  // ---- Operators -------------------------------------------------------- //
+  
+  /// Cast operator: Allow conversion to the intrinsic type.
+  /// \return The internal intrinsic vector.
+  operator VecDType() const;
+  
+  /// Assignment operator: Allows the conversion from intrinsic types.
+  /// \param[in] x The intrinsic variable to use ti set the internal vector.
+  /// \return      A reference to the vector.
+  VecType& operator=(const VecDType& x);
+
+  /// Access operator: Allows a specific element of the vector to be fetched.
+  /// This does not check bounds due to performance implications.
+  /// \param[in] idx The index of the element to fetch.
+  DType operator[](uint8_t idx) const;
+
+  // ---- General Operations ----------------------------------------------- //
+ 
+  /// Load operation: Allows a pointer to contiguous, aligned or unaligned 
+  /// memory to be loaded as a vector data type. NEON loads have no alignment
+  /// requirement, so this is the same as loada.
+  /// \param[in] p A pointer to the start of the contiguous aligned/unaligned 
+  ///              memory to load as a vector of elements.
+  void load(const void* p);
+
+  /// Load operation: Allows a pointer to contiguous, aligned memory to be
+  /// loaded as a vector data type.
+  /// \param[in] p A pointer to the start of the contiguous aligned memory to 
+  ///              load as a vector of elements.
+  void loada(const void* p);
+
+  /// Load operation: Loads 8 elements from contiguous, aligned or unaligned
+  /// memory into the low half of the vector, and zeros the high half.
+  /// \param[in] p A pointer to the start of the 8 elements to load.
+  void loadl(const void* p);
+
+  /// Store operation: Allows the vector to be stored in contiguous memory. The 
+  /// memory needs to be aligned on a 16 byte boundary.
+  /// \param[in] p A pointer to the start of the contiguous aligned memory.
+  void store(void* p) const;
+
+  /// Store operation: Allows the vector to be stored in contiguous memory. The
+  /// memory does not need to be aligned on a 16 byte boundary.
+  /// \param[in] p A pointer to the start of the contiguous aligned or
+  ///              unaligned memory.
+  void storeu(void* p) const;
+
+  /// Stream operation: Stores the vector into contiguous memory, which must
+  /// be aligned on a 16 byte boundary. NEON has no non-temporal store 
+  /// intrinsic, so this is a regular store, and is only provided so that the
+  /// interface is the same as for SSE.
+  /// \param[in] p A pointer to the start of the contiguous aligned memory.
+  void stream(void* p) const;
+
+  /// Set operation: Sets a specific element of the vector to the specified
+  /// value.
+  /// \param[in] idx The index of the element to set the value of.
+  /// \param[in] val The value to set the element to.
+  void set(uint8_t idx, DType val);
+
+  // ---- Reductions ------------------------------------------------------- //
+
+  /// Horizontal sum: Returns the sum of all the elements in the vector, using
+  /// a chain of pairwise widening adds.
+  SumType hsum() const;
+
+  /// Horizontal min: Returns the smallest element in the vector. On AArch64
+  /// this is a single across-vector instruction, otherwise a log2(16) step
+  /// pairwise reduction is used.
+  DType hmin() const;
+
+  /// Horizontal max: Returns the largest element in the vector, computed the
+  /// same way as hmin.
+  DType hmax() const;
+
+ private:
+  VecDType Data;                            //!< Data for the vector.
+
+} SNAP_ALIGNED;
+
+// ---- Implementation ----------------------------------------------------- //
+
+template <typename DT> SNAP_INLINE
+Vector<DT, 16>::Vector(const VecDType& x) {
+  Data = x;
+}
+
+template <typename DT> SNAP_INLINE 
+Vector<DT, 16>::Vector(DT x) {
+  Data = detail::neon::dup(x);
+}
+
+template <typename DT> SNAP_INLINE 
+Vector<DT, 16>::Vector(DT* p) {
+  load(p);
+}
+
+template <typename DT> SNAP_INLINE
+Vector<DT, 16>::operator VecDType() const {
+  return Data;
+}
+
+template <typename DT> SNAP_INLINE 
+Vector<DT, 16>& Vector<DT, 16>::operator=(const VecDType& x) {
+  Data = x;
+  return *this;
+}
+
+template <typename DT> SNAP_INLINE
+DT Vector<DT, 16>::operator[](uint8_t idx) const {
+  SNAP_ALIGN(16) DT dataArray[16];
+  store(dataArray);
+  return dataArray[idx];
+}
+
+template <typename DT> SNAP_INLINE
+void Vector<DT, 16>::load(const void* p) {
+  Data = detail::neon::load(static_cast<const DT*>(p));
+}
+
+template <typename DT> SNAP_INLINE 
+void Vector<DT, 16>::loada(const void* p) {
+  Data = detail::neon::load(static_cast<const DT*>(p));
+}
+
+template <typename DT> SNAP_INLINE 
+void Vector<DT, 16>::loadl(const void* p) {
+  Data = detail::neon::load_low(static_cast<const DT*>(p));
+}
+
+template <typename DT> SNAP_INLINE 
+void Vector<DT, 16>::store(void* p) const {
+  detail::neon::store(static_cast<DT*>(p), Data);
+}
+
+template <typename DT> SNAP_INLINE 
+void Vector<DT, 16>::storeu(void* p) const {
+  detail::neon::store(static_cast<DT*>(p), Data);
+}
+
+template <typename DT> SNAP_INLINE 
+void Vector<DT, 16>::stream(void* p) const {
+  detail::neon::store(static_cast<DT*>(p), Data);
+}
+
+template <typename DT> SNAP_INLINE 
+void Vector<DT, 16>::set(uint8_t idx, DT val) {
+  SNAP_ALIGN(16) DT tmp[16];
+  store(tmp);
+  tmp[idx] = val;
+  loada(tmp);
+}
+
+template <typename DT> SNAP_INLINE
+typename Vector<DT, 16>::SumType Vector<DT, 16>::hsum() const {
+  return detail::neon::hsum(Data);
+}
+
+template <typename DT> SNAP_INLINE
+DT Vector<DT, 16>::hmin() const {
+  return detail::neon::hmin(Data);
+}
+
+template <typename DT> SNAP_INLINE
+DT Vector<DT, 16>::hmax() const {
+  return detail::neon::hmax(Data);
+}
+
+// ---- Arithmetic --------------------------------------------------------- //
+
+/// Addition operator: Adds each of the elements in \p a and \p b, wrapping
+/// on overflow.
+/// \param[in] a The first vector to add.
+/// \param[in] b The second vector to add.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> operator+(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  using V = typename Vector<DT, 16>::VecDType;
+  return detail::neon::add(V(a), V(b));
+}
+
+/// Subtraction operator: Subtracts each of the elements in \p b from the
+/// corresponding elements in \p a, wrapping on overflow.
+/// \param[in] a The vector to subtract from.
+/// \param[in] b The vector to subtract.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> operator-(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  using V = typename Vector<DT, 16>::VecDType;
+  return detail::neon::sub(V(a), V(b));
+}
+
+/// Saturating add: Adds each of the elements in \p a and \p b, saturating
+/// to the range of DT on overflow.
+/// \param[in] a The first vector to add.
+/// \param[in] b The second vector to add.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> adds(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  using V = typename Vector<DT, 16>::VecDType;
+  return detail::neon::adds(V(a), V(b));
+}
+
+/// Saturating subtract: Subtracts each of the elements in \p b from the
+/// corresponding elements in \p a, saturating to the range of DT on 
+/// overflow.
+/// \param[in] a The vector to subtract from.
+/// \param[in] b The vector to subtract.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> subs(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  using V = typename Vector<DT, 16>::VecDType;
+  return detail::neon::subs(V(a), V(b));
+}
+
+/// Absolute difference: Returns a vector where each element is the absolute
+/// difference of the corresponding unsigned elements in \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+SNAP_INLINE Vector<uint8_t, 16> 
+absdiff(const Vector<uint8_t, 16>& a, const Vector<uint8_t, 16>& b) {
+  return vabdq_u8(a, b);
+}
+
+/// Min: Returns a vector where each element is the minimum of the
+/// corresponding elements in \p a and \p b.
+/// \param[in] a The first vector to compare.
+/// \param[in] b The second vector to compare.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> min(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  using V = typename Vector<DT, 16>::VecDType;
+  return detail::neon::min(V(a), V(b));
+}
+
+/// Max: Returns a vector where each element is the maximum of the
+/// corresponding elements in \p a and \p b.
+/// \param[in] a The first vector to compare.
+/// \param[in] b The second vector to compare.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> max(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  using V = typename Vector<DT, 16>::VecDType;
+  return detail::neon::max(V(a), V(b));
+}
+
+// ---- Bitwise ------------------------------------------------------------ //
+
+/// Bitwise and operator: Returns the bitwise and of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> operator&(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  using V = typename Vector<DT, 16>::VecDType;
+  return detail::neon::bit_and(V(a), V(b));
+}
+
+/// Bitwise or operator: Returns the bitwise or of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> operator|(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  using V = typename Vector<DT, 16>::VecDType;
+  return detail::neon::bit_or(V(a), V(b));
+}
+
+/// Bitwise xor operator: Returns the bitwise exclusive or of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> operator^(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  using V = typename Vector<DT, 16>::VecDType;
+  return detail::neon::bit_xor(V(a), V(b));
+}
+
+/// Bitwise not operator: Returns the bitwise complement of \p a.
+/// \param[in] a The vector to complement.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> operator~(const Vector<DT, 16>& a) {
+  using V = typename Vector<DT, 16>::VecDType;
+  return detail::neon::bit_not(V(a));
+}
+
+// ---- Comparison --------------------------------------------------------- //
+
+/// Compare equal: Returns a vector where each element is all ones if the
+/// corresponding elements in \p a and \p b are equal, and zero otherwise.
+/// \param[in] a The first vector to compare.
+/// \param[in] b The second vector to compare.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> cmpeq(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  using V = typename Vector<DT, 16>::VecDType;
+  return detail::neon::cmpeq(V(a), V(b));
+}
+
+/// Movemask: Returns a 16-bit mask where bit i is the most significant bit of
+/// element i of \p a. NEON has no movemask instruction, so the bits are
+/// shifted into place and then summed across each half of the vector.
+/// \param[in] a The vector to get the mask of.
+template <typename DT> SNAP_INLINE
+uint32_t movemask(const Vector<DT, 16>& a) {
+  using V = typename Vector<DT, 16>::VecDType;
+  return detail::neon::movemask(detail::neon::as_u8(V(a)));
+}
+
+// ---- Permutation -------------------------------------------------------- //
+
+/// Shuffle: Returns a vector where element i is element I_i of \p v, or zero
+/// if I_i is SHUFFLE_ZERO. NEON table lookups take any pattern in a single
+/// instruction, and zero out of range indices, so no classification of the
+/// pattern is needed.
+/// \param[in] v The vector to shuffle.
+/// \tparam    I The 16 source indices, each less than 16, or SHUFFLE_ZERO.
+template <uint8_t... I, typename DT> SNAP_INLINE
+Vector<DT, 16> shuffle(const Vector<DT, 16>& v) {
+  static_assert(sizeof...(I) == 16, "A shuffle needs 16 indices!");
+  static_assert(detail::is_valid_mask(detail::ShuffleMask{{I...}}, 1),
+                "Shuffle indices must be less than 16!");
+  using V = typename Vector<DT, 16>::VecDType;
+  static const uint8_t idx[16] = {I...};
+  return detail::neon::lookup(V(v), vld1q_u8(idx));
+}
+
+/// Permute: Returns a vector where element i is element I_i of the
+/// concatenation of \p a and \p b, where indices 16 to 31 are the elements
+/// of \p b, or zero if I_i is SHUFFLE_ZERO.
+/// \param[in] a The first source.
+/// \param[in] b The second source.
+/// \tparam    I The 16 source indices, each less than 32, or SHUFFLE_ZERO.
+template <uint8_t... I, typename DT> SNAP_INLINE
+Vector<DT, 16> permute(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  static_assert(sizeof...(I) == 16, "A permute needs 16 indices!");
+  static_assert(detail::is_valid_mask(detail::ShuffleMask{{I...}}, 2),
+                "Permute indices must be less than 32!");
+  using V = typename Vector<DT, 16>::VecDType;
+  static const uint8_t idx[16] = {I...};
+  return detail::neon::lookup(V(a), V(b), vld1q_u8(idx));
+}
+
+// ---- Widening ----------------------------------------------------------- //
+
+/// Sum of absolute differences: Returns a vector where elements 0 and 2 are
+/// the sums of the absolute differences of the low and high 8 elements of \p
+/// a and \p b, respectively, and elements 1 and 3 are zero, which matches
+/// the layout of the SSE psadbw result. The total SAD is the horizontal sum 
+/// of the result.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+SNAP_INLINE Vector<uint32_t, 4> 
+sad(const Vector<uint8_t, 16>& a, const Vector<uint8_t, 16>& b) {
+  const uint64x2_t sums = 
+    vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(vabdq_u8(a, b))));
+  return vreinterpretq_u32_u64(sums);
+}
+
+/// Widen low: Returns the low 8 elements of \p a zero extended to 16 bits.
+/// \param[in] a The vector to widen.
+SNAP_INLINE Vector<uint16_t, 8> widen_lo(const Vector<uint8_t, 16>& a) {
+  return vmovl_u8(vget_low_u8(a));
+}
+
+/// Widen high: Returns the high 8 elements of \p a zero extended to 16 bits.
+/// \param[in] a The vector to widen.
+SNAP_INLINE Vector<uint16_t, 8> widen_hi(const Vector<uint8_t, 16>& a) {
+  return vmovl_u8(vget_high_u8(a));
+}
+
+/// Narrow: Returns the elements of \p lo followed by those of \p hi,
+/// saturated to 8 bits.
+/// \param[in] lo The vector of the low 8 elements.
+/// \param[in] hi The vector of the high 8 elements.
+SNAP_INLINE Vector<uint8_t, 16> 
+narrow(const Vector<uint16_t, 8>& lo, const Vector<uint16_t, 8>& hi) {
+  return vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi));
+}
+
+// ---- Memory ------------------------------------------------------------- //
+
+/// Prefetch: Hints that the cache line containing \p p will be read soon.
+/// This never faults, so \p p may be past the end of the data.
+/// \param[in] p A pointer into the cache line to prefetch.
+SNAP_INLINE void prefetch(const void* p) {
+  __builtin_prefetch(p);
+}
+
+/// Stream fence: Does nothing, since stream uses regular stores with NEON.
+SNAP_INLINE void stream_fence() {}
+
+} // namespace snap
+
+#endif // SNAP_VECTOR_VECTOR_NEON_HPP
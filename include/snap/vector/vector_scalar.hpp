@@ -0,0 +1,541 @@
+//---- snap/vector/vector_scalar.hpp ----------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  vector_scalar.hpp
+/// \brief Defiition of the portable scalar Vector implementation. This has
+///        the same interface and the same results (including wrapping,
+///        saturation and lane layout) as the SIMD implementations, but is
+///        written with plain loops. It is used when no SIMD instructions are
+///        available, or when SNAP_FORCE_SCALAR is defined, and is the
+///        reference the SIMD backends are tested against.
+///
+///        -) Vec<uint8_t|int8_t, 16>   : Vec of 16 8 bit ints. 
+///        -) Vec<uint16_t|int16_t, 8>  : Vec of 8 16 bit ints. 
+///        -) Vec<uint32_t|int32_t, 4>  : Vec of 4 32 bit ints. 
+///
+///\note   The aliases are defined in vector.hpp.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_VECTOR_VECTOR_SCALAR_HPP
+#define SNAP_VECTOR_VECTOR_SCALAR_HPP
+
+#include "vector_general.hpp"
+#include "snap/config/simd_instruction_detect.h"
+#include <array>
+#include <cstring>
+#include <type_traits>
+
+namespace snap {
+
+/// Implementation of the Vector class for the scalar backend, for any of the
+/// integer data types and any width.
+/// \tparam DType The type of the data elements.
+/// \tparam Width The number of elements in the vector.
+template <typename DType, uint8_t Width>
+class Vector {
+ public:
+  using VecDType = std::array<DType, Width>;  //!< Alias for the data type.
+  using VecType  = Vector<DType, Width>;      //!< Alias for the vector type.
+
+  /// Alias for the type of the result of a horizontal sum, which matches the
+  /// SIMD backends: 32 bits for 8 and 16 bit elements, and 64 bits for 32 
+  /// bit elements.
+  using SumType  = std::conditional_t<
+    sizeof(DType) < 4,
+    std::conditional_t<std::is_signed<DType>::value, int32_t, uint32_t>,
+    std::conditional_t<std::is_signed<DType>::value, int64_t, uint64_t>>;
+
+  static constexpr uint8_t width = Width;     //!< Width of the vector.
+
+  // ---- Constructors ----------------------------------------------------- //
+
+  /// Default constructor: does nothing.
+  Vector() {}
+
+  /// Constructor: Create vector from iternal data type.
+  /// \param[in] x The elements to initialize the vector with.
+  Vector(const VecDType& x);
+
+  /// Constructor: Broadcasts a single element into the vector. 
+  /// \param[in] x The element to broadcast.
+  Vector(DType x);
+
+  /// Constructor: Sets a pointer to an array of elements as vector elements.
+  /// \param[in] p A pointer to the start of the elements to load into to
+  ///              vector.
+  Vector(DType* p);
+
+  // ---- Operators -------------------------------------------------------- //
+  
+  /// Cast operator: Allow conversion to the internal data type.
+  /// \return The internal elements.
+  operator VecDType() const;
+  
+  /// Assignment operator: Allows the conversion from the internal type.
+  /// \param[in] x The elements to set the vector to.
+  /// \return      A reference to the vector.
+  VecType& operator=(const VecDType& x);
+
+  /// Access operator: Allows a specific element of the vector to be fetched.
+  /// This does not check bounds due to performance implications.
+  /// \param[in] idx The index of the element to fetch.
+  DType operator[](uint8_t idx) const;
+
+  // ---- General Operations ----------------------------------------------- //
+ 
+  /// Load operation: Loads the vector from contiguous, aligned or unaligned 
+  /// memory.
+  /// \param[in] p A pointer to the start of the memory to load.
+  void load(const void* p);
+
+  /// Load operation: Loads the vector from contiguous, aligned memory.
+  /// \param[in] p A pointer to the start of the aligned memory to load.
+  void loada(const void* p);
+
+  /// Load operation: Loads the low half of the elements from contiguous,
+  /// aligned or unaligned memory, and zeros the high half.
+  /// \param[in] p A pointer to the start of the elements to load.
+  void loadl(const void* p);
+
+  /// Store operation: Stores the vector into contiguous aligned memory.
+  /// \param[in] p A pointer to the start of the aligned memory.
+  void store(void* p) const;
+
+  /// Store operation: Stores the vector into contiguous aligned or unaligned
+  /// memory.
+  /// \param[in] p A pointer to the start of the memory.
+  void storeu(void* p) const;
+
+  /// Stream operation: Stores the vector into contiguous memory. This is the
+  /// same as store, since there is no portable non-temporal store.
+  /// \param[in] p A pointer to the start of the contiguous aligned memory.
+  void stream(void* p) const;
+
+  /// Set operation: Sets a specific element of the vector to the specified
+  /// value.
+  /// \param[in] idx The index of the element to set the value of.
+  /// \param[in] val The value to set the element to.
+  void set(uint8_t idx, DType val);
+
+  // ---- Reductions ------------------------------------------------------- //
+
+  /// Horizontal sum: Returns the sum of all the elements in the vector.
+  SumType hsum() const;
+
+  /// Horizontal min: Returns the smallest element in the vector.
+  DType hmin() const;
+
+  /// Horizontal max: Returns the largest element in the vector.
+  DType hmax() const;
+
+ private:
+  VecDType Data;                            //!< Data for the vector.
+
+} SNAP_ALIGNED;
+
+// ---- Implementation ----------------------------------------------------- //
+
+template <typename DT, uint8_t W> SNAP_INLINE
+Vector<DT, W>::Vector(const VecDType& x) : Data(x) {}
+
+template <typename DT, uint8_t W> SNAP_INLINE 
+Vector<DT, W>::Vector(DT x) {
+  Data.fill(x);
+}
+
+template <typename DT, uint8_t W> SNAP_INLINE 
+Vector<DT, W>::Vector(DT* p) {
+  load(p);
+}
+
+template <typename DT, uint8_t W> SNAP_INLINE
+Vector<DT, W>::operator VecDType() const {
+  return Data;
+}
+
+template <typename DT, uint8_t W> SNAP_INLINE 
+Vector<DT, W>& Vector<DT, W>::operator=(const VecDType& x) {
+  Data = x;
+  return *this;
+}
+
+template <typename DT, uint8_t W> SNAP_INLINE
+DT Vector<DT, W>::operator[](uint8_t idx) const {
+  return Data[idx];
+}
+
+template <typename DT, uint8_t W> SNAP_INLINE
+void Vector<DT, W>::load(const void* p) {
+  std::memcpy(Data.data(), p, sizeof(Data));
+}
+
+template <typename DT, uint8_t W> SNAP_INLINE 
+void Vector<DT, W>::loada(const void* p) {
+  std::memcpy(Data.data(), p, sizeof(Data));
+}
+
+template <typename DT, uint8_t W> SNAP_INLINE 
+void Vector<DT, W>::loadl(const void* p) {
+  Data.fill(0);
+  std::memcpy(Data.data(), p, sizeof(Data) / 2);
+}
+
+template <typename DT, uint8_t W> SNAP_INLINE 
+void Vector<DT, W>::store(void* p) const {
+  std::memcpy(p, Data.data(), sizeof(Data));
+}
+
+template <typename DT, uint8_t W> SNAP_INLINE 
+void Vector<DT, W>::storeu(void* p) const {
+  std::memcpy(p, Data.data(), sizeof(Data));
+}
+
+template <typename DT, uint8_t W> SNAP_INLINE 
+void Vector<DT, W>::stream(void* p) const {
+  std::memcpy(p, Data.data(), sizeof(Data));
+}
+
+template <typename DT, uint8_t W> SNAP_INLINE 
+void Vector<DT, W>::set(uint8_t idx, DT val) {
+  Data[idx] = val;
+}
+
+template <typename DT, uint8_t W> SNAP_INLINE
+typename Vector<DT, W>::SumType Vector<DT, W>::hsum() const {
+  SumType sum = 0;
+  for (const auto element : Data) sum += element;
+  return sum;
+}
+
+template <typename DT, uint8_t W> SNAP_INLINE
+DT Vector<DT, W>::hmin() const {
+  DT result = Data[0];
+  for (const auto element : Data) 
+    result = element < result ? element : result;
+  return result;
+}
+
+template <typename DT, uint8_t W> SNAP_INLINE
+DT Vector<DT, W>::hmax() const {
+  DT result = Data[0];
+  for (const auto element : Data) 
+    result = element > result ? element : result;
+  return result;
+}
+
+namespace detail {
+
+/// Applies \p f to each pair of elements of \p a and \p b, and returns the
+/// vector of results, converted (wrapping) to DT.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+/// \param[in] f The function to apply to each pair of elements.
+template <typename DT, uint8_t W, typename F> SNAP_INLINE
+Vector<DT, W> scalar_map(const Vector<DT, W>& a, const Vector<DT, W>& b, F f) {
+  Vector<DT, W> result;
+  for (uint8_t i = 0; i < W; ++i) 
+    result.set(i, static_cast<DT>(f(a[i], b[i])));
+  return result;
+}
+
+/// Returns \p x clamped to the range of DT.
+/// \param[in] x The value to saturate.
+template <typename DT> SNAP_INLINE
+DT saturate(int32_t x) {
+  return x < std::numeric_limits<DT>::min() ? std::numeric_limits<DT>::min()
+       : x > std::numeric_limits<DT>::max() ? std::numeric_limits<DT>::max()
+       : static_cast<DT>(x);
+}
+
+} // namespace detail
+
+// ---- Arithmetic --------------------------------------------------------- //
+
+/// Addition operator: Adds each of the elements in \p a and \p b, wrapping
+/// on overflow.
+/// \param[in] a The first vector to add.
+/// \param[in] b The second vector to add.
+template <typename DT, uint8_t W> SNAP_INLINE
+Vector<DT, W> operator+(const Vector<DT, W>& a, const Vector<DT, W>& b) {
+  return detail::scalar_map(a, b, [] (DT x, DT y) { 
+    return std::make_unsigned_t<DT>(x) + std::make_unsigned_t<DT>(y); 
+  });
+}
+
+/// Subtraction operator: Subtracts each of the elements in \p b from the
+/// corresponding elements in \p a, wrapping on overflow.
+/// \param[in] a The vector to subtract from.
+/// \param[in] b The vector to subtract.
+template <typename DT, uint8_t W> SNAP_INLINE
+Vector<DT, W> operator-(const Vector<DT, W>& a, const Vector<DT, W>& b) {
+  return detail::scalar_map(a, b, [] (DT x, DT y) { 
+    return std::make_unsigned_t<DT>(x) - std::make_unsigned_t<DT>(y); 
+  });
+}
+
+/// Multiplication operator: Multiplies each of the 16-bit elements in \p a 
+/// and \p b, keeping the low 16 bits of each product.
+/// \param[in] a The first vector to multiply.
+/// \param[in] b The second vector to multiply.
+template <typename DT> SNAP_INLINE
+Vector<DT, 8> operator*(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  return detail::scalar_map(a, b, [] (DT x, DT y) { 
+    return uint32_t(x) * uint32_t(y); 
+  });
+}
+
+/// Saturating add: Adds each of the 8-bit elements in \p a and \p b, 
+/// saturating to the range of DT on overflow.
+/// \param[in] a The first vector to add.
+/// \param[in] b The second vector to add.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> adds(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  return detail::scalar_map(a, b, [] (DT x, DT y) { 
+    return detail::saturate<DT>(int32_t(x) + int32_t(y)); 
+  });
+}
+
+/// Saturating subtract: Subtracts each of the 8-bit elements in \p b from 
+/// the corresponding elements in \p a, saturating to the range of DT on 
+/// overflow.
+/// \param[in] a The vector to subtract from.
+/// \param[in] b The vector to subtract.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> subs(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  return detail::scalar_map(a, b, [] (DT x, DT y) { 
+    return detail::saturate<DT>(int32_t(x) - int32_t(y)); 
+  });
+}
+
+/// Saturating subtract: Subtracts each of the 16-bit elements in \p b from
+/// the corresponding elements in \p a, saturating at zero.
+/// \param[in] a The vector to subtract from.
+/// \param[in] b The vector to subtract.
+SNAP_INLINE Vector<uint16_t, 8> 
+subs(const Vector<uint16_t, 8>& a, const Vector<uint16_t, 8>& b) {
+  return detail::scalar_map(a, b, [] (uint16_t x, uint16_t y) { 
+    return x > y ? x - y : 0; 
+  });
+}
+
+/// Absolute difference: Returns a vector where each element is the absolute
+/// difference of the corresponding unsigned elements in \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+SNAP_INLINE Vector<uint8_t, 16> 
+absdiff(const Vector<uint8_t, 16>& a, const Vector<uint8_t, 16>& b) {
+  return detail::scalar_map(a, b, [] (uint8_t x, uint8_t y) { 
+    return x > y ? x - y : y - x; 
+  });
+}
+
+/// Min: Returns a vector where each element is the minimum of the
+/// corresponding elements in \p a and \p b.
+/// \param[in] a The first vector to compare.
+/// \param[in] b The second vector to compare.
+template <typename DT, uint8_t W> SNAP_INLINE
+Vector<DT, W> min(const Vector<DT, W>& a, const Vector<DT, W>& b) {
+  return detail::scalar_map(a, b, [] (DT x, DT y) { return x < y ? x : y; });
+}
+
+/// Max: Returns a vector where each element is the maximum of the
+/// corresponding elements in \p a and \p b.
+/// \param[in] a The first vector to compare.
+/// \param[in] b The second vector to compare.
+template <typename DT, uint8_t W> SNAP_INLINE
+Vector<DT, W> max(const Vector<DT, W>& a, const Vector<DT, W>& b) {
+  return detail::scalar_map(a, b, [] (DT x, DT y) { return x > y ? x : y; });
+}
+
+// ---- Bitwise ------------------------------------------------------------ //
+
+/// Bitwise and operator: Returns the bitwise and of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT, uint8_t W> SNAP_INLINE
+Vector<DT, W> operator&(const Vector<DT, W>& a, const Vector<DT, W>& b) {
+  return detail::scalar_map(a, b, [] (DT x, DT y) { return x & y; });
+}
+
+/// Bitwise or operator: Returns the bitwise or of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT, uint8_t W> SNAP_INLINE
+Vector<DT, W> operator|(const Vector<DT, W>& a, const Vector<DT, W>& b) {
+  return detail::scalar_map(a, b, [] (DT x, DT y) { return x | y; });
+}
+
+/// Bitwise xor operator: Returns the bitwise exclusive or of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT, uint8_t W> SNAP_INLINE
+Vector<DT, W> operator^(const Vector<DT, W>& a, const Vector<DT, W>& b) {
+  return detail::scalar_map(a, b, [] (DT x, DT y) { return x ^ y; });
+}
+
+/// Bitwise not operator: Returns the bitwise complement of \p a.
+/// \param[in] a The vector to complement.
+template <typename DT, uint8_t W> SNAP_INLINE
+Vector<DT, W> operator~(const Vector<DT, W>& a) {
+  return detail::scalar_map(a, a, [] (DT x, DT) { return ~x; });
+}
+
+// ---- Comparison --------------------------------------------------------- //
+
+/// Compare equal: Returns a vector where each element is all ones if the
+/// corresponding elements in \p a and \p b are equal, and zero otherwise.
+/// \param[in] a The first vector to compare.
+/// \param[in] b The second vector to compare.
+template <typename DT, uint8_t W> SNAP_INLINE
+Vector<DT, W> cmpeq(const Vector<DT, W>& a, const Vector<DT, W>& b) {
+  return detail::scalar_map(a, b, [] (DT x, DT y) { 
+    return x == y ? std::make_unsigned_t<DT>(~0) : 0; 
+  });
+}
+
+/// Movemask: Returns a 16-bit mask where bit i is the most significant bit of
+/// element i of \p a.
+/// \param[in] a The vector to get the mask of.
+template <typename DT> SNAP_INLINE
+uint32_t movemask(const Vector<DT, 16>& a) {
+  uint32_t mask = 0;
+  for (uint8_t i = 0; i < 16; ++i) 
+    mask |= uint32_t(uint8_t(a[i]) >> 7) << i;
+  return mask;
+}
+
+// ---- Permutation -------------------------------------------------------- //
+
+/// Shuffle: Returns a vector where element i is element I_i of \p v, or zero
+/// if I_i is SHUFFLE_ZERO.
+/// \param[in] v The vector to shuffle.
+/// \tparam    I The 16 source indices, each less than 16, or SHUFFLE_ZERO.
+template <uint8_t... I, typename DT> SNAP_INLINE
+Vector<DT, 16> shuffle(const Vector<DT, 16>& v) {
+  static_assert(sizeof...(I) == 16, "A shuffle needs 16 indices!");
+  constexpr detail::ShuffleMask m{{I...}};
+  static_assert(detail::is_valid_mask(m, 1),
+                "Shuffle indices must be less than 16!");
+  Vector<DT, 16> result;
+  for (uint8_t i = 0; i < 16; ++i)
+    result.set(i, detail::is_zero_lane(m, i) ? DT(0) : v[m.index[i]]);
+  return result;
+}
+
+/// Permute: Returns a vector where element i is element I_i of the
+/// concatenation of \p a and \p b, where indices 16 to 31 are the elements
+/// of \p b, or zero if I_i is SHUFFLE_ZERO.
+/// \param[in] a The first source.
+/// \param[in] b The second source.
+/// \tparam    I The 16 source indices, each less than 32, or SHUFFLE_ZERO.
+template <uint8_t... I, typename DT> SNAP_INLINE
+Vector<DT, 16> permute(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  static_assert(sizeof...(I) == 16, "A permute needs 16 indices!");
+  constexpr detail::ShuffleMask m{{I...}};
+  static_assert(detail::is_valid_mask(m, 2),
+                "Permute indices must be less than 32!");
+  Vector<DT, 16> result;
+  for (uint8_t i = 0; i < 16; ++i) {
+    const uint8_t j = m.index[i];
+    result.set(i, detail::is_zero_lane(m, i) ? DT(0)
+                : j < 16 ? a[j] : b[j - 16]);
+  }
+  return result;
+}
+
+// ---- Widening ----------------------------------------------------------- //
+
+/// Sum of absolute differences: Returns a vector where elements 0 and 2 are
+/// the sums of the absolute differences of the low and high 8 elements of \p
+/// a and \p b, respectively, and elements 1 and 3 are zero.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+SNAP_INLINE Vector<uint32_t, 4> 
+sad(const Vector<uint8_t, 16>& a, const Vector<uint8_t, 16>& b) {
+  const auto diff = absdiff(a, b);
+  Vector<uint32_t, 4> result(uint32_t(0));
+  for (uint8_t i = 0; i < 16; ++i) 
+    result.set(i / 8 * 2, result[i / 8 * 2] + diff[i]);
+  return result;
+}
+
+/// Widen low: Returns the low half of the elements of \p a zero extended to 
+/// twice the width.
+/// \param[in] a The vector to widen.
+template <typename DT, uint8_t W> SNAP_INLINE
+auto widen_lo(const Vector<DT, W>& a) {
+  static_assert(std::is_unsigned<DT>::value, "Only unsigned widening");
+  using WideType = std::conditional_t<sizeof(DT) == 1, uint16_t, uint32_t>;
+  Vector<WideType, W / 2> result;
+  for (uint8_t i = 0; i < W / 2; ++i) result.set(i, a[i]);
+  return result;
+}
+
+/// Widen high: Returns the high half of the elements of \p a zero extended
+/// to twice the width.
+/// \param[in] a The vector to widen.
+template <typename DT, uint8_t W> SNAP_INLINE
+auto widen_hi(const Vector<DT, W>& a) {
+  static_assert(std::is_unsigned<DT>::value, "Only unsigned widening");
+  using WideType = std::conditional_t<sizeof(DT) == 1, uint16_t, uint32_t>;
+  Vector<WideType, W / 2> result;
+  for (uint8_t i = 0; i < W / 2; ++i) result.set(i, a[i + W / 2]);
+  return result;
+}
+
+/// Narrow: Returns the elements of \p lo followed by those of \p hi,
+/// saturated to 8 bits.
+/// \param[in] lo The vector of the low 8 elements.
+/// \param[in] hi The vector of the high 8 elements.
+SNAP_INLINE Vector<uint8_t, 16> 
+narrow(const Vector<uint16_t, 8>& lo, const Vector<uint16_t, 8>& hi) {
+  Vector<uint8_t, 16> result;
+  for (uint8_t i = 0; i < 8; ++i) {
+    result.set(i    , static_cast<uint8_t>(lo[i] > 255 ? 255 : lo[i]));
+    result.set(i + 8, static_cast<uint8_t>(hi[i] > 255 ? 255 : hi[i]));
+  }
+  return result;
+}
+
+/// Multiply add: Multiplies the signed 16-bit elements of \p a and \p b and
+/// then adds each adjacent pair of the 32-bit products, i.e element i of the
+/// result is a[2i] * b[2i] + a[2i + 1] * b[2i + 1].
+/// \param[in] a The first vector to multiply.
+/// \param[in] b The second vector to multiply.
+template <typename DT> SNAP_INLINE
+Vector<int32_t, 4> madd(const Vector<DT, 8>& a, const Vector<DT, 8>& b) {
+  Vector<int32_t, 4> result;
+  for (uint8_t i = 0; i < 4; ++i) {
+    const int64_t sum = 
+      int64_t(int16_t(a[2 * i])) * int16_t(b[2 * i]) +
+      int64_t(int16_t(a[2 * i + 1])) * int16_t(b[2 * i + 1]);
+    result.set(i, static_cast<int32_t>(static_cast<uint32_t>(sum)));
+  }
+  return result;
+}
+
+// ---- Memory ------------------------------------------------------------- //
+
+/// Prefetch: Hints that the cache line containing \p p will be read soon.
+/// This never faults, so \p p may be past the end of the data.
+/// \param[in] p A pointer into the cache line to prefetch.
+SNAP_INLINE void prefetch(const void* p) {
+  __builtin_prefetch(p);
+}
+
+/// Stream fence: Does nothing, since stream uses regular stores with the
+/// scalar backend.
+SNAP_INLINE void stream_fence() {}
+
+} // namespace snap
+
+#endif // SNAP_VECTOR_VECTOR_SCALAR_HPP
@@ -13,7 +13,9 @@
 /// \brief Defiition of Vector class SSE implementation. The possible options 
 ///        for snap vector types when using SSE instructions are the following:
 ///
-///        -) Vec<uint8_t|int8_t, 16> : Vec of 16 8 bit ints. 
+///        -) Vec<uint8_t|int8_t, 16>   : Vec of 16 8 bit ints. 
+///        -) Vec<uint16_t|int16_t, 8>  : Vec of 8 16 bit ints. 
+///        -) Vec<uint32_t|int32_t, 4>  : Vec of 4 32 bit ints. 
 ///
 ///\note   The aliases are defined in vector_see.hpp.
 //
@@ -22,8 +24,12 @@
 #ifndef SNAP_VECTOR_VECTOR_SSE_HPP
 #define SNAP_VECTOR_VECTOR_SSE_HPP
 
+#include "shuffle_sse.hpp"
 #include "vector_general.hpp"
+#include "vector4_sse.hpp"
+#include "vector8_sse.hpp"
 #include "snap/config/simd_instruction_detect.h"
+#include <type_traits>
 
 namespace snap {
 
@@ -37,6 +43,10 @@ class Vector<DType, 16> {
   using VecDType = __m128i;               //!< Alias for the vector data type.
   using VecType  = Vector<DType, 16>;     //!< Alias for the type of vector.
 
+  /// Alias for the type of the result of a horizontal sum.
+  using SumType  = 
+    std::conditional_t<std::is_signed<DType>::value, int32_t, uint32_t>;
+
   static constexpr uint8_t width = 16;    //!< Width of the vector.
 
   // ---- Constructors ----------------------------------------------------- //
@@ -81,14 +91,19 @@ class Vector<DType, 16> {
   /// in some cases.
   /// \param[in] p A pointer to the start of the contiguous aligned/unaligned 
   ///              memory to load as a vector of elements.
-  void load(void* p);
+  void load(const void* p);
 
   /// Load operation: Allows a pointer to contiguous, aligned memory to be
   /// loaded as a vector data type. This can be faster than load, but must only 
   /// be used when the memory is definitely 16-byte aligned.
   /// \param[in] p A pointer to the start of the contiguous aligned memory to 
   ///              load as a vector of elements.
-  void loada(void* p);
+  void loada(const void* p);
+
+  /// Load operation: Loads 8 elements from contiguous, aligned or unaligned
+  /// memory into the low half of the vector, and zeros the high half.
+  /// \param[in] p A pointer to the start of the 8 elements to load.
+  void loadl(const void* p);
 
   /// Store operation: Allows the vector to be stored in contiguous memory. The 
   /// memory needs to be aligned on a 16 byte boundary.
@@ -101,12 +116,36 @@ class Vector<DType, 16> {
   ///              unaligned memory.
   void storeu(void* p) const;
 
+  /// Stream operation: Stores the vector into contiguous memory, which must
+  /// be aligned on a 16 byte boundary, with a non-temporal hint so that the
+  /// data bypasses the cache. This avoids polluting the cache (and the read
+  /// for ownership) when writing large outputs which are not read again 
+  /// soon. stream_fence must be called before the data is read by another
+  /// thread.
+  /// \param[in] p A pointer to the start of the contiguous aligned memory.
+  void stream(void* p) const;
+
   /// Set operation: Sets a specific element of the vector to the specified
   /// value.
   /// \param[in] idx The index of the element to set the value of.
   /// \param[in] val The value to set the element to.
   void set(uint8_t idx, DType val);
 
+  // ---- Reductions ------------------------------------------------------- //
+
+  /// Horizontal sum: Returns the sum of all the elements in the vector. This
+  /// uses psadbw against zero, so the sum is computed in a single instruction.
+  SumType hsum() const;
+
+  /// Horizontal min: Returns the smallest element in the vector. When SSE4.1
+  /// is available this uses phminposuw, otherwise a log2(16) step shuffle
+  /// reduction is used.
+  DType hmin() const;
+
+  /// Horizontal max: Returns the largest element in the vector, computed the
+  /// same way as hmin, using the complement of the elements.
+  DType hmax() const;
+
  private:
   VecDType Data;                            //!< Data for the vector.
 
@@ -148,15 +187,20 @@ DT Vector<DT, 16>::operator[](uint8_t idx) const {
 }
 
 template <typename DT> SNAP_INLINE
-void Vector<DT, 16>::load(void* p) {
+void Vector<DT, 16>::load(const void* p) {
   Data = _mm_loadu_si128(reinterpret_cast<VecDType const*>(p));
 }
 
 template <typename DT> SNAP_INLINE 
-void Vector<DT, 16>::loada(void* p) {
+void Vector<DT, 16>::loada(const void* p) {
   Data = _mm_load_si128(reinterpret_cast<VecDType const*>(p));
 }
 
+template <typename DT> SNAP_INLINE 
+void Vector<DT, 16>::loadl(const void* p) {
+  Data = _mm_loadl_epi64(reinterpret_cast<VecDType const*>(p));
+}
+
 template <typename DT> SNAP_INLINE 
 void Vector<DT, 16>::store(void* p) const {
   _mm_store_si128(reinterpret_cast<VecDType*>(p), Data);
@@ -167,6 +211,11 @@ void Vector<DT, 16>::storeu(void* p) const {
   _mm_storeu_si128(reinterpret_cast<VecDType*>(p), Data);
 }
 
+template <typename DT> SNAP_INLINE 
+void Vector<DT, 16>::stream(void* p) const {
+  _mm_stream_si128(reinterpret_cast<VecDType*>(p), Data);
+}
+
 template <typename DT> SNAP_INLINE 
 void Vector<DT, 16>::set(uint8_t idx, DT val) {
   SNAP_ALIGN(16) DT tmp[16];
@@ -175,6 +224,271 @@ void Vector<DT, 16>::set(uint8_t idx, DT val) {
   Data = _mm_load_si128(reinterpret_cast<VecDType const*>(tmp));
 }
 
+namespace detail {
+
+/// Returns the bias which must be xor'ed with the elements of an 8-bit vector
+/// so that unsigned operations order them correctly. For unsigned elements
+/// the bias is 0, for signed elements the sign bit is flipped, which maps
+/// [-128, 127] onto [0, 255] while preserving the order.
+/// \tparam DT The type of the vector elements.
+template <typename DT> SNAP_INLINE
+__m128i sign_bias8() {
+  return std::is_signed<DT>::value ? _mm_set1_epi8(-128) : _mm_setzero_si128();
+}
+
+/// Returns the minimum unsigned 8-bit element of \p x.
+/// \param[in] x The vector to find the minimum element of.
+SNAP_INLINE uint8_t hmin_epu8(__m128i x) {
+#if defined(__SSE4_1__)
+  // Min of each pair of bytes into the low byte of each 16-bit lane, the high
+  // bytes become min(hi, 0) = 0, so phminposuw can find the minimum.
+  const __m128i pairs = _mm_min_epu8(x, _mm_srli_epi16(x, 8));
+  return static_cast<uint8_t>(_mm_cvtsi128_si32(_mm_minpos_epu16(pairs)));
+#else
+  x = _mm_min_epu8(x, _mm_srli_si128(x, 8));
+  x = _mm_min_epu8(x, _mm_srli_si128(x, 4));
+  x = _mm_min_epu8(x, _mm_srli_si128(x, 2));
+  x = _mm_min_epu8(x, _mm_srli_si128(x, 1));
+  return static_cast<uint8_t>(_mm_cvtsi128_si32(x));
+#endif
+}
+
+} // namespace detail
+
+template <typename DT> SNAP_INLINE
+typename Vector<DT, 16>::SumType Vector<DT, 16>::hsum() const {
+  const __m128i sums = _mm_sad_epu8(
+    _mm_xor_si128(Data, detail::sign_bias8<DT>()), _mm_setzero_si128());
+  const int32_t sum  = _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+  return std::is_signed<DT>::value ? sum - 16 * 128 : sum;
+}
+
+template <typename DT> SNAP_INLINE
+DT Vector<DT, 16>::hmin() const {
+  const __m128i bias = detail::sign_bias8<DT>();
+  return static_cast<DT>(detail::hmin_epu8(_mm_xor_si128(Data, bias)) ^ 
+                         _mm_cvtsi128_si32(bias));
+}
+
+template <typename DT> SNAP_INLINE
+DT Vector<DT, 16>::hmax() const {
+  // max(x) = ~min(~x), and the bias is applied to the complement.
+  const __m128i bias = _mm_xor_si128(
+    detail::sign_bias8<DT>(), _mm_set1_epi8(-1));
+  return static_cast<DT>(detail::hmin_epu8(_mm_xor_si128(Data, bias)) ^ 
+                         _mm_cvtsi128_si32(bias));
+}
+
+// ---- Arithmetic --------------------------------------------------------- //
+
+/// Addition operator: Adds each of the elements in \p a and \p b, wrapping
+/// on overflow.
+/// \param[in] a The first vector to add.
+/// \param[in] b The second vector to add.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> operator+(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  return _mm_add_epi8(a, b);
+}
+
+/// Subtraction operator: Subtracts each of the elements in \p b from the
+/// corresponding elements in \p a, wrapping on overflow.
+/// \param[in] a The vector to subtract from.
+/// \param[in] b The vector to subtract.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> operator-(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  return _mm_sub_epi8(a, b);
+}
+
+/// Saturating add: Adds each of the elements in \p a and \p b, saturating
+/// to the range of DT on overflow.
+/// \param[in] a The first vector to add.
+/// \param[in] b The second vector to add.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> adds(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  return std::is_signed<DT>::value ? _mm_adds_epi8(a, b) : _mm_adds_epu8(a, b);
+}
+
+/// Saturating subtract: Subtracts each of the elements in \p b from the
+/// corresponding elements in \p a, saturating to the range of DT on 
+/// overflow.
+/// \param[in] a The vector to subtract from.
+/// \param[in] b The vector to subtract.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> subs(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  return std::is_signed<DT>::value ? _mm_subs_epi8(a, b) : _mm_subs_epu8(a, b);
+}
+
+/// Absolute difference: Returns a vector where each element is the absolute
+/// difference of the corresponding unsigned elements in \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+SNAP_INLINE Vector<uint8_t, 16> 
+absdiff(const Vector<uint8_t, 16>& a, const Vector<uint8_t, 16>& b) {
+  return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+/// Min: Returns a vector where each element is the minimum of the
+/// corresponding elements in \p a and \p b.
+/// \param[in] a The first vector to compare.
+/// \param[in] b The second vector to compare.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> min(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  const __m128i bias = detail::sign_bias8<DT>();
+  return _mm_xor_si128(
+    _mm_min_epu8(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias)), bias);
+}
+
+/// Max: Returns a vector where each element is the maximum of the
+/// corresponding elements in \p a and \p b.
+/// \param[in] a The first vector to compare.
+/// \param[in] b The second vector to compare.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> max(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  const __m128i bias = detail::sign_bias8<DT>();
+  return _mm_xor_si128(
+    _mm_max_epu8(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias)), bias);
+}
+
+// ---- Bitwise ------------------------------------------------------------ //
+
+/// Bitwise and operator: Returns the bitwise and of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> operator&(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  return _mm_and_si128(a, b);
+}
+
+/// Bitwise or operator: Returns the bitwise or of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> operator|(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  return _mm_or_si128(a, b);
+}
+
+/// Bitwise xor operator: Returns the bitwise exclusive or of \p a and \p b.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> operator^(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  return _mm_xor_si128(a, b);
+}
+
+/// Bitwise not operator: Returns the bitwise complement of \p a.
+/// \param[in] a The vector to complement.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> operator~(const Vector<DT, 16>& a) {
+  return _mm_xor_si128(a, _mm_set1_epi8(-1));
+}
+
+// ---- Comparison --------------------------------------------------------- //
+
+/// Compare equal: Returns a vector where each element is all ones if the
+/// corresponding elements in \p a and \p b are equal, and zero otherwise.
+/// \param[in] a The first vector to compare.
+/// \param[in] b The second vector to compare.
+template <typename DT> SNAP_INLINE
+Vector<DT, 16> cmpeq(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  return _mm_cmpeq_epi8(a, b);
+}
+
+/// Movemask: Returns a 16-bit mask where bit i is the most significant bit of
+/// element i of \p a, which is useful for converting the result of a
+/// comparison into a scalar mask.
+/// \param[in] a The vector to get the mask of.
+template <typename DT> SNAP_INLINE
+uint32_t movemask(const Vector<DT, 16>& a) {
+  return static_cast<uint32_t>(_mm_movemask_epi8(a));
+}
+
+// ---- Permutation -------------------------------------------------------- //
+
+/// Shuffle: Returns a vector where element i is element I_i of \p v, or zero
+/// if I_i is SHUFFLE_ZERO. The indices are classified at compile time, and
+/// the cheapest sequence for the pattern is used: byte shifts, pshufd,
+/// pshuflw/hw, unpacks or palignr where the pattern allows, otherwise
+/// pshufb, or an element by element copy on SSE2.
+/// \param[in] v The vector to shuffle.
+/// \tparam    I The 16 source indices, each less than 16, or SHUFFLE_ZERO.
+template <uint8_t... I, typename DT> SNAP_INLINE
+Vector<DT, 16> shuffle(const Vector<DT, 16>& v) {
+  static_assert(sizeof...(I) == 16, "A shuffle needs 16 indices!");
+  static_assert(detail::is_valid_mask(detail::ShuffleMask{{I...}}, 1),
+                "Shuffle indices must be less than 16!");
+  return detail::shuffle_epi8<I...>(v);
+}
+
+/// Permute: Returns a vector where element i is element I_i of the
+/// concatenation of \p a and \p b, where indices 16 to 31 are the elements
+/// of \p b, or zero if I_i is SHUFFLE_ZERO. As well as the shuffle patterns,
+/// unpacks, palignr, shufps and blends of either source are recognised, and
+/// the general case is two pshufb and an or.
+/// \param[in] a The first source.
+/// \param[in] b The second source.
+/// \tparam    I The 16 source indices, each less than 32, or SHUFFLE_ZERO.
+template <uint8_t... I, typename DT> SNAP_INLINE
+Vector<DT, 16> permute(const Vector<DT, 16>& a, const Vector<DT, 16>& b) {
+  static_assert(sizeof...(I) == 16, "A permute needs 16 indices!");
+  static_assert(detail::is_valid_mask(detail::ShuffleMask{{I...}}, 2),
+                "Permute indices must be less than 32!");
+  return detail::permute_epi8<I...>(a, b);
+}
+
+// ---- Widening ----------------------------------------------------------- //
+
+/// Sum of absolute differences: Returns a vector where elements 0 and 2 are
+/// the sums of the absolute differences of the low and high 8 elements of \p
+/// a and \p b, respectively, and elements 1 and 3 are zero. The total SAD is
+/// the horizontal sum of the result.
+/// \param[in] a The first vector.
+/// \param[in] b The second vector.
+SNAP_INLINE Vector<uint32_t, 4> 
+sad(const Vector<uint8_t, 16>& a, const Vector<uint8_t, 16>& b) {
+  return _mm_sad_epu8(a, b);
+}
+
+/// Widen low: Returns the low 8 elements of \p a zero extended to 16 bits.
+/// \param[in] a The vector to widen.
+SNAP_INLINE Vector<uint16_t, 8> widen_lo(const Vector<uint8_t, 16>& a) {
+  return _mm_unpacklo_epi8(a, _mm_setzero_si128());
+}
+
+/// Widen high: Returns the high 8 elements of \p a zero extended to 16 bits.
+/// \param[in] a The vector to widen.
+SNAP_INLINE Vector<uint16_t, 8> widen_hi(const Vector<uint8_t, 16>& a) {
+  return _mm_unpackhi_epi8(a, _mm_setzero_si128());
+}
+
+/// Narrow: Returns the elements of \p lo followed by those of \p hi,
+/// saturated to 8 bits. SSE2 only has a signed saturating pack, so the
+/// elements are first clamped to 255 with a saturating subtract.
+/// \param[in] lo The vector of the low 8 elements.
+/// \param[in] hi The vector of the high 8 elements.
+SNAP_INLINE Vector<uint8_t, 16> 
+narrow(const Vector<uint16_t, 8>& lo, const Vector<uint16_t, 8>& hi) {
+  const __m128i max = _mm_set1_epi16(255);
+  return _mm_packus_epi16(_mm_sub_epi16(lo, _mm_subs_epu16(lo, max)),
+                          _mm_sub_epi16(hi, _mm_subs_epu16(hi, max)));
+}
+
+// ---- Memory ------------------------------------------------------------- //
+
+/// Prefetch: Hints that the cache line containing \p p will be read soon,
+/// and should be fetched into all levels of the cache. This never faults, so
+/// \p p may be past the end of the data.
+/// \param[in] p A pointer into the cache line to prefetch.
+SNAP_INLINE void prefetch(const void* p) {
+  _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+}
+
+/// Stream fence: Orders all the streaming (non-temporal) stores made by the
+/// calling thread before any of its subsequent stores, so that the streamed
+/// data is visible to other threads once they synchronize with this one.
+SNAP_INLINE void stream_fence() {
+  _mm_sfence();
+}
+
 } // namespace snap
 
 #endif // SNAP_VECTOR_VECTOR_SSE_HPP
@@ -0,0 +1,175 @@
+//---- tests/binary_tests.cc ------------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  binary_tests.cc
+/// \brief Test file to test the snap bit packed binary mask kernels.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapBinaryTests
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/binary.hpp"
+#include "snap/algorithm/statistics.hpp"
+#include "thread_fixture.hpp"
+#include <random>
+
+using namespace snap;
+
+using Grey   = Matrix<mat::FM_GREY_8>;
+using Binary = Matrix<mat::FM_BIN_1>;
+
+// Fixture with random masks of widths which are and aren't multiples of the
+// word size.
+struct BinaryFixture : ThreadFixture {
+  std::mt19937 gen{17};
+
+
+  static std::vector<std::pair<size_t, size_t>> sizes() {
+    return {{1, 1}, {5, 63}, {7, 64}, {9, 65}, {33, 130}, {301, 517}};
+  }
+
+  // Returns a random mask with about \p density percent of the elements set.
+  Grey randomMask(size_t rows, size_t cols, int density) {
+    std::uniform_int_distribution<int> value(0, 99);
+    Grey m(rows, cols);
+    for (size_t i = 0; i < m.size(); ++i)
+      m.data()[i] = value(gen) < density ? uint8_t(value(gen) + 1) : 0;
+    return m;
+  }
+
+  // Packs \p grey into a new mask, whose padding bits are all set so that
+  // the kernels must ignore them.
+  static Binary packed(const Grey& grey) {
+    Binary m(grey.rows(), grey.cols());
+    std::fill(m.data(), m.data() + m.rows() * m.stride(), uint8_t(0xff));
+    alg::pack(grey, m);
+    for (size_t r = 0; r < m.rows(); ++r) {
+      for (size_t c = m.cols(); c < 8 * m.stride(); ++c)
+        m.data()[r * m.stride() + c / 8] |= uint8_t(1 << (c % 8));
+    }
+    return m;
+  }
+
+  static bool at(const Grey& m, long r, long c, bool outside) {
+    if (r < 0 || c < 0 || r >= long(m.rows()) || c >= long(m.cols()))
+      return outside;
+    return m.data()[r * m.stride() + c] != 0;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SnapBinarySuite, BinaryFixture)
+
+BOOST_AUTO_TEST_CASE(rowsArePaddedToWords) {
+  BOOST_CHECK(Binary(3, 1).stride()   == 8);
+  BOOST_CHECK(Binary(3, 64).stride()  == 8);
+  BOOST_CHECK(Binary(3, 65).stride()  == 16);
+  BOOST_CHECK(Binary(3, 200).stride() == 32);
+  BOOST_CHECK(Grey(3, 65).stride()    == 65);
+}
+
+BOOST_AUTO_TEST_CASE(canPackAndUnpack) {
+  for (const auto& size : sizes()) {
+    const Grey grey = randomMask(size.first, size.second, 50);
+    for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+      Binary bin(grey.rows(), grey.cols());
+      alg::pack(grey, bin, policy);
+      for (size_t r = 0; r < grey.rows(); ++r) {
+        for (size_t c = 0; c < grey.cols(); ++c)
+          BOOST_REQUIRE(alg::get_bit(bin, r, c) == at(grey, r, c, false));
+      }
+
+      Grey out(grey.rows(), grey.cols());
+      alg::unpack(bin, out, 7, policy);
+      for (size_t i = 0; i < grey.size(); ++i)
+        BOOST_REQUIRE(out.data()[i] == (grey.data()[i] ? 7 : 0));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(canSetBits) {
+  Binary bin(2, 70);
+  alg::pack(randomMask(2, 70, 0), bin);
+  alg::set_bit(bin, 1, 69, true);
+  alg::set_bit(bin, 0, 3, true);
+  alg::set_bit(bin, 0, 3, false);
+  alg::set_bit(bin, 0, 9, true);
+  BOOST_CHECK(alg::get_bit(bin, 1, 69) && alg::get_bit(bin, 0, 9));
+  BOOST_CHECK(!alg::get_bit(bin, 0, 3) && !alg::get_bit(bin, 1, 68));
+  BOOST_CHECK(alg::count_non_zero(bin) == 2);
+}
+
+BOOST_AUTO_TEST_CASE(canComputeLogicalOperations) {
+  for (const auto& size : sizes()) {
+    const Grey ga = randomMask(size.first, size.second, 50);
+    const Grey gb = randomMask(size.first, size.second, 30);
+    const Binary a = packed(ga), b = packed(gb);
+    for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+      Binary ands(a.rows(), a.cols()), ors(a.rows(), a.cols());
+      Binary xors(a.rows(), a.cols()), nots(a.rows(), a.cols());
+      alg::bitwise_and(a, b, ands, policy);
+      alg::bitwise_or(a, b, ors, policy);
+      alg::bitwise_xor(a, b, xors, policy, alg::WP_STREAM);
+      alg::bitwise_not(a, nots, policy);
+      for (size_t r = 0; r < a.rows(); ++r) {
+        for (size_t c = 0; c < a.cols(); ++c) {
+          const bool x = at(ga, r, c, false), y = at(gb, r, c, false);
+          BOOST_REQUIRE(alg::get_bit(ands, r, c) == (x && y));
+          BOOST_REQUIRE(alg::get_bit(ors , r, c) == (x || y));
+          BOOST_REQUIRE(alg::get_bit(xors, r, c) == (x != y));
+          BOOST_REQUIRE(alg::get_bit(nots, r, c) == !x);
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(canCountSetBits) {
+  for (const auto& size : sizes()) {
+    for (const int density : {0, 40, 100}) {
+      const Grey   grey = randomMask(size.first, size.second, density);
+      const Binary bin  = packed(grey);
+      const size_t expected = alg::count_non_zero(grey);
+      BOOST_CHECK(alg::count_non_zero(bin) == expected);
+      BOOST_CHECK(alg::count_non_zero(bin, EP_PARALLEL) == expected);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(morphologyMatchesReference) {
+  for (const auto& size : sizes()) {
+    const Grey   grey = randomMask(size.first, size.second, 60);
+    const Binary bin  = packed(grey);
+    for (const auto cn : {alg::CN_4, alg::CN_8}) {
+      for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+        Binary dilated(bin.rows(), bin.cols()), eroded(bin.rows(), bin.cols());
+        alg::dilate(bin, dilated, cn, policy);
+        alg::erode(bin, eroded, cn, policy);
+        for (long r = 0; r < long(bin.rows()); ++r) {
+          for (long c = 0; c < long(bin.cols()); ++c) {
+            bool any = false, all = true;
+            for (long dr = -1; dr <= 1; ++dr) {
+              for (long dc = -1; dc <= 1; ++dc) {
+                if (cn == alg::CN_4 && dr && dc) continue;
+                any = any || at(grey, r + dr, c + dc, false);
+                all = all && at(grey, r + dr, c + dc, true);
+              }
+            }
+            BOOST_REQUIRE(alg::get_bit(dilated, r, c) == any);
+            BOOST_REQUIRE(alg::get_bit(eroded , r, c) == all);
+          }
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,230 @@
+//---- tests/blend_tests.cc -------------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  blend_tests.cc
+/// \brief Test file to test the snap alpha compositing.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapBlendTests
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/blend.hpp"
+#include "thread_fixture.hpp"
+#include <cmath>
+#include <random>
+
+using namespace snap;
+
+using Image = Matrix<mat::FM_BGRA_32>;
+
+// The size of the images which are split across threads.
+static constexpr int LARGE_ROWS = 443;
+static constexpr int LARGE_COLS = 449;
+static_assert(size_t(LARGE_ROWS * LARGE_COLS) >= PARALLEL_TEST_ELEMENTS,
+              "The large images must be split across threads!");
+
+// Fixture with random images, and the reference compositing.
+struct BlendFixture : ThreadFixture {
+  // Returns an image with random channels, where a quarter of the alphas
+  // are 0 or 255. When premultiplied is true the colour channels are at most
+  // alpha.
+  static Image random(size_t rows, size_t cols, unsigned seed,
+                      bool premultiplied) {
+    Image image(rows, cols);
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> value(0, 255), kind(0, 7);
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t c = 0; c < cols; ++c) {
+        uint8_t* e = image.data() + r * image.stride() + 4 * c;
+        const int k = kind(gen);
+        e[3] = static_cast<uint8_t>(k == 0 ? 0 : k == 1 ? 255 : value(gen));
+        for (size_t j = 0; j < 3; ++j) {
+          e[j] = static_cast<uint8_t>(premultiplied
+            ? std::uniform_int_distribution<int>(0, e[3])(gen) : value(gen));
+        }
+      }
+    }
+    return image;
+  }
+
+  static int mul(int a, int b) { return int(std::floor(a * b / 255.0 + 0.5)); }
+
+  static int unpremultiply(int c, int a) {
+    return a == 0 ? 0 : std::min(255, int(std::floor(c * 255.0 / a + 0.5)));
+  }
+
+  // Reference blend of element s onto element d.
+  static void blend(const uint8_t* s, const uint8_t* d, uint8_t* out,
+                    alg::BlendMode mode, alg::AlphaMode alpha) {
+    const bool straight = alpha == alg::AM_STRAIGHT;
+    int ps[4], pd[4], r[4];
+    for (size_t k = 0; k < 4; ++k) {
+      ps[k] = straight && k < 3 ? mul(s[k], s[3]) : s[k];
+      pd[k] = straight && k < 3 ? mul(d[k], d[3]) : d[k];
+    }
+    for (size_t k = 0; k < 4; ++k) {
+      if (mode == alg::BL_OVER)
+        r[k] = std::min(255, ps[k] + mul(pd[k], 255 - ps[3]));
+      else if (mode == alg::BL_MULTIPLY)
+        r[k] = std::min(255, mul(ps[k], 255 - pd[3]) +
+          mul(pd[k], 255 - ps[3]) + mul(ps[k], pd[k]));
+      else
+        r[k] = ps[k] + pd[k] - mul(ps[k], pd[k]);
+    }
+    for (size_t k = 0; k < 4; ++k)
+      out[k] = uint8_t(straight && k < 3 ? unpremultiply(r[k], r[3]) : r[k]);
+  }
+
+  static Image copy(const Image& image) {
+    Image out(image.rows(), image.cols());
+    std::copy(image.data(), image.data() + image.rows() * image.stride(),
+              out.data());
+    return out;
+  }
+
+  static bool equal(const Image& a, const Image& b) {
+    for (size_t r = 0; r < a.rows(); ++r)
+      if (!std::equal(a.data() + r * a.stride(),
+                      a.data() + r * a.stride() + 4 * a.cols(),
+                      b.data() + r * b.stride()))
+        return false;
+    return true;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SnapBlendSuite, BlendFixture)
+
+BOOST_AUTO_TEST_CASE(alphaConversionsMatchReference) {
+  // Widths which are, and are not, multiples of the 4 elements per vector,
+  // and an image which is large enough to be split across threads.
+  for (const auto& size : {std::make_pair(29, 1), std::make_pair(29, 4),
+                           std::make_pair(29, 7), std::make_pair(29, 53),
+                           std::make_pair(LARGE_ROWS, LARGE_COLS)}) {
+    const size_t rows = size.first, cols = size.second;
+    const Image straight = random(rows, cols, 3, false);
+    const Image premult  = random(rows, cols, 4, true);
+    Image expectedMul(rows, cols), expectedDiv(rows, cols);
+    for (size_t i = 0; i < rows * 4 * cols; i += 4) {
+      for (size_t k = 0; k < 3; ++k) {
+        expectedMul.data()[i + k] = uint8_t(
+          mul(straight.data()[i + k], straight.data()[i + 3]));
+        expectedDiv.data()[i + k] = uint8_t(
+          unpremultiply(premult.data()[i + k], premult.data()[i + 3]));
+      }
+      expectedMul.data()[i + 3] = straight.data()[i + 3];
+      expectedDiv.data()[i + 3] = premult.data()[i + 3];
+    }
+
+    for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+      Image out(rows, cols), inPlace = copy(premult);
+      alg::premultiply(straight, out, policy);
+      BOOST_CHECK(equal(out, expectedMul));
+      alg::unpremultiply(inPlace, inPlace, policy);
+      BOOST_CHECK(equal(inPlace, expectedDiv));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(unpremultiplyInvertsPremultiply) {
+  // Premultiplying then unpremultiplying is within the rounding error of
+  // the premultiplied channel, scaled up by 255 / alpha.
+  Image image = random(17, 67, 5, false), out(17, 67);
+  alg::premultiply(image, out);
+  alg::unpremultiply(out, out);
+  for (size_t i = 0; i < 17 * 4 * 67; i += 4) {
+    const int a = image.data()[i + 3];
+    for (size_t k = 0; k < 3; ++k) {
+      const int expected = a == 0 ? 0 : image.data()[i + k];
+      BOOST_REQUIRE(std::abs(out.data()[i + k] - expected) <=
+                    (a == 0 ? 0 : int(std::ceil(127.5 / a))));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(blendMatchesReference) {
+  for (const auto& size : {std::make_pair(23, 3), std::make_pair(23, 8),
+                           std::make_pair(23, 61),
+                           std::make_pair(LARGE_ROWS, LARGE_COLS)}) {
+    const size_t rows = size.first, cols = size.second;
+    for (const auto alpha : {alg::AM_PREMULTIPLIED, alg::AM_STRAIGHT}) {
+      const bool  premultiplied = alpha == alg::AM_PREMULTIPLIED;
+      const Image src = random(rows, cols, 7, premultiplied);
+      const Image dst = random(rows, cols, 8, premultiplied);
+      for (const auto mode : {alg::BL_OVER, alg::BL_MULTIPLY,
+                              alg::BL_SCREEN}) {
+        Image expected(rows, cols);
+        for (size_t i = 0; i < rows * 4 * cols; i += 4)
+          blend(src.data() + i, dst.data() + i, expected.data() + i, mode,
+                alpha);
+        for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+          Image out = copy(dst);
+          alg::blend(src, out, mode, alpha, policy);
+          BOOST_CHECK(equal(out, expected));
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(blendIdentities) {
+  const Image dst = random(9, 30, 9, true);
+  Image opaque = random(9, 30, 10, true), clear(9, 30), white(9, 30),
+        black(9, 30);
+  for (size_t i = 0; i < 9 * 4 * 30; i += 4) {
+    opaque.data()[i + 3] = 255;
+    for (size_t k = 0; k < 4; ++k) {
+      clear.data()[i + k] = 0;
+      white.data()[i + k] = 255;
+      black.data()[i + k] = k == 3 ? 255 : 0;
+    }
+  }
+
+  // An opaque source replaces the destination, and a clear source leaves it
+  // unchanged.
+  Image out = copy(dst);
+  alg::blend(opaque, out);
+  BOOST_CHECK(equal(out, opaque));
+  out = copy(dst);
+  alg::blend(clear, out);
+  BOOST_CHECK(equal(out, dst));
+
+  // Multiplying an opaque image by white, and screening it with black,
+  // leaves it unchanged.
+  out = copy(opaque);
+  alg::blend(white, out, alg::BL_MULTIPLY);
+  BOOST_CHECK(equal(out, opaque));
+  out = copy(opaque);
+  alg::blend(black, out, alg::BL_SCREEN);
+  BOOST_CHECK(equal(out, opaque));
+}
+
+BOOST_AUTO_TEST_CASE(straightOverOpaqueIsInterpolation) {
+  // A straight alpha source over an opaque destination interpolates
+  // between them, to within the rounding of the premultiplied channels.
+  const Image src = random(11, 45, 11, false);
+  Image dst = random(11, 45, 12, false);
+  for (size_t i = 0; i < 11 * 4 * 45; i += 4)
+    dst.data()[i + 3] = 255;
+  Image out = copy(dst);
+  alg::blend(src, out, alg::BL_OVER, alg::AM_STRAIGHT, EP_PARALLEL);
+  for (size_t i = 0; i < 11 * 4 * 45; i += 4) {
+    const double a = src.data()[i + 3] / 255.0;
+    BOOST_REQUIRE(out.data()[i + 3] == 255);
+    for (size_t k = 0; k < 3; ++k) {
+      const double expected = src.data()[i + k] * a +
+                              dst.data()[i + k] * (1.0 - a);
+      BOOST_REQUIRE(std::abs(out.data()[i + k] - expected) <= 1.0);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,194 @@
+//---- tests/components_tests.cc --------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  components_tests.cc
+/// \brief Test file to test the snap connected component labeling.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapComponentsTests
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/components.hpp"
+#include "snap/algorithm/transform.hpp"
+#include "thread_fixture.hpp"
+#include <random>
+
+using namespace snap;
+
+using Mask = Matrix<mat::FM_GREY_8>;
+
+// Fixture with the helpers to build masks, and the reference labeling.
+struct ComponentsFixture : ThreadFixture {
+  static void set(Mask& m, size_t r, size_t c, uint8_t v = 255) {
+    m.data()[r * m.stride() + c] = v;
+  }
+
+  static bool at(const Mask& m, long r, long c) {
+    return r >= 0 && c >= 0 && r < long(m.rows()) && c < long(m.cols()) &&
+      m.data()[r * m.stride() + c] != 0;
+  }
+
+  // Reference labeling with a flood fill in raster order.
+  static std::vector<uint32_t> reference(const Mask& m, alg::Connectivity cn,
+      std::vector<alg::Blob>& blobs) {
+    const long rows = m.rows(), cols = m.cols();
+    std::vector<uint32_t> labels(rows * cols, 0);
+    blobs.clear();
+    for (long r = 0; r < rows; ++r) {
+      for (long c = 0; c < cols; ++c) {
+        if (!at(m, r, c) || labels[r * cols + c] != 0) continue;
+        const uint32_t label = static_cast<uint32_t>(blobs.size() + 1);
+        alg::Blob blob{label, 0, Rect{size_t(c), size_t(r), 1, 1}, 0, 0};
+        size_t minX = c, maxX = c, maxY = r;
+        std::vector<std::pair<long, long>> stack{{r, c}};
+        labels[r * cols + c] = label;
+        while (!stack.empty()) {
+          const auto p = stack.back(); stack.pop_back();
+          ++blob.area;
+          blob.cx += p.second;
+          blob.cy += p.first;
+          minX = std::min<size_t>(minX, p.second);
+          maxX = std::max<size_t>(maxX, p.second);
+          maxY = std::max<size_t>(maxY, p.first);
+          for (long dr = -1; dr <= 1; ++dr) {
+            for (long dc = -1; dc <= 1; ++dc) {
+              if ((dr == 0 && dc == 0) || (cn == alg::CN_4 && dr && dc))
+                continue;
+              const long nr = p.first + dr, nc = p.second + dc;
+              if (at(m, nr, nc) && labels[nr * cols + nc] == 0) {
+                labels[nr * cols + nc] = label;
+                stack.emplace_back(nr, nc);
+              }
+            }
+          }
+        }
+        blob.bounds = Rect{minX, size_t(r), maxX - minX + 1, maxY - r + 1};
+        blob.cx /= blob.area;
+        blob.cy /= blob.area;
+        blobs.push_back(blob);
+      }
+    }
+    return labels;
+  }
+
+  // Checks the labeler against the reference for \p m.
+  static void check(const Mask& m, alg::Connectivity cn) {
+    std::vector<alg::Blob> expected, blobs;
+    const auto expectedLabels = reference(m, cn, expected);
+
+    alg::ComponentLabeler labeler(cn);
+    for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+      std::vector<uint32_t> labels(m.rows() * m.cols(), 7);
+      BOOST_CHECK(labeler.label(m, labels.data(), blobs, policy) ==
+        expected.size());
+      BOOST_REQUIRE(blobs.size() == expected.size());
+      BOOST_CHECK(labels == expectedLabels);
+      for (size_t i = 0; i < blobs.size(); ++i) {
+        const auto& a = blobs[i];
+        const auto& b = expected[i];
+        BOOST_CHECK(a.label == b.label && a.area == b.area);
+        BOOST_CHECK(a.bounds.x     == b.bounds.x     && 
+                    a.bounds.y     == b.bounds.y     &&
+                    a.bounds.width == b.bounds.width && 
+                    a.bounds.height == b.bounds.height);
+        BOOST_CHECK_CLOSE(a.cx + 1, b.cx + 1, 1e-9);
+        BOOST_CHECK_CLOSE(a.cy + 1, b.cy + 1, 1e-9);
+      }
+    }
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SnapComponentsSuite, ComponentsFixture)
+
+BOOST_AUTO_TEST_CASE(emptyAndFullMasks) {
+  Mask m(37, 45);
+  alg::fill(m, 0);
+  std::vector<alg::Blob> blobs;
+  BOOST_CHECK(alg::ComponentLabeler().label(m, blobs) == 0);
+
+  alg::fill(m, 1);
+  BOOST_CHECK(alg::ComponentLabeler().label(m, blobs, EP_PARALLEL) == 1);
+  BOOST_CHECK(blobs[0].area == m.size());
+  BOOST_CHECK(blobs[0].bounds.width == 45 && blobs[0].bounds.height == 37);
+  BOOST_CHECK_CLOSE(blobs[0].cx, 22.0, 1e-9);
+  BOOST_CHECK_CLOSE(blobs[0].cy, 18.0, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(diagonalsDependOnConnectivity) {
+  Mask m(8, 8);
+  alg::fill(m, 0);
+  for (size_t i = 0; i < 8; ++i)
+    set(m, i, i);
+
+  std::vector<alg::Blob> blobs;
+  BOOST_CHECK(alg::ComponentLabeler(alg::CN_8).label(m, blobs) == 1);
+  BOOST_CHECK(alg::ComponentLabeler(alg::CN_4).label(m, blobs) == 8);
+  check(m, alg::CN_4);
+  check(m, alg::CN_8);
+}
+
+BOOST_AUTO_TEST_CASE(canMergeComponentsAcrossBands) {
+  // A U shape whose arms are only joined in the last row, and a spiral,
+  // in a mask which is large enough to be split into three bands, so that
+  // the components are merged across every band boundary.
+  const size_t rows = 1800, cols = 121;
+  static_assert(rows * cols >= PARALLEL_TEST_ELEMENTS, 
+                "The mask must be split across the threads!");
+  Mask m(rows, cols);
+  alg::fill(m, 0);
+  for (size_t r = 0; r < rows; ++r) {
+    set(m, r, 2);
+    set(m, r, cols - 3);
+  }
+  for (size_t c = 2; c <= cols - 3; ++c)
+    set(m, rows - 1, c);
+  for (size_t r = 5; r + 10 < rows; r += 8) {
+    for (size_t c = 10; c < 100; ++c) set(m, r, c);
+    for (size_t k = 0; k < 4; ++k) set(m, r + k, (r / 8) % 2 ? 10 : 99);
+  }
+  check(m, alg::CN_4);
+  check(m, alg::CN_8);
+}
+
+BOOST_AUTO_TEST_CASE(largeRandomMasksMatchReference) {
+  // Densities around the percolation threshold, where components are large
+  // and cross the band boundaries in many places.
+  std::mt19937 gen(9);
+  std::uniform_int_distribution<int> value(0, 99);
+  for (const int density : {45, 60}) {
+    Mask m(449, 457);
+    for (size_t r = 0; r < m.rows(); ++r)
+      for (size_t c = 0; c < m.cols(); ++c)
+        set(m, r, c, value(gen) < density ? 1 : 0);
+    BOOST_REQUIRE(m.size() >= PARALLEL_TEST_ELEMENTS);
+    check(m, alg::CN_4);
+    check(m, alg::CN_8);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(randomMasksMatchReference) {
+  std::mt19937 gen(5);
+  for (const int density : {10, 45, 60, 90}) {
+    std::uniform_int_distribution<int> value(0, 99);
+    for (const auto& size : {std::make_pair(1, 1), std::make_pair(3, 17),
+                             std::make_pair(64, 64), std::make_pair(97, 131)}) {
+      Mask m(size.first, size.second);
+      for (size_t r = 0; r < m.rows(); ++r)
+        for (size_t c = 0; c < m.cols(); ++c)
+          set(m, r, c, value(gen) < density ? uint8_t(value(gen) + 1) : 0);
+      check(m, alg::CN_4);
+      check(m, alg::CN_8);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
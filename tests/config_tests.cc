@@ -22,7 +22,7 @@
 BOOST_AUTO_TEST_SUITE(SnapConfigSuite)
 
 BOOST_AUTO_TEST_CASE(simdTypeDetected) {
-  BOOST_CHECK(snap::SIMD_TYPE >= 0 && snap::SIMD_TYPE <= 10);
+  BOOST_CHECK(snap::SIMD_TYPE >= 0 && snap::SIMD_TYPE <= snap::ST_SCALAR);
 }
 
 BOOST_AUTO_TEST_CASE(alignmentSet) {
@@ -0,0 +1,538 @@
+//---- tests/differential_kernels.cc ----------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  differential_kernels.cc
+/// \brief Runs all the vector operations and kernels on randomized data. This
+///        file is compiled twice: once as is, for the SIMD backend, and once
+///        with SNAP_FORCE_SCALAR, snap=snap_scalar and 
+///        SNAP_DIFF_RUN=run_kernels_scalar, for the scalar backend. Renaming
+///        the namespace keeps the two builds of the header only library from
+///        violating the one definition rule.
+//
+//---------------------------------------------------------------------------//
+
+#include "differential_kernels.hpp"
+#include "snap/algorithm/binary.hpp"
+#include "snap/algorithm/blend.hpp"
+#include "snap/algorithm/components.hpp"
+#include "snap/algorithm/edges.hpp"
+#include "snap/algorithm/features.hpp"
+#include "snap/algorithm/filter.hpp"
+#include "snap/algorithm/match.hpp"
+#include "snap/algorithm/metrics.hpp"
+#include "snap/algorithm/motion.hpp"
+#include "snap/algorithm/preprocess.hpp"
+#include "snap/algorithm/statistics.hpp"
+#include "snap/algorithm/transform.hpp"
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+#ifndef SNAP_DIFF_RUN
+ #define SNAP_DIFF_RUN run_kernels_simd
+#endif
+
+using namespace snap;
+
+namespace {
+
+using Image = Matrix<mat::FM_GREY_8>;
+
+/// Appends the bytes of \p value to the result of kernel \p name.
+template <typename T>
+void put(KernelResults& results, const std::string& name, const T& value) {
+  static_assert(std::is_arithmetic<T>::value, "Only arithmetic values!");
+  auto& bytes = results[name];
+  const auto* p = reinterpret_cast<const uint8_t*>(&value);
+  bytes.insert(bytes.end(), p, p + sizeof(T));
+}
+
+/// Appends the elements of \p values to the result of kernel \p name.
+template <typename T>
+void put(KernelResults&        results, 
+         const std::string&    name   ,
+         const std::vector<T>& values ) {
+  for (const auto& value : values) put(results, name, value);
+}
+
+/// Appends the elements of vector \p v to the result of kernel \p name.
+template <typename DT, uint8_t W>
+void put(KernelResults& results, const std::string& name, 
+         const Vector<DT, W>& v) {
+  for (uint8_t i = 0; i < W; ++i) put(results, name, v[i]);
+}
+
+void put(KernelResults& results, const std::string& name, const Point& p) {
+  put(results, name, p.x);
+  put(results, name, p.y);
+}
+
+/// Runs the vector operations on \p a and \p b, which are 16 random bytes,
+/// where some of the elements of b are the same as those of a.
+void run_vector_ops(KernelResults& results, const uint8_t* a, 
+                    const uint8_t* b) {
+  Vec16x8u ua, ub; ua.load(a); ub.load(b);
+  Vec16x8s sa, sb; sa.load(a); sb.load(b);
+
+  put(results, "vec16x8u.add"     , ua + ub);
+  put(results, "vec16x8u.sub"     , ua - ub);
+  put(results, "vec16x8u.adds"    , adds(ua, ub));
+  put(results, "vec16x8u.subs"    , subs(ua, ub));
+  put(results, "vec16x8u.absdiff" , absdiff(ua, ub));
+  put(results, "vec16x8u.min"     , min(ua, ub));
+  put(results, "vec16x8u.max"     , max(ua, ub));
+  put(results, "vec16x8u.cmpeq"   , cmpeq(ua, ub));
+  put(results, "vec16x8u.movemask", movemask(ua));
+  put(results, "vec16x8u.hsum"    , ua.hsum());
+  put(results, "vec16x8u.hmin"    , ua.hmin());
+  put(results, "vec16x8u.hmax"    , ua.hmax());
+  put(results, "vec16x8u.sad"     , sad(ua, ub));
+  put(results, "vec16x8u.widen_lo", widen_lo(ua));
+  put(results, "vec16x8u.widen_hi", widen_hi(ua));
+
+  Vec16x8u low; low.loadl(a);
+  put(results, "vec16x8u.loadl"   , low);
+
+  // Shuffles and permutes pick their instructions by pattern, so cover a
+  // shift, a dword pattern, a general one with zeros and the common permutes.
+  const auto Z = SHUFFLE_ZERO;
+  put(results, "vec16x8u.shuffle.shift", 
+    shuffle<3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, Z, Z, Z>(ua));
+  put(results, "vec16x8u.shuffle.dwords", 
+    shuffle<12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3>(ua));
+  put(results, "vec16x8u.shuffle.reverse", 
+    shuffle<15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0>(ua));
+  put(results, "vec16x8u.shuffle.zeros", 
+    shuffle<0, 3, 6, 9, 12, 15, Z, Z, 1, 4, 7, 10, 13, Z, Z, 5>(ua));
+  put(results, "vec16x8u.permute.unpack", 
+    permute<0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23>(ua, ub));
+  put(results, "vec16x8u.permute.window", 
+    permute<5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20>(
+      ua, ub));
+  put(results, "vec16x8u.permute.blend", 
+    permute<0, 17, 2, 19, 4, 5, 22, 7, 24, 9, 10, 27, 12, 29, 30, 15>(ua, ub));
+  put(results, "vec16x8u.permute.deinterleave", 
+    permute<0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30>(
+      ua, ub));
+
+  put(results, "vec16x8s.add"     , sa + sb);
+  put(results, "vec16x8s.sub"     , sa - sb);
+  put(results, "vec16x8s.adds"    , adds(sa, sb));
+  put(results, "vec16x8s.subs"    , subs(sa, sb));
+  put(results, "vec16x8s.min"     , min(sa, sb));
+  put(results, "vec16x8s.max"     , max(sa, sb));
+  put(results, "vec16x8s.cmpeq"   , cmpeq(sa, sb));
+  put(results, "vec16x8s.movemask", movemask(sa));
+  put(results, "vec16x8s.hsum"    , sa.hsum());
+  put(results, "vec16x8s.hmin"    , sa.hmin());
+  put(results, "vec16x8s.hmax"    , sa.hmax());
+  put(results, "vec16x8s.shuffle.reverse", 
+    shuffle<15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0>(sa));
+  put(results, "vec16x8s.permute.general", 
+    permute<31, 0, 30, 1, 29, 2, 28, 3, Z, 4, 27, 5, 26, 6, 25, 7>(sa, sb));
+
+  Vec8x16u wa, wb; wa.load(a); wb.load(b);
+  Vec8x16s va, vb; va.load(a); vb.load(b);
+  put(results, "vec8x16u.add"     , wa + wb);
+  put(results, "vec8x16u.sub"     , wa - wb);
+  put(results, "vec8x16u.mul"     , wa * wb);
+  put(results, "vec8x16u.madd"    , madd(wa, wb));
+  put(results, "vec8x16u.subs"    , subs(wa, wb));
+  put(results, "vec8x16u.cmpeq"   , cmpeq(wa, wb));
+  put(results, "vec8x16u.bitwise" , ~(wa & wb) ^ (wa | wb));
+  put(results, "vec8x16u.narrow"  , narrow(wa, wb));
+  put(results, "vec8x16u.widen_lo", widen_lo(wa));
+  put(results, "vec8x16u.widen_hi", widen_hi(wa));
+  put(results, "vec8x16s.mul"     , va * vb);
+  put(results, "vec8x16s.madd"    , madd(va, vb));
+
+  Vec4x32u da, db; da.load(a); db.load(b);
+  Vec4x32s ea, eb; ea.load(a); eb.load(b);
+  put(results, "vec4x32u.add"     , da + db);
+  put(results, "vec4x32u.sub"     , da - db);
+  put(results, "vec4x32u.hsum"    , da.hsum());
+  put(results, "vec4x32s.hsum"    , ea.hsum());
+}
+
+/// Runs the statistics kernels on \p m over the whole matrix and over \p roi
+/// with execution policy \p policy.
+void run_statistics(KernelResults& results, const Image& m, const Rect& roi,
+                    ExecutionPolicy policy, const std::string& suffix) {
+  put(results, "sum" + suffix           , alg::sum(m, policy));
+  put(results, "sum.roi" + suffix       , alg::sum(m, roi, policy));
+  put(results, "count_non_zero" + suffix, alg::count_non_zero(m, policy));
+  put(results, "count_non_zero.roi" + suffix, 
+    alg::count_non_zero(m, roi, policy));
+
+  const auto stats = alg::mean_stddev(m, roi, policy);
+  put(results, "mean_stddev.roi" + suffix, stats.mean);
+  put(results, "mean_stddev.roi" + suffix, stats.stddev);
+
+  const auto loc = alg::min_max_loc(m, policy);
+  put(results, "min_max_loc" + suffix, loc.minVal);
+  put(results, "min_max_loc" + suffix, loc.maxVal);
+  put(results, "min_max_loc" + suffix, loc.minLoc);
+  put(results, "min_max_loc" + suffix, loc.maxLoc);
+}
+
+/// Runs the metrics kernels on \p a and \p b with policy \p policy.
+void run_metrics(KernelResults& results, const Image& a, const Image& b, 
+                 ExecutionPolicy policy, const std::string& suffix) {
+  put(results, "sad" + suffix , alg::sad(a, b, policy));
+  put(results, "ssd" + suffix , alg::ssd(a, b, policy));
+  put(results, "psnr" + suffix, alg::psnr(a, b, policy));
+  put(results, "ssim" + suffix, alg::ssim(a, b, policy));
+
+  std::vector<uint32_t> blocks;
+  alg::sad_blocks<8>(a, b, blocks, policy);
+  put(results, "sad_blocks<8>" + suffix, blocks);
+  alg::ssd_blocks<16>(a, b, blocks, policy);
+  put(results, "ssd_blocks<16>" + suffix, blocks);
+
+  std::vector<float> ssims;
+  alg::ssim_blocks<8>(a, b, ssims, policy);
+  put(results, "ssim_blocks<8>" + suffix, ssims);
+}
+
+/// Runs the elementwise kernels on \p a and \p b with policy \p policy, with
+/// both regular and streaming stores.
+void run_transform(KernelResults& results, const Image& a, const Image& b,
+                   ExecutionPolicy policy, const std::string& suffix) {
+  Image out(a.rows(), a.cols());
+  for (const auto write : {alg::WP_CACHED, alg::WP_STREAM}) {
+    const std::string name = suffix + (write == alg::WP_STREAM ? ".stream" 
+                                                               : "");
+    alg::fill(out, 0x3c, policy, write);
+    put(results, "fill" + name, 
+      std::vector<uint8_t>(out.data(), out.data() + out.size()));
+    alg::copy(a, out, policy, write);
+    put(results, "copy" + name, 
+      std::vector<uint8_t>(out.data(), out.data() + out.size()));
+    alg::absdiff(a, b, out, policy, write);
+    put(results, "absdiff" + name, 
+      std::vector<uint8_t>(out.data(), out.data() + out.size()));
+  }
+}
+
+/// Runs the motion estimation kernels on \p reference and \p current with 
+/// policy \p policy.
+void run_motion(KernelResults& results, const Image& reference, 
+                const Image& current, ExecutionPolicy policy, 
+                const std::string& suffix) {
+  const std::pair<alg::SearchMethod, const char*> methods[] = {
+    {alg::SM_FULL, "full"}, {alg::SM_DIAMOND, "diamond"}, 
+    {alg::SM_HEXAGON, "hexagon"}
+  };
+  std::vector<alg::MotionVector> field;
+  for (const auto& method : methods) {
+    for (const auto blockSize : {8, 16}) {
+      if (blockSize == 8) {
+        alg::estimate_motion<8>(reference, current, field, method.first, 7, 
+          policy);
+      } else {
+        alg::estimate_motion<16>(reference, current, field, method.first, 7,
+          policy);
+      }
+      const auto name = std::string("estimate_motion<") + 
+        std::to_string(blockSize) + ">." + method.second + suffix;
+      for (const auto& mv : field) {
+        put(results, name, mv.x);
+        put(results, name, mv.y);
+        put(results, name, mv.sad);
+      }
+    }
+  }
+}
+
+/// Runs the alpha conversions and the blend modes on the BGRA matrices made
+/// from the values of \p a and \p b, with both alpha representations, with
+/// policy \p policy.
+void run_blend(KernelResults& results, const Image& a, const Image& b,
+               ExecutionPolicy policy, const std::string& suffix) {
+  using Bgra = Matrix<mat::FM_BGRA_32>;
+  Bgra src(a.rows(), a.cols()), dst(a.rows(), a.cols()), 
+       out(a.rows(), a.cols());
+  for (size_t r = 0; r < a.rows(); ++r) {
+    for (size_t c = 0; c < a.cols(); ++c) {
+      uint8_t* s = src.data() + r * src.stride() + 4 * c;
+      uint8_t* d = dst.data() + r * dst.stride() + 4 * c;
+      s[0] = d[3] = a(r, c);
+      s[1] = d[0] = b(r, c);
+      s[2] = d[1] = static_cast<uint8_t>(a(r, c) ^ b(r, c));
+      s[3] = d[2] = static_cast<uint8_t>(a(r, c) + b(r, c));
+    }
+  }
+
+  const auto putBgra = [&] (const std::string& name, const Bgra& m) {
+    put(results, name + suffix, 
+      std::vector<uint8_t>(m.data(), m.data() + 4 * m.size()));
+  };
+  alg::premultiply(src, out, policy);
+  putBgra("premultiply", out);
+  alg::unpremultiply(src, out, policy);
+  putBgra("unpremultiply", out);
+
+  // The premultiplied sources are the straight sources premultiplied, so
+  // that the colour channels are at most alpha.
+  const std::pair<alg::BlendMode, const char*> modes[] = {
+    {alg::BL_OVER, "over"}, {alg::BL_MULTIPLY, "multiply"},
+    {alg::BL_SCREEN, "screen"}
+  };
+  Bgra premultSrc(a.rows(), a.cols()), premultDst(a.rows(), a.cols());
+  alg::premultiply(src, premultSrc, policy);
+  alg::premultiply(dst, premultDst, policy);
+  for (const auto& mode : modes) {
+    for (const auto alpha : {alg::AM_PREMULTIPLIED, alg::AM_STRAIGHT}) {
+      const bool straight = alpha == alg::AM_STRAIGHT;
+      const Bgra& from = straight ? dst : premultDst;
+      std::copy(from.data(), from.data() + 4 * from.size(), out.data());
+      alg::blend(straight ? src : premultSrc, out, mode.first, alpha, 
+        policy);
+      putBgra(std::string("blend.") + mode.second + 
+        (straight ? ".straight" : ""), out);
+    }
+  }
+}
+
+/// Runs the BGR to tensor conversion on the BGR matrix made from the 
+/// values of \p a and \p b, with both layouts, with policy \p policy.
+void run_preprocess(KernelResults& results, const Image& a, const Image& b,
+                    ExecutionPolicy policy, const std::string& suffix) {
+  Matrix<mat::FM_BGR_24> bgr(a.rows(), a.cols());
+  for (size_t r = 0; r < a.rows(); ++r) {
+    for (size_t c = 0; c < a.cols(); ++c) {
+      uint8_t* e = bgr.data() + r * bgr.stride() + 3 * c;
+      e[0] = a(r, c);
+      e[1] = b(r, c);
+      e[2] = static_cast<uint8_t>(a(r, c) ^ b(r, c));
+    }
+  }
+
+  const float mean[3]   = {104.0f, 117.0f, 123.0f};
+  const float stddev[3] = {57.4f, 57.1f, 58.4f};
+  std::vector<float> tensor(3 * bgr.size());
+  alg::to_tensor(bgr, tensor.data(), mean, stddev, alg::TL_CHW, policy);
+  put(results, "to_tensor.chw" + suffix, tensor);
+  alg::to_tensor(bgr, tensor.data(), mean, stddev, alg::TL_HWC, policy);
+  put(results, "to_tensor.hwc" + suffix, tensor);
+}
+
+/// Runs the Sobel gradients and the FAST detector on \p m, with each of the
+/// segment tests and scores, with policy \p policy.
+void run_features(KernelResults& results, const Image& m,
+                  ExecutionPolicy policy, const std::string& suffix) {
+  std::vector<int16_t> dx(m.size()), dy(m.size());
+  alg::sobel(m, dx.data(), dy.data(), policy);
+  put(results, "sobel.dx" + suffix, dx);
+  put(results, "sobel.dy" + suffix, dy);
+
+  alg::KeyPoints keypoints(m.size());
+  for (const auto type : {alg::FT_9, alg::FT_12}) {
+    for (const auto score : {alg::CS_FAST, alg::CS_HARRIS}) {
+      alg::FastParams params;
+      params.type        = type;
+      params.score       = score;
+      params.cellCorners = 16;
+      alg::FastDetector(params).detect(m, keypoints, 0, 1.0f, policy);
+
+      const auto name = std::string("fast.") + std::to_string(int(type)) + 
+        (score == alg::CS_FAST ? "" : ".harris") + suffix;
+      put(results, name, keypoints.size());
+      for (const auto& k : keypoints) {
+        put(results, name, k.x);
+        put(results, name, k.y);
+        put(results, name, k.response);
+      }
+      keypoints.clear();
+    }
+  }
+}
+
+/// Runs the Canny detector on \p m, with thresholds which leave some weak
+/// candidates and which leave none, with policy \p policy.
+void run_edges(KernelResults& results, const Image& m,
+               ExecutionPolicy policy, const std::string& suffix) {
+  Image out(m.rows(), m.cols());
+  for (const auto& thresholds : {std::make_pair(300, 700), 
+                                 std::make_pair(500, 500)}) {
+    alg::canny(m, out, thresholds.first, thresholds.second, policy);
+    put(results, "canny." + std::to_string(thresholds.first) + suffix, 
+      std::vector<uint8_t>(out.data(), out.data() + out.size()));
+  }
+}
+
+/// Runs the median filter on \p m with the radii of both networks and of
+/// the histogram method, with policy \p policy.
+void run_filter(KernelResults& results, const Image& m,
+                ExecutionPolicy policy, const std::string& suffix) {
+  Image out(m.rows(), m.cols());
+  for (const size_t radius : {1, 2, 3, 7}) {
+    alg::median(m, out, radius, alg::BM_REFLECT, 0, policy);
+    put(results, "median." + std::to_string(radius) + suffix, 
+      std::vector<uint8_t>(out.data(), out.data() + out.size()));
+  }
+}
+
+/// Runs the template matching of the block of \p current at (5, 3) in \p
+/// reference, with both methods, over all the positions and with a pyramid
+/// search, with policy \p policy.
+void run_match(KernelResults& results, const Image& reference, 
+               const Image& current, ExecutionPolicy policy, 
+               const std::string& suffix) {
+  Image templ(std::min<size_t>(reference.rows() - 3, 34), 
+              std::min<size_t>(reference.cols() - 5, 37));
+  for (size_t r = 0; r < templ.rows(); ++r)
+    for (size_t c = 0; c < templ.cols(); ++c)
+      templ(r, c) = current(r + 3, c + 5);
+
+  std::vector<float> scores;
+  for (const auto method : {alg::MM_SSD, alg::MM_NCC}) {
+    const std::string name = method == alg::MM_SSD ? ".ssd" : ".ncc";
+    alg::match_template(reference, templ, scores, method, policy);
+    put(results, "match_template" + name + suffix, scores);
+    for (const size_t levels : {0, 2}) {
+      const auto match = alg::find_template(reference, templ, method, 
+        levels, policy);
+      const auto levelName = "find_template" + name + "." + 
+        std::to_string(levels) + suffix;
+      put(results, levelName, match.x);
+      put(results, levelName, match.y);
+      put(results, levelName, match.score);
+    }
+  }
+}
+
+/// Runs the connected component labeling of the pixels of \p m which are
+/// above 150, with both connectivities, with policy \p policy.
+void run_components(KernelResults& results, const Image& m,
+                    ExecutionPolicy policy, const std::string& suffix) {
+  Image mask(m.rows(), m.cols());
+  for (size_t r = 0; r < m.rows(); ++r)
+    for (size_t c = 0; c < m.cols(); ++c)
+      mask(r, c) = m(r, c) > 150 ? m(r, c) : 0;
+
+  std::vector<uint32_t>  labels(m.size());
+  std::vector<alg::Blob> blobs;
+  for (const auto cn : {alg::CN_4, alg::CN_8}) {
+    alg::ComponentLabeler(cn).label(mask, labels.data(), blobs, policy);
+    const auto name = std::string("components.") + 
+      (cn == alg::CN_4 ? "4" : "8") + suffix;
+    put(results, name, labels);
+    for (const auto& blob : blobs) {
+      put(results, name, blob.area);
+      put(results, name, blob.bounds.x);
+      put(results, name, blob.bounds.y);
+      put(results, name, blob.bounds.width);
+      put(results, name, blob.bounds.height);
+    }
+  }
+}
+
+/// Runs the binary mask kernels on the masks of the pixels of \p a and \p b
+/// which are above 128, with policy \p policy. The results are unpacked, 
+/// since the padding bits of the masks are unspecified.
+void run_binary(KernelResults& results, const Image& a, const Image& b,
+                ExecutionPolicy policy, const std::string& suffix) {
+  using Binary = Matrix<mat::FM_BIN_1>;
+  Image  grey(a.rows(), a.cols());
+  Binary ma(a.rows(), a.cols()), mb(a.rows(), a.cols()), 
+         out(a.rows(), a.cols());
+  for (size_t i = 0; i < 2; ++i) {
+    const Image& m = i == 0 ? a : b;
+    for (size_t r = 0; r < m.rows(); ++r)
+      for (size_t c = 0; c < m.cols(); ++c)
+        grey(r, c) = m(r, c) > 128 ? m(r, c) : 0;
+    alg::pack(grey, i == 0 ? ma : mb, policy);
+  }
+
+  auto putMask = [&] (const std::string& name, const Binary& m) {
+    alg::unpack(m, grey, 255, policy);
+    put(results, name + suffix, 
+      std::vector<uint8_t>(grey.data(), grey.data() + grey.size()));
+  };
+  putMask("pack", ma);
+  alg::bitwise_and(ma, mb, out, policy);
+  putMask("bitwise_and", out);
+  alg::bitwise_or(ma, mb, out, policy);
+  putMask("bitwise_or", out);
+  alg::bitwise_xor(ma, mb, out, policy);
+  putMask("bitwise_xor", out);
+  alg::bitwise_not(ma, out, policy);
+  putMask("bitwise_not", out);
+  put(results, "count_non_zero.binary" + suffix, 
+    alg::count_non_zero(ma, policy));
+  for (const auto cn : {alg::CN_4, alg::CN_8}) {
+    const std::string name = cn == alg::CN_4 ? ".4" : ".8";
+    alg::dilate(ma, out, cn, policy);
+    putMask("dilate" + name, out);
+    alg::erode(ma, out, cn, policy);
+    putMask("erode" + name, out);
+  }
+}
+
+} // namespace anon
+
+KernelResults SNAP_DIFF_RUN(const KernelParams& params) {
+  KernelResults results;
+  std::mt19937 gen(params.seed);
+  std::uniform_int_distribution<int> value(0, 255), noise(-12, 12), 
+                                     coin(0, 1);
+
+  for (size_t i = 0; i < 64; ++i) {
+    uint8_t a[16], b[16];
+    for (size_t j = 0; j < 16; ++j) {
+      a[j] = static_cast<uint8_t>(value(gen));
+      b[j] = coin(gen) ? a[j] : static_cast<uint8_t>(value(gen));
+    }
+    run_vector_ops(results, a, b);
+  }
+
+  // The current frame is the reference shifted by (3, -2), plus noise, with
+  // some runs of zeros so that count_non_zero has something to count.
+  Image reference(params.rows, params.cols), current(params.rows, params.cols);
+  for (size_t r = 0; r < params.rows; ++r) {
+    for (size_t c = 0; c < params.cols; ++c) {
+      reference(r, c) = r % 7 == 0 && c % 3 == 0 
+                      ? 0 : static_cast<uint8_t>(value(gen));
+    }
+  }
+  for (size_t r = 0; r < params.rows; ++r) {
+    for (size_t c = 0; c < params.cols; ++c) {
+      const size_t sr = std::min(params.rows - 1, r + 2);
+      const size_t sc = c >= 3 ? c - 3 : 0;
+      current(r, c) = static_cast<uint8_t>(
+        std::min(255, std::max(0, reference(sr, sc) + noise(gen))));
+    }
+  }
+
+  const Rect roi{params.cols / 5, params.rows / 4, 
+                 params.cols / 2 + 1, params.rows / 2 + 1};
+
+  util::par::set_thread_count(params.threads);
+  for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+    const std::string suffix = policy == EP_SERIAL ? "" : ".parallel";
+    run_statistics(results, reference, roi, policy, suffix);
+    run_metrics(results, reference, current, policy, suffix);
+    run_transform(results, reference, current, policy, suffix);
+    run_motion(results, reference, current, policy, suffix);
+    run_preprocess(results, reference, current, policy, suffix);
+    run_blend(results, reference, current, policy, suffix);
+    run_features(results, current, policy, suffix);
+    run_edges(results, current, policy, suffix);
+    run_filter(results, current, policy, suffix);
+    run_match(results, reference, current, policy, suffix);
+    run_components(results, reference, policy, suffix);
+    run_binary(results, reference, current, policy, suffix);
+  }
+  util::par::set_thread_count(0);
+
+  return results;
+}
@@ -0,0 +1,49 @@
+//---- tests/differential_kernels.hpp ---------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  differential_kernels.hpp
+/// \brief Interface between the differential tests and the kernels, which
+///        are compiled once for the SIMD backend and once for the scalar
+///        backend. Only standard types cross the interface, since the snap
+///        types of the two builds are different types.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_TESTS_DIFFERENTIAL_KERNELS_HPP
+#define SNAP_TESTS_DIFFERENTIAL_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/// Defines the results of running all the kernels, as the raw bytes of the
+/// result of each kernel, keyed by the name of the kernel.
+using KernelResults = std::map<std::string, std::vector<uint8_t>>;
+
+/// Defines the parameters which the kernels are run with.
+struct KernelParams {
+  uint32_t seed;      //!< The seed for the random images.
+  size_t   rows;      //!< The number of rows in the images.
+  size_t   cols;      //!< The number of columns in the images.
+  size_t   threads;   //!< The number of threads for the parallel kernels.
+};
+
+/// Runs all the kernels with the SIMD backend.
+/// \param[in] params The parameters to run the kernels with.
+KernelResults run_kernels_simd(const KernelParams& params);
+
+/// Runs all the kernels with the scalar backend.
+/// \param[in] params The parameters to run the kernels with.
+KernelResults run_kernels_scalar(const KernelParams& params);
+
+#endif // SNAP_TESTS_DIFFERENTIAL_KERNELS_HPP
@@ -0,0 +1,53 @@
+//---- tests/differential_tests.cc ------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  differential_tests.cc
+/// \brief Test file to check that the SIMD backend gives bit for bit the 
+///        same results as the scalar backend for all the kernels.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapDifferentialTests
+
+#include <boost/test/unit_test.hpp>
+#include "differential_kernels.hpp"
+
+// Checks that the SIMD and scalar results are identical for each kernel.
+static void checkBackendsMatch(const KernelParams& params) {
+  const auto simd   = run_kernels_simd(params);
+  const auto scalar = run_kernels_scalar(params);
+
+  BOOST_REQUIRE_EQUAL(simd.size(), scalar.size());
+  for (const auto& result : simd) {
+    BOOST_TEST_CONTEXT("Kernel: " << result.first) {
+      const auto reference = scalar.find(result.first);
+      BOOST_REQUIRE(reference != scalar.end());
+      BOOST_CHECK(!result.second.empty());
+      BOOST_CHECK(result.second == reference->second);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(SnapDifferentialSuite)
+
+BOOST_AUTO_TEST_CASE(backendsMatchForUnalignedSizes) {
+  checkBackendsMatch(KernelParams{3, 77, 133, 3});
+}
+
+BOOST_AUTO_TEST_CASE(backendsMatchForAlignedSizes) {
+  checkBackendsMatch(KernelParams{5, 64, 128, 4});
+}
+
+BOOST_AUTO_TEST_CASE(backendsMatchForSmallSizes) {
+  checkBackendsMatch(KernelParams{7, 17, 19, 2});
+}
+
+BOOST_AUTO_TEST_SUITE_END()
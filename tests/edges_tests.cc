@@ -0,0 +1,184 @@
+//---- tests/edges_tests.cc -------------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  edges_tests.cc
+/// \brief Test file to test the snap Canny edge detector.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapEdgesTests
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/edges.hpp"
+#include "snap/algorithm/transform.hpp"
+#include "thread_fixture.hpp"
+#include <cmath>
+#include <random>
+
+using namespace snap;
+
+using Image = Matrix<mat::FM_GREY_8>;
+
+// Fixture with a noisy image with smooth shapes and sharp squares. The
+// image is split into bands across the threads, and the second shape is
+// centred on the boundary of the first two bands, so that its edges are
+// connected across them.
+struct EdgesFixture : ThreadFixture {
+  static constexpr size_t rows = 443;
+  static constexpr size_t cols = 449;
+  static_assert(rows * cols >= PARALLEL_TEST_ELEMENTS,
+                "The image must be split across threads!");
+
+  Image image{rows, cols};
+
+  EdgesFixture() {
+    std::mt19937 gen(13);
+    std::uniform_int_distribution<int> noise(0, 20);
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t c = 0; c < cols; ++c) {
+        int v = 70 + noise(gen);
+        if ((r / 29) % 2 == 0 && (c / 37) % 2 == 1) v += 90;
+        const double d = std::hypot(double(r) - 90.0, double(c) - 60.0);
+        if (d < 35.0) v += int(120.0 - 3.0 * d);
+        const double e = std::hypot(double(r) - double(rows / 3),
+                                    double(c) - double(cols / 2));
+        if (e < 50.0) v += int(100.0 - 1.5 * e);
+        image.data()[r * image.stride() + c] = static_cast<uint8_t>(v);
+      }
+    }
+  }
+
+  // Reference detector, with full frame gradients and a recursive fill for
+  // the hysteresis.
+  static std::vector<uint8_t> reference(const Image& in, int low, int high) {
+    const int rows = int(in.rows()), cols = int(in.cols());
+    const auto at = [&] (int r, int c) {
+      return int(in.data()[r * in.stride() + c]);
+    };
+    std::vector<int> mag(rows * cols, 0), dir(rows * cols, 0);
+    for (int r = 1; r + 1 < rows; ++r) {
+      for (int c = 1; c + 1 < cols; ++c) {
+        const int gx = at(r - 1, c + 1) - at(r - 1, c - 1) +
+                       2 * (at(r, c + 1) - at(r, c - 1)) +
+                       at(r + 1, c + 1) - at(r + 1, c - 1);
+        const int gy = at(r + 1, c - 1) + 2 * at(r + 1, c) + at(r + 1, c + 1)
+                     - at(r - 1, c - 1) - 2 * at(r - 1, c) - at(r - 1, c + 1);
+        const int ax = std::abs(gx), ay = std::abs(gy);
+        mag[r * cols + c] = ax + ay;
+        dir[r * cols + c] = 12 * ax > 29 * ay ? 0 : 12 * ay > 29 * ax ? 2
+                          : (gx < 0) == (gy < 0) ? 1 : 3;
+      }
+    }
+
+    // Offsets of the neighbours before and after each direction.
+    const int before[4][2] = {{0, -1}, {-1, -1}, {-1, 0}, {-1, 1}};
+    std::vector<uint8_t> labels(rows * cols, 0);
+    std::vector<int>     stack;
+    for (int r = 1; r + 1 < rows; ++r) {
+      for (int c = 1; c + 1 < cols; ++c) {
+        const int  m = mag[r * cols + c], d = dir[r * cols + c];
+        const int  dr = before[d][0], dc = before[d][1];
+        const bool keep = m > low &&
+          m >  mag[(r + dr) * cols + c + dc] &&
+          m >= mag[(r - dr) * cols + c - dc];
+        labels[r * cols + c] = !keep ? 0 : m > high ? 2 : 1;
+        if (keep && m > high)
+          stack.push_back(r * cols + c);
+      }
+    }
+    while (!stack.empty()) {
+      const int p = stack.back();
+      stack.pop_back();
+      for (const int n : {-cols - 1, -cols, -cols + 1, -1, 1,
+                          cols - 1, cols, cols + 1}) {
+        if (labels[p + n] == 1) {
+          labels[p + n] = 2;
+          stack.push_back(p + n);
+        }
+      }
+    }
+    for (auto& l : labels)
+      l = l == 2 ? 255 : 0;
+    return labels;
+  }
+
+  static bool matches(const Image& out, const std::vector<uint8_t>& expected) {
+    for (size_t r = 0; r < out.rows(); ++r)
+      for (size_t c = 0; c < out.cols(); ++c)
+        if (out.data()[r * out.stride() + c] != expected[r * out.cols() + c])
+          return false;
+    return true;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SnapEdgesSuite, EdgesFixture)
+
+BOOST_AUTO_TEST_CASE(cannyMatchesReference) {
+  Image out(image.rows(), image.cols());
+  for (const auto& thresholds : {std::make_pair(40, 120),
+                                 std::make_pair(100, 300),
+                                 std::make_pair(200, 200)}) {
+    const auto expected =
+      reference(image, thresholds.first, thresholds.second);
+    size_t edges = 0;
+    for (const auto e : expected)
+      edges += e != 0;
+    BOOST_CHECK(edges > 0);
+
+    for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+      alg::fill(out, 7);
+      alg::canny(image, out, thresholds.first, thresholds.second, policy);
+      BOOST_CHECK(matches(out, expected));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(cannyOfNarrowImages) {
+  // Rows which are narrower than a vector, or not a multiple of one.
+  for (const size_t cols : {2, 3, 9, 17, 18, 33}) {
+    Image small(11, cols), out(11, cols);
+    for (size_t r = 0; r < 11; ++r)
+      for (size_t c = 0; c < cols; ++c)
+        small.data()[r * small.stride() + c] =
+          image.data()[(r + 20) * image.stride() + c + 30];
+    alg::canny(small, out, 30, 90);
+    BOOST_CHECK(matches(out, reference(small, 30, 90)));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(cannyFindsSquareOutline) {
+  Image square(64, 64), out(64, 64);
+  alg::fill(square, 20);
+  for (size_t r = 16; r < 48; ++r)
+    for (size_t c = 16; c < 48; ++c)
+      square.data()[r * square.stride() + c] = 220;
+  alg::canny(square, out, 100, 400, EP_PARALLEL);
+
+  // Every edge is on the boundary of the square, and each side has edges
+  // along all of its interior.
+  size_t left = 0, top = 0;
+  for (size_t r = 0; r < 64; ++r) {
+    for (size_t c = 0; c < 64; ++c) {
+      if (out.data()[r * out.stride() + c] == 0)
+        continue;
+      BOOST_CHECK(out.data()[r * out.stride() + c] == 255);
+      BOOST_CHECK((r >= 15 && r <= 48 && (c == 15 || c == 16 ||
+                                          c == 47 || c == 48)) ||
+                  (c >= 15 && c <= 48 && (r == 15 || r == 16 ||
+                                          r == 47 || r == 48)));
+      left += (c == 15 || c == 16) && r > 17 && r < 46;
+      top  += (r == 15 || r == 16) && c > 17 && c < 46;
+    }
+  }
+  BOOST_CHECK(left == 28 && top == 28);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
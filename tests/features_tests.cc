@@ -0,0 +1,272 @@
+//---- tests/features_tests.cc ----------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  features_tests.cc
+/// \brief Test file to test the snap Sobel gradients and FAST detector.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapFeaturesTests
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/features.hpp"
+#include "snap/algorithm/preprocess.hpp"
+#include "snap/algorithm/transform.hpp"
+#include "thread_fixture.hpp"
+#include <random>
+
+using namespace snap;
+
+using Image = Matrix<mat::FM_GREY_8>;
+
+// Fixture with a noisy image with bright and dark squares and spots, so that
+// it has corners of both polarities for both tests, which is large enough
+// for the parallel kernels to split it across the threads.
+struct FeaturesFixture : ThreadFixture {
+  static constexpr size_t rows = 443, cols = 449;
+  static_assert(rows * cols >= PARALLEL_TEST_ELEMENTS, 
+                "The image must be split across the threads!");
+  Image image{rows, cols};
+
+  FeaturesFixture() {
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<int> noise(0, 12);
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t c = 0; c < cols; ++c) {
+        int v = 100 + noise(gen);
+        if ((r / 20) % 2 == 0 && (c / 25) % 2 == 1) v += 80;
+        if ((r / 30) % 3 == 1 && (c / 35) % 2 == 0) v -= 70;
+        if (r % 37 == 18 && c % 41 == 20) v = 250;
+        if (r % 43 == 21 && c % 29 == 14) v = 5;
+        image.data()[r * image.stride() + c] = static_cast<uint8_t>(v);
+      }
+    }
+  }
+
+  uint8_t at(size_t r, size_t c) const {
+    return image.data()[r * image.stride() + c];
+  }
+
+  // Reference segment test score, which is 0 for pixels which are not
+  // corners.
+  int score(size_t r, size_t c, int t, size_t n) const {
+    static const int ringX[16] =
+      { 0,  1,  2,  3, 3, 3, 2, 1, 0, -1, -2, -3, -3, -3, -2, -1};
+    static const int ringY[16] =
+      {-3, -3, -2, -1, 0, 1, 2, 3, 3,  3,  2,  1,  0, -1, -2, -3};
+    int diffs[16], sumB = 0, sumD = 0;
+    for (size_t k = 0; k < 16; ++k) {
+      diffs[k] = at(r + ringY[k], c + ringX[k]) - at(r, c);
+      sumB += diffs[k] >  t ?  diffs[k] - t : 0;
+      sumD += diffs[k] < -t ? -diffs[k] - t : 0;
+    }
+    for (size_t start = 0; start < 16; ++start) {
+      bool bright = true, dark = true;
+      for (size_t k = 0; k < n; ++k) {
+        bright = bright && diffs[(start + k) % 16] >  t;
+        dark   = dark   && diffs[(start + k) % 16] < -t;
+      }
+      if (bright || dark)
+        return std::max(sumB, sumD);
+    }
+    return 0;
+  }
+
+  // Reference detector, with the same non-max suppression, which keeps all
+  // the corners which are not suppressed.
+  std::vector<std::pair<size_t, size_t>> reference(int t, size_t n) const {
+    std::vector<std::vector<int>> s(rows, std::vector<int>(cols, 0));
+    for (size_t r = 4; r + 4 < rows; ++r)
+      for (size_t c = 4; c + 4 < cols; ++c)
+        s[r][c] = score(r, c, t, n);
+
+    std::vector<std::pair<size_t, size_t>> corners;
+    for (size_t r = 4; r + 4 < rows; ++r) {
+      for (size_t c = 4; c + 4 < cols; ++c) {
+        const int v = s[r][c];
+        if (v == 0) continue;
+        bool keep = true;
+        for (int dr = -1; dr <= 1; ++dr) {
+          for (int dc = -1; dc <= 1; ++dc) {
+            if (dr == 0 && dc == 0) continue;
+            const int w = s[r + dr][c + dc];
+            const bool before = dr < 0 || (dr == 0 && dc < 0);
+            keep = keep && (before ? v > w : v >= w);
+          }
+        }
+        if (keep) corners.emplace_back(c, r);
+      }
+    }
+    return corners;
+  }
+};
+
+constexpr size_t FeaturesFixture::rows;
+constexpr size_t FeaturesFixture::cols;
+
+BOOST_FIXTURE_TEST_SUITE(SnapFeaturesSuite, FeaturesFixture)
+
+BOOST_AUTO_TEST_CASE(sobelMatchesReference) {
+  std::vector<int16_t> dx(rows * cols), dy(rows * cols);
+  for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+    std::fill(dx.begin(), dx.end(), int16_t(1));
+    alg::sobel(image, dx.data(), dy.data(), policy);
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t c = 0; c < cols; ++c) {
+        int gx = 0, gy = 0;
+        if (r > 0 && r + 1 < rows && c > 0 && c + 1 < cols) {
+          gx = (at(r - 1, c + 1) - at(r - 1, c - 1)) +
+               2 * (at(r, c + 1) - at(r, c - 1)) +
+               (at(r + 1, c + 1) - at(r + 1, c - 1));
+          gy = (at(r + 1, c - 1) + 2 * at(r + 1, c) + at(r + 1, c + 1)) -
+               (at(r - 1, c - 1) + 2 * at(r - 1, c) + at(r - 1, c + 1));
+        }
+        BOOST_REQUIRE(dx[r * cols + c] == gx);
+        BOOST_REQUIRE(dy[r * cols + c] == gy);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(fastMatchesReference) {
+  for (const auto type : {alg::FT_9, alg::FT_12}) {
+    for (const int t : {10, 30}) {
+      const auto expected = reference(t, type);
+      BOOST_CHECK(!expected.empty());
+
+      // Cells which are large enough to keep every corner.
+      alg::FastParams params;
+      params.threshold   = static_cast<uint8_t>(t);
+      params.type        = type;
+      params.cellSize    = 8;
+      params.cellCorners = 64;
+      alg::FastDetector detector(params);
+
+      for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+        alg::KeyPoints keypoints(4096);
+        detector.detect(image, keypoints, 0, 1.0f, policy);
+        BOOST_CHECK(keypoints.dropped() == 0);
+
+        std::vector<std::pair<size_t, size_t>> found;
+        for (const auto& k : keypoints) {
+          found.emplace_back(size_t(k.x), size_t(k.y));
+          BOOST_CHECK(k.response == float(score(k.y, k.x, t, type)));
+        }
+        std::sort(found.begin(), found.end(),
+          [] (const std::pair<size_t, size_t>& a,
+              const std::pair<size_t, size_t>& b) {
+            return std::make_pair(a.second, a.first) <
+                   std::make_pair(b.second, b.first);
+          });
+        BOOST_CHECK(found == expected);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(gridKeepsStrongestCornersOfEachCell) {
+  alg::FastParams params;
+  params.threshold   = 10;
+  params.cellSize    = 32;
+  params.cellCorners = 2;
+  alg::FastDetector detector(params);
+  alg::KeyPoints    keypoints(1024);
+  detector.detect(image, keypoints, 0, 1.0f, EP_PARALLEL);
+
+  const auto   expected = reference(10, alg::FT_9);
+  const size_t cellsX   = (cols + 31) / 32;
+  std::vector<std::vector<int>> cells((rows + 31) / 32 * cellsX);
+  for (const auto& corner : expected) {
+    cells[corner.second / 32 * cellsX + corner.first / 32].push_back(
+      score(corner.second, corner.first, 10, alg::FT_9));
+  }
+
+  std::vector<size_t> counts(cells.size(), 0);
+  for (const auto& k : keypoints) {
+    const size_t cell = size_t(k.y) / 32 * cellsX + size_t(k.x) / 32;
+    auto&        s    = cells[cell];
+    std::sort(s.rbegin(), s.rend());
+    ++counts[cell];
+    BOOST_CHECK(k.response >= s[std::min<size_t>(s.size(), 2) - 1]);
+  }
+  for (size_t cell = 0; cell < cells.size(); ++cell)
+    BOOST_CHECK(counts[cell] == std::min<size_t>(cells[cell].size(), 2));
+}
+
+BOOST_AUTO_TEST_CASE(canScoreWithHarrisAndShiTomasi) {
+  for (const auto score : {alg::CS_HARRIS, alg::CS_SHI_TOMASI}) {
+    alg::FastParams params;
+    params.threshold   = 30;
+    params.score       = score;
+    params.cellCorners = 1;
+    alg::FastDetector serial(params), parallel(params);
+    alg::KeyPoints    a(512), b(512);
+    serial.detect(image, a, 0, 1.0f, EP_SERIAL);
+    parallel.detect(image, b, 0, 1.0f, EP_PARALLEL);
+
+    BOOST_REQUIRE(a.size() > 0 && a.size() == b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+      BOOST_CHECK(a[i].x == b[i].x && a[i].y == b[i].y);
+      BOOST_CHECK(a[i].response == b[i].response);
+    }
+
+    // The corners of the squares have a positive response.
+    size_t positive = 0;
+    for (const auto& k : a)
+      positive += k.response > 0.0f;
+    BOOST_CHECK(positive > a.size() / 2);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(flatImagesHaveNoCorners) {
+  Image flat(64, 64);
+  alg::fill(flat, 128);
+  alg::FastDetector detector;
+  alg::KeyPoints    keypoints(16);
+  BOOST_CHECK(detector.detect(flat, keypoints) == 0);
+  BOOST_CHECK(keypoints.size() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(fullBufferDropsKeyPoints) {
+  alg::FastDetector detector;
+  alg::KeyPoints    all(1024), few(5);
+  const size_t found = detector.detect(image, all);
+  BOOST_REQUIRE(found > 5);
+
+  BOOST_CHECK(detector.detect(image, few) == 5);
+  BOOST_CHECK(few.size() == 5 && few.dropped() == found - 5);
+  for (size_t i = 0; i < 5; ++i)
+    BOOST_CHECK(few[i].x == all[i].x && few[i].y == all[i].y);
+
+  few.clear();
+  BOOST_CHECK(few.size() == 0 && few.dropped() == 0);
+  BOOST_CHECK(few.capacity() == 5);
+}
+
+BOOST_AUTO_TEST_CASE(canDetectOnPyramidLevels) {
+  Image half(rows / 2, cols / 2);
+  alg::resize(image, half);
+
+  alg::FastDetector detector;
+  alg::KeyPoints    keypoints(2048);
+  const size_t base   = detector.detect(image, keypoints, 0, 1.0f);
+  const size_t scaled = detector.detect(half , keypoints, 1, 2.0f);
+  BOOST_CHECK(base > 0 && scaled > 0);
+  BOOST_CHECK(keypoints.size() == base + scaled);
+
+  for (size_t i = base; i < keypoints.size(); ++i) {
+    BOOST_CHECK(keypoints[i].level == 1);
+    BOOST_CHECK(std::fmod(keypoints[i].x, 2.0f) == 0.0f);
+    BOOST_CHECK(keypoints[i].x < cols && keypoints[i].y < rows);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
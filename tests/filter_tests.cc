@@ -0,0 +1,139 @@
+//---- tests/filter_tests.cc ------------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  filter_tests.cc
+/// \brief Test file to test the snap median filter.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapFilterTests
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/filter.hpp"
+#include "thread_fixture.hpp"
+#include <algorithm>
+#include <random>
+
+using namespace snap;
+
+using Image = Matrix<mat::FM_GREY_8>;
+
+// Fixture with noisy images, and the reference median filter.
+struct FilterFixture : ThreadFixture {
+  static Image noisy(size_t rows, size_t cols, unsigned seed) {
+    Image image(rows, cols);
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> value(0, 255);
+    for (size_t r = 0; r < rows; ++r)
+      for (size_t c = 0; c < cols; ++c)
+        image.data()[r * image.stride() + c] = static_cast<uint8_t>(value(gen));
+    return image;
+  }
+
+  // Checks the median filter of image against a sort of each window.
+  static void check(const Image& image, size_t radius, alg::BorderMode border,
+                    ExecutionPolicy policy) {
+    const int64_t rows = image.rows(), cols = image.cols(), r = radius;
+    Image out(image.rows(), image.cols());
+    alg::median(image, out, radius, border, 9, policy);
+
+    std::vector<uint8_t> window;
+    for (int64_t y = 0; y < rows; ++y) {
+      for (int64_t x = 0; x < cols; ++x) {
+        window.clear();
+        for (int64_t dy = -r; dy <= r; ++dy) {
+          for (int64_t dx = -r; dx <= r; ++dx) {
+            const int64_t sy = alg::border_index(y + dy, rows, border);
+            const int64_t sx = alg::border_index(x + dx, cols, border);
+            window.push_back(sy < 0 || sx < 0 ? 9
+              : image.data()[sy * image.stride() + sx]);
+          }
+        }
+        std::nth_element(window.begin(), window.begin() + window.size() / 2,
+                         window.end());
+        BOOST_REQUIRE(out.data()[y * out.stride() + x] ==
+                      window[window.size() / 2]);
+      }
+    }
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SnapFilterSuite, FilterFixture)
+
+BOOST_AUTO_TEST_CASE(medianMatchesReference) {
+  const Image image = noisy(41, 53, 3);
+  for (const size_t radius : {0, 1, 2, 3, 7}) {
+    for (const auto border : {alg::BM_CONSTANT, alg::BM_REPLICATE,
+                              alg::BM_REFLECT, alg::BM_WRAP}) {
+      for (const auto policy : {EP_SERIAL, EP_PARALLEL})
+        check(image, radius, border, policy);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(parallelMedianMatchesReference) {
+  // The rows are split into bands across the threads, and the histograms
+  // of each band are seeded from the rows above its first row.
+  constexpr size_t rows = 443, cols = 449;
+  static_assert(rows * cols >= PARALLEL_TEST_ELEMENTS,
+                "The image must be split across threads!");
+  const Image image = noisy(rows, cols, 11);
+  for (const size_t radius : {1, 2, 7})
+    check(image, radius, alg::BM_REFLECT, EP_PARALLEL);
+}
+
+BOOST_AUTO_TEST_CASE(medianOfNarrowImages) {
+  // Rows narrower than a vector, and windows larger than the image.
+  const Image image = noisy(9, 11, 5);
+  for (const size_t radius : {1, 2, 6, 12}) {
+    for (const auto border : {alg::BM_REPLICATE, alg::BM_REFLECT})
+      check(image, radius, border, EP_SERIAL);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(medianReadsHaloDirectly) {
+  const Image image = noisy(23, 37, 7);
+  Image padded(23, 37, Halo{4}), a(23, 37), b(23, 37);
+  for (size_t r = 0; r < 23; ++r)
+    std::copy(image.data() + r * image.stride(),
+              image.data() + r * image.stride() + 37,
+              padded.data() + r * padded.stride());
+  alg::fill_border(padded, alg::BM_REFLECT);
+
+  for (const size_t radius : {1, 2, 4}) {
+    alg::median(padded, a, radius, alg::BM_CONSTANT);
+    alg::median(image, b, radius, alg::BM_REFLECT);
+    for (size_t r = 0; r < 23; ++r)
+      BOOST_CHECK(std::equal(a.data() + r * a.stride(),
+                             a.data() + r * a.stride() + 37,
+                             b.data() + r * b.stride()));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(medianRemovesSaltAndPepper) {
+  Image image(64, 96), out(64, 96);
+  alg::fill(image, 120);
+  std::mt19937 gen(9);
+  std::uniform_int_distribution<size_t> row(0, 63), col(0, 95);
+  for (size_t i = 0; i < 300; ++i)
+    image.data()[row(gen) * image.stride() + col(gen)] = i % 2 ? 255 : 0;
+
+  for (const size_t radius : {1, 2, 7}) {
+    alg::median(image, out, radius, alg::BM_REPLICATE, 0, EP_PARALLEL);
+    size_t clean = 0;
+    for (size_t r = 0; r < 64; ++r)
+      for (size_t c = 0; c < 96; ++c)
+        clean += out.data()[r * out.stride() + c] == 120;
+    BOOST_CHECK(clean >= (radius == 1 ? 64 * 96 - 40 : 64 * 96));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,120 @@
+//---- tests/instrument_tests.cc --------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  instrument_tests.cc
+/// \brief Test file to test the snap kernel instrumentation, which is 
+///        enabled for this file regardless of the INSTRUMENT option.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapInstrumentTests
+
+#ifndef SNAP_INSTRUMENT
+ #define SNAP_INSTRUMENT
+#endif
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/statistics.hpp"
+#include "snap/algorithm/transform.hpp"
+#include <sstream>
+#include <thread>
+
+using namespace snap;
+
+// Fixture which resets the counters before each test.
+struct InstrumentFixture {
+  Matrix<mat::FM_GREY_8> m{67, 93};
+
+  InstrumentFixture() {
+    alg::fill(m, 3);
+    util::inst::reset();
+  }
+
+  // Returns the statistics of kernel \p name, which are zero if the kernel
+  // has not been called.
+  static util::inst::KernelStats stats(const std::string& name) {
+    for (const auto& kernel : util::inst::snapshot())
+      if (kernel.name == name) return kernel;
+    return util::inst::KernelStats{name, 0, 0, 0, 0, 0.0};
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SnapInstrumentSuite, InstrumentFixture)
+
+BOOST_AUTO_TEST_CASE(isEnabled) {
+  BOOST_CHECK(util::inst::enabled());
+}
+
+BOOST_AUTO_TEST_CASE(canRecordKernelCalls) {
+  BOOST_CHECK(alg::sum(m) == 3 * m.size());
+  BOOST_CHECK(alg::sum(m, Rect{0, 0, 10, 10}) == 300);
+
+  const auto sum = stats("alg::sum");
+  BOOST_CHECK(sum.calls    == 2);
+  BOOST_CHECK(sum.elements == m.size() + 100);
+  BOOST_CHECK(sum.bytes    == m.size() + 100);
+  BOOST_CHECK(sum.seconds  >= 0.0);
+  BOOST_CHECK(stats("alg::copy").calls == 0);
+}
+
+BOOST_AUTO_TEST_CASE(parallelCallsAreRecordedOnce) {
+  util::par::set_thread_count(3);
+  alg::count_non_zero(m, EP_PARALLEL);
+  util::par::set_thread_count(0);
+
+  BOOST_CHECK(stats("alg::count_non_zero").calls    == 1);
+  BOOST_CHECK(stats("alg::count_non_zero").elements == m.size());
+}
+
+BOOST_AUTO_TEST_CASE(canRecordFromExitedThreads) {
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([] {
+      Matrix<mat::FM_GREY_8> out(16, 16);
+      for (size_t i = 0; i < 10; ++i)
+        alg::fill(out, uint8_t(i), EP_SERIAL, alg::WP_CACHED);
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  alg::fill(m, 0);
+
+  BOOST_CHECK(stats("alg::fill").calls    == 41);
+  BOOST_CHECK(stats("alg::fill").elements == 40 * 16 * 16 + m.size());
+}
+
+BOOST_AUTO_TEST_CASE(canResetCounters) {
+  alg::mean_stddev(m);
+  BOOST_CHECK(stats("alg::mean_stddev").calls == 1);
+
+  util::inst::reset();
+  BOOST_CHECK(stats("alg::mean_stddev").calls == 0);
+  BOOST_CHECK(stats("alg::mean_stddev").ticks == 0);
+
+  alg::mean_stddev(m);
+  BOOST_CHECK(stats("alg::mean_stddev").calls == 1);
+}
+
+BOOST_AUTO_TEST_CASE(canWriteSnapshotAsCsv) {
+  Matrix<mat::FM_GREY_8> out(m.rows(), m.cols());
+  alg::copy(m, out);
+
+  std::ostringstream csv;
+  util::inst::write_csv(csv, util::inst::snapshot());
+
+  const std::string text = csv.str();
+  BOOST_CHECK(text.find("kernel,calls,elements,bytes,ticks,seconds\n") == 0);
+  BOOST_CHECK(text.find("alg::copy,1," + std::to_string(m.size()) + "," +
+                        std::to_string(2 * m.size()) + ",") != 
+              std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
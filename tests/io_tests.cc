@@ -0,0 +1,212 @@
+//---- tests/io_tests.cc ----------------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  io_tests.cc
+/// \brief Test file to test the snap memory mapped image loading.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapIoTests
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include "snap/io/band_reader.hpp"
+#include "snap/io/mapped_matrix.hpp"
+#include <fstream>
+#include <vector>
+
+using namespace snap;
+
+// Fixture which writes image files with a header, and removes them after
+// each test.
+struct IoFixture {
+  static constexpr size_t rows = 37;
+  static constexpr size_t cols = 23;
+
+  std::vector<boost::filesystem::path> paths;
+
+  ~IoFixture() {
+    for (const auto& path : paths)
+      boost::filesystem::remove(path);
+  }
+
+  // Returns the sample value of channel k of element (r, c).
+  static uint8_t value(size_t r, size_t c, size_t k) {
+    return static_cast<uint8_t>(r * 7 + c * 3 + k * 101);
+  }
+
+  // Writes a file with the \p header followed by \p channels samples for
+  // each element of an image with \p rows rows, returning the path.
+  std::string write(const std::string& header, size_t channels, 
+                    size_t imageRows = rows) {
+    paths.push_back(boost::filesystem::temp_directory_path() / 
+                    boost::filesystem::unique_path("snap-io-%%%%-%%%%"));
+    std::ofstream file(paths.back().string(), std::ios::binary);
+    file << header;
+    for (size_t r = 0; r < imageRows; ++r)
+      for (size_t c = 0; c < cols; ++c)
+        for (size_t k = 0; k < channels; ++k)
+          file.put(static_cast<char>(value(r, c, k)));
+    return paths.back().string();
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SnapIoSuite, IoFixture)
+
+BOOST_AUTO_TEST_CASE(canParsePnmHeaderWithComments) {
+  const std::string header = "P6\n# comment\n23 37\n# another\n255\n";
+  const auto path = write(header, 3);
+
+  io::MappedFile file;
+  BOOST_REQUIRE(file.open(path));
+
+  io::PnmHeader pnm;
+  BOOST_REQUIRE(io::parse_pnm_header(file.data(), file.size(), pnm));
+  BOOST_CHECK(pnm.width      == cols);
+  BOOST_CHECK(pnm.height     == rows);
+  BOOST_CHECK(pnm.maxval     == 255);
+  BOOST_CHECK(pnm.channels   == 3);
+  BOOST_CHECK(pnm.dataOffset == header.size());
+}
+
+BOOST_AUTO_TEST_CASE(rejectsInvalidPnmHeaders) {
+  io::MappedFile file;
+  io::PnmHeader  pnm;
+
+  BOOST_REQUIRE(file.open(write("P2\n23 37\n255\n", 1)));
+  BOOST_CHECK(!io::parse_pnm_header(file.data(), file.size(), pnm));
+
+  BOOST_REQUIRE(file.open(write("P5\n23 37\n65535\n", 1)));
+  BOOST_CHECK(!io::parse_pnm_header(file.data(), file.size(), pnm));
+
+  // The file has fewer rows than the header.
+  BOOST_REQUIRE(file.open(write("P5\n23 38\n255\n", 1)));
+  BOOST_CHECK(!io::parse_pnm_header(file.data(), file.size(), pnm));
+}
+
+BOOST_AUTO_TEST_CASE(rejectsPnmHeadersWhichOverflow) {
+  io::MappedFile file;
+  io::PnmHeader  pnm;
+
+  // The size of the image wraps to zero, and the dimensions are too big.
+  const auto path = write("P5\n4294967296 4294967296\n255\nxxxx", 1, 0);
+  BOOST_REQUIRE(file.open(path));
+  BOOST_CHECK(!io::parse_pnm_header(file.data(), file.size(), pnm));
+
+  // Within the bound on each field, but still far bigger than the file.
+  BOOST_REQUIRE(file.open(write("P6\n2147483647 2147483647\n255\n", 1)));
+  BOOST_CHECK(!io::parse_pnm_header(file.data(), file.size(), pnm));
+
+  io::MappedMatrix<mat::FM_GREY_8> image;
+  BOOST_CHECK(!image.openPnm(path));
+  BOOST_CHECK(!image.openRaw(path, size_t(1) << 32, size_t(1) << 32, 0));
+  BOOST_CHECK(!image.openRaw(path, 2, ~size_t(0) / 2 + 1, 0));
+  BOOST_CHECK(image.matrix().data() == nullptr);
+
+  io::RowBandReader<mat::FM_BGR_24> reader;
+  BOOST_CHECK(!reader.openRaw(path, size_t(1) << 32, size_t(1) << 32, 0));
+  BOOST_CHECK(!reader.openRaw(path, 4, ~size_t(0) / 3 + 1, 0));
+}
+
+BOOST_AUTO_TEST_CASE(canMapPgmWithoutCopy) {
+  const std::string header = "P5 23 37 255\n";
+  const auto path = write(header, 1);
+
+  io::MappedMatrix<mat::FM_GREY_8> image;
+  BOOST_REQUIRE(image.openPnm(path));
+
+  const auto& mat = image.matrix();
+  BOOST_CHECK(!mat.owner());
+  BOOST_CHECK(mat.rows() == rows);
+  BOOST_CHECK(mat.cols() == cols);
+  BOOST_CHECK(mat.data() == image.file().data() + header.size());
+  BOOST_CHECK(!image.aligned());
+
+  for (size_t r = 0; r < rows; ++r)
+    for (size_t c = 0; c < cols; ++c)
+      BOOST_CHECK(mat(r, c) == value(r, c, 0));
+}
+
+BOOST_AUTO_TEST_CASE(canMapAlignedRawImage) {
+  const auto path = write(std::string(32, 'x'), 3);
+
+  io::MappedMatrix<mat::FM_BGR_24> image;
+  BOOST_REQUIRE(image.openRaw(path, rows, cols, 32));
+  BOOST_CHECK(image.aligned());
+
+  const auto& mat = image.matrix();
+  for (size_t r = 0; r < rows; ++r) {
+    for (size_t c = 0; c < cols; ++c) {
+      const uint8_t* element = mat.data() + r * mat.stride() + c * 3;
+      for (size_t k = 0; k < 3; ++k)
+        BOOST_CHECK(element[k] == value(r, c, k));
+    }
+  }
+
+  BOOST_CHECK(!image.openRaw(path, rows + 1, cols, 32));
+  BOOST_CHECK(!image.isOpen());
+  BOOST_CHECK(image.matrix().data() == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(cantMapPpmAsBgr) {
+  io::MappedMatrix<mat::FM_BGR_24> image;
+  BOOST_CHECK(!image.openPnm(write("P6\n23 37\n255\n", 3)));
+  BOOST_CHECK(!image.openPnm("/snap/does/not/exist.ppm"));
+}
+
+BOOST_AUTO_TEST_CASE(canReadPgmInBands) {
+  io::RowBandReader<mat::FM_GREY_8> reader(8);
+  BOOST_REQUIRE(reader.openPnm(write("P5\n23 37\n255\n", 1)));
+  BOOST_CHECK(!reader.decoding());
+
+  size_t row = 0, bands = 0;
+  while (reader.next()) {
+    const auto& band = reader.band();
+    BOOST_CHECK(!band.owner());
+    BOOST_CHECK(reader.bandRow() == row);
+    BOOST_CHECK(band.rows() == std::min(size_t(8), rows - row));
+
+    for (size_t r = 0; r < band.rows(); ++r)
+      for (size_t c = 0; c < cols; ++c)
+        BOOST_CHECK(band(r, c) == value(row + r, c, 0));
+    row += band.rows();
+    ++bands;
+  }
+  BOOST_CHECK(row   == rows);
+  BOOST_CHECK(bands == 5);
+  BOOST_CHECK(!reader.next());
+}
+
+BOOST_AUTO_TEST_CASE(canDecodePpmBandsToBgr) {
+  io::RowBandReader<mat::FM_BGR_24> reader(10, 1);
+  BOOST_REQUIRE(reader.openPnm(write("P6\n23 37\n255\n", 3)));
+  BOOST_CHECK(reader.decoding());
+
+  size_t row = 0;
+  while (reader.next()) {
+    const auto& band = reader.band();
+    for (size_t r = 0; r < band.rows(); ++r) {
+      for (size_t c = 0; c < cols; ++c) {
+        const uint8_t* element = band.data() + r * band.stride() + c * 3;
+        BOOST_CHECK(element[0] == value(row + r, c, 2));
+        BOOST_CHECK(element[1] == value(row + r, c, 1));
+        BOOST_CHECK(element[2] == value(row + r, c, 0));
+      }
+    }
+    row += band.rows();
+  }
+  BOOST_CHECK(row == rows);
+
+  // A greyscale image can't be read as BGR.
+  BOOST_CHECK(!reader.openPnm(write("P5\n23 37\n255\n", 1)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,164 @@
+//---- tests/match_tests.cc -------------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  match_tests.cc
+/// \brief Test file to test the snap template matching.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapMatchTests
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/match.hpp"
+#include "snap/algorithm/transform.hpp"
+#include "thread_fixture.hpp"
+#include <cmath>
+#include <random>
+
+using namespace snap;
+
+using Image = Matrix<mat::FM_GREY_8>;
+
+// Fixture with a smooth noisy image with a ring fiducial and some distractor
+// squares.
+struct MatchFixture : ThreadFixture {
+  static constexpr size_t rows = 181, cols = 223, fx = 117, fy = 63;
+  Image image{rows, cols};
+
+  MatchFixture() {
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int> noise(0, 9);
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t c = 0; c < cols; ++c) {
+        int v = 60 + int(r / 4) + int(c / 5) + noise(gen);
+        if ((r / 23) % 3 == 1 && (c / 31) % 3 == 2) v += 50;
+        const double d = std::hypot(double(r) - (fy + 20.0),
+                                    double(c) - (fx + 24.0));
+        if (d < 18.0 && int(d) / 4 % 2 == 0) v = 240 - noise(gen);
+        image.data()[r * image.stride() + c] = static_cast<uint8_t>(v);
+      }
+    }
+  }
+
+  uint8_t at(size_t r, size_t c) const {
+    return image.data()[r * image.stride() + c];
+  }
+
+  // Copies the rows x cols window of the image at (x, y) to a template.
+  Image crop(size_t x, size_t y, size_t h, size_t w) const {
+    Image t(h, w);
+    for (size_t r = 0; r < h; ++r)
+      for (size_t c = 0; c < w; ++c)
+        t.data()[r * t.stride() + c] = at(y + r, x + c);
+    return t;
+  }
+
+  // Reference score of template t at (x, y).
+  double reference(const Image& t, size_t x, size_t y,
+                   alg::MatchMethod method) const {
+    const double n = double(t.size());
+    double sI = 0, sII = 0, sT = 0, sTT = 0, sIT = 0, ssd = 0;
+    for (size_t r = 0; r < t.rows(); ++r) {
+      for (size_t c = 0; c < t.cols(); ++c) {
+        const double a = at(y + r, x + c);
+        const double b = t.data()[r * t.stride() + c];
+        sI += a; sII += a * a; sT += b; sTT += b * b; sIT += a * b;
+        ssd += (a - b) * (a - b);
+      }
+    }
+    if (method == alg::MM_SSD)
+      return ssd;
+    const double den = (n * sII - sI * sI) * (n * sTT - sT * sT);
+    return den > 0.0 ? (n * sIT - sI * sT) / std::sqrt(den) : 0.0;
+  }
+};
+
+constexpr size_t MatchFixture::rows;
+constexpr size_t MatchFixture::cols;
+constexpr size_t MatchFixture::fx;
+constexpr size_t MatchFixture::fy;
+
+BOOST_FIXTURE_TEST_SUITE(SnapMatchSuite, MatchFixture)
+
+BOOST_AUTO_TEST_CASE(scoresMatchReference) {
+  // Widths with 16, 8 and single element column blocks.
+  std::mt19937 gen(17);
+  std::uniform_int_distribution<int> value(0, 255);
+  for (const auto& dims : {std::make_pair(13, 21), std::make_pair(5, 37),
+                          std::make_pair(24, 16), std::make_pair(9, 3)}) {
+    Image t(dims.first, dims.second);
+    for (size_t i = 0; i < t.rows() * t.stride(); ++i)
+      t.data()[i] = static_cast<uint8_t>(value(gen));
+
+    const size_t outRows = rows - t.rows() + 1, outCols = cols - t.cols() + 1;
+    for (const auto method : {alg::MM_SSD, alg::MM_NCC}) {
+      for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+        std::vector<float> scores;
+        alg::match_template(image, t, scores, method, policy);
+        BOOST_REQUIRE(scores.size() == outRows * outCols);
+        for (size_t y = 0; y < outRows; y += 3) {
+          for (size_t x = 0; x < outCols; ++x) {
+            const double expected = reference(t, x, y, method);
+            const double tolerance = method == alg::MM_SSD
+              ? expected * 1e-7 : 1e-5;
+            BOOST_REQUIRE(std::abs(scores[y * outCols + x] - expected) <=
+                          tolerance);
+          }
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(canFindTemplate) {
+  const Image t = crop(fx, fy, 40, 48);
+  for (const auto method : {alg::MM_SSD, alg::MM_NCC}) {
+    for (const size_t levels : {0, 1, 2, 8}) {
+      for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+        const auto match = alg::find_template(image, t, method, levels, policy);
+        BOOST_CHECK(match.x == fx && match.y == fy);
+        if (method == alg::MM_SSD)
+          BOOST_CHECK(match.score == 0.0f);
+        else
+          BOOST_CHECK(std::abs(match.score - 1.0f) < 1e-5f);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(canFindTemplateNearEdges) {
+  for (const auto& corner : {std::make_pair(size_t(0), size_t(0)),
+                            std::make_pair(cols - 33, rows - 30)}) {
+    const Image t = crop(corner.first, corner.second, 30, 33);
+    for (const size_t levels : {0, 1}) {
+      const auto match = alg::find_template(image, t, alg::MM_NCC, levels);
+      BOOST_CHECK(match.x == corner.first && match.y == corner.second);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(bestMatchIsFirstOfTies) {
+  // A flat image and template have the same SSD at every position, and no
+  // variance, so every NCC is 0.
+  Image flat(40, 50), t(10, 12);
+  alg::fill(flat, 77);
+  alg::fill(t, 77);
+  for (const auto method : {alg::MM_SSD, alg::MM_NCC}) {
+    const auto match = alg::find_template(flat, t, method, 0, EP_PARALLEL);
+    BOOST_CHECK(match.x == 0 && match.y == 0 && match.score == 0.0f);
+  }
+
+  std::vector<float> scores;
+  alg::match_template(flat, flat, scores, alg::MM_SSD);
+  BOOST_CHECK(scores.size() == 1 && scores[0] == 0.0f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -18,6 +18,7 @@
 
 #include <boost/test/unit_test.hpp>
 #include "snap/matrix/matrix.hpp"
+#include "snap/matrix/matrix_batch.hpp"
 
 using namespace snap;
 
@@ -31,5 +32,102 @@ BOOST_AUTO_TEST_CASE(canDefaultConstructMatGrey8) {
   BOOST_CHECK(mat.size() == 0);
 }
 
+BOOST_AUTO_TEST_CASE(canAccessElementsMatGrey8) {
+  Matrix<mat::FM_GREY_8> mat(3, 21);
+
+  BOOST_CHECK(mat.size()   == 3 * 21);
+  BOOST_CHECK(mat.stride() == 21);
+
+  for (size_t r = 0; r < mat.rows(); ++r) 
+    for (size_t c = 0; c < mat.cols(); ++c)
+      mat(r, c) = r * mat.cols() + c;
+
+  for (size_t i = 0; i < mat.size(); ++i)
+    BOOST_CHECK(mat.data()[i] == i);
+}
+
+BOOST_AUTO_TEST_CASE(canWrapExistingDataMatGrey8) {
+  uint8_t data[4 * 5];
+  for (size_t i = 0; i < 4 * 5; ++i)
+    data[i] = i;
+
+  Matrix<mat::FM_GREY_8> mat(4, 5, data);
+
+  BOOST_CHECK(!mat.owner());
+  BOOST_CHECK(mat.data() == data);
+  BOOST_CHECK(mat(3, 2) == 3 * 5 + 2);
+}
+
+BOOST_AUTO_TEST_CASE(canMoveMatBgr24) {
+  Matrix<mat::FM_BGR_24> mat(3, 7);
+  mat(2, 6) = 42;
+
+  BOOST_CHECK(mat.stride() == 7 * 3);
+
+  const uint8_t* data = mat.data();
+  Matrix<mat::FM_BGR_24> moved(std::move(mat));
+
+  BOOST_CHECK(moved.owner());
+  BOOST_CHECK(moved.data() == data);
+  BOOST_CHECK(moved(2, 6) == 42);
+  BOOST_CHECK(mat.data() == nullptr);
+  BOOST_CHECK(mat.size() == 0);
+
+  mat = std::move(moved);
+  BOOST_CHECK(mat.data() == data);
+  BOOST_CHECK(moved.data() == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(canAllocateHalo) {
+  Matrix<mat::FM_BGR_24> mat(5, 7, Halo{3});
+
+  BOOST_CHECK(mat.owner());
+  BOOST_CHECK(mat.halo() == 3);
+  BOOST_CHECK(mat.size() == 5 * 7);
+  BOOST_CHECK(mat.stride() >= (7 + 2 * 3) * 3);
+  BOOST_CHECK(mat.stride() % ALIGNMENT == 0);
+  BOOST_CHECK(reinterpret_cast<uintptr_t>(mat.data()) % ALIGNMENT == 0);
+
+  // The whole halo, including the corners, must be writable.
+  for (int r = -3; r < 5 + 3; ++r) 
+    for (int c = -3 * 3; c < (7 + 3) * 3; ++c)
+      mat.data()[r * int(mat.stride()) + c] = uint8_t(r + c);
+  mat(4, 6) = 42;
+  BOOST_CHECK(mat.data()[4 * mat.stride() + 6 * 3] == 42);
+
+  const uint8_t* data = mat.data();
+  Matrix<mat::FM_BGR_24> moved(std::move(mat));
+  BOOST_CHECK(moved.data() == data && moved.halo() == 3);
+  BOOST_CHECK(mat.data() == nullptr && mat.halo() == 0);
+
+  Matrix<mat::FM_GREY_8> none(4, 5, Halo{0});
+  BOOST_CHECK(none.halo() == 0 && none.stride() % ALIGNMENT == 0);
+}
+
+BOOST_AUTO_TEST_CASE(canAccessFramesOfBatch) {
+  MatrixBatch<mat::FM_BGR_24> batch(4, 5, 7);
+
+  BOOST_CHECK(batch.count()  == 4);
+  BOOST_CHECK(batch.size()   == 5 * 7);
+  BOOST_CHECK(batch.stride() == 7 * 3);
+  BOOST_CHECK(batch.frameStride() >= 5 * 7 * 3);
+
+  for (size_t n = 0; n < batch.count(); ++n) {
+    const auto address = reinterpret_cast<uintptr_t>(batch.data(n));
+    BOOST_CHECK(address % decltype(batch)::FRAME_ALIGNMENT == 0);
+
+    auto frame = batch.frame(n);
+    BOOST_CHECK(!frame.owner());
+    BOOST_CHECK(frame.data() == batch.data(n));
+    frame(4, 6) = static_cast<uint8_t>(n + 1);
+    BOOST_CHECK(batch(n, 4, 6) == n + 1);
+  }
+
+  MatrixBatch<mat::FM_BGR_24> moved(std::move(batch));
+  BOOST_CHECK(moved.count() == 4);
+  BOOST_CHECK(moved(3, 4, 6) == 4);
+  BOOST_CHECK(batch.data() == nullptr);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
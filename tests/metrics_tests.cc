@@ -0,0 +1,151 @@
+//---- tests/metrics_tests.cc ------------------------------ -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  metrics_tests.cc
+/// \brief Test file to test the snap matrix difference metrics.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapMetricsTests
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/metrics.hpp"
+#include <random>
+
+using namespace snap;
+
+// Fixture with two random matrices with dimensions which are not multiples
+// of the vector width or the block sizes, where the second matrix is a noisy
+// version of the first.
+struct MetricsFixture {
+  static constexpr size_t rows = 75;
+  static constexpr size_t cols = 109;
+
+  Matrix<mat::FM_GREY_8> a{rows, cols};
+  Matrix<mat::FM_GREY_8> b{rows, cols};
+
+  MetricsFixture() {
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<int> value(0, 255), noise(-20, 20);
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t c = 0; c < cols; ++c) {
+        a(r, c) = static_cast<uint8_t>(value(gen));
+        b(r, c) = static_cast<uint8_t>(
+          std::min(255, std::max(0, a(r, c) + noise(gen))));
+      }
+    }
+    util::par::set_thread_count(3);
+  }
+
+  ~MetricsFixture() { util::par::set_thread_count(0); }
+
+  // Reference block metric, where power 1 is SAD and power 2 is SSD.
+  std::vector<uint32_t> referenceBlocks(size_t blockSize, int power) const {
+    const size_t blocksX = alg::block_count(cols, blockSize);
+    std::vector<uint32_t> blocks(alg::block_count(rows, blockSize) * blocksX);
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t c = 0; c < cols; ++c) {
+        const int d = std::abs(int(a(r, c)) - int(b(r, c)));
+        blocks[r / blockSize * blocksX + c / blockSize] += 
+          power == 1 ? d : d * d;
+      }
+    }
+    return blocks;
+  }
+
+  // Reference SSIM of a window.
+  double referenceSsim(size_t y, size_t x, size_t h, size_t w) const {
+    double sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+    for (size_t r = y; r < y + h; ++r) {
+      for (size_t c = x; c < x + w; ++c) {
+        sa  += a(r, c)          ; sb  += b(r, c);
+        saa += a(r, c) * a(r, c); sbb += b(r, c) * b(r, c);
+        sab += a(r, c) * b(r, c);
+      }
+    }
+    const double n = h * w, c1 = 6.5025, c2 = 58.5225;
+    const double ma = sa / n, mb = sb / n;
+    const double va = saa / n - ma * ma, vb = sbb / n - mb * mb;
+    const double cov = sab / n - ma * mb;
+    return ((2 * ma * mb + c1) * (2 * cov + c2)) / 
+           ((ma * ma + mb * mb + c1) * (va + vb + c2));
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SnapMetricsSuite, MetricsFixture)
+
+BOOST_AUTO_TEST_CASE(canComputeSadAndSsd) {
+  uint64_t sad = 0, ssd = 0;
+  for (auto d : referenceBlocks(8, 1)) sad += d;
+  for (auto d : referenceBlocks(8, 2)) ssd += d;
+
+  BOOST_CHECK(alg::sad(a, b) == sad);
+  BOOST_CHECK(alg::ssd(a, b) == ssd);
+  BOOST_CHECK(alg::sad(a, b, EP_PARALLEL) == sad);
+  BOOST_CHECK(alg::ssd(a, b, EP_PARALLEL) == ssd);
+}
+
+BOOST_AUTO_TEST_CASE(canComputePsnr) {
+  uint64_t ssd = 0;
+  for (auto d : referenceBlocks(8, 2)) ssd += d;
+
+  const double mse = double(ssd) / (rows * cols);
+  BOOST_CHECK_CLOSE(alg::psnr(a, b), 10 * std::log10(255 * 255 / mse), 1e-9);
+  BOOST_CHECK(std::isinf(alg::psnr(a, a)));
+}
+
+BOOST_AUTO_TEST_CASE(canComputeBlockSadAndSsd) {
+  std::vector<uint32_t> blocks;
+
+  alg::sad_blocks<8>(a, b, blocks);
+  BOOST_CHECK(blocks == referenceBlocks(8, 1));
+  alg::sad_blocks<16>(a, b, blocks, EP_PARALLEL);
+  BOOST_CHECK(blocks == referenceBlocks(16, 1));
+
+  alg::ssd_blocks<8>(a, b, blocks, EP_PARALLEL);
+  BOOST_CHECK(blocks == referenceBlocks(8, 2));
+  alg::ssd_blocks<16>(a, b, blocks);
+  BOOST_CHECK(blocks == referenceBlocks(16, 2));
+}
+
+BOOST_AUTO_TEST_CASE(canComputeSsim) {
+  constexpr size_t window = 8;
+  double total = 0.0;
+  for (size_t r = 0; r + window <= rows; ++r) 
+    for (size_t c = 0; c + window <= cols; ++c)
+      total += referenceSsim(r, c, window, window);
+  total /= (rows - window + 1) * (cols - window + 1);
+
+  BOOST_CHECK_CLOSE(alg::ssim<window>(a, b), total, 1e-6);
+  BOOST_CHECK_CLOSE(alg::ssim<window>(a, b, EP_PARALLEL), total, 1e-6);
+  BOOST_CHECK_CLOSE(alg::ssim(a, a), 1.0, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(canComputeBlockSsim) {
+  for (size_t blockSize : {8, 16}) {
+    std::vector<float> blocks;
+    if (blockSize == 8) 
+      alg::ssim_blocks<8>(a, b, blocks);
+    else
+      alg::ssim_blocks<16>(a, b, blocks, EP_PARALLEL);
+
+    const size_t blocksX = alg::block_count(cols, blockSize);
+    BOOST_CHECK(blocks.size() == alg::block_count(rows, blockSize) * blocksX);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      const size_t y = i / blocksX * blockSize, x = i % blocksX * blockSize;
+      const double expected = referenceSsim(y, x, 
+        std::min(blockSize, rows - y), std::min(blockSize, cols - x));
+      BOOST_CHECK_CLOSE(blocks[i], expected, 1e-3);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,127 @@
+//---- tests/motion_tests.cc ------------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  motion_tests.cc
+/// \brief Test file to test the snap block matching motion estimation.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapMotionTests
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/motion.hpp"
+#include <cmath>
+
+using namespace snap;
+
+// Fixture with a smooth reference frame and a current frame which is the
+// reference frame shifted by (shiftX, shiftY), so that the motion vector of
+// each interior block is (-shiftX, -shiftY).
+struct MotionFixture {
+  static constexpr size_t rows   = 96;
+  static constexpr size_t cols   = 136;
+  static constexpr int    shiftX = 3;
+  static constexpr int    shiftY = -2;
+
+  Matrix<mat::FM_GREY_8> reference{rows, cols};
+  Matrix<mat::FM_GREY_8> current{rows, cols};
+
+  static uint8_t texture(int x, int y) {
+    return static_cast<uint8_t>(128 + 60 * std::sin(x / 6.0) 
+                                    + 60 * std::cos(y / 5.0 + x / 17.0));
+  }
+
+  MotionFixture() {
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t c = 0; c < cols; ++c) {
+        reference(r, c) = texture(c, r);
+        current(r, c)   = texture(int(c) - shiftX, int(r) - shiftY);
+      }
+    }
+    util::par::set_thread_count(2);
+  }
+
+  ~MotionFixture() { util::par::set_thread_count(0); }
+
+  // Checks that the vectors of all the blocks which are far enough from the
+  // frame edges to have a valid match are correct.
+  template <size_t BlockSize>
+  void checkField(const std::vector<alg::MotionVector>& field) {
+    const size_t blocksX = cols / BlockSize;
+    BOOST_CHECK(field.size() == (rows / BlockSize) * blocksX);
+    for (size_t by = 1; by < rows / BlockSize - 1; ++by) {
+      for (size_t bx = 1; bx < blocksX - 1; ++bx) {
+        const auto& v = field[by * blocksX + bx];
+        BOOST_CHECK(v.x == -shiftX && v.y == -shiftY && v.sad == 0);
+      }
+    }
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SnapMotionSuite, MotionFixture)
+
+BOOST_AUTO_TEST_CASE(canFullSearch16x16) {
+  std::vector<alg::MotionVector> field;
+  alg::estimate_motion<16>(reference, current, field, alg::SM_FULL, 7);
+  checkField<16>(field);
+}
+
+BOOST_AUTO_TEST_CASE(canFullSearch8x8InParallel) {
+  std::vector<alg::MotionVector> field;
+  alg::estimate_motion<8>(reference, current, field, alg::SM_FULL, 12, 
+    EP_PARALLEL);
+  checkField<8>(field);
+}
+
+BOOST_AUTO_TEST_CASE(canDiamondSearch) {
+  std::vector<alg::MotionVector> field;
+  alg::estimate_motion<16>(reference, current, field, alg::SM_DIAMOND, 8);
+  checkField<16>(field);
+}
+
+BOOST_AUTO_TEST_CASE(canHexagonSearch) {
+  std::vector<alg::MotionVector> field;
+  alg::estimate_motion<8>(reference, current, field, alg::SM_HEXAGON, 8, 
+    EP_PARALLEL);
+  checkField<8>(field);
+}
+
+BOOST_AUTO_TEST_CASE(fullSearchFindsMinimumSad) {
+  // Compare against a brute force search for every block, including the
+  // edge blocks, on identical frames the result must be the zero vector.
+  std::vector<alg::MotionVector> field;
+  alg::estimate_motion<16>(reference, reference, field, alg::SM_FULL, 16);
+  for (const auto& v : field)
+    BOOST_CHECK(v.x == 0 && v.y == 0 && v.sad == 0);
+
+  alg::estimate_motion<16>(reference, current, field, alg::SM_FULL, 5);
+  const size_t blocksX = cols / 16;
+  for (size_t i = 0; i < field.size(); ++i) {
+    const int bx = i % blocksX * 16, by = i / blocksX * 16;
+    uint32_t best = std::numeric_limits<uint32_t>::max();
+    for (int dy = -5; dy <= 5; ++dy) {
+      for (int dx = -5; dx <= 5; ++dx) {
+        if (bx + dx < 0 || by + dy < 0 || bx + dx + 16 > int(cols) ||
+            by + dy + 16 > int(rows))
+          continue;
+        uint32_t sad = 0;
+        for (int r = 0; r < 16; ++r)
+          for (int c = 0; c < 16; ++c)
+            sad += std::abs(int(current(by + r, bx + c)) - 
+                            int(reference(by + dy + r, bx + dx + c)));
+        best = std::min(best, sad);
+      }
+    }
+    BOOST_CHECK(field[i].sad == best);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,216 @@
+//---- tests/preprocess_tests.cc --------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  preprocess_tests.cc
+/// \brief Test file to test the snap convert, resize and normalize kernels
+///        for matrices and batches of matrices.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapPreprocessTests
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/preprocess.hpp"
+#include <cmath>
+#include <random>
+
+using namespace snap;
+
+// Fixture with a batch of random BGR frames, with dimensions which are not
+// multiples of the vector width.
+struct PreprocessFixture {
+  static constexpr size_t count = 5;
+  static constexpr size_t rows  = 38;
+  static constexpr size_t cols  = 46;
+
+  MatrixBatch<mat::FM_BGR_24> bgr{count, rows, cols};
+  MatrixBatch<mat::FM_GREY_8> grey{count, rows, cols};
+
+  PreprocessFixture() {
+    std::mt19937 gen(29);
+    std::uniform_int_distribution<int> value(0, 255);
+    for (size_t n = 0; n < count; ++n)
+      for (size_t i = 0; i < rows * bgr.stride(); ++i)
+        bgr.data(n)[i] = static_cast<uint8_t>(value(gen));
+    util::par::set_thread_count(3);
+  }
+
+  ~PreprocessFixture() { util::par::set_thread_count(0); }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SnapPreprocessSuite, PreprocessFixture)
+
+BOOST_AUTO_TEST_CASE(canConvertBgrToGrey) {
+  auto frame = bgr.frame(2);
+  Matrix<mat::FM_GREY_8> out(rows, cols);
+  alg::convert(frame, out);
+
+  for (size_t r = 0; r < rows; ++r) {
+    for (size_t c = 0; c < cols; ++c) {
+      const uint8_t* p   = frame.data() + r * frame.stride() + c * 3;
+      const double   ref = 0.114 * p[0] + 0.587 * p[1] + 0.299 * p[2];
+      BOOST_REQUIRE(std::abs(out(r, c) - ref) <= 1.0);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(batchConvertMatchesFrameConvert) {
+  for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+    alg::convert(bgr, grey, policy);
+    for (size_t n = 0; n < count; ++n) {
+      Matrix<mat::FM_GREY_8> out(rows, cols);
+      alg::convert(bgr.frame(n), out);
+      for (size_t i = 0; i < out.size(); ++i)
+        BOOST_REQUIRE_EQUAL(grey.data(n)[i], out.data()[i]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(canResizeToSameSize) {
+  alg::convert(bgr, grey);
+  MatrixBatch<mat::FM_GREY_8> out(count, rows, cols);
+  alg::resize(grey, out, EP_PARALLEL);
+
+  for (size_t n = 0; n < count; ++n)
+    for (size_t i = 0; i < grey.size(); ++i)
+      BOOST_REQUIRE_EQUAL(out.data(n)[i], grey.data(n)[i]);
+}
+
+BOOST_AUTO_TEST_CASE(canResizeToHalfSize) {
+  alg::convert(bgr, grey);
+  MatrixBatch<mat::FM_GREY_8> out(count, rows / 2, cols / 2);
+  alg::resize(grey, out);
+
+  // The centers of the output elements are between 2x2 input elements, so
+  // each output is the rounded mean of the 2x2 inputs.
+  for (size_t n = 0; n < count; ++n) {
+    for (size_t r = 0; r < out.rows(); ++r) {
+      for (size_t c = 0; c < out.cols(); ++c) {
+        const int sum = grey(n, 2 * r, 2 * c) + grey(n, 2 * r, 2 * c + 1) +
+          grey(n, 2 * r + 1, 2 * c) + grey(n, 2 * r + 1, 2 * c + 1);
+        BOOST_REQUIRE_EQUAL(out(n, r, c), (sum + 2) / 4);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(batchResizeMatchesFrameResize) {
+  alg::convert(bgr, grey);
+  const std::pair<size_t, size_t> sizes[] = {{17, 29}, {97, 64}};
+  for (const auto& size : sizes) {
+    MatrixBatch<mat::FM_GREY_8> out(count, size.first, size.second);
+    for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+      alg::resize(grey, out, policy);
+      for (size_t n = 0; n < count; ++n) {
+        Matrix<mat::FM_GREY_8> frame(out.rows(), out.cols());
+        alg::resize(grey.frame(n), frame);
+        for (size_t i = 0; i < frame.size(); ++i)
+          BOOST_REQUIRE_EQUAL(out.data(n)[i], frame.data()[i]);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(canResizeConstantImage) {
+  Matrix<mat::FM_GREY_8> in(7, 9), out(31, 20);
+  for (size_t i = 0; i < in.size(); ++i)
+    in.data()[i] = 201;
+
+  alg::resize(in, out);
+  for (size_t i = 0; i < out.size(); ++i)
+    BOOST_REQUIRE_EQUAL(out.data()[i], 201);
+}
+
+BOOST_AUTO_TEST_CASE(canNormalizeBatch) {
+  alg::convert(bgr, grey);
+  const float scale = 1.0f / 255.0f, bias = -0.5f;
+
+  for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+    std::vector<float> out(count * grey.size(), 0.0f);
+    alg::normalize(grey, out.data(), scale, bias, policy);
+
+    for (size_t n = 0; n < count; ++n) {
+      for (size_t r = 0; r < rows; ++r) {
+        for (size_t c = 0; c < cols; ++c) {
+          const float ref = grey(n, r, c) * scale + bias;
+          BOOST_REQUIRE(std::abs(out[(n * rows + r) * cols + c] - ref) 
+                        < 1e-6f);
+        }
+      }
+    }
+
+    std::vector<float> frame(grey.size());
+    alg::normalize(grey.frame(count - 1), frame.data(), scale, bias, policy);
+    BOOST_CHECK(std::equal(frame.begin(), frame.end(), 
+                           out.begin() + (count - 1) * grey.size()));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(canNormalizeBgrToTensor) {
+  const float mean[3]   = {103.94f, 116.78f, 123.68f};
+  const float stddev[3] = {57.38f, 57.12f, 58.4f};
+
+  // Each frame of the batch is a separate matrix, so both versions are
+  // checked against the same reference.
+  for (const auto layout : {alg::TL_CHW, alg::TL_HWC}) {
+    for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+      std::vector<float> batch(count * bgr.size() * 3, 0.0f);
+      std::vector<float> frame(bgr.size() * 3, 0.0f);
+      alg::to_tensor(bgr, batch.data(), mean, stddev, layout, policy);
+
+      for (size_t n = 0; n < count; ++n) {
+        alg::to_tensor(bgr.frame(n), frame.data(), mean, stddev, layout, 
+          policy);
+        const float* tensor = batch.data() + n * bgr.size() * 3;
+        for (size_t r = 0; r < rows; ++r) {
+          for (size_t c = 0; c < cols; ++c) {
+            for (size_t k = 0; k < 3; ++k) {
+              const size_t i = layout == alg::TL_CHW 
+                ? (k * rows + r) * cols + c : (r * cols + c) * 3 + k;
+              const float ref = 
+                (bgr.data(n)[r * bgr.stride() + c * 3 + k] - mean[k]) / 
+                stddev[k];
+              BOOST_REQUIRE(std::abs(tensor[i] - ref) < 1e-5f);
+              BOOST_REQUIRE_EQUAL(tensor[i], frame[i]);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(canNormalizeHaloMatrixToTensor) {
+  const float mean[3]   = {103.94f, 116.78f, 123.68f};
+  const float stddev[3] = {57.38f, 57.12f, 58.4f};
+
+  // The halo pads the rows, so the tensor must still be dense.
+  Matrix<mat::FM_BGR_24> halo(rows, cols, Halo{2});
+  BOOST_REQUIRE(halo.stride() > 3 * cols);
+  const auto frame = bgr.frame(0);
+  for (size_t r = 0; r < rows; ++r)
+    for (size_t i = 0; i < 3 * cols; ++i)
+      halo.data()[r * halo.stride() + i] = frame.data()[r * frame.stride() + i];
+
+  for (const auto layout : {alg::TL_CHW, alg::TL_HWC}) {
+    for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+      // The extra values catch any writes past the end of the tensor.
+      std::vector<float> expected(frame.size() * 3 + 64, -1.0f);
+      std::vector<float> tensor(expected.size(), -1.0f);
+      alg::to_tensor(frame, expected.data(), mean, stddev, layout, policy);
+      alg::to_tensor(halo, tensor.data(), mean, stddev, layout, policy);
+      for (size_t i = 0; i < tensor.size(); ++i)
+        BOOST_REQUIRE_EQUAL(tensor[i], expected[i]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,163 @@
+//---- tests/regression_tests.cc --------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  regression_tests.cc
+/// \brief Test file to test the benchmark baselines and regression gate.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapRegressionTests
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include "../benchmarks/regression.hpp"
+#include <fstream>
+
+// Fixture with a private baseline directory, which is removed after each
+// test.
+struct RegressionFixture {
+  const boost::filesystem::path dir = 
+    boost::filesystem::temp_directory_path() / 
+    boost::filesystem::unique_path("snap-regression-%%%%-%%%%");
+
+  RegressionFixture()  { boost::filesystem::create_directory(dir); }
+  ~RegressionFixture() { boost::filesystem::remove_all(dir); }
+
+  // Returns a result with repetitions which have the \p median and a MAD of
+  // \p mad, in seconds.
+  static bench::Result result(const std::string& name, double median, 
+                              double mad, size_t pixels = 1000) {
+    return bench::Result{name, pixels, 2 * pixels, 10, 
+      {median - 2 * mad, median - mad, median, median + mad, median + 2 * mad},
+      {}};
+  }
+
+  // Returns the options to save (or compare) the baseline for the profile
+  // "test" in the fixture directory.
+  bench::Options options(bool save, bool compare) const {
+    bench::Options options;
+    options.save        = save;
+    options.compare     = compare;
+    options.baselineDir = dir.string();
+    options.profile     = "test";
+    return options;
+  }
+
+  std::string path() const { return (dir / "test.json").string(); }
+
+  void write(const std::string& text) const {
+    std::ofstream file(path());
+    file << text;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SnapRegressionSuite, RegressionFixture)
+
+BOOST_AUTO_TEST_CASE(baselineRoundTrips) {
+  // Names with quotes and backslashes must be escaped in the JSON.
+  const std::vector<bench::Result> results = {
+    result("sum"              , 2.5e-4, 1e-6, 1920 * 1080),
+    result("box \"3x3\" \\ 2" , 1.0e-3, 2e-5),
+    result("canny"            , 7.25e-3, 0.0)
+  };
+  BOOST_REQUIRE(bench::write_baseline(path(), "cpu \"x\" 8t sse", results));
+
+  bench::Baseline baseline;
+  BOOST_REQUIRE(bench::read_baseline(path(), baseline));
+  BOOST_CHECK_EQUAL(baseline.profile, "cpu \"x\" 8t sse");
+  BOOST_REQUIRE_EQUAL(baseline.entries.size(), results.size());
+  for (const auto& r : results) {
+    const auto it = baseline.entries.find(r.name);
+    BOOST_REQUIRE(it != baseline.entries.end());
+    BOOST_CHECK_EQUAL(it->second.pixels, r.pixels);
+    BOOST_CHECK_EQUAL(it->second.repetitions, r.seconds.size());
+    BOOST_CHECK_CLOSE(it->second.median, r.median(), 1e-6);
+    BOOST_CHECK_SMALL(it->second.mad - bench::mad(r), 1e-12);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(compareUsesThresholdAndNoise) {
+  bench::Baseline baseline;
+  for (const auto& r : {result("quiet", 1e-3, 1e-6), 
+                        result("noisy", 1e-3, 1e-4),
+                        result("sized", 1e-3, 1e-6)})
+    baseline.entries[r.name] = 
+      bench::BaselineEntry{r.name, r.pixels, 5, r.median(), bench::mad(r)};
+
+  // With a 10% threshold: 20% slower is a regression when the noise is 
+  // low, but not when the MADs of 100us make the difference insignificant.
+  auto status = [&] (const bench::Result& r) {
+    return bench::compare(baseline, {r}, 0.1).front().status;
+  };
+  BOOST_CHECK(status(result("quiet", 1.2e-3, 1e-6))   == bench::RS_SLOWER);
+  BOOST_CHECK(status(result("quiet", 1.05e-3, 1e-6))  == bench::RS_SAME);
+  BOOST_CHECK(status(result("quiet", 0.8e-3, 1e-6))   == bench::RS_FASTER);
+  BOOST_CHECK(status(result("noisy", 1.2e-3, 1e-4))   == bench::RS_SAME);
+  BOOST_CHECK(status(result("noisy", 2.0e-3, 1e-4))   == bench::RS_SLOWER);
+  BOOST_CHECK(status(result("sized", 2.0e-3, 1e-6, 7)) 
+              == bench::RS_MISMATCH);
+  BOOST_CHECK(status(result("other", 1.0e-3, 1e-6))   == bench::RS_NEW);
+
+  // Only the regressions are counted.
+  std::ostringstream out;
+  const auto comparisons = bench::compare(baseline, 
+    {result("quiet", 1.2e-3, 1e-6), result("noisy", 2.0e-3, 1e-4), 
+     result("sized", 0.5e-3, 1e-6), result("other", 1e-3, 1e-6)}, 0.1);
+  BOOST_CHECK_EQUAL(bench::report(out, comparisons), 2u);
+  BOOST_CHECK(out.str().find("SLOWER") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(gateReturnsExitCodes) {
+  const std::vector<bench::Result> results  = {result("sum", 1e-3, 1e-6)};
+  const std::vector<bench::Result> slower   = {result("sum", 2e-3, 1e-6)};
+
+  // A missing baseline is an I/O error, as is a baseline which can't be 
+  // written.
+  BOOST_CHECK_EQUAL(bench::regression_gate(options(false, true), results), 2);
+  auto missing = options(true, false);
+  missing.baselineDir = (dir / "missing").string();
+  BOOST_CHECK_EQUAL(bench::regression_gate(missing, results), 2);
+
+  BOOST_CHECK_EQUAL(bench::regression_gate(options(true, false), results), 0);
+  BOOST_CHECK_EQUAL(bench::regression_gate(options(false, true), results), 0);
+  BOOST_CHECK_EQUAL(bench::regression_gate(options(false, true), slower) , 1);
+
+  // A regression is not saved over the baseline.
+  BOOST_CHECK_EQUAL(bench::regression_gate(options(true, true), slower)  , 1);
+  BOOST_CHECK_EQUAL(bench::regression_gate(options(false, true), slower) , 1);
+}
+
+BOOST_AUTO_TEST_CASE(malformedBaselinesAreRejected) {
+  const std::vector<bench::Result> results = {result("sum", 1e-3, 1e-6)};
+  BOOST_REQUIRE(bench::write_baseline(path(), "test", results));
+  std::ifstream     file(path());
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  const std::string valid = buffer.str();
+
+  // A missing comma, an unknown key, an unquoted name, a truncated file
+  // and trailing text.
+  const std::string pos = ", \"pixels\"";
+  for (const auto& text : {
+         std::string(valid).erase(valid.find(pos), 1),
+         std::string(valid).replace(valid.find("\"mad\""), 5, "\"max\""),
+         std::string(valid).erase(valid.find("\"sum\""), 1),
+         valid.substr(0, valid.size() / 2),
+         valid + "}"}) {
+    write(text);
+    bench::Baseline baseline;
+    BOOST_CHECK(!bench::read_baseline(path(), baseline));
+    BOOST_CHECK_EQUAL(
+      bench::regression_gate(options(false, true), results), 2);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
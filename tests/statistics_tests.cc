@@ -0,0 +1,131 @@
+//---- tests/statistics_tests.cc --------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  statistics_tests.cc
+/// \brief Test file to test the snap matrix statistics algorithms.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapStatisticsTests
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/statistics.hpp"
+#include <random>
+
+using namespace snap;
+
+// Fixture with a matrix of random elements, which is large enough to be
+// split when run in parallel, and which has a width which is not a multiple
+// of the vector width, so that the remainder elements are tested.
+struct StatisticsFixture {
+  static constexpr size_t rows = 397;
+  static constexpr size_t cols = 403;
+
+  Matrix<mat::FM_GREY_8> mat{rows, cols};
+
+  StatisticsFixture() {
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> dist(1, 200);
+    for (size_t r = 0; r < rows; ++r) 
+      for (size_t c = 0; c < cols; ++c)
+        mat(r, c) = static_cast<uint8_t>(dist(gen));
+
+    util::par::set_thread_count(4);
+  }
+
+  ~StatisticsFixture() { util::par::set_thread_count(0); }
+
+  // Reference sum of the elements in the roi.
+  uint64_t referenceSum(const Rect& roi, uint64_t power = 1) const {
+    uint64_t total = 0;
+    for (size_t r = roi.y; r < roi.y + roi.height; ++r) 
+      for (size_t c = roi.x; c < roi.x + roi.width; ++c)
+        total += power == 1 ? mat(r, c) : mat(r, c) * mat(r, c);
+    return total;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SnapStatisticsSuite, StatisticsFixture)
+
+BOOST_AUTO_TEST_CASE(canComputeSum) {
+  const Rect all{0, 0, cols, rows};
+  BOOST_CHECK(alg::sum(mat) == referenceSum(all));
+  BOOST_CHECK(alg::sum(mat, EP_PARALLEL) == referenceSum(all));
+}
+
+BOOST_AUTO_TEST_CASE(canComputeSumOfRoi) {
+  const Rect roi{5, 17, 131, 250};
+  BOOST_CHECK(alg::sum(mat, roi) == referenceSum(roi));
+  BOOST_CHECK(alg::sum(mat, roi, EP_PARALLEL) == referenceSum(roi));
+}
+
+BOOST_AUTO_TEST_CASE(canComputeMeanAndStdDev) {
+  const Rect   roi{3, 1, 300, 390};
+  const double n      = roi.width * roi.height;
+  const double mean   = referenceSum(roi) / n;
+  const double stddev = std::sqrt(referenceSum(roi, 2) / n - mean * mean);
+
+  for (auto policy : {EP_SERIAL, EP_PARALLEL}) {
+    const auto result = alg::mean_stddev(mat, roi, policy);
+    BOOST_CHECK_CLOSE(result.mean  , mean  , 1e-9);
+    BOOST_CHECK_CLOSE(result.stddev, stddev, 1e-6);
+    BOOST_CHECK_CLOSE(alg::mean(mat, roi, policy), mean, 1e-9);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(canFindMinMaxAndLocations) {
+  mat(123, 45)  = 0;
+  mat(300, 401) = 255;
+  mat(310, 2)   = 0;      // Second min, which must not be reported.
+
+  for (auto policy : {EP_SERIAL, EP_PARALLEL}) {
+    const auto result = alg::min_max_loc(mat, policy);
+    BOOST_CHECK(result.minVal   == 0  );
+    BOOST_CHECK(result.maxVal   == 255);
+    BOOST_CHECK(result.minLoc.x == 45 && result.minLoc.y == 123);
+    BOOST_CHECK(result.maxLoc.x == 401 && result.maxLoc.y == 300);
+  }
+
+  // Relative to the roi, which excludes the first min.
+  const auto result = alg::min_max_loc(mat, Rect{0, 200, cols, 150});
+  BOOST_CHECK(result.minLoc.x == 2 && result.minLoc.y == 110);
+}
+
+BOOST_AUTO_TEST_CASE(canCountNonZero) {
+  size_t zeros = 0;
+  for (size_t r = 0; r < rows; r += 3) {
+    for (size_t c = r % 7; c < cols; c += 5) {
+      mat(r, c) = 0;
+      ++zeros;
+    }
+  }
+
+  BOOST_CHECK(alg::count_non_zero(mat) == rows * cols - zeros);
+  BOOST_CHECK(alg::count_non_zero(mat, EP_PARALLEL) == rows * cols - zeros);
+}
+
+BOOST_AUTO_TEST_CASE(canCountNonZeroWithoutLaneOverflow) {
+  // All zeros, so that each of the 8-bit lane counters is saturated.
+  for (size_t r = 0; r < rows; ++r) 
+    for (size_t c = 0; c < cols; ++c)
+      mat(r, c) = 0;
+
+  BOOST_CHECK(alg::count_non_zero(mat) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(handlesEmptyRoi) {
+  const Rect empty{10, 10, 0, 0};
+  BOOST_CHECK(alg::sum(mat, empty) == 0);
+  BOOST_CHECK(alg::count_non_zero(mat, empty) == 0);
+  BOOST_CHECK(alg::mean(mat, empty) == 0.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
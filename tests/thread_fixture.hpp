@@ -0,0 +1,41 @@
+//---- tests/thread_fixture.hpp ---------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  thread_fixture.hpp
+/// \brief Defines the base of the test fixtures which run the parallel 
+///        kernels, which fixes the number of threads.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef SNAP_TESTS_THREAD_FIXTURE_HPP
+#define SNAP_TESTS_THREAD_FIXTURE_HPP
+
+#include "snap/algorithm/region.hpp"
+
+/// Defines a fixture which uses three threads while it exists, so that the
+/// parallel kernels split their work the same way on all machines, 
+/// including single core ones, and which restores the default number of 
+/// threads when it is destroyed.
+///
+/// The kernels only split inputs which have at least MIN_PARALLEL_ELEMENTS
+/// elements per chunk, so an input must have at least 
+/// PARALLEL_TEST_ELEMENTS elements for the parallel path of a kernel to be
+/// exercised with all three threads.
+struct ThreadFixture {
+  ThreadFixture()  { snap::util::par::set_thread_count(3); }
+  ~ThreadFixture() { snap::util::par::set_thread_count(0); }
+};
+
+/// Defines the number of elements for which the kernels use three threads.
+static constexpr size_t PARALLEL_TEST_ELEMENTS = 
+  3 * snap::alg::detail::MIN_PARALLEL_ELEMENTS;
+
+#endif // SNAP_TESTS_THREAD_FIXTURE_HPP
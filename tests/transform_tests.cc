@@ -0,0 +1,253 @@
+//---- tests/transform_tests.cc ---------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  transform_tests.cc
+/// \brief Test file to test the snap elementwise matrix kernels.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapTransformTests
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/transform.hpp"
+#include "thread_fixture.hpp"
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <random>
+
+using namespace snap;
+
+// Fixture with two random matrices with dimensions which are not multiples
+// of the vector width or the cache line size.
+struct TransformFixture : ThreadFixture {
+  static constexpr size_t rows = 93;
+  static constexpr size_t cols = 171;
+
+  Matrix<mat::FM_GREY_8> a{rows, cols};
+  Matrix<mat::FM_GREY_8> b{rows, cols};
+  Matrix<mat::FM_GREY_8> out{rows, cols};
+
+  TransformFixture() {
+    std::mt19937 gen(17);
+    std::uniform_int_distribution<int> value(0, 255);
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t c = 0; c < cols; ++c) {
+        a(r, c) = static_cast<uint8_t>(value(gen));
+        b(r, c) = static_cast<uint8_t>(value(gen));
+      }
+    }
+  }
+
+  // Runs f with each combination of execution and write policy.
+  template <typename F>
+  void forEachPolicy(F&& f) {
+    for (const auto policy : {EP_SERIAL, EP_PARALLEL}) 
+      for (const auto write : {alg::WP_AUTO, alg::WP_CACHED, alg::WP_STREAM})
+        f(policy, write);
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SnapTransformSuite, TransformFixture)
+
+BOOST_AUTO_TEST_CASE(canSelectStreamingFromOutputSize) {
+  using alg::detail::use_streaming;
+  BOOST_CHECK(!use_streaming(alg::NON_TEMPORAL_BYTES - 1, alg::WP_AUTO));
+  BOOST_CHECK( use_streaming(alg::NON_TEMPORAL_BYTES    , alg::WP_AUTO));
+  BOOST_CHECK(!use_streaming(alg::NON_TEMPORAL_BYTES    , alg::WP_CACHED));
+  BOOST_CHECK( use_streaming(1                          , alg::WP_STREAM));
+}
+
+BOOST_AUTO_TEST_CASE(canFillMatrix) {
+  forEachPolicy([&] (ExecutionPolicy policy, alg::WritePolicy write) {
+    alg::fill(out, 0x5a, policy, write);
+    for (size_t i = 0; i < out.size(); ++i)
+      BOOST_REQUIRE_EQUAL(out.data()[i], 0x5a);
+    alg::fill(out, 0, policy, write);
+  });
+}
+
+BOOST_AUTO_TEST_CASE(canCopyMatrix) {
+  forEachPolicy([&] (ExecutionPolicy policy, alg::WritePolicy write) {
+    alg::fill(out, 0);
+    alg::copy(a, out, policy, write);
+    BOOST_REQUIRE(std::equal(a.data(), a.data() + a.size(), out.data()));
+  });
+}
+
+BOOST_AUTO_TEST_CASE(canComputeAbsoluteDifferenceMatrix) {
+  forEachPolicy([&] (ExecutionPolicy policy, alg::WritePolicy write) {
+    alg::fill(out, 0);
+    alg::absdiff(a, b, out, policy, write);
+    for (size_t i = 0; i < out.size(); ++i) {
+      BOOST_REQUIRE_EQUAL(int(out.data()[i]), 
+        std::abs(int(a.data()[i]) - int(b.data()[i])));
+    }
+  });
+}
+
+BOOST_AUTO_TEST_CASE(keepsHaloOfOutputMatrix) {
+  // The rows of a haloed matrix are not contiguous, so the kernels must
+  // write each row without touching the halo, and the input strides differ.
+  constexpr int64_t halo = 3, rows = 461, cols = 433;
+  static_assert(rows * cols >= PARALLEL_TEST_ELEMENTS,
+                "The output must be split across threads!");
+  Matrix<mat::FM_GREY_8> x(rows, cols, Halo{halo}), y(rows, cols);
+  Matrix<mat::FM_GREY_8> z(rows, cols, Halo{halo});
+  std::mt19937 gen(29);
+  std::uniform_int_distribution<int> value(0, 255);
+  for (int64_t r = 0; r < rows; ++r) {
+    for (int64_t c = 0; c < cols; ++c) {
+      x(r, c) = static_cast<uint8_t>(value(gen));
+      y(r, c) = static_cast<uint8_t>(value(gen));
+    }
+  }
+
+  const auto check = [&] (const std::function<int(int64_t, int64_t)>& at) {
+    for (int64_t r = -halo; r < rows + halo; ++r) {
+      for (int64_t c = -halo; c < cols + halo; ++c) {
+        const bool inside = r >= 0 && r < rows && c >= 0 && c < cols;
+        BOOST_REQUIRE_EQUAL(int(z.data()[r * int64_t(z.stride()) + c]),
+                            inside ? at(r, c) : 0xa5);
+      }
+    }
+  };
+  forEachPolicy([&] (ExecutionPolicy policy, alg::WritePolicy write) {
+    alg::fill_border(z, alg::BM_CONSTANT, 0xa5);
+    alg::fill(z, 0x5a, policy, write);
+    check([] (int64_t, int64_t) { return 0x5a; });
+    alg::copy(y, z, policy, write);
+    check([&] (int64_t r, int64_t c) { return int(y(r, c)); });
+    alg::absdiff(x, y, z, policy, write);
+    check([&] (int64_t r, int64_t c) { 
+      return std::abs(int(x(r, c)) - int(y(r, c))); 
+    });
+  });
+}
+
+BOOST_AUTO_TEST_CASE(canStreamToUnalignedOutput) {
+  // Copy into a view which starts 3 elements into the output, to check the
+  // scalar head which aligns the streaming stores.
+  std::vector<uint8_t> expected(a.data(), a.data() + a.size());
+  std::vector<uint8_t> result(a.size() + 3, 0);
+  const uint8_t* in = a.data();
+  alg::detail::write_span(result.data() + 3, a.size(), true,
+    [in] (size_t i) { Vec16x8u v; v.load(in + i); return v; },
+    [in] (size_t i) { return in[i]; },
+    [in] (size_t i) { prefetch(in + i); });
+  BOOST_CHECK(std::equal(expected.begin(), expected.end(), 
+    result.begin() + 3));
+}
+
+BOOST_AUTO_TEST_CASE(splitsParallelWritesOnCacheLines) {
+  // Write an output which is large enough to be split across the threads,
+  // and which starts 3 bytes into a cache line, so that each chunk after
+  // the first must start on a cache line of the addresses, rather than at
+  // a multiple of the line size from the start of the output.
+  constexpr size_t line = alg::CACHE_LINE_BYTES;
+  const size_t n = size_t(1) << 18;
+  std::vector<uint8_t> in(n), result(n + 2 * line, 0);
+  for (size_t i = 0; i < n; ++i)
+    in[i] = static_cast<uint8_t>(i % 251);
+  const size_t lead =
+    reinterpret_cast<uintptr_t>(result.data()) % line;
+  uint8_t* out = result.data() + (line - lead) % line + 3;
+
+  std::mutex          mutex;
+  std::vector<size_t> offsets;
+  const uint8_t*      input = in.data();
+  alg::detail::write_elements(out, n, EP_PARALLEL, alg::WP_CACHED,
+    [&] (size_t i) { 
+      std::lock_guard<std::mutex> lock(mutex);
+      offsets.push_back(i);
+      Vec16x8u v; 
+      v.load(input + i); 
+      return v; 
+    },
+    [input] (size_t i) { return input[i]; },
+    [] (size_t) {});
+
+  // Vectors are stored from the start of each chunk, so only the first
+  // chunk has unaligned vectors, and the first aligned vector is the start
+  // of the second chunk.
+  std::sort(offsets.begin(), offsets.end());
+  const auto second = std::find_if(offsets.begin(), offsets.end(),
+    [&] (size_t i) {
+      return reinterpret_cast<uintptr_t>(out + i) % Vec16x8u::width == 0;
+    });
+  BOOST_REQUIRE(second != offsets.end());
+  BOOST_CHECK(reinterpret_cast<uintptr_t>(out + *second) % line == 0);
+  BOOST_CHECK(std::equal(in.begin(), in.end(), out));
+}
+
+BOOST_AUTO_TEST_CASE(canMapBorderIndices) {
+  const int64_t n = 4;
+  const int64_t indices[] = {-6, -5, -4, -3, -2, -1, 0, 3, 4, 5, 6, 7, 9};
+  const int64_t replicate[] = {0, 0, 0, 0, 0, 0, 0, 3, 3, 3, 3, 3, 3};
+  const int64_t reflect[]   = {0, 1, 2, 3, 2, 1, 0, 3, 2, 1, 0, 1, 3};
+  const int64_t wrap[]      = {2, 3, 0, 1, 2, 3, 0, 3, 0, 1, 2, 3, 1};
+  for (size_t i = 0; i < sizeof(indices) / sizeof(indices[0]); ++i) {
+    const bool inside = indices[i] >= 0 && indices[i] < n;
+    BOOST_CHECK(alg::border_index(indices[i], n, alg::BM_CONSTANT) == 
+                (inside ? indices[i] : -1));
+    BOOST_CHECK(alg::border_index(indices[i], n, alg::BM_REPLICATE) == 
+                replicate[i]);
+    BOOST_CHECK(alg::border_index(indices[i], n, alg::BM_REFLECT) == 
+                reflect[i]);
+    BOOST_CHECK(alg::border_index(indices[i], n, alg::BM_WRAP) == wrap[i]);
+  }
+  BOOST_CHECK(alg::border_index(-3, 1, alg::BM_REFLECT) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(canFillBorders) {
+  // The sides of the first halo fit in a vector, and those of the second
+  // need several stores.
+  for (const int64_t halo : {5, 17}) {
+    for (const auto border : {alg::BM_CONSTANT, alg::BM_REPLICATE, 
+                              alg::BM_REFLECT, alg::BM_WRAP}) {
+      for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+        Matrix<mat::FM_GREY_8> grey(7, 19, Halo{size_t(halo)});
+        Matrix<mat::FM_BGR_24> bgr(3, 4, Halo{size_t(halo)});
+        for (size_t r = 0; r < grey.rows(); ++r)
+          for (size_t c = 0; c < grey.cols(); ++c)
+            grey(r, c) = a(r, c);
+        for (size_t r = 0; r < bgr.rows(); ++r)
+          for (size_t c = 0; c < 3 * bgr.cols(); ++c)
+            bgr.data()[r * bgr.stride() + c] = b(r, c);
+
+        alg::fill_border(grey, border, 42, policy);
+        alg::fill_border(bgr, border, 42, policy);
+        for (int64_t r = -halo; r < int64_t(grey.rows()) + halo; ++r) {
+          for (int64_t c = -halo; c < int64_t(grey.cols()) + halo; ++c) {
+            const int64_t y = alg::border_index(r, grey.rows(), border);
+            const int64_t x = alg::border_index(c, grey.cols(), border);
+            const uint8_t expected = x < 0 || y < 0 ? 42 : a(y, x);
+            BOOST_REQUIRE(grey.data()[r * int64_t(grey.stride()) + c] == 
+                          expected);
+          }
+        }
+        for (int64_t r = -halo; r < int64_t(bgr.rows()) + halo; ++r) {
+          for (int64_t c = -halo; c < int64_t(bgr.cols()) + halo; ++c) {
+            const int64_t y = alg::border_index(r, bgr.rows(), border);
+            const int64_t x = alg::border_index(c, bgr.cols(), border);
+            for (int64_t k = 0; k < 3; ++k) {
+              const uint8_t expected = x < 0 || y < 0 ? 42 : b(y, 3 * x + k);
+              BOOST_REQUIRE(
+                bgr.data()[r * int64_t(bgr.stride()) + 3 * c + k] == expected);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,212 @@
+//---- tests/tuning_tests.cc ------------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  tuning_tests.cc
+/// \brief Test file to test the kernel tuning parameters and the auto-tuner.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapTuningTests
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/metrics.hpp"
+#include "snap/algorithm/statistics.hpp"
+#include "thread_fixture.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+using namespace snap;
+
+// Fixture which uses a private tuning cache. The images are small, so the
+// parallel paths are only exercised by candidates with small grains.
+struct TuningFixture : ThreadFixture {
+  const std::string      cache = "snap_tuning_tests.cache";
+  Matrix<mat::FM_GREY_8> a{131, 197}, b{131, 197};
+
+  TuningFixture() {
+    std::remove(cache.c_str());
+    setenv("SNAP_TUNING_CACHE", cache.c_str(), 1);
+
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> value(0, 255);
+    for (size_t i = 0; i < a.size(); ++i) {
+      a.data()[i] = static_cast<uint8_t>(value(gen));
+      b.data()[i] = static_cast<uint8_t>(value(gen));
+    }
+  }
+
+  ~TuningFixture() {
+    std::remove(cache.c_str());
+  }
+};
+
+// Clock which only advances when advance() is called, so that the tuner can
+// be tested with kernels which have a known cost.
+struct FakeClock {
+  using rep        = int64_t;
+  using period     = std::nano;
+  using duration   = std::chrono::duration<rep, period>;
+  using time_point = std::chrono::time_point<FakeClock>;
+  static constexpr bool is_steady = true;
+
+  static time_point now() { return time_point(duration(ticks())); }
+
+  static void advance(rep nanoseconds) { ticks() += nanoseconds; }
+
+  static rep& ticks() {
+    static rep value = 0;
+    return value;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SnapTuningSuite, TuningFixture)
+
+BOOST_AUTO_TEST_CASE(canDispatchUnrollFactors) {
+  auto factor = [] (uint32_t unroll) {
+    return util::tune::dispatch_unroll(unroll, [] (auto u) { 
+      return decltype(u)::value; 
+    });
+  };
+  BOOST_CHECK(factor(0)  == 1);
+  BOOST_CHECK(factor(1)  == 1);
+  BOOST_CHECK(factor(3)  == 2);
+  BOOST_CHECK(factor(4)  == 4);
+  BOOST_CHECK(factor(7)  == 4);
+  BOOST_CHECK(factor(16) == 8);
+}
+
+BOOST_AUTO_TEST_CASE(chunkCountRespectsThreadsAndGrain) {
+  BOOST_CHECK(util::tune::chunk_count(1 << 20, EP_SERIAL, 
+    util::tune::Params{4, 0, 1}) == 1);
+  BOOST_CHECK(util::tune::chunk_count(1 << 20, EP_PARALLEL, 
+    util::tune::Params{4, 0, 1}) == 3);
+  BOOST_CHECK(util::tune::chunk_count(1 << 20, EP_PARALLEL, 
+    util::tune::Params{4, 2, 1}) == 2);
+  BOOST_CHECK(util::tune::chunk_count(1 << 20, EP_PARALLEL, 
+    util::tune::Params{4, 0, 1 << 19}) == 2);
+  BOOST_CHECK(util::tune::chunk_count(1 << 20, EP_PARALLEL, 
+    util::tune::Params{4, 0, 0}) == 3);
+}
+
+BOOST_AUTO_TEST_CASE(entriesUseDefaultsUntilSet) {
+  const util::tune::Params defaults{4, 0, 1024};
+  auto& entry = util::tune::entry("test::defaults", defaults);
+  BOOST_CHECK(entry.get() == defaults);
+  BOOST_CHECK(&entry == &util::tune::entry("test::defaults", defaults));
+
+  util::tune::set("test::defaults", util::tune::Params{2, 1, 64});
+  BOOST_CHECK(entry.get() == (util::tune::Params{2, 1, 64}));
+
+  // Parameters which are set before the kernel is used are applied to it.
+  util::tune::set("test::later", util::tune::Params{8, 2, 32});
+  BOOST_CHECK(util::tune::entry("test::later", defaults).get() == 
+    (util::tune::Params{8, 2, 32}));
+}
+
+BOOST_AUTO_TEST_CASE(canSaveAndLoadTheCacheForThisProfile) {
+  {
+    std::ofstream file(cache);
+    file << "[other-machine]\ntest::saved 1 1 1\n";
+  }
+
+  const util::tune::Params defaults{4, 0, 1024};
+  auto& saved = util::tune::entry("test::saved", defaults);
+  util::tune::entry("test::unused", defaults);
+  saved.set(util::tune::Params{2, 3, 4096});
+  BOOST_CHECK(util::tune::save());
+
+  // The section of the other machine is kept, and the default parameters of
+  // the other kernels are not written.
+  std::ifstream file(cache);
+  const std::string text((std::istreambuf_iterator<char>(file)), 
+                          std::istreambuf_iterator<char>());
+  BOOST_CHECK(text.find("[other-machine]\ntest::saved 1 1 1\n") == 0);
+  BOOST_CHECK(text.find("[" + util::tune::machine_profile() + "]\n") !=
+    std::string::npos);
+  BOOST_CHECK(text.find("test::saved 2 3 4096\n") != std::string::npos);
+  BOOST_CHECK(text.find("test::unused") == std::string::npos);
+
+  saved.set(defaults);
+  BOOST_CHECK(util::tune::load());
+  BOOST_CHECK(saved.get() == (util::tune::Params{2, 3, 4096}));
+  BOOST_CHECK(!util::tune::load("snap_tuning_tests.missing"));
+  saved.set(defaults);
+}
+
+BOOST_AUTO_TEST_CASE(kernelsAreCorrectWithAllCandidates) {
+  uint64_t sum = 0, sumSq = 0, sad = 0, ssd = 0, zeros = 0;
+  uint8_t  lo  = 255, hi = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    const int va = a.data()[i], vb = b.data()[i];
+    sum   += va;
+    sumSq += va * va;
+    sad   += std::abs(va - vb);
+    ssd   += (va - vb) * (va - vb);
+    zeros += va == 0;
+    lo     = std::min<uint8_t>(lo, va);
+    hi     = std::max<uint8_t>(hi, va);
+  }
+  const double mean = double(sum) / a.size();
+
+  const char* kernels[] = {"alg::sum", "alg::mean_stddev", "alg::sad",
+    "alg::ssd", "alg::min_max_loc", "alg::count_non_zero"};
+  auto candidates = util::tune::default_candidates();
+  candidates.push_back(util::tune::Params{1, 3, 1});
+  candidates.push_back(util::tune::Params{8, 2, 1});
+
+  for (const auto& params : candidates) {
+    for (const auto kernel : kernels)
+      util::tune::set(kernel, params);
+    for (const auto policy : {EP_SERIAL, EP_PARALLEL}) {
+      BOOST_CHECK(alg::sum(a, policy) == sum);
+      BOOST_CHECK(alg::sad(a, b, policy) == sad);
+      BOOST_CHECK(alg::ssd(a, b, policy) == ssd);
+      BOOST_CHECK(alg::count_non_zero(a, policy) == a.size() - zeros);
+      BOOST_CHECK_CLOSE(alg::mean_stddev(a, policy).mean, mean, 1e-9);
+      BOOST_CHECK_CLOSE(alg::mean_stddev(a, policy).stddev, 
+        std::sqrt(double(sumSq) / a.size() - mean * mean), 1e-9);
+      const auto minMax = alg::min_max_loc(a, policy);
+      BOOST_CHECK(minMax.minVal == lo && minMax.maxVal == hi);
+    }
+  }
+  for (const auto kernel : kernels)
+    util::tune::set(kernel, alg::detail::DEFAULT_TUNING);
+}
+
+BOOST_AUTO_TEST_CASE(tunerSelectsTheFastestCandidate) {
+  const util::tune::Params defaults{4, 0, 1024};
+  auto& entry = util::tune::entry("test::tuned", defaults);
+
+  // The kernel advances the fake clock by its cost, which is lowest when it
+  // is unrolled 8 times on a single thread.
+  const auto result = util::tune::tune<FakeClock>("test::tuned", defaults, 
+    util::tune::default_candidates(), [&] {
+      const auto params = entry.get();
+      FakeClock::advance(
+        (params.unroll == 8 ? 100 : 400) + (params.threads == 1 ? 0 : 50));
+    }, 3);
+
+  BOOST_CHECK(result.best.unroll == 8 && result.best.threads == 1);
+  BOOST_CHECK_CLOSE(result.seconds , 100e-9, 1e-6);
+  BOOST_CHECK_CLOSE(result.baseline, 450e-9, 1e-6);
+  BOOST_CHECK(entry.get() == result.best);
+}
+
+BOOST_AUTO_TEST_CASE(emptyCachePathDisablesLoading) {
+  setenv("SNAP_TUNING_CACHE", "", 1);
+  BOOST_CHECK(util::tune::cache_path().empty());
+  BOOST_CHECK(!util::tune::load());
+  BOOST_CHECK(!util::tune::load(""));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -102,4 +102,112 @@ BOOST_AUTO_TEST_CASE(canUnrollWithoutUnrollIndexAndtherParams) {
   BOOST_CHECK(x == (END * UNROLL_SIZE * (1 + offsetB)));
 }
 
+BOOST_AUTO_TEST_CASE(canUnrollGenericLambda) {
+  const auto end = elements.size() - UNROLL_SIZE + 1;
+
+  for (size_t i = 0; i < end; i += UNROLL_SIZE) {
+    util::perf::unroll<0, UNROLL_SIZE - 1>(
+      [&] (auto unrollIdx, auto offset) {
+        elements[i + unrollIdx] = i + unrollIdx + offset;
+      },
+      size_t(3)  // Value of offset in unrolled lambda.
+    );
+  }
+
+  for (size_t i = 0; i < end - 1; ++i)
+    BOOST_CHECK(elements[i] == i + 3);
+}
+
+BOOST_AUTO_TEST_CASE(canUnrollSpanLargerThan255) {
+  constexpr size_t span = 512;
+  
+  util::perf::unroll<0, span - 1>([&] (const UnrollIndex unrollIdx) {
+    elements[unrollIdx] = unrollIdx;
+  });
+
+  for (size_t i = 0; i < span; ++i)
+    BOOST_CHECK(elements[i] == i);
+  BOOST_CHECK(elements[span] == 0);
+}
+
+BOOST_AUTO_TEST_CASE(canForEachUnrolledOverRuntimeRange) {
+  // Use an unroll factor which does not divide the size so that the
+  // remainder is handled.
+  constexpr uint8_t unrollFactor = 7;
+  static_assert(std::tuple_size<decltype(elements)>::value % unrollFactor,
+    "Test requires a remainder!");
+
+  util::perf::for_each_unrolled<unrollFactor>(
+    size_t(0), elements.size(), [&] (size_t i) { elements[i] = i; }
+  );
+
+  for (size_t i = 0; i < elements.size(); ++i)
+    BOOST_CHECK(elements[i] == i);
+}
+
+BOOST_AUTO_TEST_CASE(canForEachUnrolledOverEmptyRange) {
+  size_t calls = 0;
+  util::perf::for_each_unrolled<4>(10, 10, [&] (int) { ++calls; });
+  util::perf::for_each_unrolled<4>(10, 5 , [&] (int) { ++calls; });
+
+  BOOST_CHECK(calls == 0);
+}
+
+BOOST_AUTO_TEST_CASE(canReduceUnrolledWithLaneAccumulators) {
+  for (size_t i = 0; i < elements.size(); ++i) 
+    elements[i] = i;
+
+  const auto sum = util::perf::reduce_unrolled<UNROLL_SIZE>(
+    size_t(3), elements.size(), uint64_t(0),
+    [&] (uint64_t& acc, size_t i) { acc += elements[i]; },
+    [ ] (uint64_t a, uint64_t b) { return a + b; }
+  );
+
+  const uint64_t n = elements.size();
+  BOOST_CHECK(sum == n * (n - 1) / 2 - 3);
+}
+
+BOOST_AUTO_TEST_CASE(canParallelForOverChunks) {
+  constexpr size_t chunks = 7;
+  std::array<size_t, chunks> chunkElements = {0};
+
+  util::par::parallel_for(0, elements.size(), chunks, 
+    [&] (size_t begin, size_t end, size_t chunk) {
+      for (size_t i = begin; i < end; ++i)
+        elements[i] = i;
+      chunkElements[chunk] = end - begin;
+    }
+  );
+
+  for (size_t i = 0; i < elements.size(); ++i)
+    BOOST_CHECK(elements[i] == i);
+  for (size_t chunk = 0; chunk < chunks; ++chunk)
+    BOOST_CHECK(chunkElements[chunk] >= elements.size() / chunks);
+}
+
+BOOST_AUTO_TEST_CASE(hardwareCountersFailGracefully) {
+  using namespace util::perf;
+  HardwareCounters counters;
+
+  // The counters are often unavailable (e.g in containers), in which case 
+  // there must be a reason, and the counts must be marked as invalid.
+  const bool opened = counters.open();
+  BOOST_CHECK(opened == counters.available());
+  if (!opened)
+    BOOST_CHECK(!counters.error().empty());
+
+  counters.start();
+  for (size_t i = 0; i < elements.size(); ++i)
+    elements[i] = i * i;
+  const auto values = counters.stop();
+
+  for (size_t e = 0; e < HE_COUNT; ++e) {
+    const auto event = HardwareEvent(e);
+    if (!counters.available(event))
+      BOOST_CHECK(!values.has(event) && values.value[e] == 0);
+  }
+  if (values.has(HE_INSTRUCTIONS))
+    BOOST_CHECK(values.value[HE_INSTRUCTIONS] >= elements.size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()  
@@ -47,6 +47,27 @@ struct Vec16x8Fixture {
   };
 };
 
+static constexpr uint8_t Z = SHUFFLE_ZERO;  // Index of a zero element.
+
+// Checks the permute of a = {0, ..., 15} and b = {16, ..., 31} with indices
+// I, where each element of the result must be its index, or zero.
+template <uint8_t... I>
+void check_permute(const Vec16x8u& a, const Vec16x8u& b) {
+  const uint8_t index[16] = {I...};
+  const auto    result    = permute<I...>(a, b);
+  for (auto i = 0; i < 16; ++i) 
+    BOOST_CHECK(result[i] == (index[i] & Z ? 0 : index[i]));
+}
+
+// Checks the shuffle of a = {0, ..., 15} with indices I.
+template <uint8_t... I>
+void check_shuffle(const Vec16x8u& a) {
+  const uint8_t index[16] = {I...};
+  const auto    result    = shuffle<I...>(a);
+  for (auto i = 0; i < 16; ++i) 
+    BOOST_CHECK(result[i] == (index[i] & Z ? 0 : index[i]));
+}
+
 BOOST_FIXTURE_TEST_SUITE(SnapVec16x8Suite, Vec16x8Fixture)
 
 BOOST_AUTO_TEST_CASE(canBroadcastConstructUnsigned) {
@@ -134,5 +155,189 @@ BOOST_AUTO_TEST_CASE(canSetSingleElement) {
     BOOST_CHECK(vec[i] == i);
   }
 }
+
+BOOST_AUTO_TEST_CASE(canComputeHorizontalReductions) {
+  Vec16x8u vecU(uint16x8a);
+  Vec16x8s vecS(sint16x8a);
+
+  vecU.set(9, 201);
+  vecS.set(3, -128);
+  vecS.set(12, 127);
+
+  uint32_t sumU = 0;
+  int32_t  sumS = 0;
+  for (auto i = 0; i < 16; ++i) {
+    sumU += vecU[i];
+    sumS += vecS[i];
+  }
+
+  BOOST_CHECK(vecU.hsum() == sumU);
+  BOOST_CHECK(vecS.hsum() == sumS);
+  BOOST_CHECK(vecU.hmin() == 0   );
+  BOOST_CHECK(vecU.hmax() == 201 );
+  BOOST_CHECK(vecS.hmin() == -128);
+  BOOST_CHECK(vecS.hmax() == 127 );
+}
+
+BOOST_AUTO_TEST_CASE(canComputeElementwiseMinMax) {
+  Vec16x8s a(sint16x8a);
+  Vec16x8s b(int8_t(0));
+
+  const auto mins = min(a, b);
+  const auto maxs = max(a, b);
+  for (auto i = 0; i < 16; ++i) {
+    BOOST_CHECK(mins[i] == std::min<int8_t>(sint16x8a[i], 0));
+    BOOST_CHECK(maxs[i] == std::max<int8_t>(sint16x8a[i], 0));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(canComputeBitwiseOperations) {
+  Vec16x8u a(uint16x8a);
+  Vec16x8u b(uint8_t(0x5a));
+
+  const auto ands = a & b;
+  const auto ors  = a | b;
+  const auto xors = a ^ b;
+  const auto nots = ~a;
+  for (auto i = 0; i < 16; ++i) {
+    BOOST_CHECK(ands[i] == (uint16x8a[i] & 0x5a));
+    BOOST_CHECK(ors[i]  == (uint16x8a[i] | 0x5a));
+    BOOST_CHECK(xors[i] == (uint16x8a[i] ^ 0x5a));
+    BOOST_CHECK(nots[i] == uint8_t(~uint16x8a[i]));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(canCompute16BitMasks) {
+  const uint16_t values[8] = {0, 1, 254, 255, 256, 2040, 32768, 65535};
+  Vec8x16u a, b(uint16_t(255));
+  a.load(values);
+
+  const auto diffs = subs(a, b);
+  const auto equal = cmpeq(a, b);
+  const auto ors   = (a & b) | (a ^ b);
+  const auto nots  = ~a;
+  for (auto i = 0; i < 8; ++i) {
+    BOOST_CHECK(diffs[i] == (values[i] > 255 ? values[i] - 255 : 0));
+    BOOST_CHECK(equal[i] == (values[i] == 255 ? 0xffff : 0));
+    BOOST_CHECK(ors[i]   == (values[i] | 255));
+    BOOST_CHECK(nots[i]  == uint16_t(~values[i]));
+  }
+
+  // Narrowing saturates, including the values which are negative as int16.
+  const auto narrowed = narrow(a, diffs);
+  for (auto i = 0; i < 8; ++i) {
+    BOOST_CHECK(narrowed[i] == std::min<int>(values[i], 255));
+    BOOST_CHECK(narrowed[i + 8] == std::min<int>(diffs[i], 255));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(canComputeSad) {
+  Vec16x8u a(uint16x8a);
+  Vec16x8u b(uint8_t(10));
+
+  uint32_t sad = 0;
+  for (auto i = 0; i < 16; ++i) 
+    sad += std::abs(int(uint16x8a[i]) - 10);
+
+  BOOST_CHECK(snap::sad(a, b).hsum() == sad);
+}
   
+BOOST_AUTO_TEST_CASE(canShuffleElements) {
+  const Vec16x8u a(uint16x8a);
+
+  // Identity, zero, byte shifts, dwords, words and a rotation.
+  check_shuffle<0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15>(a);
+  check_shuffle<Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z>(a);
+  check_shuffle<3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, Z, Z, Z>(a);
+  check_shuffle<Z, Z, Z, Z, Z, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10>(a);
+  check_shuffle<12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3>(a);
+  check_shuffle<6, 7, 0, 1, 2, 3, 2, 3, 8, 9, 8, 9, 14, 15, 12, 13>(a);
+  check_shuffle<0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7>(a);
+  check_shuffle<7, 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6>(a);
+
+  // General patterns, with and without zeros.
+  check_shuffle<15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0>(a);
+  check_shuffle<0, 3, 6, 9, 12, 15, Z, Z, 1, 4, 7, 10, 13, Z, Z, 5>(a);
+
+  const Vec16x8s s(sint16x8a);
+  const auto     reversed = 
+    shuffle<15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0>(s);
+  for (auto i = 0; i < 16; ++i)
+    BOOST_CHECK(reversed[i] == sint16x8a[15 - i]);
+}
+
+BOOST_AUTO_TEST_CASE(canPermuteElements) {
+  const Vec16x8u a(uint16x8a);
+  const Vec16x8u b = a + Vec16x8u(uint8_t(16));
+
+  // Interleaves, in both orders and at each granularity.
+  check_permute<0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23>(a, b);
+  check_permute<24, 25, 8, 9, 26, 27, 10, 11, 28, 29, 12, 13, 30, 31, 14, 
+                15>(a, b);
+  check_permute<0, 1, 2, 3, 16, 17, 18, 19, 4, 5, 6, 7, 20, 21, 22, 23>(a, b);
+  check_permute<24, 25, 26, 27, 28, 29, 30, 31, 8, 9, 10, 11, 12, 13, 14, 
+                15>(a, b);
+
+  // Windows of the concatenation, two dwords of each, and blends.
+  check_permute<5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20>(
+    a, b);
+  check_permute<27, 28, 29, 30, 31, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10>(a, b);
+  check_permute<8, 9, 10, 11, 0, 1, 2, 3, 28, 29, 30, 31, 16, 17, 18, 19>(
+    a, b);
+  check_permute<0, 17, 2, 19, 4, 5, 22, 7, 24, 9, 10, 27, 12, 29, 30, 15>(
+    a, b);
+  check_permute<0, 1, 18, 19, 4, 5, 22, 23, 8, 9, 10, 11, 28, 29, 14, 15>(
+    a, b);
+
+  // Only one source, and general patterns.
+  check_permute<2, 1, 0, Z, 6, 5, 4, Z, 10, 9, 8, Z, 14, 13, 12, Z>(a, b);
+  check_permute<31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 
+                16>(a, b);
+  check_permute<0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, Z, Z, Z, Z, Z>(a, b);
+  check_permute<31, 0, 30, 1, 29, 2, 28, 3, Z, 4, 27, 5, 26, 6, 25, 7>(a, b);
+}
+
+#if defined(SSE_ENABLED)
+
+BOOST_AUTO_TEST_CASE(shufflesUseCheapestPattern) {
+  using detail::ShuffleMask;
+  BOOST_CHECK(detail::shuffle_kind(ShuffleMask{{
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, Z, Z, Z}}) == 
+    detail::SK_SHIFT_RIGHT);
+  BOOST_CHECK(detail::shuffle_kind(ShuffleMask{{
+    12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3}}) == 
+    detail::SK_PSHUFD);
+  BOOST_CHECK(detail::shuffle_kind(ShuffleMask{{
+    6, 7, 0, 1, 2, 3, 2, 3, 8, 9, 8, 9, 14, 15, 12, 13}}) == 
+    detail::SK_PSHUFLHW);
+  BOOST_CHECK(detail::shuffle_kind(ShuffleMask{{
+    7, 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6}}) == 
+    detail::SK_ALIGNR);
+  BOOST_CHECK(detail::permute_kind(ShuffleMask{{
+    24, 25, 8, 9, 26, 27, 10, 11, 28, 29, 12, 13, 30, 31, 14, 15}}) == 
+    detail::SK_SWAP);
+  BOOST_CHECK(detail::permute_kind(ShuffleMask{{
+    8, 9, 10, 11, 0, 1, 2, 3, 28, 29, 30, 31, 16, 17, 18, 19}}) == 
+    detail::SK_SHUFPS);
+  BOOST_CHECK(detail::permute_kind(ShuffleMask{{
+    0, 17, 2, 19, 4, 5, 22, 7, 24, 9, 10, 27, 12, 29, 30, 15}}) == 
+    detail::SK_SELECT);
+  BOOST_CHECK(detail::permute_kind(ShuffleMask{{
+    0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, Z, Z, Z, Z, Z}}) == 
+    (detail::SHUFFLE_PSHUFB ? detail::SK_PSHUFB2 : detail::SK_GATHER));
+}
+
+#endif // SSE_ENABLED
+
+BOOST_AUTO_TEST_CASE(canStreamVector) {
+  Vec16x8u a(uint16x8a);
+  SNAP_ALIGN(16) uint8_t result[16] = {};
+
+  a.stream(result);
+  stream_fence();
+
+  for (auto i = 0; i < 16; ++i) 
+    BOOST_CHECK(result[i] == uint16x8a[i]);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
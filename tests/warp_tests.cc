@@ -0,0 +1,248 @@
+//---- tests/warp_tests.cc --------------------------------- -*- C++ -*- ----//
+//
+//                                 Snap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                   https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  warp_tests.cc
+/// \brief Test file to test the snap affine, perspective and remap warps.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE SnapWarpTests
+
+#include <boost/test/unit_test.hpp>
+#include "snap/algorithm/warp.hpp"
+#include "thread_fixture.hpp"
+#include <random>
+
+using namespace snap;
+
+using Grey = Matrix<mat::FM_GREY_8>;
+using Bgr  = Matrix<mat::FM_BGR_24>;
+
+// Fixture with noisy greyscale and BGR images. The warped outputs are 
+// 450x470, which is large enough to be split across the threads.
+struct WarpFixture : ThreadFixture {
+  static constexpr size_t rows = 450, cols = 470;
+  static_assert(rows * cols >= PARALLEL_TEST_ELEMENTS, 
+                "The outputs must be split across the threads!");
+
+  Grey grey{331, 353};
+  Bgr  bgr{211, 223};
+
+  WarpFixture() {
+    std::mt19937 gen(23);
+    std::uniform_int_distribution<int> value(0, 255);
+    for (size_t i = 0; i < grey.rows() * grey.stride(); ++i)
+      grey.data()[i] = static_cast<uint8_t>(value(gen));
+    for (size_t i = 0; i < bgr.rows() * bgr.stride(); ++i)
+      bgr.data()[i] = static_cast<uint8_t>(value(gen));
+  }
+
+  // Reference bilinear sample of channel k of \p m at column x and row y.
+  template <uint8_t F>
+  static int sample(const Matrix<F>& m, double x, double y, size_t k,
+                    alg::BorderMode border, uint8_t value) {
+    constexpr size_t C = format_traits<F>::channels;
+    const auto at = [&] (long c, long r) -> int {
+      c = alg::border_index(c, m.cols(), border);
+      r = alg::border_index(r, m.rows(), border);
+      return c < 0 || r < 0 ? value : m.data()[r * m.stride() + c * C + k];
+    };
+    const int32_t fx = alg::detail::to_fixed(x);
+    const int32_t fy = alg::detail::to_fixed(y);
+    const long    c  = fx >> 11, r = fy >> 11;
+    const double  wx = (fx & 2047) / 2048.0, wy = (fy & 2047) / 2048.0;
+    const double  t  = at(c, r) * (1 - wx) + at(c + 1, r) * wx;
+    const double  b  = at(c, r + 1) * (1 - wx) + at(c + 1, r + 1) * wx;
+    return int(std::floor(t * (1 - wy) + b * wy + 0.5));
+  }
+
+  // Checks that \p out is within \p tolerance of the reference warp of
+  // \p in, where map(c, r, x, y) gives the input position of each element.
+  template <uint8_t F, typename Map>
+  static void check(const Matrix<F>& in, const Matrix<F>& out,
+                    alg::BorderMode border, uint8_t value, int tolerance,
+                    Map&& map) {
+    constexpr size_t C = format_traits<F>::channels;
+    int worst = 0;
+    for (size_t r = 0; r < out.rows(); ++r) {
+      for (size_t c = 0; c < out.cols(); ++c) {
+        double x, y;
+        map(double(c), double(r), x, y);
+        for (size_t k = 0; k < C; ++k) {
+          const int expected = sample(in, x, y, k, border, value);
+          const int actual   = out.data()[r * out.stride() + c * C + k];
+          worst = std::max(worst, std::abs(expected - actual));
+        }
+      }
+    }
+    BOOST_CHECK(worst <= tolerance);
+  }
+
+  template <uint8_t F>
+  static bool equal(const Matrix<F>& a, const Matrix<F>& b) {
+    return a.rows() == b.rows() && a.cols() == b.cols() &&
+      std::equal(a.data(), a.data() + a.rows() * a.stride(), b.data());
+  }
+
+  // Returns a rotation by \p angle and scale by \p scale about the center
+  // of \p m.
+  template <uint8_t F>
+  static void rotation(const Matrix<F>& m, double angle, double scale,
+                       double (&t)[6]) {
+    const double cx = m.cols() / 2.0, cy = m.rows() / 2.0;
+    const double a  = std::cos(angle) * scale, b = std::sin(angle) * scale;
+    t[0] = a; t[1] = -b; t[2] = cx - a * cx + b * cy;
+    t[3] = b; t[4] =  a; t[5] = cy - b * cx - a * cy;
+  }
+};
+
+constexpr size_t WarpFixture::rows;
+constexpr size_t WarpFixture::cols;
+
+BOOST_FIXTURE_TEST_SUITE(SnapWarpSuite, WarpFixture)
+
+BOOST_AUTO_TEST_CASE(identityWarpsCopy) {
+  const double affine[6]      = {1, 0, 0, 0, 1, 0};
+  const double perspective[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+  Grey a(grey.rows(), grey.cols()), p(grey.rows(), grey.cols());
+  alg::warp_affine(grey, a, affine);
+  alg::warp_perspective(grey, p, perspective);
+  BOOST_CHECK(equal(a, grey) && equal(p, grey));
+
+  Bgr b(bgr.rows(), bgr.cols());
+  alg::warp_affine(bgr, b, affine, alg::BM_REPLICATE, 0, EP_PARALLEL);
+  BOOST_CHECK(equal(b, bgr));
+}
+
+BOOST_AUTO_TEST_CASE(translationsUseTheBorder) {
+  const double m[6] = {1, 0, -3, 0, 1, 5};
+  Grey out(grey.rows(), grey.cols());
+  for (const auto border : {alg::BM_CONSTANT, alg::BM_REPLICATE}) {
+    alg::warp_affine(grey, out, m, border, 77);
+    for (long r = 0; r < long(out.rows()); ++r) {
+      for (long c = 0; c < long(out.cols()); ++c) {
+        long x = c - 3, y = r + 5;
+        int  expected = 77;
+        if (border == alg::BM_REPLICATE) {
+          x = std::min(std::max(x, 0l), long(grey.cols()) - 1);
+          y = std::min(std::max(y, 0l), long(grey.rows()) - 1);
+        }
+        if (x >= 0 && y >= 0 && x < long(grey.cols()) && 
+            y < long(grey.rows()))
+          expected = grey.data()[y * grey.stride() + x];
+        BOOST_REQUIRE(out.data()[r * out.stride() + c] == expected);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(affineMatchesReference) {
+  for (const auto border : {alg::BM_CONSTANT, alg::BM_REPLICATE,
+                            alg::BM_REFLECT, alg::BM_WRAP}) {
+    double m[6];
+    rotation(grey, 0.3, 0.8, m);
+    Grey serial(rows, cols), parallel(rows, cols);
+    alg::warp_affine(grey, serial, m, border, 9, EP_SERIAL);
+    alg::warp_affine(grey, parallel, m, border, 9, EP_PARALLEL);
+    BOOST_CHECK(equal(serial, parallel));
+    check(grey, serial, border, 9, 1, [&] (double c, double r, double& x,
+                                           double& y) {
+      x = m[0] * c + m[1] * r + m[2];
+      y = m[3] * c + m[4] * r + m[5];
+    });
+
+    rotation(bgr, -1.1, 1.7, m);
+    Bgr out(rows, cols);
+    alg::warp_affine(bgr, out, m, border, 200, EP_PARALLEL);
+    check(bgr, out, border, 200, 1, [&] (double c, double r, double& x,
+                                         double& y) {
+      x = m[0] * c + m[1] * r + m[2];
+      y = m[3] * c + m[4] * r + m[5];
+    });
+  }
+}
+
+BOOST_AUTO_TEST_CASE(perspectiveMatchesReference) {
+  const double m[9] = {0.9, 0.2, 4.0, -0.1, 1.1, -3.0, 0.001, 0.0015, 1.0};
+  for (const auto border : {alg::BM_CONSTANT, alg::BM_REPLICATE}) {
+    Grey serial(rows, cols), parallel(rows, cols);
+    alg::warp_perspective(grey, serial, m, border, 0, EP_SERIAL);
+    alg::warp_perspective(grey, parallel, m, border, 0, EP_PARALLEL);
+    BOOST_CHECK(equal(serial, parallel));
+    check(grey, serial, border, 0, 1, [&] (double c, double r, double& x,
+                                           double& y) {
+      const double w = m[6] * c + m[7] * r + m[8];
+      x = (m[0] * c + m[1] * r + m[2]) / w;
+      y = (m[3] * c + m[4] * r + m[5]) / w;
+    });
+  }
+}
+
+BOOST_AUTO_TEST_CASE(pointsBehindTheCameraAreOutside) {
+  // The denominator is zero on the column 100, and negative after it.
+  const double m[9] = {1, 0, 0, 0, 1, 0, -0.01, 0, 1};
+  Grey out(40, 200);
+  alg::warp_perspective(grey, out, m, alg::BM_CONSTANT, 123);
+  for (size_t r = 0; r < out.rows(); ++r)
+    BOOST_CHECK(out.data()[r * out.stride() + 100] == 123);
+}
+
+BOOST_AUTO_TEST_CASE(remapMatchesReference) {
+  std::vector<float> mapX(rows * cols), mapY(rows * cols);
+  std::mt19937 gen(3);
+  std::uniform_real_distribution<float> jitter(-2.0f, 2.0f);
+  for (size_t r = 0; r < rows; ++r) {
+    for (size_t c = 0; c < cols; ++c) {
+      mapX[r * cols + c] = 0.8f * c - 10.0f + jitter(gen);
+      mapY[r * cols + c] = 0.7f * r - 8.0f  + jitter(gen);
+    }
+  }
+  for (const auto border : {alg::BM_CONSTANT, alg::BM_REPLICATE}) {
+    Grey serial(rows, cols), parallel(rows, cols);
+    alg::remap(grey, serial, mapX.data(), mapY.data(), border, 50);
+    alg::remap(grey, parallel, mapX.data(), mapY.data(), border, 50, 
+               EP_PARALLEL);
+    BOOST_CHECK(equal(serial, parallel));
+    check(grey, serial, border, 50, 0, [&] (double c, double r, double& x,
+                                            double& y) {
+      x = mapX[size_t(r) * cols + size_t(c)];
+      y = mapY[size_t(r) * cols + size_t(c)];
+    });
+  }
+}
+
+BOOST_AUTO_TEST_CASE(canInvertTransforms) {
+  double m[6], inverse[6];
+  rotation(grey, 0.7, 1.3, m);
+  BOOST_REQUIRE(alg::invert_affine(m, inverse));
+  const double x = 12.5, y = -4.0;
+  const double u = m[0] * x + m[1] * y + m[2];
+  const double v = m[3] * x + m[4] * y + m[5];
+  BOOST_CHECK_CLOSE(inverse[0] * u + inverse[1] * v + inverse[2], x, 1e-9);
+  BOOST_CHECK_CLOSE(inverse[3] * u + inverse[4] * v + inverse[5], y, 1e-9);
+
+  const double p[9] = {0.9, 0.2, 4.0, -0.1, 1.1, -3.0, 0.001, 0.0015, 1.0};
+  double q[9];
+  BOOST_REQUIRE(alg::invert_perspective(p, q));
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      double sum = 0.0;
+      for (size_t k = 0; k < 3; ++k)
+        sum += p[3 * i + k] * q[3 * k + j];
+      BOOST_CHECK_SMALL(sum - (i == j ? 1.0 : 0.0), 1e-12);
+    }
+  }
+
+  const double singular[6] = {1, 2, 0, 2, 4, 0};
+  BOOST_CHECK(!alg::invert_affine(singular, inverse));
+}
+
+BOOST_AUTO_TEST_SUITE_END()